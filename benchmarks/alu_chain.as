@@ -0,0 +1,26 @@
+# A long chain of ALU instructions with a single store at the end
+# Measures the issue rate of the cores without any memory traffic
+
+.blocks 2
+.warps 2
+
+addi x5, x1, 1
+addi x6, x5, 2
+xor x7, x5, x6
+slli x8, x7, 2
+add x9, x8, x5
+sub x10, x9, x6
+or x11, x10, x7
+and x12, x11, x9
+srli x13, x12, 1
+addi x14, x13, 7
+add x15, x14, x11
+xori x16, x15, 255
+sll x17, x16, x5
+slt x18, x17, x16
+add x19, x18, x15
+sub x20, x19, x14
+slli x21, x2, 6
+add x21, x21, x1
+sw x20, 0(x21)
+halt
@@ -0,0 +1,18 @@
+# Only some of the threads access the memory, the rest are masked out
+# Checks that the memory traffic scales with the number of active threads
+
+.blocks 2
+.warps 2
+
+slli x5, x2, 6      # x5 := block_id * 64
+add x5, x5, x1      # x5 := global thread id
+sx.slti s1, x1, 8   # Only threads 0-7 of every warp stay active
+lw x6, 0(x5)
+addi x6, x6, 1
+sw x6, 128(x5)
+s.addi s1, s0, 4095 # Enable every thread again
+sx.slti s1, x1, 24  # Threads 0-23
+lw x7, 0(x5)
+addi x7, x7, 2
+sw x7, 256(x5)
+halt
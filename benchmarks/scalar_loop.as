@@ -0,0 +1,14 @@
+# A loop that is controlled by the scalar registers
+
+.blocks 2
+.warps 2
+
+s.addi s6, s0, 16       # Number of iterations
+loop:
+s.addi s5, s5, 1
+addi x5, x5, 3
+blt s5, s6, loop        # Loop while s5 < s6
+slli x6, x2, 6
+add x6, x6, x1
+sw x5, 0(x6)
+halt
@@ -0,0 +1,14 @@
+# c[i] = a[i] + b[i] for 256 elements
+# a starts at address 0, b at 256 and c at 512
+# Every thread issues two loads and a store, so this is bound by the data memory channels
+
+.blocks 4
+.warps 2
+
+slli x5, x2, 6      # x5 := block_id * 64
+add x5, x5, x1      # x5 := global thread id
+lw x6, 0(x5)        # x6 := a[i]
+lw x7, 256(x5)      # x7 := b[i]
+add x8, x6, x7
+sw x8, 512(x5)      # c[i] := a[i] + b[i]
+halt
@@ -0,0 +1,49 @@
+# Grid indexing shared by the kernel library, linked into every routine (see README)
+#
+# The routines take their arguments from the start of the data memory, word 0 is always the number of blocks the
+# kernel was launched with (the GPU has no register for it) and word 1 the number of elements n.
+#
+# grid_setup, called with `jal s31, grid_setup`:
+#   x4 := global thread id, block_id * block_size + thread_id
+#   x5 := number of threads in the grid, num_blocks * block_size
+#   x6 := n, or 0 for the threads past the block size
+# Every block runs all the warps of a core, the threads past the block size (.warps below the number of warps per
+# core) get the global ids of the next block, so they must not touch memory. x6 lets a routine drop them with the
+# same comparison that drops the threads past the end of the data.
+# Clobbers x7-x10, s29 and s30.
+
+.global grid_setup
+
+.equ ARG_NUM_BLOCKS, 0
+.equ ARG_N, 1
+
+grid_setup:
+    s.lw s29, ARG_NUM_BLOCKS(s0)
+    lw x7, ARG_NUM_BLOCKS(x0)   # x7 := num_blocks, shifted right once per bit
+    mv x8, x2                   # x8 := block_id, ditto
+    mv x9, x3                   # x9 := block_size << bit
+    li x4, 0
+    li x5, 0
+    s.li s30, 1                 # s30 := 1 << bit
+# Shift-add multiplication by the bits of num_blocks, block_id < num_blocks has no more bits than it
+grid_bit:
+    andi x10, x8, 1
+    neg x10, x10                # All ones if the bit of block_id is set
+    and x10, x10, x9
+    add x4, x4, x10
+    andi x10, x7, 1
+    neg x10, x10
+    and x10, x10, x9
+    add x5, x5, x10
+    srli x7, x7, 1
+    srli x8, x8, 1
+    slli x9, x9, 1
+    s.slli s30, s30, 1
+    bge s29, s30, grid_bit      # Until 1 << bit is above num_blocks
+
+    add x4, x4, x1
+    lw x6, ARG_N(x0)
+    slt x10, x1, x3             # 1 for the threads of the block
+    neg x10, x10
+    and x6, x6, x10
+    jalr s0, 0(s31)
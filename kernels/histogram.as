@@ -0,0 +1,100 @@
+# histogram: counts the elements of src by their low bits, bin b gets the src[i] with src[i] & (bins - 1) == b
+#
+# Arguments (data memory words, see grid.as):
+#   0: number of blocks
+#   1: n, the number of elements of pass 0 and of output words of the merges
+#   2: dst
+#   3: src
+#   4: bin shift, bins = 1 << shift, at least 2
+#   5: pass
+#   6: group shift
+# Without atomics every thread counts into a histogram of its own, the launches after that add them up:
+#   pass 0: thread gid clears dst[gid * bins...] and counts its grid-strided elements of src into it
+#   pass 1: merges the histograms of src by groups of 1 << group shift, thread gid sums the bin gid % bins of the
+#           group gid / bins into dst[gid]. One thread per output word, n of them.
+# The launcher merges until a single histogram is left, every merge reading the words past the last histogram as
+# zeros, so each should write to a fresh region.
+
+.blocks 4
+.warps 2
+
+.equ ARG_DST, 2
+.equ ARG_SRC, 3
+.equ ARG_BIN_SHIFT, 4
+.equ ARG_PASS, 5
+.equ ARG_GROUP_SHIFT, 6
+
+    jal s31, grid_setup
+    lw x11, ARG_BIN_SHIFT(x0)
+    li x12, 1
+    sll x12, x12, x11           # x12 := bins
+    addi x13, x12, -1           # x13 := bin mask
+    s.lw s2, ARG_PASS(s0)
+    bne s2, s0, merge
+
+    lw x14, ARG_DST(x0)
+    sll x15, x4, x11
+    add x14, x14, x15           # x14 := histogram of the thread
+    s.lw s3, ARG_BIN_SHIFT(s0)
+    s.li s4, 1
+    s.sll s4, s4, s3            # s4 := bins
+    s.li s5, 0
+    mv x16, x14
+    s.li s1, -1
+    sx.slt s1, x1, x3
+clear:
+    sw x0, 0(x16)
+    sw x0, 1(x16)
+    sw x0, 2(x16)
+    sw x0, 3(x16)
+    addi x16, x16, 4
+    s.addi s5, s5, 4
+    blt s5, s4, clear
+
+    lw x17, ARG_SRC(x0)
+    add x18, x17, x6            # x18 := src + n, src for the threads that sit out
+    add x17, x17, x4            # x17 := &src[gid]
+    s.li s1, -1
+    sx.slt s1, x17, x18
+    beq s1, s0, done
+count:
+    lw x19, 0(x17)
+    and x19, x19, x13
+    add x19, x19, x14
+    lw x20, 0(x19)
+    addi x20, x20, 1
+    sw x20, 0(x19)
+    add x17, x17, x5
+    s.li s1, -1
+    sx.slt s1, x17, x18
+    bne s1, s0, count
+done:
+    halt
+
+merge:
+    lw x14, ARG_GROUP_SHIFT(x0)
+    and x15, x4, x13            # x15 := bin
+    srl x16, x4, x11
+    add x17, x11, x14
+    sll x16, x16, x17           # x16 := first word of the group, (gid / bins) << (group shift + bin shift)
+    lw x18, ARG_SRC(x0)
+    add x18, x18, x16
+    add x18, x18, x15           # x18 := bin of the first histogram of the group
+    lw x19, ARG_DST(x0)
+    add x19, x19, x4            # x19 := &dst[gid]
+    li x20, 0                   # x20 := sum
+    s.lw s3, ARG_GROUP_SHIFT(s0)
+    s.li s4, 1
+    s.sll s4, s4, s3            # s4 := histograms per group
+    s.li s5, 0
+    s.li s1, -1
+    sx.slt s1, x4, x6           # One thread per output word
+    beq s1, s0, done
+sum:
+    lw x21, 0(x18)
+    add x20, x20, x21
+    add x18, x18, x12
+    s.addi s5, s5, 1
+    blt s5, s4, sum
+    sw x20, 0(x19)
+    halt
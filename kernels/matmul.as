@@ -0,0 +1,78 @@
+# matmul: C := A * B, A is M x K, B is K x N and C is M x N, all row-major
+#
+# Arguments (data memory words, see grid.as):
+#   0: number of blocks
+#   1: n, the number of elements of C, M * N
+#   2: C
+#   3: A
+#   4: B, elements below 256
+#   5: K shift, K = 1 << shift
+#   6: N shift, N = 1 << shift
+# Every thread computes the grid-strided elements of C, a row of A times a column of B. The products are shift-adds
+# over the eight bits of the element of B, with the bit turned into a mask instead of a branch so the warp never
+# diverges: 6 instructions per bit.
+
+.blocks 4
+.warps 2
+
+.equ ARG_C, 2
+.equ ARG_A, 3
+.equ ARG_B, 4
+.equ ARG_K_SHIFT, 5
+.equ ARG_N_SHIFT, 6
+
+# x20 += x23 if the low bit of x24 is set
+.macro add_if_bit
+    andi x25, x24, 1
+    neg x25, x25
+    and x25, x25, x23
+    add x20, x20, x25
+.endm
+
+    jal s31, grid_setup
+    lw x11, ARG_K_SHIFT(x0)
+    lw x12, ARG_N_SHIFT(x0)
+    li x13, 1
+    sll x13, x13, x12           # x13 := N, the distance between the elements of a column of B
+    addi x14, x13, -1           # x14 := column mask
+    lw x21, ARG_A(x0)
+    lw x22, ARG_B(x0)
+    lw x15, ARG_C(x0)
+    add x16, x15, x6            # x16 := C + n, C for the threads that sit out
+    add x15, x15, x4            # x15 := &C[gid]
+    mv x17, x4                  # x17 := element index
+    s.lw s2, ARG_K_SHIFT(s0)
+    s.li s3, 1
+    s.sll s3, s3, s2            # s3 := K
+    s.li s1, -1
+    sx.slt s1, x15, x16
+    beq s1, s0, done
+element:
+    srl x18, x17, x12
+    sll x18, x18, x11
+    add x18, x18, x21           # x18 := &A[row][0]
+    and x19, x17, x14
+    add x19, x19, x22           # x19 := &B[0][column]
+    li x20, 0                   # x20 := sum
+    s.li s4, 0
+product:
+    lw x23, 0(x18)
+    lw x24, 0(x19)
+    .rept 7
+    add_if_bit
+    slli x23, x23, 1
+    srli x24, x24, 1
+    .endr
+    add_if_bit
+    addi x18, x18, 1
+    add x19, x19, x13
+    s.addi s4, s4, 1
+    blt s4, s3, product
+    sw x20, 0(x15)
+    add x15, x15, x5
+    add x17, x17, x5
+    s.li s1, -1
+    sx.slt s1, x15, x16
+    bne s1, s0, element
+done:
+    halt
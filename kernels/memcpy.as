@@ -0,0 +1,36 @@
+# memcpy: dst[i] := src[i] for i < n
+#
+# Arguments (data memory words, see grid.as):
+#   0: number of blocks
+#   1: n
+#   2: dst
+#   3: src
+# Every thread copies the elements gid, gid + grid, gid + 2 * grid, ... so the warps access consecutive words.
+# The loop runs on the source pointer alone, one load, one store and five instructions of overhead per element.
+
+.blocks 4
+.warps 2
+
+.equ ARG_DST, 2
+.equ ARG_SRC, 3
+
+    jal s31, grid_setup
+    lw x11, ARG_SRC(x0)
+    lw x12, ARG_DST(x0)
+    add x13, x11, x6            # x13 := src + n, src for the threads that sit out
+    add x11, x11, x4            # x11 := &src[gid]
+    add x12, x12, x4            # x12 := &dst[gid]
+    s.li s1, -1
+    sx.slt s1, x11, x13
+    beq s1, s0, done
+loop:
+    lw x14, 0(x11)
+    sw x14, 0(x12)
+    add x11, x11, x5
+    add x12, x12, x5
+    # Every thread compares, the RTL keeps a stale result for the threads that are masked out
+    s.li s1, -1
+    sx.slt s1, x11, x13
+    bne s1, s0, loop
+done:
+    halt
@@ -0,0 +1,32 @@
+# memset: dst[i] := value for i < n
+#
+# Arguments (data memory words, see grid.as):
+#   0: number of blocks
+#   1: n
+#   2: dst
+#   3: value
+# Grid-strided like memcpy.as, a store and four instructions of overhead per element.
+
+.blocks 4
+.warps 2
+
+.equ ARG_DST, 2
+.equ ARG_VALUE, 3
+
+    jal s31, grid_setup
+    lw x11, ARG_DST(x0)
+    lw x12, ARG_VALUE(x0)
+    add x13, x11, x6            # x13 := dst + n, dst for the threads that sit out
+    add x11, x11, x4            # x11 := &dst[gid]
+    s.li s1, -1
+    sx.slt s1, x11, x13
+    beq s1, s0, done
+loop:
+    sw x12, 0(x11)
+    add x11, x11, x5
+    # Every thread compares, the RTL keeps a stale result for the threads that are masked out
+    s.li s1, -1
+    sx.slt s1, x11, x13
+    bne s1, s0, loop
+done:
+    halt
@@ -0,0 +1,90 @@
+# reduce: dst[w] := the sum of the elements the warp w of the grid visited, sum of src[i] for i < n over every w
+#
+# Arguments (data memory words, see grid.as):
+#   0: number of blocks
+#   1: n
+#   2: dst, one word per warp of the grid
+#   3: src
+#   4: scratch, one word per thread of the grid
+# There is no way to synchronize the warps of a grid, so it takes two launches to get to a single sum: the grid,
+# then a single warp (1 block of 1 warp) on the sums of the first launch. Every thread accumulates its
+# grid-strided elements in a register, then the warp adds them up in a tree through the scratch words, which needs
+# no synchronization since the loads and stores of a warp complete before its next instruction.
+# Assumes warps of 32 threads.
+
+.blocks 4
+.warps 2
+
+.equ ARG_DST, 2
+.equ ARG_SRC, 3
+.equ ARG_SCRATCH, 4
+
+    jal s31, grid_setup
+    lw x11, ARG_SRC(x0)
+    add x13, x11, x6            # x13 := src + n, src for the threads that sit out
+    add x11, x11, x4            # x11 := &src[gid]
+    li x14, 0                   # x14 := sum of the thread
+    s.li s1, -1
+    sx.slt s1, x11, x13
+    beq s1, s0, tree
+loop:
+    lw x15, 0(x11)
+    add x14, x14, x15
+    add x11, x11, x5
+    # Every thread compares, the RTL keeps a stale result for the threads that are masked out
+    s.li s1, -1
+    sx.slt s1, x11, x13
+    bne s1, s0, loop
+
+# Step k adds the sum of the thread 2^k lanes up to the threads whose lane is a multiple of 2^(k+1). The threads
+# that sit out get an odd key so they never take part.
+tree:
+    s.li s1, -1
+    lw x16, ARG_SCRATCH(x0)
+    add x16, x16, x4            # x16 := &scratch[gid]
+    andi x17, x1, 31
+    slt x18, x1, x3
+    xori x18, x18, 1
+    or x17, x17, x18            # x17 := lane, odd for the threads that sit out
+    sx.slt s1, x1, x3
+    sw x14, 0(x16)
+
+    s.li s1, -1
+    andi x18, x17, 1
+    sx.slti s1, x18, 1
+    lw x15, 1(x16)
+    add x14, x14, x15
+    sw x14, 0(x16)
+
+    s.li s1, -1
+    andi x18, x17, 3
+    sx.slti s1, x18, 1
+    lw x15, 2(x16)
+    add x14, x14, x15
+    sw x14, 0(x16)
+
+    s.li s1, -1
+    andi x18, x17, 7
+    sx.slti s1, x18, 1
+    lw x15, 4(x16)
+    add x14, x14, x15
+    sw x14, 0(x16)
+
+    s.li s1, -1
+    andi x18, x17, 15
+    sx.slti s1, x18, 1
+    lw x15, 8(x16)
+    add x14, x14, x15
+    sw x14, 0(x16)
+
+    # Only lane 0 is left
+    s.li s1, -1
+    andi x18, x17, 31
+    sx.slti s1, x18, 1
+    lw x15, 16(x16)
+    add x14, x14, x15
+    lw x19, ARG_DST(x0)
+    srli x20, x4, 5
+    add x19, x19, x20
+    sw x14, 0(x19)              # dst[gid / 32]
+    halt
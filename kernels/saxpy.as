@@ -0,0 +1,99 @@
+# saxpy: y[i] := a * x[i] + y[i] for i < n, with a below 2^16
+#
+# Arguments (data memory words, see grid.as):
+#   0: number of blocks
+#   1: n
+#   2: y
+#   3: x
+#   4: a
+# There is no multiply, a is the same for every thread so the product is a ladder of shift-adds, one rung per bit
+# of a. The prologue links the rungs of the set bits of a in s10-s25, every rung jumps to the one of the next lower
+# set bit, the last to the store. An element costs ten instructions and three per set bit of a.
+
+.blocks 4
+.warps 2
+
+.equ ARG_Y, 2
+.equ ARG_X, 3
+.equ ARG_A, 4
+
+# y += x << shift, then on to the rung in `next`
+.macro rung shift, next
+    slli x20, x11, shift
+    add x12, x12, x20
+    jalr s0, 0(next)
+.endm
+
+# Links the rung of the next bit of a (in s3), which sits at s2 + address: `next` gets the lowest set bit so far in
+# s4, which becomes this rung if the bit is set. Done once a has no set bits left.
+.macro link_bit next, address
+    s.mv next, s4
+    s.andi s5, s3, 1
+    beq s5, s0, 2
+    s.addi s4, s2, address
+    s.srli s3, s3, 1
+    beq s3, s0, ladder_ready
+.endm
+
+    jal s31, grid_setup
+    jal s2, ladder_setup        # s2 := address of the ladder
+ladder:
+    rung 15, s25
+    rung 14, s24
+    rung 13, s23
+    rung 12, s22
+    rung 11, s21
+    rung 10, s20
+    rung 9, s19
+    rung 8, s18
+    rung 7, s17
+    rung 6, s16
+    rung 5, s15
+    rung 4, s14
+    rung 3, s13
+    rung 2, s12
+    rung 1, s11
+    rung 0, s10
+store:
+    sw x12, 0(x14)
+    add x13, x13, x5
+    add x14, x14, x5
+    s.li s1, -1
+    sx.slt s1, x13, x15
+    beq s1, s0, done
+loop:
+    lw x11, 0(x13)
+    lw x12, 0(x14)
+    jalr s0, 0(s4)              # Through the rungs to the store
+done:
+    halt
+
+ladder_setup:
+    s.lw s3, ARG_A(s0)
+    s.addi s4, s2, 48           # s4 := the store, a has no set bits so far
+    link_bit s10, 45
+    link_bit s11, 42
+    link_bit s12, 39
+    link_bit s13, 36
+    link_bit s14, 33
+    link_bit s15, 30
+    link_bit s16, 27
+    link_bit s17, 24
+    link_bit s18, 21
+    link_bit s19, 18
+    link_bit s20, 15
+    link_bit s21, 12
+    link_bit s22, 9
+    link_bit s23, 6
+    link_bit s24, 3
+    link_bit s25, 0
+ladder_ready:
+    lw x13, ARG_X(x0)
+    lw x14, ARG_Y(x0)
+    add x15, x13, x6            # x15 := x + n, x for the threads that sit out
+    add x13, x13, x4            # x13 := &x[gid]
+    add x14, x14, x4            # x14 := &y[gid]
+    s.li s1, -1
+    sx.slt s1, x13, x15
+    beq s1, s0, done
+    j loop
@@ -0,0 +1,150 @@
+# scan: dst[i] := src[0] + src[1] + ... + src[i] for i < n, the inclusive prefix sum
+#
+# Arguments (data memory words, see grid.as):
+#   0: number of blocks
+#   1: n
+#   2: dst
+#   3: src
+#   4: sums, one word per warp of the grid
+#   5: chunk shift, every warp of the grid scans 1 << shift consecutive elements, at least 5 and enough for n
+#   6: pass
+# Three launches, the warps of a grid can't wait on each other:
+#   pass 0, the grid: every warp scans its chunk a tile of 32 elements at a time and writes its total to sums[w]
+#   pass 1, 1 block of 1 warp with n the number of warps of pass 0, at most 32: scans sums in place
+#   pass 2, the grid: every warp adds sums[w - 1] to its chunk of dst
+# A tile is a Hillis-Steele scan through dst, step k adds the element 2^k to the left to every lane that has one.
+# The loads and stores of a warp complete before its next instruction, so a step sees all of the previous one.
+# Assumes warps of 32 threads.
+
+.blocks 4
+.warps 2
+
+.equ ARG_DST, 2
+.equ ARG_SRC, 3
+.equ ARG_SUMS, 4
+.equ ARG_CHUNK_SHIFT, 5
+.equ ARG_PASS, 6
+
+# One step, offset is minus the distance and bound 32 + offset: the lanes with x22 < bound add the element at
+# x17 + offset to x23 and store it at x17
+.macro scan_step offset, bound
+    s.li s1, -1
+    sx.slti s1, x22, bound
+    lw x24, offset(x17)
+    add x23, x23, x24
+    sw x23, 0(x17)
+.endm
+
+# x22 := 31 - lane for the lanes with x15 < n, 32 otherwise, lane l takes part in the steps at a distance <= l
+.macro scan_key
+    s.li s1, -1
+    slt x21, x15, x6
+    xori x21, x21, 1
+    slli x21, x21, 5
+    or x22, x18, x21
+.endm
+
+    jal s31, grid_setup
+    andi x14, x1, 31            # x14 := lane
+    li x18, 31
+    sub x18, x18, x14           # x18 := 31 - lane
+    s.lw s2, ARG_PASS(s0)
+    s.li s3, 1
+    beq s2, s3, scan_sums
+
+    lw x11, ARG_CHUNK_SHIFT(x0)
+    srli x12, x4, 5             # x12 := warp index w
+    sll x15, x12, x11
+    add x15, x15, x14           # x15 := index of the element of the lane in the tile
+    lw x17, ARG_DST(x0)
+    add x17, x17, x15           # x17 := &dst[x15]
+    s.lw s4, ARG_CHUNK_SHIFT(s0)
+    s.addi s4, s4, -5
+    s.li s5, 1
+    s.sll s5, s5, s4            # s5 := tiles per chunk
+    s.li s6, 0                  # s6 := tile
+    s.li s3, 2
+    beq s2, s3, add_offsets
+
+    lw x16, ARG_SRC(x0)
+    add x16, x16, x15           # x16 := &src[x15]
+    li x19, 0                   # x19 := carry, the sum of the tiles so far
+    slti x20, x14, 1
+    neg x20, x20                # x20 := all ones on lane 0
+    addi x25, x6, -1            # x25 := n - 1
+    sub x26, x15, x14
+    addi x26, x26, 31           # x26 := index of the last element of the tile
+tile:
+    scan_key
+    sx.slt s1, x15, x6
+    beq s1, s0, tiles_done      # The rest of the chunk is past n too
+    lw x23, 0(x16)
+    and x24, x19, x20
+    add x23, x23, x24
+    sw x23, 0(x17)
+    scan_step -1, 31
+    scan_step -2, 30
+    scan_step -4, 28
+    scan_step -8, 24
+    scan_step -16, 16
+    # The carry is the last element of the tile, or the element n - 1 when the tile is the last one
+    s.li s1, -1
+    slt x21, x25, x26
+    neg x21, x21
+    sub x22, x25, x26
+    and x22, x22, x21
+    add x22, x22, x26
+    sub x22, x22, x15
+    add x22, x22, x17
+    lw x19, 0(x22)
+    addi x15, x15, 32
+    addi x16, x16, 32
+    addi x17, x17, 32
+    addi x26, x26, 32
+    s.addi s6, s6, 1
+    blt s6, s5, tile
+tiles_done:
+    s.li s1, -1
+    slt x21, x1, x3
+    and x21, x21, x20
+    sx.slt s1, x0, x21          # Lane 0 of the warps of the blocks
+    lw x22, ARG_SUMS(x0)
+    add x22, x22, x12
+    sw x19, 0(x22)
+    halt
+
+# A single tile, the lanes are the warps of pass 0
+scan_sums:
+    lw x17, ARG_SUMS(x0)
+    add x17, x17, x4            # x17 := &sums[lane]
+    mv x15, x4
+    scan_key
+    sx.slt s1, x15, x6
+    lw x23, 0(x17)
+    scan_step -1, 31
+    scan_step -2, 30
+    scan_step -4, 28
+    scan_step -8, 24
+    scan_step -16, 16
+    halt
+
+add_offsets:
+    s.li s1, -1
+    sx.slt s7, x0, x12
+    beq s7, s0, done            # Nothing to add to the first chunk
+    lw x20, ARG_SUMS(x0)
+    add x20, x20, x12
+    lw x19, -1(x20)             # x19 := sums[w - 1]
+offset_tile:
+    s.li s1, -1
+    sx.slt s1, x15, x6
+    beq s1, s0, done
+    lw x23, 0(x17)
+    add x23, x23, x19
+    sw x23, 0(x17)
+    addi x15, x15, 32
+    addi x17, x17, 32
+    s.addi s6, s6, 1
+    blt s6, s5, offset_tile
+done:
+    halt
@@ -0,0 +1,274 @@
+#include "analyzer.hpp"
+#include "dataflow.hpp"
+#include <algorithm>
+#include <bitset>
+#include <format>
+
+namespace as {
+
+namespace {
+
+using parser::Instruction;
+
+// One bit per register, the scalar registers come after the vector ones
+using RegisterSet = std::bitset<2 * sim::WarpState::NUM_REGISTERS>;
+
+auto bit(const sim::Register &reg) -> std::size_t {
+    return reg.register_number + (reg.is_scalar() ? sim::WarpState::NUM_REGISTERS : 0u);
+}
+
+auto to_registers(const RegisterSet &set) -> std::vector<sim::Register> {
+    auto registers = std::vector<sim::Register>{};
+    for (auto i = 0u; i < set.size(); i++) {
+        if (set.test(i)) {
+            const auto is_scalar = i >= sim::WarpState::NUM_REGISTERS;
+            registers.push_back({.register_number = i % sim::WarpState::NUM_REGISTERS,
+                                 .type = is_scalar ? sim::RegisterType::SCALAR : sim::RegisterType::VECTOR});
+        }
+    }
+    return registers;
+}
+
+auto classify(const Instruction &instruction) -> InstructionMix {
+    auto mix = InstructionMix{};
+    if (instruction.mnemonic.is_vector_scalar()) {
+        mix.vector_scalar = 1;
+    } else if (instruction.mnemonic.is_scalar() || is_halt(instruction)) {
+        mix.scalar = 1;
+    } else {
+        mix.vector = 1;
+    }
+
+    if (is_load(instruction)) {
+        mix.loads = 1;
+    } else if (is_store(instruction)) {
+        mix.stores = 1;
+    } else if (is_control_transfer(instruction)) {
+        mix.control = 1;
+    } else {
+        mix.alu = 1;
+    }
+    return mix;
+}
+
+struct InstructionCost {
+    std::uint64_t busy;    // DECODE through UPDATE
+    std::uint64_t channel; // Cycles of data memory channel occupancy
+};
+
+auto cost(const Instruction &instruction, const AnalyzerOptions &options) -> InstructionCost {
+    const auto &timing = options.timing;
+    if (!is_load(instruction) && !is_store(instruction)) {
+        return {.busy = timing.issue_cycles + timing.alu_wait_cycles + timing.retire_cycles, .channel = 0};
+    }
+    // A scalar access is a single request, a vector one a request per thread spread over the channels
+    const auto requests = instruction.mnemonic.is_scalar() ? 1u : options.threads_per_warp;
+    const auto channels = std::max(options.shape.data_mem_channels, 1u);
+    const auto rounds = (requests + channels - 1) / channels;
+    const auto wait = timing.memory_latency + (std::uint64_t)(rounds - 1) * timing.channel_occupancy;
+    return {.busy = timing.issue_cycles + wait + timing.retire_cycles,
+            .channel = (std::uint64_t)requests * timing.channel_occupancy};
+}
+
+// Basic blocks the last instruction of the one ending at `end` may continue with
+auto successors(const parser::Program &program, std::uint32_t end, std::span<const std::uint32_t> block_of)
+    -> std::vector<std::uint32_t> {
+    const auto size = (std::uint32_t)program.instructions.size();
+    const auto &last = program.instructions[end - 1];
+    auto result = std::vector<std::uint32_t>{};
+    auto add_index = [&](std::int64_t index) {
+        if (index >= 0 && index < (std::int64_t)size) {
+            result.push_back(block_of[(std::size_t)index]);
+        }
+    };
+
+    if (is_halt(last)) {
+        return result;
+    }
+    if (const auto *jalr = std::get_if<parser::JalrOperands>(&last.operands); jalr != nullptr) {
+        if (const auto *label = std::get_if<token::LabelRef>(&jalr->immediate_or_label_ref); label != nullptr) {
+            add_index(program.label_mappings.at(label->label_name));
+        } else {
+            // Through a register, could be anywhere
+            for (auto index = 0u; index < size; index++) {
+                add_index(index);
+            }
+        }
+        return result;
+    }
+    if (const auto target = target_index(program, end - 1); target.has_value()) {
+        add_index(*target);
+    }
+    if (!last.mnemonic.is_jump()) {
+        add_index(end);
+    }
+    return result;
+}
+
+auto registers_read(const Instruction &instruction) -> RegisterSet {
+    auto set = RegisterSet{};
+    for (const auto &source : operand_sources(instruction)) {
+        if (!is_read_only(source) && source != EXECUTION_MASK) {
+            set.set(bit(source));
+        }
+    }
+    return set;
+}
+
+auto register_written(const Instruction &instruction) -> RegisterSet {
+    auto set = RegisterSet{};
+    if (const auto rd = destination(instruction); rd.has_value() && !is_read_only(*rd) && *rd != EXECUTION_MASK) {
+        set.set(bit(*rd));
+    }
+    return set;
+}
+
+} // namespace
+
+auto InstructionMix::arithmetic_intensity() const -> std::optional<double> {
+    if (loads + stores == 0) {
+        return std::nullopt;
+    }
+    return (double)alu / (double)(loads + stores);
+}
+
+auto InstructionMix::operator+=(const InstructionMix &other) -> InstructionMix & {
+    vector += other.vector;
+    scalar += other.scalar;
+    vector_scalar += other.vector_scalar;
+    alu += other.alu;
+    loads += other.loads;
+    stores += other.stores;
+    control += other.control;
+    return *this;
+}
+
+auto analyze(const parser::Program &program, const AnalyzerOptions &options) -> KernelAnalysis {
+    const auto size = (std::uint32_t)program.instructions.size();
+    auto analysis = KernelAnalysis{.blocks = program.blocks, .warps = program.warps, .mix = {}, .basic_blocks = {}, .cycles = 0};
+    if (size == 0) {
+        return analysis;
+    }
+
+    const auto starts = find_block_starts(program);
+    auto block_of = std::vector<std::uint32_t>(size);
+    for (auto i = 0u; i < size; i++) {
+        if (starts[i]) {
+            analysis.basic_blocks.push_back(BasicBlockAnalysis{.begin = i, .end = size, .labels = {}, .mix = {},
+                                                               .live_across_loads = {}, .warp_cycles = 0, .busy_cycles = 0});
+            if (analysis.basic_blocks.size() > 1) {
+                analysis.basic_blocks[analysis.basic_blocks.size() - 2].end = i;
+            }
+        }
+        block_of[i] = (std::uint32_t)analysis.basic_blocks.size() - 1;
+    }
+    for (const auto &[label, index] : program.label_mappings) {
+        if (index < size) {
+            analysis.basic_blocks[block_of[index]].labels.push_back(label);
+        }
+    }
+    for (auto &block : analysis.basic_blocks) {
+        std::ranges::sort(block.labels);
+    }
+
+    // Backwards liveness until nothing changes, in reverse order as most edges go forward
+    const auto num_blocks = analysis.basic_blocks.size();
+    auto live_in = std::vector<RegisterSet>(num_blocks);
+    auto live_out = std::vector<RegisterSet>(num_blocks);
+    auto block_successors = std::vector<std::vector<std::uint32_t>>(num_blocks);
+    for (auto b = 0u; b < num_blocks; b++) {
+        block_successors[b] = successors(program, analysis.basic_blocks[b].end, block_of);
+    }
+    for (auto changed = true; changed;) {
+        changed = false;
+        for (auto b = num_blocks; b-- > 0;) {
+            auto live = RegisterSet{};
+            for (const auto successor : block_successors[b]) {
+                live |= live_in[successor];
+            }
+            live_out[b] = live;
+            const auto &block = analysis.basic_blocks[b];
+            for (auto i = block.end; i-- > block.begin;) {
+                live = (live & ~register_written(program.instructions[i])) | registers_read(program.instructions[i]);
+            }
+            if (live != live_in[b]) {
+                live_in[b] = live;
+                changed = true;
+            }
+        }
+    }
+
+    auto kernel_busy = std::uint64_t{0};
+    auto kernel_latency = std::uint64_t{0};
+    auto kernel_channel = std::uint64_t{0};
+    for (auto b = 0u; b < num_blocks; b++) {
+        auto &block = analysis.basic_blocks[b];
+        auto live = live_out[b];
+        auto across_loads = RegisterSet{};
+        for (auto i = block.end; i-- > block.begin;) {
+            const auto &instruction = program.instructions[i];
+            const auto written = register_written(instruction);
+            if (is_load(instruction)) {
+                across_loads |= live & ~written;
+            }
+            live = (live & ~written) | registers_read(instruction);
+
+            block.mix += classify(instruction);
+            const auto [busy, channel] = cost(instruction, options);
+            block.busy_cycles += busy;
+            block.warp_cycles += options.timing.fetch_cycles + busy;
+            kernel_channel += channel;
+        }
+        block.live_across_loads = to_registers(across_loads);
+
+        analysis.mix += block.mix;
+        kernel_busy += block.busy_cycles;
+        kernel_latency += block.warp_cycles;
+    }
+
+    // The warps of a block share the core, while one waits on its fetch another one can run
+    const auto warps = (std::uint64_t)std::max(options.warps_per_core, 1u);
+    const auto cores = (std::uint64_t)std::max(options.shape.num_cores, 1u);
+    const auto channels = (std::uint64_t)std::max(options.shape.data_mem_channels, 1u);
+    const auto blocks = (std::uint64_t)std::max(program.blocks, 1u);
+    const auto concurrent = std::min(blocks, cores);
+    const auto per_block = std::max({warps * kernel_busy, kernel_latency, concurrent * warps * kernel_channel / channels});
+    const auto rounds = (blocks + cores - 1) / cores;
+    analysis.cycles = rounds * (options.timing.dispatch_cycles + per_block) + options.timing.drain_cycles;
+    return analysis;
+}
+
+auto dump_analysis(const parser::Program &program, const KernelAnalysis &analysis) -> std::string {
+    auto format_mix = [](const InstructionMix &mix) {
+        const auto intensity = mix.arithmetic_intensity();
+        return std::format("  {} instructions: {} vector, {} scalar, {} vector-scalar\n"
+                           "  {} alu, {} loads, {} stores, {} control, arithmetic intensity {}\n",
+                           mix.total(), mix.vector, mix.scalar, mix.vector_scalar, mix.alu, mix.loads, mix.stores,
+                           mix.control, intensity.has_value() ? std::format("{:.2f}", *intensity) : "-");
+    };
+
+    auto result = std::format("Kernel: {} blocks of {} warps, {} basic blocks, estimated {} cycles\n", analysis.blocks,
+                              analysis.warps, analysis.basic_blocks.size(), analysis.cycles);
+    result += format_mix(analysis.mix);
+    for (const auto &block : analysis.basic_blocks) {
+        auto labels = std::string{};
+        for (const auto &label : block.labels) {
+            labels += std::format(" {}:", label);
+        }
+        result += std::format("Block {}-{} (lines {}-{}){}\n", block.begin, block.end - 1,
+                              program.instructions[block.begin].line, program.instructions[block.end - 1].line, labels);
+        result += format_mix(block.mix);
+        if (!block.live_across_loads.empty()) {
+            auto registers = std::string{};
+            for (const auto &reg : block.live_across_loads) {
+                registers += std::format("{}{}", registers.empty() ? "" : ", ", reg.to_str());
+            }
+            result += std::format("  live across loads: {}\n", registers);
+        }
+        result += std::format("  {} cycles for a single warp, {} of them on the core\n", block.warp_cycles,
+                              block.busy_cycles);
+    }
+    return result;
+}
+
+} // namespace as
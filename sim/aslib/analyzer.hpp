@@ -0,0 +1,75 @@
+#pragma once
+
+#include "parser.hpp"
+#include "timing_model.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace as {
+
+struct AnalyzerOptions {
+    sim::GpuShape shape{};
+    std::uint32_t warps_per_core = 2; // Every block runs this many warps (WARPS_PER_CORE in compute_core.sv)
+    std::uint32_t threads_per_warp = 32;
+    sim::TimingParameters timing{};
+};
+
+struct InstructionMix {
+    // By where the instruction executes, every instruction is counted in one of these
+    std::uint32_t vector{};
+    std::uint32_t scalar{};        // s. instructions, branches, jumps and halt
+    std::uint32_t vector_scalar{}; // sx.slt and sx.slti, which compare vector registers into a scalar one
+    // and by what it does
+    std::uint32_t alu{};
+    std::uint32_t loads{};
+    std::uint32_t stores{};
+    std::uint32_t control{}; // Branches, jumps and halt
+
+    [[nodiscard]] auto total() const -> std::uint32_t { return vector + scalar + vector_scalar; }
+
+    // ALU instructions per memory access, std::nullopt without memory accesses
+    [[nodiscard]] auto arithmetic_intensity() const -> std::optional<double>;
+
+    auto operator+=(const InstructionMix &other) -> InstructionMix &;
+};
+
+struct BasicBlockAnalysis {
+    std::uint32_t begin; // Index of the first instruction
+    std::uint32_t end;   // One past the last instruction
+    std::vector<std::string_view> labels;
+    InstructionMix mix;
+    // Registers holding a value that is still needed after one of the loads in the block, so it can't be reused to
+    // hide the load latency. Read-only registers and the execution mask are left out.
+    std::vector<sim::Register> live_across_loads;
+    std::uint64_t warp_cycles; // A single warp going through the block on its own, instruction fetches included
+    std::uint64_t busy_cycles; // Cycles the core is occupied by one warp going through the block
+};
+
+struct KernelAnalysis {
+    std::uint32_t blocks;
+    std::uint32_t warps;
+    InstructionMix mix;
+    std::vector<BasicBlockAnalysis> basic_blocks;
+    std::uint64_t cycles; // Static estimate of the whole kernel, see analyze()
+};
+
+// Static analysis of a kernel, without executing it
+//
+// The cycle estimate charges every instruction the costs of the warp state machine in compute_core.sv and every
+// memory request the latency and channel occupancy of mem_controller.sv, with the parameters of the timing model
+// (timing_model.hpp). Vector memory instructions are assumed to have every thread active. Trip counts aren't known,
+// so every basic block is counted once. A core takes the longest of running its warps back to back, a single warp
+// waiting on its own fetches and its share of the data memory channels, and the blocks are spread evenly over the
+// cores.
+//
+// Liveness is computed over the control flow graph of the basic blocks, a jalr through a register may go to any of
+// them.
+auto analyze(const parser::Program &program, const AnalyzerOptions &options = {}) -> KernelAnalysis;
+
+// Human readable report of `analysis`, one section per basic block
+auto dump_analysis(const parser::Program &program, const KernelAnalysis &analysis) -> std::string;
+
+} // namespace as
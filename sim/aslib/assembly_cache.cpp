@@ -0,0 +1,202 @@
+#include "assembly_cache.hpp"
+#include "emitter.hpp"
+#include "parser.hpp"
+#include <bit>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <thread>
+#include <unistd.h>
+
+// Set by CMake from the assembler sources (sim/aslib/CMakeLists.txt)
+#ifndef ASSEMBLER_VERSION
+#define ASSEMBLER_VERSION __DATE__ " " __TIME__
+#endif
+
+namespace as {
+
+auto assembler_version() -> std::string_view { return ASSEMBLER_VERSION; }
+
+auto hash_source(std::string_view source) -> std::uint64_t {
+    constexpr auto prime1 = 0x9E3779B185EBCA87ull;
+    constexpr auto prime2 = 0xC2B2AE3D27D4EB4Full;
+
+    auto hash = 0xcbf29ce484222325ull ^ (source.size() * prime1);
+    auto step = [&](std::uint64_t word) { hash = std::rotl(hash ^ (word * prime2), 31) * prime1; };
+
+    auto i = std::size_t{0};
+    for (; i + sizeof(std::uint64_t) <= source.size(); i += sizeof(std::uint64_t)) {
+        auto word = std::uint64_t{};
+        std::memcpy(&word, source.data() + i, sizeof(word));
+        step(word);
+    }
+    if (i < source.size()) {
+        auto word = std::uint64_t{};
+        std::memcpy(&word, source.data() + i, source.size() - i);
+        step(word);
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+auto sha256(std::string_view source) -> std::array<std::uint8_t, 32> {
+    constexpr auto round_constants = std::array<std::uint32_t, 64>{
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    auto state = std::array<std::uint32_t, 8>{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                              0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    auto compress = [&](const std::uint8_t *block) {
+        auto w = std::array<std::uint32_t, 64>{};
+        for (auto i = 0u; i < 16; i++) {
+            w[i] = (std::uint32_t)block[4 * i] << 24u | (std::uint32_t)block[4 * i + 1] << 16u |
+                   (std::uint32_t)block[4 * i + 2] << 8u | (std::uint32_t)block[4 * i + 3];
+        }
+        for (auto i = 16u; i < 64; i++) {
+            const auto s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3u);
+            const auto s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10u);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        auto [a, b, c, d, e, f, g, h] = state;
+        for (auto i = 0u; i < 64; i++) {
+            const auto t1 = h + (std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                            round_constants[i] + w[i];
+            const auto t2 = (std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        const auto result = std::array<std::uint32_t, 8>{a, b, c, d, e, f, g, h};
+        for (auto i = 0u; i < 8; i++) {
+            state[i] += result[i];
+        }
+    };
+
+    const auto *const bytes = reinterpret_cast<const std::uint8_t *>(source.data());
+    auto i = std::size_t{0};
+    for (; i + 64 <= source.size(); i += 64) {
+        compress(bytes + i);
+    }
+
+    // The rest, a one bit, zeros and the length in bits fill one or two more blocks
+    auto tail = std::array<std::uint8_t, 128>{};
+    const auto rest = source.size() - i;
+    std::memcpy(tail.data(), bytes + i, rest);
+    tail[rest] = 0x80;
+    const auto tail_size = rest + 9 <= 64 ? 64u : 128u;
+    const auto bit_length = (std::uint64_t)source.size() * 8u;
+    for (auto byte = 0u; byte < 8; byte++) {
+        tail[tail_size - 1 - byte] = (std::uint8_t)(bit_length >> (8u * byte));
+    }
+    for (auto block = 0u; block < tail_size; block += 64) {
+        compress(tail.data() + block);
+    }
+
+    auto digest = std::array<std::uint8_t, 32>{};
+    for (auto word = 0u; word < 8; word++) {
+        for (auto byte = 0u; byte < 4; byte++) {
+            digest[4 * word + byte] = (std::uint8_t)(state[word] >> (24u - 8u * byte));
+        }
+    }
+    return digest;
+}
+
+AssemblyCache::AssemblyCache(std::optional<std::filesystem::path> directory)
+    : directory(std::move(directory)), version_hash(hash_source(assembler_version())) {
+    if (this->directory) {
+        auto ec = std::error_code{};
+        std::filesystem::create_directories(*this->directory, ec);
+    }
+}
+
+auto AssemblyCache::assemble(std::string_view source, std::uint32_t num_threads) -> Result {
+    {
+        const auto lock = std::scoped_lock{mutex};
+        if (const auto entry = entries.find(source); entry != entries.end()) {
+            counters.memory_hits++;
+            return entry->second;
+        }
+    }
+
+    const auto path = directory ? object_path(source) : std::filesystem::path{};
+    auto contents = load_from_disk(path);
+    if (contents) {
+        const auto lock = std::scoped_lock{mutex};
+        counters.disk_hits++;
+        return entries.try_emplace(std::string{source}, std::move(contents)).first->second;
+    }
+
+    auto arena = Arena{};
+    const auto program = parse_program_parallel(source, num_threads, &arena);
+    if (!program) {
+        return std::unexpected{program.error()};
+    }
+    const auto machine_code = translate_to_binary(*program, num_threads);
+    contents = std::make_shared<const sim::KernelObjectContents>(make_kernel_object(*program, machine_code));
+    store_to_disk(path, *contents);
+
+    const auto lock = std::scoped_lock{mutex};
+    counters.misses++;
+    return entries.try_emplace(std::string{source}, std::move(contents)).first->second;
+}
+
+auto AssemblyCache::stats() const -> Stats {
+    const auto lock = std::scoped_lock{mutex};
+    return counters;
+}
+
+auto AssemblyCache::object_path(std::string_view source) const -> std::filesystem::path {
+    auto name = std::string{};
+    for (const auto byte : sha256(source)) {
+        name += std::format("{:02x}", byte);
+    }
+    return *directory / std::format("{}-{:016x}.kobj", name, version_hash);
+}
+
+auto AssemblyCache::load_from_disk(const std::filesystem::path &path) const -> std::shared_ptr<const sim::KernelObjectContents> {
+    if (!directory) {
+        return nullptr;
+    }
+    // Missing, truncated or written by an incompatible version, either way it gets assembled and replaced
+    const auto object = sim::KernelObject::load(path);
+    if (!object) {
+        return nullptr;
+    }
+    return std::make_shared<const sim::KernelObjectContents>(object->contents());
+}
+
+void AssemblyCache::store_to_disk(const std::filesystem::path &path, const sim::KernelObjectContents &contents) const {
+    if (!directory) {
+        return;
+    }
+    // Written under a unique name and renamed into place, so concurrent readers never see a partial object
+    auto temporary = path;
+    temporary += std::format(".{}.{}.tmp", ::getpid(), std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+    auto ec = std::error_code{};
+    if (!sim::write_kernel_object(temporary, contents)) {
+        std::filesystem::remove(temporary, ec);
+        return;
+    }
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+    }
+}
+
+} // namespace as
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "common.hpp"
+#include "error.hpp"
+#include "kernel_object.hpp"
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace as {
+
+// Identifies the assembler build. CMake derives it from the contents of the assembler sources, so any change to
+// the assembler gives a new version and never reuses results cached by an older one.
+auto assembler_version() -> std::string_view;
+
+// Fast non-cryptographic 64-bit hash of the source bytes, eight bytes per step
+auto hash_source(std::string_view source) -> std::uint64_t;
+
+// SHA-256 of the source bytes, objects on disk can't be compared with their source so they are named after it
+auto sha256(std::string_view source) -> std::array<std::uint8_t, 32>;
+
+// Content-addressed cache of assembled kernels
+//
+// Results are kept in memory for the lifetime of the cache, keyed on the whole source so a hit never depends on
+// hashes alone. With a directory they are also stored there as kernel objects named after the SHA-256 of the source
+// and the assembler version, so other processes (e.g. the runs of a sweep) can pick them up without assembling.
+// Sources with errors are never cached.
+class AssemblyCache {
+  public:
+    using Result = std::expected<std::shared_ptr<const sim::KernelObjectContents>, std::vector<sim::Error>>;
+
+    struct Stats {
+        std::uint64_t memory_hits = 0;
+        std::uint64_t disk_hits = 0;
+        std::uint64_t misses = 0;
+    };
+
+    explicit AssemblyCache(std::optional<std::filesystem::path> directory = std::nullopt);
+
+    // Returns the cached machine code and metadata of `source`, assembling it (on up to num_threads threads)
+    // only if neither the memory nor the disk cache has it
+    auto assemble(std::string_view source, std::uint32_t num_threads = 1) -> Result;
+
+    [[nodiscard]] auto stats() const -> Stats;
+
+  private:
+    // Looks sources up by string_view without copying them into a key
+    struct SourceHash {
+        using is_transparent = void;
+        auto operator()(std::string_view source) const -> std::size_t { return hash_source(source); }
+    };
+
+    [[nodiscard]] auto object_path(std::string_view source) const -> std::filesystem::path;
+    auto load_from_disk(const std::filesystem::path &path) const -> std::shared_ptr<const sim::KernelObjectContents>;
+    void store_to_disk(const std::filesystem::path &path, const sim::KernelObjectContents &contents) const;
+
+    std::optional<std::filesystem::path> directory;
+    std::uint64_t version_hash;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const sim::KernelObjectContents>, SourceHash, std::equal_to<>> entries;
+    Stats counters;
+};
+
+} // namespace as
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <expected>
 #include <cstdint>
 #include <string>
@@ -16,23 +17,85 @@ template <class... Ts> struct overloaded : Ts... {
 };
 template <class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
 
-constexpr auto is_whitespace(char c) -> bool { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
-constexpr auto is_numeric(char c, std::uint8_t base = 10) -> bool {
-    if (base > 1 && base <= 10) {
-        // bases 2-10
-        return c >= '0' && c < '0' + base;
-    } else if (base <= 10 + 26) {
-        // bases 11-36 (number of digits + number of letters)
-        return (c >= '0' && c <= '9') || (c >= 'A' && c < 'A' + base - 10) || (c >= 'a' && c < 'a' + base - 10);
+// Character classification is table driven, the lexer looks at every character of the source at least once
+namespace char_class {
+enum : std::uint8_t {
+    WHITESPACE = 1 << 0,
+    DIGIT = 1 << 1,
+    LOWERCASE = 1 << 2,
+    UPPERCASE = 1 << 3,
+    UNDERSCORE = 1 << 4,
+    KEYWORD_PUNCTUATION = 1 << 5, // '.' and ':', which can be part of mnemonics and labels
+};
+
+constexpr auto ALPHABETIC = std::uint8_t{LOWERCASE | UPPERCASE};
+constexpr auto ALPHANUMERIC = std::uint8_t{ALPHABETIC | DIGIT};
+constexpr auto LABEL = std::uint8_t{ALPHANUMERIC | UNDERSCORE};
+constexpr auto KEYWORD = std::uint8_t{LABEL | KEYWORD_PUNCTUATION};
+
+constexpr auto NOT_A_DIGIT = std::uint8_t{0xff};
+
+constexpr auto make_class_table() -> std::array<std::uint8_t, 256> {
+    auto table = std::array<std::uint8_t, 256>{};
+    for (auto c : {' ', '\t', '\n', '\r'}) {
+        table[static_cast<unsigned char>(c)] |= WHITESPACE;
+    }
+    for (auto c = '0'; c <= '9'; c++) {
+        table[static_cast<unsigned char>(c)] |= DIGIT;
+    }
+    for (auto c = 'a'; c <= 'z'; c++) {
+        table[static_cast<unsigned char>(c)] |= LOWERCASE;
+    }
+    for (auto c = 'A'; c <= 'Z'; c++) {
+        table[static_cast<unsigned char>(c)] |= UPPERCASE;
+    }
+    table['_'] |= UNDERSCORE;
+    table['.'] |= KEYWORD_PUNCTUATION;
+    table[':'] |= KEYWORD_PUNCTUATION;
+    return table;
+}
+
+// Value of a character as a digit in bases up to 36, NOT_A_DIGIT for everything else
+constexpr auto make_digit_table() -> std::array<std::uint8_t, 256> {
+    auto table = std::array<std::uint8_t, 256>{};
+    table.fill(NOT_A_DIGIT);
+    for (auto c = '0'; c <= '9'; c++) {
+        table[static_cast<unsigned char>(c)] = static_cast<std::uint8_t>(c - '0');
     }
-    return false;
+    for (auto c = 'a'; c <= 'z'; c++) {
+        table[static_cast<unsigned char>(c)] = static_cast<std::uint8_t>(c - 'a' + 10);
+        table[static_cast<unsigned char>(c - 'a' + 'A')] = static_cast<std::uint8_t>(c - 'a' + 10);
+    }
+    return table;
+}
+
+constexpr auto class_table = make_class_table();
+constexpr auto digit_table = make_digit_table();
+
+constexpr auto has(char c, std::uint8_t classes) -> bool {
+    return (class_table[static_cast<unsigned char>(c)] & classes) != 0;
+}
+
+// Stateless predicate types, so templated scanning loops inline them
+template <std::uint8_t Classes> struct Is {
+    constexpr auto operator()(char c) const -> bool { return has(c, Classes); }
+};
+template <std::uint8_t Classes> struct IsNot {
+    constexpr auto operator()(char c) const -> bool { return !has(c, Classes); }
+};
+} // namespace char_class
+
+constexpr auto is_whitespace(char c) -> bool { return char_class::has(c, char_class::WHITESPACE); }
+constexpr auto is_numeric(char c, std::uint8_t base = 10) -> bool {
+    // bases 2-36 (number of digits + number of letters)
+    return base > 1 && base <= 10 + 26 && char_class::digit_table[static_cast<unsigned char>(c)] < base;
 }
-constexpr auto is_lowercase_alphabetic(char c) -> bool { return (c >= 'a' && c <= 'z'); }
-constexpr auto is_uppercase_alphabetic(char c) -> bool { return (c >= 'A' && c <= 'Z'); }
-constexpr auto is_alphabetic(char c) -> bool { return is_lowercase_alphabetic(c) || is_uppercase_alphabetic(c); }
+constexpr auto is_lowercase_alphabetic(char c) -> bool { return char_class::has(c, char_class::LOWERCASE); }
+constexpr auto is_uppercase_alphabetic(char c) -> bool { return char_class::has(c, char_class::UPPERCASE); }
+constexpr auto is_alphabetic(char c) -> bool { return char_class::has(c, char_class::ALPHABETIC); }
 constexpr auto is_alphanumeric(char c, std::uint8_t base = 10) -> bool { return is_alphabetic(c) || is_numeric(c, base); }
 
-constexpr auto is_label_char(char c) -> bool { return is_alphanumeric(c) || c == '_'; }
+constexpr auto is_label_char(char c) -> bool { return char_class::has(c, char_class::LABEL); }
 
 using num_type = std::variant<double, std::int64_t>;
 constexpr auto as_double(num_type num) -> double {
@@ -1,56 +1,191 @@
 #include "data_reader.hpp"
 #include "common.hpp"
+#include "data_image.hpp"
+#include "mapped_file.hpp"
 #include "parser_utils.hpp"
+#include "source_file.hpp"
 #include <string_view>
+#include <vector>
 
 namespace as {
-// FIXME: This is very lazy, untested and doesn't have any error handling
-// For now it's good enough tho
-auto parse_line(std::string_view line) -> std::optional<std::pair<IData, IData>> {
-    line = as::trim_line(line);
 
-    auto pos = line.find(':');
-    if (pos == std::string_view::npos) {
-        return std::nullopt;
+namespace {
+
+// Splits a line on whitespace and commas
+auto split_fields(std::string_view line) -> std::vector<std::string_view> {
+    auto fields = std::vector<std::string_view>{};
+    auto is_separator = [](char c) { return as::is_whitespace(c) || c == ','; };
+    while (!line.empty()) {
+        while (!line.empty() && is_separator(line.front())) {
+            line.remove_prefix(1);
+        }
+        auto size = std::size_t{0};
+        while (size < line.size() && !is_separator(line[size])) {
+            size++;
+        }
+        if (size != 0) {
+            fields.push_back(line.substr(0, size));
+        }
+        line.remove_prefix(size);
     }
+    return fields;
+}
 
-    auto left = as::trim_line(line.substr(0, pos));
-    auto right = as::trim_line(line.substr(pos + 1));
+auto parse_field(std::string_view field) -> std::expected<IData, std::string> {
+    auto rest = field;
+    const auto number = as::parse_num(rest);
+    if (!number) {
+        return std::unexpected(number.error().message);
+    }
+    if (!rest.empty()) {
+        return std::unexpected(std::format("Unexpected characters after a number: '{}'", field));
+    }
+    return (IData)*number;
+}
 
-    const auto address = as::parse_num(left);
-    if (!address) {
-        return std::nullopt;
+auto parse_fields(std::span<const std::string_view> fields) -> std::expected<std::vector<IData>, std::string> {
+    auto numbers = std::vector<IData>{};
+    numbers.reserve(fields.size());
+    for (const auto field : fields) {
+        const auto number = parse_field(field);
+        if (!number) {
+            return std::unexpected(number.error());
+        }
+        numbers.push_back(*number);
     }
+    return numbers;
+}
 
-    const auto value = as::parse_num(right);
-    if (!value) {
-        return std::nullopt;
+auto check_range(IData address, IData count) -> std::expected<void, std::string> {
+    if (count != 0 && address > ~IData{0} - (count - 1)) {
+        return std::unexpected(std::format("{} words at address {} go past the end of the address space", count, address));
     }
+    return {};
+}
 
-    return std::make_pair(*address, *value);
+// A raw binary file of words in host byte order
+auto include_blob(sim::data_memory_container_t& memory, IData address, const std::filesystem::path& path)
+    -> std::expected<void, std::string> {
+    auto ec = std::error_code{};
+    if (std::filesystem::file_size(path, ec) == 0 && !ec) {
+        return {};
+    }
+    const auto blob = sim::MappedFile::open(path);
+    if (!blob) {
+        return std::unexpected(blob.error());
+    }
+    const auto bytes = blob->bytes();
+    if (bytes.size() % sizeof(IData) != 0) {
+        return std::unexpected(std::format("The size of '{}' is not a multiple of the word size", path.c_str()));
+    }
+    const auto words = std::span{reinterpret_cast<const IData*>(bytes.data()), bytes.size() / sizeof(IData)};
+    if (const auto range = check_range(address, (IData)words.size()); !range) {
+        return range;
+    }
+    sim::write_words(memory, address, (IData)words.size(), [&](IData i) { return words[i]; });
+    return {};
 }
 
+// Every form of a line is described in data_reader.hpp
+auto parse_line(sim::data_memory_container_t& memory, std::string_view line, const std::filesystem::path& directory)
+    -> std::expected<void, std::string> {
+    line = line.substr(0, line.find('#'));
+    auto fields = split_fields(line);
+    if (fields.empty()) {
+        return {};
+    }
+
+    if (fields[0] == ".include") {
+        if (fields.size() != 3) {
+            return std::unexpected(std::string{"Expected '.include <address> <file>'"});
+        }
+        const auto address = parse_field(fields[1]);
+        if (!address) {
+            return std::unexpected(address.error());
+        }
+        return include_blob(memory, *address, directory / fields[2]);
+    }
 
-auto read_data(const std::filesystem::path& path) -> std::expected<sim::data_memory_container_t, std::string_view> {
-    auto file = as::open_file(path);
-    if (!file) {
-        return std::unexpected(file.error());
+    if (fields[0] == ".fill" || fields[0] == ".seq") {
+        const auto is_fill = fields[0] == ".fill";
+        const auto numbers = parse_fields(std::span{fields}.subspan(1));
+        if (!numbers) {
+            return std::unexpected(numbers.error());
+        }
+        if (numbers->size() != (is_fill ? 3u : 4u)) {
+            return std::unexpected(std::string{is_fill ? "Expected '.fill <address> <count> <value>'"
+                                                       : "Expected '.seq <address> <count> <start> <stride>'"});
+        }
+        const auto address = (*numbers)[0];
+        const auto count = (*numbers)[1];
+        if (const auto range = check_range(address, count); !range) {
+            return range;
+        }
+        const auto start = (*numbers)[2];
+        const auto stride = is_fill ? IData{0} : (*numbers)[3];
+        sim::write_words(memory, address, count, [&](IData i) { return start + i * stride; });
+        return {};
     }
 
-    const auto lines = as::get_lines(*file);
+    // <address>: <value>...
+    auto& first = fields[0];
+    if (first.ends_with(':')) {
+        first.remove_suffix(1);
+    } else if (fields.size() > 1 && fields[1].starts_with(':')) {
+        fields[1].remove_prefix(1);
+        if (fields[1].empty()) {
+            fields.erase(fields.begin() + 1);
+        }
+    } else if (const auto colon = first.find(':'); colon != std::string_view::npos) {
+        fields.insert(fields.begin() + 1, first.substr(colon + 1));
+        fields[0] = fields[0].substr(0, colon);
+    } else {
+        return std::unexpected(std::string{"Expected '<address>: <value>...' or a directive"});
+    }
 
-    file->close();
+    const auto numbers = parse_fields(fields);
+    if (!numbers) {
+        return std::unexpected(numbers.error());
+    }
+    const auto values = std::span{*numbers}.subspan(1);
+    if (values.empty()) {
+        return std::unexpected(std::string{"Expected at least one value after the address"});
+    }
+    if (const auto range = check_range(numbers->front(), (IData)values.size()); !range) {
+        return range;
+    }
+    sim::write_words(memory, numbers->front(), (IData)values.size(), [&](IData i) { return values[i]; });
+    return {};
+}
 
-    sim::data_memory_container_t data_memory{};
+} // namespace
 
-    for (std::string_view line : lines) {
-        const auto record_or_none = parse_line(line);
-        if (!record_or_none) {
-            return std::unexpected(std::format("Failed to parse line: '{}'", line));
+auto read_data(const std::filesystem::path& path) -> std::expected<sim::data_memory_container_t, std::string> {
+    if (sim::DataImage::is_data_image(path)) {
+        const auto image = sim::DataImage::load(path);
+        if (!image) {
+            return std::unexpected(image.error());
         }
+        auto data_memory = sim::data_memory_container_t{};
+        image->load_into(data_memory);
+        return data_memory;
+    }
 
-        const auto [address, value] = *record_or_none;
-        data_memory[address] = value;
+    const auto source = SourceFile::open(path);
+    if (!source) {
+        return std::unexpected(source.error());
+    }
+
+    auto data_memory = sim::data_memory_container_t{};
+    auto remaining = source->view();
+    for (auto line_number = 1u; !remaining.empty(); line_number++) {
+        const auto end = remaining.find('\n');
+        const auto line = remaining.substr(0, end);
+        remaining.remove_prefix(end == std::string_view::npos ? remaining.size() : end + 1);
+
+        if (const auto parsed = parse_line(data_memory, line, path.parent_path()); !parsed) {
+            return std::unexpected(std::format("{}:{}: {}", path.c_str(), line_number, parsed.error()));
+        }
     }
 
     return data_memory;
@@ -3,5 +3,12 @@
 #include "sim.hpp"
 #include <filesystem>
 namespace as {
-auto read_data(const std::filesystem::path& path) -> std::expected<sim::data_memory_container_t, std::string_view>;
+// Reads either a binary data image (see simlib/data_image.hpp) or a text data file. Every line of a text data file
+// is one of the following, numbers are in the assembler's syntax and '#' starts a comment:
+//   <address>: <value> [<value>...]              the values at consecutive addresses starting at address
+//   .fill <address> <count> <value>              count copies of value
+//   .seq <address> <count> <start> <stride>      start, start + stride, start + 2 * stride...
+//   .include <address> <file>                    a raw file of words in host byte order, relative to the data file
+// Ranges are written with hinted insertions (sim::write_words), not one lookup per word.
+auto read_data(const std::filesystem::path& path) -> std::expected<sim::data_memory_container_t, std::string>;
 }
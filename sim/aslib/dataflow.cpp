@@ -0,0 +1,120 @@
+#include "dataflow.hpp"
+#include <algorithm>
+
+namespace as {
+
+auto is_read_only(const sim::Register &reg) -> bool {
+    return reg.is_vector() ? reg.register_number < 4 : reg.register_number == 0;
+}
+
+auto is_halt(const parser::Instruction &instruction) -> bool {
+    return instruction.mnemonic.get_name() == sim::MnemonicName::HALT;
+}
+
+auto is_control_transfer(const parser::Instruction &instruction) -> bool {
+    return is_halt(instruction) || instruction.mnemonic.is_branch() || instruction.mnemonic.is_jump();
+}
+
+auto is_load(const parser::Instruction &instruction) -> bool {
+    return parser::is_load_type(instruction.mnemonic.get_name());
+}
+
+auto is_store(const parser::Instruction &instruction) -> bool {
+    return parser::is_store_type(instruction.mnemonic.get_name());
+}
+
+auto pure_destination(const parser::Instruction &instruction) -> std::optional<sim::Register> {
+    // halt is parsed with empty I-type operands
+    if (is_halt(instruction) || instruction.mnemonic.get_name() == sim::MnemonicName::AUIPC) {
+        return std::nullopt;
+    }
+    return std::visit(overloaded{
+                          [](const parser::ItypeOperands &operands) -> std::optional<sim::Register> { return operands.rd; },
+                          [](const parser::RtypeOperands &operands) -> std::optional<sim::Register> { return operands.rd; },
+                          [](const parser::UtypeOperands &operands) -> std::optional<sim::Register> { return operands.rd; },
+                          [](const auto &) -> std::optional<sim::Register> { return std::nullopt; },
+                      },
+                      instruction.operands);
+}
+
+auto destination(const parser::Instruction &instruction) -> std::optional<sim::Register> {
+    if (is_halt(instruction)) {
+        return std::nullopt;
+    }
+    return std::visit(overloaded{
+                          [](const parser::StypeOperands &) -> std::optional<sim::Register> { return std::nullopt; },
+                          [](const parser::BtypeOperands &) -> std::optional<sim::Register> { return std::nullopt; },
+                          [](const auto &operands) -> std::optional<sim::Register> { return operands.rd; },
+                      },
+                      instruction.operands);
+}
+
+auto operand_sources(const parser::Instruction &instruction) -> std::vector<sim::Register> {
+    auto registers = std::vector<sim::Register>{};
+    if (is_halt(instruction)) {
+        return registers;
+    }
+    std::visit(overloaded{
+                   [&](const parser::ItypeOperands &operands) { registers.push_back(operands.rs1); },
+                   [&](const parser::RtypeOperands &operands) { registers.insert(registers.end(), {operands.rs1, operands.rs2}); },
+                   [&](const parser::StypeOperands &operands) { registers.insert(registers.end(), {operands.rs1, operands.rs2}); },
+                   [&](const parser::BtypeOperands &operands) { registers.insert(registers.end(), {operands.rs1, operands.rs2}); },
+                   [&](const parser::JalrOperands &operands) { registers.push_back(operands.rs1); },
+                   [](const auto &) {},
+               },
+               instruction.operands);
+    return registers;
+}
+
+auto reads_operand(const parser::Instruction &instruction, const sim::Register &reg) -> bool {
+    const auto registers = operand_sources(instruction);
+    return std::ranges::find(registers, reg) != registers.end();
+}
+
+auto target_index(const parser::Program &program, std::uint32_t index) -> std::optional<std::int64_t> {
+    const auto *target = std::visit(overloaded{
+                                        [](const parser::BtypeOperands &operands) { return &operands.offset_or_label_ref; },
+                                        [](const parser::JtypeOperands &operands) { return &operands.offset_or_label_ref; },
+                                        [](const auto &) -> const parser::ImmediateOrLabelref * { return nullptr; },
+                                    },
+                                    program.instructions[index].operands);
+    if (target == nullptr) {
+        return std::nullopt;
+    }
+    const auto offset = parser::target_offset(program, index, *target);
+    if (!offset) {
+        return std::nullopt;
+    }
+    return index + *offset;
+}
+
+auto find_block_starts(const parser::Program &program) -> std::vector<bool> {
+    const auto size = program.instructions.size();
+    auto starts = std::vector<bool>(size + 1, false);
+    starts[0] = true;
+    for (const auto &[label, index] : program.label_mappings) {
+        starts[std::min<std::size_t>(index, size)] = true;
+    }
+    for (auto i = 0u; i < size; i++) {
+        if (const auto target = target_index(program, i); target.has_value() && *target >= 0 && *target <= (std::int64_t)size) {
+            starts[*target] = true;
+        }
+        if (is_control_transfer(program.instructions[i])) {
+            starts[i + 1] = true;
+        }
+    }
+    return starts;
+}
+
+auto find_address_dependency(const parser::Program &program) -> const parser::Instruction * {
+    for (const auto &instruction : program.instructions) {
+        const auto *jalr = std::get_if<parser::JalrOperands>(&instruction.operands);
+        if ((jalr != nullptr && std::holds_alternative<token::Immediate>(jalr->immediate_or_label_ref)) ||
+            instruction.mnemonic.get_name() == sim::MnemonicName::AUIPC) {
+            return &instruction;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace as
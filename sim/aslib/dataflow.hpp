@@ -0,0 +1,45 @@
+#pragma once
+
+#include "parser.hpp"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace as {
+
+// What the passes over parsed programs (optimizer.hpp, scheduler.hpp) know about the instructions
+
+constexpr auto EXECUTION_MASK = sim::Register{.register_number = 1, .type = sim::RegisterType::SCALAR};
+
+// x0-x3 hold zero, the thread id, the block id and the block size, s0 holds zero, writes to them are dropped
+auto is_read_only(const sim::Register &reg) -> bool;
+
+auto is_halt(const parser::Instruction &instruction) -> bool;
+
+// Branches, jumps and halt, whatever follows them starts a new basic block
+auto is_control_transfer(const parser::Instruction &instruction) -> bool;
+
+auto is_load(const parser::Instruction &instruction) -> bool;
+auto is_store(const parser::Instruction &instruction) -> bool;
+
+// The register written by an instruction whose only effect is that write
+auto pure_destination(const parser::Instruction &instruction) -> std::optional<sim::Register>;
+
+// The register written by any instruction, jumps included
+auto destination(const parser::Instruction &instruction) -> std::optional<sim::Register>;
+
+// The register operands, vector instructions read the execution mask on top of these
+auto operand_sources(const parser::Instruction &instruction) -> std::vector<sim::Register>;
+auto reads_operand(const parser::Instruction &instruction, const sim::Register &reg) -> bool;
+
+// Index of the instruction the branch or jump at `index` goes to, std::nullopt for anything else
+auto target_index(const parser::Program &program, std::uint32_t index) -> std::optional<std::int64_t>;
+
+// For every index (and one past the end), whether it can be reached from anywhere but the instruction before it
+auto find_block_starts(const parser::Program &program) -> std::vector<bool>;
+
+// The first jalr through a register or auipc, which depend on the address of every instruction, so the program
+// can't be rearranged
+auto find_address_dependency(const parser::Program &program) -> const parser::Instruction *;
+
+} // namespace as
@@ -1,54 +1,136 @@
 #include "emitter.hpp"
 #include "instructions.hpp"
+#include <algorithm>
+#include <thread>
+#include <tuple>
 
 namespace as {
 
+namespace {
+
+// Negative immediates are written as they are sign extended, the instruction only holds their low bits
+constexpr auto IMM12_MASK = IData{0xFFF};
+constexpr auto IMM20_MASK = IData{0xFFFFF};
+
+auto translate_instruction(const as::parser::Program& program, std::uint32_t index) -> sim::InstructionBits {
+    const auto& instruction = program.instructions[index];
+    auto instruction_bits = sim::InstructionBits{};
+
+    const auto [opcode, funct3, funct7] = name_to_determinant(instruction.mnemonic.get_name());
+
+    std::visit(as::overloaded{
+        [&](const as::parser::ItypeOperands &operands) {
+            if (sim::is_itype_shift(instruction.mnemonic.get_name())) {
+                instruction_bits = sim::instructions::create_itype_shift_instruction(opcode, funct3, funct7, operands.rd, operands.rs1, (IData)operands.imm12.value);
+            } else {
+                instruction_bits = sim::instructions::create_itype_instruction(opcode, funct3, operands.rd, operands.rs1, (IData)operands.imm12.value & IMM12_MASK);
+            }
+        },
+            [&](const as::parser::RtypeOperands &operands) {
+            instruction_bits = sim::instructions::create_rtype_instruction(opcode, funct3, funct7, operands.rd, operands.rs1, operands.rs2);
+        },
+            [&](const as::parser::StypeOperands &operands) {
+            instruction_bits = sim::instructions::create_stype_instruction(opcode, funct3, operands.rs1, operands.rs2, (IData)operands.imm12.value & IMM12_MASK);
+        },
+            [&](const as::parser::UtypeOperands &operands) {
+            instruction_bits = sim::instructions::create_utype_instruction(opcode, operands.rd, (IData)operands.imm20.value & IMM20_MASK);
+        },
+            [&](const as::parser::BtypeOperands &operands) {
+            // The parser already checked that defined targets are in range, labels of other modules are left at 0
+            // for the linker to fill in
+            const auto offset = as::parser::target_offset(program, index, operands.offset_or_label_ref).value_or(0);
+            instruction_bits = sim::instructions::create_btype_instruction(opcode, funct3, operands.rs1, operands.rs2, (IData)offset);
+        },
+            [&](const as::parser::JtypeOperands &operands) {
+            const auto offset = as::parser::target_offset(program, index, operands.offset_or_label_ref).value_or(0);
+            instruction_bits = sim::instructions::create_jtype_instruction(opcode, operands.rd, (IData)offset);
+        },
+            [&](const as::parser::JalrOperands &operands) {
+            if (std::holds_alternative<token::LabelRef>(operands.immediate_or_label_ref)) {
+                // parse_program reports undefined labels, the ones of modules are resolved by the linker
+                const auto &label_token = std::get<token::LabelRef>(operands.immediate_or_label_ref);
+                const auto label = program.label_mappings.find(label_token.label_name);
+                const auto target = label != program.label_mappings.end() ? label->second : 0u;
+                instruction_bits = sim::instructions::jalr(operands.rd, 0_x, target);
+            } else {
+                const auto &immediate = std::get<token::Immediate>(operands.immediate_or_label_ref);
+                instruction_bits = sim::instructions::jalr(operands.rd, operands.rs1, (IData)immediate.value & IMM12_MASK);
+            }
+        }
+
+    }, instruction.operands);
+
+    // The s. prefix only lives in the mnemonic, the determinant always has the vector opcode
+    if (instruction.mnemonic.is_scalar()) {
+        instruction_bits.make_scalar();
+    }
+
+    return instruction_bits;
+}
+
+// Fewer instructions than this per thread aren't worth it
+constexpr auto MIN_INSTRUCTIONS_PER_THREAD = std::size_t{1} << 14;
+
+}
+
 auto translate_to_binary(const as::parser::Program& program) -> std::vector<sim::InstructionBits> {
     const auto len = program.instructions.size();
     auto machine_code = std::vector<sim::InstructionBits>(len);
 
     for(auto i = 0u; i < len; i++) {
-        const auto instruction = program.instructions[i];
-        auto instruction_bits = sim::InstructionBits{};
-
-        const auto [opcode, funct3, funct7] = name_to_determinant(instruction.mnemonic.get_name());
-
-        std::visit(as::overloaded{
-            [&](const as::parser::ItypeOperands &operands) {
-                instruction_bits = sim::instructions::create_itype_instruction(opcode, funct3, operands.rd, operands.rs1, (IData)operands.imm12.value);
-            },
-                [&](const as::parser::RtypeOperands &operands) {
-                instruction_bits = sim::instructions::create_rtype_instruction(opcode, funct3, funct7, operands.rd, operands.rs1, operands.rs2);
-            },
-                [&](const as::parser::StypeOperands &operands) {
-                instruction_bits = sim::instructions::create_stype_instruction(opcode, funct3, operands.rs1, operands.rs2, (IData)operands.imm12.value);
-            },
-                [&](const as::parser::UtypeOperands &operands) {
-                instruction_bits = sim::instructions::create_utype_instruction(opcode, operands.rd, (IData)operands.imm20.value);
-            },
-                [&](const as::parser::JtypeOperands &operands) {
-                // FIXME: The JtypeOperands might be broken. The create_jtype_instruction requires imm21 but we provide imm20
-                instruction_bits = sim::instructions::create_jtype_instruction(opcode, operands.rd, (IData)operands.imm20.value);
-            },
-                [&](const as::parser::JalrOperands &operands) {
-                if (std::holds_alternative<token::LabelRef>(operands.immediate_or_label_ref)) {
-                    const auto &label_token = std::get<token::LabelRef>(operands.immediate_or_label_ref);
-                    if (!program.label_mappings.contains(label_token.label_name)) {
-                        // TODO: Error here
-                    }
-                    instruction_bits = sim::instructions::jalr(operands.rd, 0_x, program.label_mappings.at(label_token.label_name));
-                } else {
-                    const auto &immediate = std::get<token::Immediate>(operands.immediate_or_label_ref);
-                    instruction_bits = sim::instructions::jalr(operands.rd, operands.rs1, immediate.value);
-                }
-            }
+        machine_code[i] = translate_instruction(program, i);
+    }
 
-        }, program.instructions[i].operands);
+    return machine_code;
+}
 
-        machine_code[i] = instruction_bits;
+auto translate_to_binary(const as::parser::Program& program, std::uint32_t num_threads) -> std::vector<sim::InstructionBits> {
+    const auto len = program.instructions.size();
+    const auto num_chunks = std::clamp<std::size_t>(len / MIN_INSTRUCTIONS_PER_THREAD, 1, std::max(num_threads, 1u));
+    if (num_chunks == 1) {
+        return translate_to_binary(program);
+    }
+
+    // Every instruction is encoded on its own, the label table is only read
+    auto machine_code = std::vector<sim::InstructionBits>(len);
+    {
+        auto threads = std::vector<std::jthread>{};
+        for (auto chunk = 0u; chunk < num_chunks; chunk++) {
+            threads.emplace_back([&, chunk]() {
+                for (auto i = len * chunk / num_chunks; i < len * (chunk + 1) / num_chunks; i++) {
+                    machine_code[i] = translate_instruction(program, (std::uint32_t)i);
+                }
+            });
+        }
     }
 
     return machine_code;
 }
 
+auto make_kernel_object(const as::parser::Program& program, std::span<const sim::InstructionBits> machine_code,
+                        bool with_source_lines) -> sim::KernelObjectContents {
+    auto contents = sim::KernelObjectContents{.num_blocks = program.blocks, .num_warps_per_block = program.warps};
+
+    contents.instructions.reserve(machine_code.size());
+    for (const auto& instruction : machine_code) {
+        contents.instructions.push_back(instruction.bits);
+    }
+
+    for (const auto& [name, instruction] : program.label_mappings) {
+        contents.symbols.emplace_back(std::string{name}, instruction);
+    }
+    // The label table is unordered, sort so the same program always gives the same object
+    std::ranges::sort(contents.symbols, [](const auto& a, const auto& b) {
+        return std::tie(a.second, a.first) < std::tie(b.second, b.first);
+    });
+
+    if (with_source_lines) {
+        for (const auto& instruction : program.instructions) {
+            contents.source_lines.push_back(instruction.line);
+        }
+    }
+
+    return contents;
+}
+
 }
@@ -1,8 +1,14 @@
 #pragma once
 
 #include "instructions.hpp"
+#include "kernel_object.hpp"
 #include "parser.hpp"
 
 namespace as {
     auto translate_to_binary(const parser::Program& program) -> std::vector<sim::InstructionBits>;
+    // Encodes the instructions on up to num_threads threads
+    auto translate_to_binary(const parser::Program& program, std::uint32_t num_threads) -> std::vector<sim::InstructionBits>;
+    // The labels become the symbols, the source lines are only included with_source_lines
+    auto make_kernel_object(const parser::Program& program, std::span<const sim::InstructionBits> machine_code,
+                            bool with_source_lines = true) -> sim::KernelObjectContents;
 }
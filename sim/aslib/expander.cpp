@@ -0,0 +1,413 @@
+#include "expander.hpp"
+#include <algorithm>
+#include <array>
+#include <format>
+
+namespace as {
+
+namespace {
+
+// Macros calling each other this deep are most likely calling themselves
+constexpr auto MAX_EXPANSION_DEPTH = 64u;
+
+auto is_expander_directive(const Token &token) -> bool {
+    return token.is_of_type<token::EquDirective, token::MacroDirective, token::EndmDirective, token::ReptDirective,
+                            token::EndrDirective>();
+}
+
+// Position of the first token after the label the line may start with
+auto after_label(std::span<const Token> tokens) -> std::size_t {
+    return !tokens.empty() && tokens[0].is_of_type<token::Label>() ? 1 : 0;
+}
+
+auto names(const Token &token, std::string_view name) -> bool {
+    return token.is_of_type<token::LabelRef>() && token.as<token::LabelRef>().label_name == name;
+}
+
+auto make_mnemonic(sim::MnemonicName name, bool is_scalar, std::uint32_t col) -> Token {
+    return Token{.token_type = token::Mnemonic{.mnemonic = sim::Mnemonic{name, is_scalar}}, .col = col};
+}
+
+auto make_zero(bool is_scalar, std::uint32_t col) -> Token {
+    const auto type = is_scalar ? sim::RegisterType::SCALAR : sim::RegisterType::VECTOR;
+    return Token{.token_type = token::Register{.register_data = {.register_number = 0, .type = type}}, .col = col};
+}
+
+auto make_immediate(std::int32_t value, std::uint32_t col) -> Token {
+    return Token{.token_type = token::Immediate{value}, .col = col};
+}
+
+auto make_comma(std::uint32_t col) -> Token {
+    return Token{.token_type = token::Comma{}, .col = col};
+}
+
+} // namespace
+
+auto Expander::passes_through(std::span<const Token> tokens) const -> bool {
+    if (recording.has_value()) {
+        return false;
+    }
+    const auto first = after_label(tokens);
+    if (first < tokens.size() && (is_expander_directive(tokens[first]) || tokens[first].is_of_type<token::Pseudo>() ||
+                                  macro_called(tokens.subspan(first)))) {
+        return false;
+    }
+    if (constants.empty()) {
+        return true;
+    }
+    return std::ranges::none_of(tokens, [&](const Token &token) {
+        return token.is_of_type<token::LabelRef>() && constants.contains(token.as<token::LabelRef>().label_name);
+    });
+}
+
+void Expander::expand(std::span<const Token> tokens, std::uint32_t line, std::vector<ExpandedLine> &output,
+                      std::vector<sim::Error> &errors) {
+    process(tokens, line, 0, output, errors);
+}
+
+void Expander::finish(std::vector<sim::Error> &errors) {
+    if (recording.has_value()) {
+        errors.emplace_back(recording->is_macro ? "'.macro' without '.endm'" : "'.rept' without '.endr'", 0,
+                            recording->line);
+        recording.reset();
+    }
+}
+
+void Expander::process(std::span<const Token> tokens, std::uint32_t line, std::uint32_t depth,
+                       std::vector<ExpandedLine> &output, std::vector<sim::Error> &errors) {
+    if (tokens.empty()) {
+        return;
+    }
+    if (recording.has_value()) {
+        record(tokens, line, depth, output, errors);
+        return;
+    }
+
+    auto rest = tokens.subspan(after_label(tokens));
+    const auto *macro = macro_called(rest);
+    if (rest.empty() || (!is_expander_directive(rest[0]) && !rest[0].is_of_type<token::Pseudo>() && macro == nullptr)) {
+        output.push_back({.tokens = substitute_constants(tokens), .line = line});
+        return;
+    }
+
+    // The label goes on a line of its own in front of whatever the rest expands to
+    if (rest.size() < tokens.size()) {
+        output.push_back({.tokens = {tokens[0]}, .line = line});
+    }
+
+    if (macro != nullptr) {
+        call_macro(*macro, rest, line, depth, output, errors);
+    } else if (rest[0].is_of_type<token::Pseudo>()) {
+        expand_pseudo(substitute_constants(rest), line, output, errors);
+    } else if (rest[0].is_of_type<token::EquDirective>()) {
+        define_constant(rest, line, errors);
+    } else if (rest[0].is_of_type<token::MacroDirective>()) {
+        begin_macro(rest, line, errors);
+    } else if (rest[0].is_of_type<token::ReptDirective>()) {
+        begin_rept(rest, line, errors);
+    } else {
+        const auto opening = rest[0].is_of_type<token::EndmDirective>() ? ".macro" : ".rept";
+        errors.emplace_back(std::format("'{}' without '{}'", rest[0].to_str(), opening), rest[0].col, line);
+    }
+}
+
+void Expander::record(std::span<const Token> tokens, std::uint32_t line, std::uint32_t depth,
+                      std::vector<ExpandedLine> &output, std::vector<sim::Error> &errors) {
+    auto &current = *recording;
+    const auto first = after_label(tokens);
+    const auto is_begin = first < tokens.size() && (current.is_macro ? tokens[first].is_of_type<token::MacroDirective>()
+                                                                     : tokens[first].is_of_type<token::ReptDirective>());
+    const auto is_end = first < tokens.size() && (current.is_macro ? tokens[first].is_of_type<token::EndmDirective>()
+                                                                   : tokens[first].is_of_type<token::EndrDirective>());
+
+    if (is_begin && current.is_macro) {
+        errors.emplace_back("Macros can't be defined inside a macro", tokens[first].col, line);
+        return;
+    }
+    if (is_begin) {
+        current.nesting++;
+    }
+    if (!is_end || current.nesting > 0) {
+        if (is_end) {
+            current.nesting--;
+        }
+        current.macro.body.push_back({.tokens = {tokens.begin(), tokens.end()}, .line = line});
+        return;
+    }
+
+    if (first + 1 < tokens.size()) {
+        errors.emplace_back(std::format("Unexpected token after '{}': '{}'", tokens[first].to_str(), tokens[first + 1].to_str()),
+                            tokens[first + 1].col, line);
+    }
+    if (first > 0) {
+        current.macro.body.push_back({.tokens = {tokens[0]}, .line = line});
+    }
+
+    auto done = std::move(current);
+    recording.reset();
+    if (done.failed) {
+        return;
+    }
+    if (done.is_macro) {
+        macros.emplace(done.name, std::move(done.macro));
+        return;
+    }
+
+    if (depth >= MAX_EXPANSION_DEPTH) {
+        errors.emplace_back(std::format("'.rept' nested more than {} deep", MAX_EXPANSION_DEPTH), 0, done.line);
+        return;
+    }
+    for (auto iteration = 0; iteration < done.count; iteration++) {
+        for (const auto &body_line : done.macro.body) {
+            auto repeated = body_line.tokens;
+            if (done.symbol.has_value()) {
+                for (auto &token : repeated) {
+                    if (names(token, *done.symbol)) {
+                        token.token_type = token::Immediate{iteration};
+                    }
+                }
+            }
+            process(repeated, body_line.line, depth + 1, output, errors);
+        }
+        if (recording.has_value()) {
+            errors.emplace_back(std::format("'{}' on line {} isn't closed inside the '.rept' body",
+                                            recording->is_macro ? ".macro" : ".rept", recording->line),
+                                0, done.line);
+            recording.reset();
+            return;
+        }
+    }
+}
+
+void Expander::define_constant(std::span<const Token> tokens, std::uint32_t line, std::vector<sim::Error> &errors) {
+    if (tokens.size() < 2 || !tokens[1].is_of_type<token::LabelRef>()) {
+        const auto message = tokens.size() < 2 ? std::string{"Expected a constant name after '.equ'"}
+                                               : std::format("'{}' can't name a constant", tokens[1].to_str());
+        errors.emplace_back(message, tokens.size() < 2 ? tokens[0].col : tokens[1].col, line);
+        return;
+    }
+    const auto value = substitute_constants(tokens.subspan(2));
+    if (value.size() != 2 || !value[0].is_of_type<token::Comma>() || !value[1].is_of_type<token::Immediate>()) {
+        errors.emplace_back(std::format("Expected '.equ {}, <number or constant>'", tokens[1].to_str()), tokens[0].col,
+                            line);
+        return;
+    }
+    constants[tokens[1].as<token::LabelRef>().label_name] = value[1].as<token::Immediate>().value;
+}
+
+void Expander::begin_macro(std::span<const Token> tokens, std::uint32_t line, std::vector<sim::Error> &errors) {
+    // The body is recorded even if the header is wrong, so it doesn't get parsed on its own
+    recording = Recording{.is_macro = true, .line = line};
+    auto fail = [&](std::string &&message, std::uint32_t col) {
+        errors.emplace_back(std::move(message), col, line);
+        recording->failed = true;
+    };
+
+    if (tokens.size() < 2 || !tokens[1].is_of_type<token::LabelRef>()) {
+        fail(tokens.size() < 2 ? std::string{"Expected a macro name after '.macro'"}
+                               : std::format("'{}' can't name a macro", tokens[1].to_str()),
+             tokens.size() < 2 ? tokens[0].col : tokens[1].col);
+        return;
+    }
+    const auto name = tokens[1].as<token::LabelRef>().label_name;
+    if (macros.contains(name)) {
+        fail(std::format("Macro '{}' is already defined", name), tokens[1].col);
+        return;
+    }
+    recording->name = name;
+
+    // Parameters are separated by commas, there may be one between the name and the first parameter as well
+    auto &parameters = recording->macro.parameters;
+    auto expect_parameter = true;
+    for (auto i = std::size_t{2}; i < tokens.size(); i++) {
+        const auto &token = tokens[i];
+        if (token.is_of_type<token::Comma>() && (i == 2 || !expect_parameter)) {
+            expect_parameter = true;
+            continue;
+        }
+        if (!expect_parameter || !token.is_of_type<token::LabelRef>()) {
+            fail(std::format("Unexpected token in the parameters of macro '{}': '{}'", name, token.to_str()), token.col);
+            return;
+        }
+        const auto parameter = token.as<token::LabelRef>().label_name;
+        if (std::ranges::find(parameters, parameter) != parameters.end()) {
+            fail(std::format("Duplicate parameter '{}' of macro '{}'", parameter, name), token.col);
+            return;
+        }
+        parameters.push_back(parameter);
+        expect_parameter = false;
+    }
+    if (expect_parameter && tokens.size() > 2) {
+        fail(std::format("Expected a parameter after ',' in macro '{}'", name), tokens.back().col);
+    }
+}
+
+void Expander::begin_rept(std::span<const Token> tokens, std::uint32_t line, std::vector<sim::Error> &errors) {
+    recording = Recording{.is_macro = false, .line = line};
+    auto fail = [&](std::string &&message, std::uint32_t col) {
+        errors.emplace_back(std::move(message), col, line);
+        recording->failed = true;
+    };
+
+    const auto count = substitute_constants(tokens.subspan(1, std::min<std::size_t>(tokens.size() - 1, 1)));
+    if (count.empty() || !count[0].is_of_type<token::Immediate>()) {
+        fail("Expected a repeat count after '.rept'", count.empty() ? tokens[0].col : count[0].col);
+        return;
+    }
+    recording->count = count[0].as<token::Immediate>().value;
+    if (recording->count < 0) {
+        fail(std::format("Invalid repeat count: '{}'", recording->count), count[0].col);
+        return;
+    }
+
+    if (tokens.size() == 2) {
+        return;
+    }
+    if (tokens.size() != 4 || !tokens[2].is_of_type<token::Comma>() || !tokens[3].is_of_type<token::LabelRef>()) {
+        fail("Expected '.rept <count>' or '.rept <count>, <symbol>'", tokens[0].col);
+        return;
+    }
+    recording->symbol = tokens[3].as<token::LabelRef>().label_name;
+}
+
+void Expander::call_macro(const Macro &macro, std::span<const Token> tokens, std::uint32_t line, std::uint32_t depth,
+                          std::vector<ExpandedLine> &output, std::vector<sim::Error> &errors) {
+    const auto name = tokens[0].as<token::LabelRef>().label_name;
+    if (depth >= MAX_EXPANSION_DEPTH) {
+        errors.emplace_back(std::format("Macros nested more than {} deep, does '{}' call itself?", MAX_EXPANSION_DEPTH, name),
+                            tokens[0].col, line);
+        return;
+    }
+
+    const auto arguments = substitute_constants(tokens.subspan(1));
+    for (auto i = std::size_t{0}; i < arguments.size(); i++) {
+        if (arguments[i].is_of_type<token::Comma>() != (i % 2 == 1)) {
+            errors.emplace_back(std::format("Macro arguments are single tokens separated by commas, found '{}'",
+                                            arguments[i].to_str()),
+                                arguments[i].col, line);
+            return;
+        }
+    }
+    const auto num_arguments = (arguments.size() + 1) / 2;
+    if (num_arguments != macro.parameters.size() || (!arguments.empty() && arguments.back().is_of_type<token::Comma>())) {
+        errors.emplace_back(std::format("Macro '{}' takes {} arguments, got {}", name, macro.parameters.size(), num_arguments),
+                            tokens[0].col, line);
+        return;
+    }
+
+    for (const auto &body_line : macro.body) {
+        auto expanded = body_line.tokens;
+        for (auto &token : expanded) {
+            for (auto parameter = 0u; parameter < macro.parameters.size(); parameter++) {
+                if (names(token, macro.parameters[parameter])) {
+                    token.token_type = arguments[parameter * 2].token_type;
+                    break;
+                }
+            }
+        }
+        process(expanded, line, depth + 1, output, errors);
+    }
+    if (recording.has_value()) {
+        errors.emplace_back(std::format("'{}' isn't closed inside macro '{}'", recording->is_macro ? ".macro" : ".rept", name),
+                            tokens[0].col, line);
+        recording.reset();
+    }
+}
+
+void Expander::expand_pseudo(std::span<const Token> tokens, std::uint32_t line, std::vector<ExpandedLine> &output,
+                             std::vector<sim::Error> &errors) const {
+    using sim::MnemonicName;
+    const auto [name, is_scalar] = tokens[0].as<token::Pseudo>().pseudo;
+    const auto col = tokens[0].col;
+    auto operands = tokens.subspan(1);
+    auto has_operands = [&]<typename... Types>(Types...) {
+        constexpr auto count = sizeof...(Types);
+        if (operands.size() != (count == 0 ? 0 : 2 * count - 1)) {
+            return false;
+        }
+        auto i = std::size_t{0};
+        return ((operands[i].is_of_type<Types>() && (++i == operands.size() || operands[i++].is_of_type<token::Comma>())) &&
+                ...);
+    };
+    auto emit = [&](std::vector<Token> &&line_tokens) { output.push_back({.tokens = std::move(line_tokens), .line = line}); };
+
+    switch (name) {
+    case PseudoName::LI:
+        if (has_operands(token::Register{}, token::Immediate{})) {
+            const auto &rd = operands[0];
+            const auto value = operands[2].as<token::Immediate>().value;
+            const auto [upper, lower] = materialize_constant(value);
+            if (upper.has_value()) {
+                emit({make_mnemonic(MnemonicName::LUI, is_scalar, col), rd, make_comma(col),
+                      make_immediate(*upper, operands[2].col)});
+            }
+            if (lower.has_value()) {
+                const auto source = upper.has_value() ? rd : make_zero(is_scalar, col);
+                emit({make_mnemonic(MnemonicName::ADDI, is_scalar, col), rd, make_comma(col), source, make_comma(col),
+                      make_immediate(*lower, operands[2].col)});
+            }
+            return;
+        }
+        break;
+    case PseudoName::MV:
+    case PseudoName::NOT:
+        if (has_operands(token::Register{}, token::Register{})) {
+            // The immediate of not is -1 in 12 bits
+            const auto [mnemonic, immediate] =
+                name == PseudoName::MV ? std::pair{MnemonicName::ADDI, 0} : std::pair{MnemonicName::XORI, 0xFFF};
+            emit({make_mnemonic(mnemonic, is_scalar, col), operands[0], make_comma(col), operands[2], make_comma(col),
+                  make_immediate(immediate, col)});
+            return;
+        }
+        break;
+    case PseudoName::NEG:
+        if (has_operands(token::Register{}, token::Register{})) {
+            emit({make_mnemonic(MnemonicName::SUB, is_scalar, col), operands[0], make_comma(col), make_zero(is_scalar, col),
+                  make_comma(col), operands[2]});
+            return;
+        }
+        break;
+    case PseudoName::NOP:
+        if (has_operands()) {
+            emit({make_mnemonic(MnemonicName::ADDI, is_scalar, col), make_zero(is_scalar, col), make_comma(col),
+                  make_zero(is_scalar, col), make_comma(col), make_immediate(0, col)});
+            return;
+        }
+        break;
+    case PseudoName::J:
+        if (has_operands(token::LabelRef{}) || has_operands(token::Immediate{})) {
+            emit({make_mnemonic(MnemonicName::JAL, false, col), make_zero(true, col), make_comma(col), operands[0]});
+            return;
+        }
+        break;
+    }
+
+    constexpr auto USAGES = std::array{"li rd, value", "mv rd, rs", "nop", "j target", "not rd, rs", "neg rd, rs"};
+    errors.emplace_back(std::format("Expected '{}{}'", is_scalar ? "s." : "", USAGES[static_cast<std::size_t>(name)]), col,
+                        line);
+}
+
+auto Expander::substitute_constants(std::span<const Token> tokens) const -> std::vector<Token> {
+    auto result = std::vector<Token>{tokens.begin(), tokens.end()};
+    if (constants.empty()) {
+        return result;
+    }
+    for (auto &token : result) {
+        if (token.is_of_type<token::LabelRef>()) {
+            if (const auto constant = constants.find(token.as<token::LabelRef>().label_name); constant != constants.end()) {
+                token.token_type = token::Immediate{constant->second};
+            }
+        }
+    }
+    return result;
+}
+
+auto Expander::macro_called(std::span<const Token> tokens) const -> const Macro * {
+    if (tokens.empty() || !tokens[0].is_of_type<token::LabelRef>()) {
+        return nullptr;
+    }
+    const auto macro = macros.find(tokens[0].as<token::LabelRef>().label_name);
+    return macro == macros.end() ? nullptr : &macro->second;
+}
+
+} // namespace as
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "error.hpp"
+#include "token.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace as {
+
+// A line of tokens produced by the expander, `line` is the source line errors in it get reported on
+struct ExpandedLine {
+    std::vector<Token> tokens;
+    std::uint32_t line;
+};
+
+// Expands the assembler's macro language and the pseudo-instructions (pseudo.hpp) on lexed lines, before they get
+// to the parser
+//
+//   .equ NAME, value           defines a constant, every later use of NAME as an operand is replaced by value
+//   .macro name p1, p2, ...    records the lines up to .endm, `name a1, a2, ...` on a line of its own (after an
+//   ...                        optional label) is replaced by them, with every use of a parameter replaced by the
+//   .endm                      argument in its position. Arguments are single tokens: registers, numbers, labels.
+//   .rept count[, symbol]      repeats the lines up to .endr count times, with symbol replaced by 0, 1, ...
+//   ...
+//   .endr
+//
+// Everything works on the tokens the lexer already produced, recorded lines are replayed without lexing them again.
+// The names are label references to the lexer, so they can't shadow mnemonics or registers. Constants can be
+// redefined, a use sees the latest definition before it. The lines of a macro report errors on the line of the
+// call, the lines of a .rept on their own. Labels get no special treatment, one in a body that is expanded more
+// than once is a duplicate.
+class Expander {
+  public:
+    // Whether `tokens` go to the parser unchanged, which is the case for most lines
+    [[nodiscard]] auto passes_through(std::span<const Token> tokens) const -> bool;
+
+    // Appends the lines that `tokens` expand to to `output`, possibly none while a body is being recorded
+    void expand(std::span<const Token> tokens, std::uint32_t line, std::vector<ExpandedLine> &output,
+                std::vector<sim::Error> &errors);
+
+    // Reports a .macro or .rept without its end
+    void finish(std::vector<sim::Error> &errors);
+
+    [[nodiscard]] auto is_constant(std::string_view name) const -> bool { return constants.contains(name); }
+
+  private:
+    struct Macro {
+        std::vector<std::string_view> parameters;
+        std::vector<ExpandedLine> body;
+    };
+
+    // A .macro or .rept whose body is being recorded
+    struct Recording {
+        bool is_macro; // .rept otherwise
+        std::uint32_t line;
+        std::string_view name; // Of the macro
+        Macro macro;
+        std::int32_t count{}; // Of the .rept
+        std::optional<std::string_view> symbol;
+        std::uint32_t nesting = 0; // Of bodies of the same kind inside this one
+        bool failed = false;       // The header had errors, the body gets dropped
+    };
+
+    void process(std::span<const Token> tokens, std::uint32_t line, std::uint32_t depth,
+                 std::vector<ExpandedLine> &output, std::vector<sim::Error> &errors);
+    void record(std::span<const Token> tokens, std::uint32_t line, std::uint32_t depth,
+                std::vector<ExpandedLine> &output, std::vector<sim::Error> &errors);
+
+    void define_constant(std::span<const Token> tokens, std::uint32_t line, std::vector<sim::Error> &errors);
+    void begin_macro(std::span<const Token> tokens, std::uint32_t line, std::vector<sim::Error> &errors);
+    void begin_rept(std::span<const Token> tokens, std::uint32_t line, std::vector<sim::Error> &errors);
+    void call_macro(const Macro &macro, std::span<const Token> tokens, std::uint32_t line, std::uint32_t depth,
+                    std::vector<ExpandedLine> &output, std::vector<sim::Error> &errors);
+    void expand_pseudo(std::span<const Token> tokens, std::uint32_t line, std::vector<ExpandedLine> &output,
+                       std::vector<sim::Error> &errors) const;
+
+    // Replaces the constants among `tokens` by their values
+    [[nodiscard]] auto substitute_constants(std::span<const Token> tokens) const -> std::vector<Token>;
+    [[nodiscard]] auto macro_called(std::span<const Token> tokens) const -> const Macro *;
+
+    std::unordered_map<std::string_view, std::int32_t> constants;
+    std::unordered_map<std::string_view, Macro> macros;
+    std::optional<Recording> recording;
+};
+
+} // namespace as
@@ -0,0 +1,256 @@
+#include "kernel_library.hpp"
+#include "emitter.hpp"
+#include "linker.hpp"
+#include "parser.hpp"
+#include "source_file.hpp"
+#include <algorithm>
+#include <bit>
+#include <format>
+
+namespace as {
+
+namespace {
+
+// Every array of a job gets a region of its own, the arguments live below the first one
+constexpr auto REGION_SIZE = IData{1} << 16u;
+constexpr auto REGION_BASE = REGION_SIZE;
+
+constexpr auto HISTOGRAM_BIN_SHIFT = 4u;
+constexpr auto MATMUL_K_SHIFT = 4u;
+constexpr auto MATMUL_N_SHIFT = 4u;
+constexpr auto SAXPY_A = IData{0x9A5};
+constexpr auto MAX_SCAN_WARPS = 32u;
+
+auto region(IData index) -> IData { return REGION_BASE + index * REGION_SIZE; }
+
+// Numerical Recipes LCG, good enough for test inputs
+class Inputs {
+  public:
+    explicit Inputs(std::uint32_t seed) : state(seed) {}
+
+    auto next() -> IData {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    }
+
+    // Writes count values below `limit` (all 32 bits without) from `address` on and returns them
+    auto fill(sim::data_memory_container_t &memory, IData address, std::uint32_t count, IData limit = 0)
+        -> std::vector<IData> {
+        auto values = std::vector<IData>(count);
+        for (auto i = 0u; i < count; i++) {
+            values[i] = limit == 0 ? next() : next() % limit;
+            memory[address + i] = values[i];
+        }
+        return values;
+    }
+
+  private:
+    std::uint32_t state;
+};
+
+auto ceil_log2(std::uint32_t value) -> std::uint32_t { return value <= 1 ? 0 : std::bit_width(value - 1); }
+
+// The words of `expected` from `address` on
+void expect(KernelJob &job, IData address, std::span<const IData> values) {
+    for (auto i = 0u; i < values.size(); i++) {
+        job.expected.emplace_back(address + i, values[i]);
+    }
+}
+
+} // namespace
+
+auto link_kernel_routine(const std::filesystem::path &kernels_dir, std::string_view routine)
+    -> std::expected<sim::KernelObjectContents, std::vector<std::string>> {
+    auto assemble = [&](std::string_view name) -> std::expected<LinkInput, std::vector<std::string>> {
+        const auto path = kernels_dir / std::format("{}.as", name);
+        const auto source = SourceFile::open(path);
+        if (!source.has_value()) {
+            return std::unexpected{std::vector{source.error()}};
+        }
+        const auto program = parse_module(source->view());
+        if (!program.has_value()) {
+            auto errors = std::vector<std::string>{};
+            for (const auto &error : program.error()) {
+                errors.push_back(std::format("{}:{}:{}: {}", path.string(), error.line, error.column, error.message));
+            }
+            return std::unexpected{std::move(errors)};
+        }
+        return LinkInput{.name = path.string(),
+                         .object = make_relocatable_object(*program, translate_to_binary(*program))};
+    };
+
+    const auto entry = assemble(routine);
+    if (!entry.has_value()) {
+        return std::unexpected{entry.error()};
+    }
+    const auto grid = assemble("grid");
+    if (!grid.has_value()) {
+        return std::unexpected{grid.error()};
+    }
+    return link(std::span{&*entry, 1}, std::span{&*grid, 1});
+}
+
+auto make_kernel_job(std::string_view routine, std::uint32_t num_elements, IData num_blocks,
+                     IData num_warps_per_block, std::uint32_t seed) -> std::expected<KernelJob, std::string> {
+    if (num_elements == 0 || num_elements > REGION_SIZE) {
+        return std::unexpected{std::format("Expected between 1 and {} elements", REGION_SIZE)};
+    }
+    if (num_blocks == 0 || num_warps_per_block == 0) {
+        return std::unexpected{std::string{"Expected at least one block of one warp"}};
+    }
+
+    auto job = KernelJob{.routine = std::string{routine}, .num_elements = num_elements};
+    auto inputs = Inputs{seed};
+    const auto n = num_elements;
+    const auto num_warps = num_blocks * num_warps_per_block;
+    const auto num_threads = num_warps * KERNEL_THREADS_PER_WARP;
+    // Arguments 0 and 1 of every launch
+    auto grid_launch = [&](IData blocks, IData warps, IData elements, MemoryWords arguments) {
+        arguments.insert(arguments.begin(), {{0, blocks}, {1, elements}});
+        job.launches.push_back(KernelLaunch{.num_blocks = blocks, .num_warps_per_block = warps,
+                                            .arguments = std::move(arguments)});
+    };
+
+    if (routine == "memcpy") {
+        const auto src = inputs.fill(job.memory, region(0), n);
+        grid_launch(num_blocks, num_warps_per_block, n, {{2, region(1)}, {3, region(0)}});
+        expect(job, region(1), src);
+        job.expected.emplace_back(region(1) + n, 0); // Nothing past the end
+    } else if (routine == "memset") {
+        const auto value = inputs.next();
+        grid_launch(num_blocks, num_warps_per_block, n, {{2, region(0)}, {3, value}});
+        expect(job, region(0), std::vector<IData>(n, value));
+        job.expected.emplace_back(region(0) + n, 0);
+    } else if (routine == "reduce") {
+        const auto src = inputs.fill(job.memory, region(0), n);
+        // A partial sum per warp in region 1, then a single warp adds those up into region 3
+        grid_launch(num_blocks, num_warps_per_block, n, {{2, region(1)}, {3, region(0)}, {4, region(2)}});
+        grid_launch(1, 1, num_warps, {{2, region(3)}, {3, region(1)}, {4, region(2)}});
+        auto sum = IData{};
+        for (const auto value : src) {
+            sum += value;
+        }
+        job.expected.emplace_back(region(3), sum);
+    } else if (routine == "scan") {
+        if (num_warps > MAX_SCAN_WARPS) {
+            return std::unexpected{std::format("scan takes at most {} warps", MAX_SCAN_WARPS)};
+        }
+        const auto src = inputs.fill(job.memory, region(0), n);
+        const auto chunk_shift = std::max(5u, ceil_log2((n + num_warps - 1) / num_warps));
+        const auto pass = [&](IData blocks, IData warps, IData elements, IData number) {
+            grid_launch(blocks, warps, elements,
+                        {{2, region(1)}, {3, region(0)}, {4, region(2)}, {5, chunk_shift}, {6, number}});
+        };
+        pass(num_blocks, num_warps_per_block, n, 0);
+        pass(1, 1, num_warps, 1);
+        pass(num_blocks, num_warps_per_block, n, 2);
+        auto prefix = std::vector<IData>(n);
+        auto sum = IData{};
+        for (auto i = 0u; i < n; i++) {
+            sum += src[i];
+            prefix[i] = sum;
+        }
+        expect(job, region(1), prefix);
+        job.expected.emplace_back(region(1) + n, 0);
+    } else if (routine == "histogram") {
+        constexpr auto bins = 1u << HISTOGRAM_BIN_SHIFT;
+        if (num_threads * bins > REGION_SIZE) {
+            return std::unexpected{std::format("histogram takes at most {} threads", REGION_SIZE / bins)};
+        }
+        const auto src = inputs.fill(job.memory, region(0), n);
+        auto histograms = num_threads;
+        auto source = region(1);
+        grid_launch(num_blocks, num_warps_per_block, n,
+                    {{2, source}, {3, region(0)}, {4, HISTOGRAM_BIN_SHIFT}, {5, 0}});
+        // Every merge does about half of the levels left, with at most one output word per thread
+        for (auto next_region = IData{2}; histograms > 1; next_region++) {
+            auto group_shift = std::max(1u, (ceil_log2(histograms) + 1) / 2);
+            while (((histograms + (1u << group_shift) - 1) >> group_shift) * bins > num_threads) {
+                group_shift++;
+            }
+            histograms = (histograms + (1u << group_shift) - 1) >> group_shift;
+            grid_launch(num_blocks, num_warps_per_block, histograms * bins,
+                        {{2, region(next_region)}, {3, source}, {4, HISTOGRAM_BIN_SHIFT}, {5, 1}, {6, group_shift}});
+            source = region(next_region);
+        }
+        auto counts = std::vector<IData>(bins);
+        for (const auto value : src) {
+            counts[value % bins]++;
+        }
+        expect(job, source, counts);
+    } else if (routine == "saxpy") {
+        const auto x = inputs.fill(job.memory, region(0), n, IData{1} << 16u);
+        const auto y = inputs.fill(job.memory, region(1), n);
+        grid_launch(num_blocks, num_warps_per_block, n, {{2, region(1)}, {3, region(0)}, {4, SAXPY_A}});
+        auto result = std::vector<IData>(n);
+        for (auto i = 0u; i < n; i++) {
+            result[i] = SAXPY_A * x[i] + y[i];
+        }
+        expect(job, region(1), result);
+        job.expected.emplace_back(region(1) + n, 0);
+    } else if (routine == "matmul") {
+        constexpr auto k = 1u << MATMUL_K_SHIFT;
+        constexpr auto columns = 1u << MATMUL_N_SHIFT;
+        if (n % columns != 0) {
+            return std::unexpected{std::format("matmul takes a multiple of {} elements", columns)};
+        }
+        const auto rows = n / columns;
+        if (rows * k > REGION_SIZE) {
+            return std::unexpected{std::format("matmul takes at most {} rows", REGION_SIZE / k)};
+        }
+        const auto a = inputs.fill(job.memory, region(0), rows * k, IData{1} << 16u);
+        const auto b = inputs.fill(job.memory, region(1), k * columns, IData{1} << 8u);
+        grid_launch(num_blocks, num_warps_per_block, n,
+                    {{2, region(2)}, {3, region(0)}, {4, region(1)}, {5, MATMUL_K_SHIFT}, {6, MATMUL_N_SHIFT}});
+        auto c = std::vector<IData>(n);
+        for (auto row = 0u; row < rows; row++) {
+            for (auto column = 0u; column < columns; column++) {
+                for (auto i = 0u; i < k; i++) {
+                    c[row * columns + column] += a[row * k + i] * b[i * columns + column];
+                }
+            }
+        }
+        expect(job, region(2), c);
+        job.expected.emplace_back(region(2) + n, 0);
+    } else {
+        return std::unexpected{std::format("Unknown routine '{}'", routine)};
+    }
+    return job;
+}
+
+void write_arguments(const KernelLaunch &launch, sim::data_memory_container_t &memory) {
+    for (const auto &[address, value] : launch.arguments) {
+        memory[address] = value;
+    }
+}
+
+auto execute_kernel_job(const KernelJob &job, std::span<const IData> program, std::uint32_t warps_per_core)
+    -> sim::data_memory_container_t {
+    auto memory = job.memory;
+    for (const auto &launch : job.launches) {
+        write_arguments(launch, memory);
+        auto executor = sim::Executor{sim::ExecutorConfig{.warps_per_core = warps_per_core,
+                                                          .threads_per_warp = KERNEL_THREADS_PER_WARP,
+                                                          .num_blocks = launch.num_blocks,
+                                                          .num_warps_per_block = launch.num_warps_per_block},
+                                      program, std::move(memory)};
+        executor.run();
+        memory = std::move(executor.get_memory());
+    }
+    return memory;
+}
+
+auto check_kernel_job(const KernelJob &job, const sim::data_memory_container_t &memory, std::size_t max_errors)
+    -> std::vector<std::string> {
+    auto errors = std::vector<std::string>{};
+    for (const auto &[address, value] : job.expected) {
+        const auto word = memory.find(address);
+        const auto actual = word != memory.end() ? word->second : IData{0};
+        if (actual != value && errors.size() < max_errors) {
+            errors.push_back(std::format("{} word {:#x}: expected {}, got {}", job.routine, address, value, actual));
+        }
+    }
+    return errors;
+}
+
+} // namespace as
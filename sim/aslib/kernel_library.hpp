@@ -0,0 +1,71 @@
+#pragma once
+
+#include "kernel_object.hpp"
+#include "executor.hpp"
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace as {
+
+// Kernel library
+//
+// The routines in kernels/ are hand-written modules that export nothing and call grid_setup (kernels/grid.as),
+// which is linked in as a library. They take their arguments from the start of the data memory: word 0 is the
+// number of blocks of the launch, word 1 the number of elements, the others depend on the routine. Routines that need
+// the whole grid to finish before going on (reduce, scan, histogram) take several launches, the data memory carries
+// over from one to the next. See the header comment of each routine for its arguments.
+//
+// A KernelJob has everything to run a routine on pseudo-random inputs and check its results: the inputs, the
+// launches with their arguments and the words the memory must hold after the last one. Tests and benchmarks run the
+// same jobs, on the executor or on the RTL.
+
+constexpr auto KERNEL_ROUTINES =
+    std::array<std::string_view, 7>{"memcpy", "memset", "reduce", "scan", "histogram", "saxpy", "matmul"};
+
+// The routines assume warps of this many threads
+constexpr auto KERNEL_THREADS_PER_WARP = 32u;
+
+// Links `<kernels_dir>/<routine>.as` with grid.as
+auto link_kernel_routine(const std::filesystem::path &kernels_dir, std::string_view routine)
+    -> std::expected<sim::KernelObjectContents, std::vector<std::string>>;
+
+using MemoryWords = std::vector<std::pair<IData, IData>>; // Address and value
+
+struct KernelLaunch {
+    IData num_blocks;
+    IData num_warps_per_block;
+    MemoryWords arguments; // Written to the data memory before the launch
+};
+
+struct KernelJob {
+    std::string routine;
+    std::uint32_t num_elements{};
+    sim::data_memory_container_t memory; // Inputs
+    std::vector<KernelLaunch> launches;
+    MemoryWords expected;
+};
+
+// A job for `routine` on num_elements elements (of C for matmul, a multiple of 16), with the launches spread over
+// num_blocks blocks of num_warps_per_block warps. scan needs at most 32 warps in the grid.
+auto make_kernel_job(std::string_view routine, std::uint32_t num_elements, IData num_blocks,
+                     IData num_warps_per_block, std::uint32_t seed = 1) -> std::expected<KernelJob, std::string>;
+
+// Writes the arguments of `launch` into `memory`
+void write_arguments(const KernelLaunch &launch, sim::data_memory_container_t &memory);
+
+// Runs every launch of `job` on the executor and returns the data memory after the last one
+auto execute_kernel_job(const KernelJob &job, std::span<const IData> program, std::uint32_t warps_per_core = 2)
+    -> sim::data_memory_container_t;
+
+// The words of `memory` that don't have the expected value, one message each and at most max_errors of them
+auto check_kernel_job(const KernelJob &job, const sim::data_memory_container_t &memory, std::size_t max_errors = 8)
+    -> std::vector<std::string>;
+
+} // namespace as
@@ -0,0 +1,414 @@
+#pragma once
+
+#include "common.hpp"
+#include "instructions.hpp"
+#include "parser.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+namespace as {
+
+// Kernels assembled at C++ compile time
+//
+//   constexpr auto program = as::kernel<"addi x5, x1, 1\n"
+//                                       "sw x5, 0(x1)\n"
+//                                       "halt\n">();
+//   using namespace as::literals;
+//   constexpr auto same = "addi x5, x1, 1\nsw x5, 0(x1)\nhalt\n"_kernel;
+//
+// Both give a std::array<IData, N> with the machine code of the N instructions. The syntax is the one
+// parse_program takes, minus the expander: labels, branch and jump targets, comments and the .blocks and .warps
+// directives (which configure the kernel and don't end up in the array) work, macros, constants, repeats and
+// pseudo-instructions don't. Anything ill-formed fails the compilation, the diagnostic points at the
+// kernel_literal::syntax_error call with the message.
+namespace kernel_literal {
+
+template <std::size_t N>
+struct FixedString {
+    char data[N]{};
+
+    consteval FixedString(const char (&str)[N]) { std::copy_n(str, N, data); }
+
+    [[nodiscard]] constexpr auto view() const -> std::string_view { return {data, N - 1}; }
+};
+
+// Not constexpr on purpose, reaching it during constant evaluation is what makes the compilation fail
+inline void syntax_error(const char *message) {
+    (void)message;
+}
+
+// The source of a single line
+class Cursor {
+  public:
+    constexpr explicit Cursor(std::string_view line) : rest(line.substr(0, line.find('#'))) {}
+
+    constexpr void skip_whitespace() {
+        while (!rest.empty() && is_whitespace(rest.front())) {
+            rest.remove_prefix(1);
+        }
+    }
+
+    [[nodiscard]] constexpr auto at_end() -> bool {
+        skip_whitespace();
+        return rest.empty();
+    }
+
+    [[nodiscard]] constexpr auto peek() -> char {
+        skip_whitespace();
+        return rest.empty() ? '\0' : rest.front();
+    }
+
+    constexpr auto consume(char c) -> bool {
+        if (peek() != c) {
+            return false;
+        }
+        rest.remove_prefix(1);
+        return true;
+    }
+
+    constexpr void expect(char c, const char *message) {
+        if (!consume(c)) {
+            syntax_error(message);
+        }
+    }
+
+    // Mnemonics, registers, labels and directive names
+    constexpr auto word() -> std::string_view {
+        skip_whitespace();
+        auto length = std::size_t{0};
+        while (length < rest.size() && char_class::has(rest[length], char_class::KEYWORD)) {
+            length++;
+        }
+        const auto result = rest.substr(0, length);
+        rest.remove_prefix(length);
+        return result;
+    }
+
+    // Same formats as parse_num: decimal, 0x hexadecimal, 0b binary and octal with a leading 0
+    constexpr auto number() -> std::int32_t {
+        const auto is_negative = consume('-');
+        auto base = std::uint8_t{10};
+        if (rest.size() > 1 && rest[0] == '0') {
+            if (rest[1] == 'x' || rest[1] == 'X') {
+                base = 16;
+                rest.remove_prefix(2);
+            } else if (rest[1] == 'b' || rest[1] == 'B') {
+                base = 2;
+                rest.remove_prefix(2);
+            } else {
+                base = 8;
+            }
+        }
+
+        auto value = std::int64_t{0};
+        auto digits = 0u;
+        for (; !rest.empty() && is_numeric(rest.front(), 16); rest.remove_prefix(1), digits++) {
+            if (!is_numeric(rest.front(), base)) {
+                syntax_error("Invalid digit for the base of the number");
+            }
+            value = value * base + char_class::digit_table[static_cast<unsigned char>(rest.front())];
+            if (value > std::numeric_limits<std::int32_t>::max()) {
+                syntax_error("Number out of the 32-bit range");
+            }
+        }
+        if (digits == 0) {
+            syntax_error("Expected a number");
+        }
+        return static_cast<std::int32_t>(is_negative ? -value : value);
+    }
+
+    constexpr auto reg() -> sim::Register {
+        const auto name = word();
+        if (name.size() < 2 || (name[0] != 'x' && name[0] != 's')) {
+            syntax_error("Expected a register");
+        }
+        auto number = IData{0};
+        for (const auto c : name.substr(1)) {
+            if (!is_numeric(c)) {
+                syntax_error("Expected a register");
+            }
+            number = number * 10 + static_cast<IData>(c - '0');
+            if (number >= 32) {
+                syntax_error("Register number out of range");
+            }
+        }
+        return sim::Register{.register_number = number,
+                             .type = name[0] == 's' ? sim::RegisterType::SCALAR : sim::RegisterType::VECTOR};
+    }
+
+    // <imm>(<rs1>)
+    struct Address {
+        std::int32_t offset;
+        sim::Register base;
+    };
+    constexpr auto address() -> Address {
+        const auto offset = number();
+        expect('(', "Expected '('");
+        const auto base = reg();
+        expect(')', "Expected ')'");
+        return {.offset = offset, .base = base};
+    }
+
+  private:
+    std::string_view rest;
+};
+
+// What a line holds, the label and mnemonic are empty when it doesn't have them
+struct Line {
+    std::string_view label;
+    std::string_view mnemonic;
+    Cursor operands;
+};
+
+constexpr auto split_line(std::string_view line) -> Line {
+    auto cursor = Cursor{line};
+    auto result = Line{.label = {}, .mnemonic = {}, .operands = cursor};
+    if (cursor.at_end()) {
+        return result;
+    }
+
+    if (cursor.consume('.')) {
+        const auto directive = cursor.word();
+        if (directive != "blocks" && directive != "warps") {
+            syntax_error("Only the .blocks and .warps directives are supported");
+        }
+        if (cursor.number() < 1) {
+            syntax_error("The number of blocks and warps has to be positive");
+        }
+        if (!cursor.at_end()) {
+            syntax_error("Expected the end of the line after a directive");
+        }
+        return result;
+    }
+
+    auto first = cursor.word();
+    if (first.empty()) {
+        syntax_error("Expected a label or a mnemonic");
+    }
+    if (first.back() == ':') {
+        result.label = first.substr(0, first.size() - 1);
+        first = cursor.word();
+    }
+    result.mnemonic = first;
+    result.operands = cursor;
+    return result;
+}
+
+template <typename Function>
+constexpr void for_each_line(std::string_view source, Function function) {
+    while (!source.empty()) {
+        const auto end = source.find('\n');
+        function(split_line(source.substr(0, end)));
+        source = end == std::string_view::npos ? std::string_view{} : source.substr(end + 1);
+    }
+}
+
+constexpr auto count_instructions(std::string_view source) -> std::size_t {
+    auto count = std::size_t{0};
+    for_each_line(source, [&](const Line &line) { count += line.mnemonic.empty() ? 0 : 1; });
+    return count;
+}
+
+// Index of the instruction the label is in front of
+constexpr auto find_label(std::string_view source, std::string_view label) -> std::optional<std::uint32_t> {
+    auto index = 0u;
+    auto found = std::optional<std::uint32_t>{};
+    for_each_line(source, [&](const Line &line) {
+        if (!found.has_value() && line.label == label) {
+            found = index;
+        }
+        index += line.mnemonic.empty() ? 0 : 1;
+    });
+    return found;
+}
+
+// A label or a number of instructions, relative to the instruction at `index`
+constexpr auto target_offset(std::string_view source, Cursor &operands, std::uint32_t index, unsigned bits)
+    -> std::int64_t {
+    auto offset = std::int64_t{0};
+    if (operands.peek() == '-' || is_numeric(operands.peek())) {
+        offset = operands.number();
+    } else {
+        const auto target = find_label(source, operands.word());
+        if (!target.has_value()) {
+            syntax_error("Undefined label");
+        }
+        offset = std::int64_t{*target} - index;
+    }
+    if (!sim::fits_offset(offset, bits)) {
+        syntax_error("Branch or jump target out of reach");
+    }
+    return offset;
+}
+
+constexpr void check_type(const sim::Register &reg, bool should_be_scalar) {
+    if ((reg.type == sim::RegisterType::SCALAR) != should_be_scalar) {
+        syntax_error("Mixed scalar and vector registers");
+    }
+}
+
+// The fields of sim::instructions::create_*_instruction, which aren't usable in constant expressions. Immediates get
+// the range checks of the parser.
+constexpr auto encode_rd(const sim::Register &rd) -> IData { return rd.register_number << 7u; }
+constexpr auto encode_rs1(const sim::Register &rs1) -> IData { return rs1.register_number << 15u; }
+constexpr auto encode_rs2(const sim::Register &rs2) -> IData { return rs2.register_number << 20u; }
+constexpr auto checked_immediate(std::int32_t imm, unsigned bits) -> IData {
+    if (!sim::fits_immediate(imm, bits)) {
+        syntax_error("Immediate out of range");
+    }
+    return (IData)imm & (((IData)1 << bits) - 1u);
+}
+constexpr auto encode_imm12(std::int32_t imm) -> IData { return checked_immediate(imm, sim::IMMEDIATE_BITS) << 20u; }
+constexpr auto encode_store_offset(std::int32_t imm) -> IData {
+    const auto imm12 = checked_immediate(imm, sim::IMMEDIATE_BITS);
+    return (imm12 >> 5u) << 25u | (imm12 & 0x1Fu) << 7u;
+}
+constexpr auto encode_branch_offset(std::int64_t offset) -> IData {
+    const auto imm13 = (IData)offset << 1u;
+    return ((imm13 >> 12u) & 1u) << 31u | ((imm13 >> 5u) & 0b111111u) << 25u | ((imm13 >> 1u) & 0b1111u) << 8u |
+           ((imm13 >> 11u) & 1u) << 7u;
+}
+constexpr auto encode_jump_offset(std::int64_t offset) -> IData {
+    const auto imm21 = (IData)offset << 1u;
+    return ((imm21 >> 20u) & 1u) << 31u | ((imm21 >> 1u) & 0x3FFu) << 21u | ((imm21 >> 11u) & 1u) << 20u |
+           ((imm21 >> 12u) & 0xFFu) << 12u;
+}
+
+constexpr auto assemble_instruction(std::string_view source, Line line, std::uint32_t index) -> IData {
+    const auto mnemonic = sim::str_to_mnemonic(line.mnemonic);
+    if (!mnemonic.has_value()) {
+        syntax_error("Unknown mnemonic");
+    }
+    const auto name = mnemonic->get_name();
+    const auto is_scalar = mnemonic->is_scalar();
+    const auto [opcode, funct3, funct7] = sim::name_to_determinant(name);
+    auto &operands = line.operands;
+
+    auto bits = (IData)opcode | (IData)funct3 << 12u;
+    if (name == sim::MnemonicName::HALT) {
+        // Nothing to add
+    } else if (parser::is_itype_arithmetic(name)) {
+        const auto rd = operands.reg();
+        operands.expect(',', "Expected ','");
+        const auto rs1 = operands.reg();
+        operands.expect(',', "Expected ','");
+        const auto imm = operands.number();
+        const auto is_vector_scalar = name == sim::MnemonicName::SX_SLTI;
+        check_type(rd, is_scalar);
+        check_type(rs1, is_scalar && !is_vector_scalar);
+        if (sim::is_itype_shift(name) && (imm < 0 || imm >= (1 << sim::SHIFT_AMOUNT_BITS))) {
+            syntax_error("Shift amount out of range");
+        }
+        bits |= encode_rd(rd) | encode_rs1(rs1) | encode_imm12(imm);
+        if (sim::is_itype_shift(name)) {
+            bits |= (IData)funct7 << 25u;
+        }
+    } else if (parser::is_rtype(name)) {
+        const auto rd = operands.reg();
+        operands.expect(',', "Expected ','");
+        const auto rs1 = operands.reg();
+        operands.expect(',', "Expected ','");
+        const auto rs2 = operands.reg();
+        const auto is_vector_scalar = name == sim::MnemonicName::SX_SLT;
+        check_type(rd, is_scalar);
+        check_type(rs1, is_scalar && !is_vector_scalar);
+        check_type(rs2, is_scalar && !is_vector_scalar);
+        bits |= encode_rd(rd) | encode_rs1(rs1) | encode_rs2(rs2) | (IData)funct7 << 25u;
+    } else if (parser::is_load_type(name)) {
+        const auto rd = operands.reg();
+        operands.expect(',', "Expected ','");
+        const auto [offset, rs1] = operands.address();
+        check_type(rd, is_scalar);
+        check_type(rs1, is_scalar);
+        bits |= encode_rd(rd) | encode_rs1(rs1) | encode_imm12(offset);
+    } else if (parser::is_store_type(name)) {
+        const auto rs2 = operands.reg();
+        operands.expect(',', "Expected ','");
+        const auto [offset, rs1] = operands.address();
+        check_type(rs1, is_scalar);
+        check_type(rs2, is_scalar);
+        bits |= encode_rs1(rs1) | encode_rs2(rs2) | encode_store_offset(offset);
+    } else if (parser::is_utype(name)) {
+        const auto rd = operands.reg();
+        operands.expect(',', "Expected ','");
+        const auto imm = operands.number();
+        check_type(rd, is_scalar);
+        bits |= encode_rd(rd) | checked_immediate(imm, sim::UPPER_IMMEDIATE_BITS) << 12u;
+    } else if (parser::is_btype(name)) {
+        const auto rs1 = operands.reg();
+        operands.expect(',', "Expected ','");
+        const auto rs2 = operands.reg();
+        operands.expect(',', "Expected ','");
+        check_type(rs1, true);
+        check_type(rs2, true);
+        bits |= encode_rs1(rs1) | encode_rs2(rs2) |
+                encode_branch_offset(target_offset(source, operands, index, sim::BRANCH_OFFSET_BITS));
+    } else if (name == sim::MnemonicName::JAL) {
+        const auto rd = operands.reg();
+        operands.expect(',', "Expected ','");
+        bits |= encode_rd(rd) | encode_jump_offset(target_offset(source, operands, index, sim::JUMP_OFFSET_BITS));
+    } else if (name == sim::MnemonicName::JALR) {
+        // jalr <rd>, <label> jumps to the label through x0, like in parse_program
+        const auto rd = operands.reg();
+        operands.expect(',', "Expected ','");
+        if (operands.peek() == '-' || is_numeric(operands.peek())) {
+            const auto [offset, rs1] = operands.address();
+            bits |= encode_rd(rd) | encode_rs1(rs1) | encode_imm12(offset);
+        } else {
+            const auto target = find_label(source, operands.word());
+            if (!target.has_value()) {
+                syntax_error("Undefined label");
+            }
+            bits |= encode_rd(rd) | encode_imm12((std::int32_t)*target);
+        }
+    }
+
+    if (!operands.at_end()) {
+        syntax_error("Expected the end of the line after the operands");
+    }
+    if (is_scalar) {
+        bits |= (IData)1 << 6u;
+    }
+    return bits;
+}
+
+template <std::size_t N>
+consteval auto assemble(std::string_view source) -> std::array<IData, N> {
+    auto program = std::array<IData, N>{};
+    auto index = 0u;
+    for_each_line(source, [&](const Line &line) {
+        if (!line.label.empty()) {
+            if (find_label(source, line.label) != index) {
+                syntax_error("Duplicate label declaration");
+            }
+        }
+        if (!line.mnemonic.empty()) {
+            program[index] = assemble_instruction(source, line, index);
+            index++;
+        }
+    });
+    return program;
+}
+
+} // namespace kernel_literal
+
+template <kernel_literal::FixedString Source>
+consteval auto kernel() -> std::array<IData, kernel_literal::count_instructions(Source.view())> {
+    return kernel_literal::assemble<kernel_literal::count_instructions(Source.view())>(Source.view());
+}
+
+namespace literals {
+
+template <kernel_literal::FixedString Source>
+consteval auto operator""_kernel() {
+    return kernel<Source>();
+}
+
+} // namespace literals
+
+} // namespace as
@@ -12,15 +12,18 @@ auto Lexer::chop() -> char {
     return result;
 }
 
-auto Lexer::chop_while(const std::function<bool(char)> &predicate) -> std::string_view {
-    auto i = 0u;
-    while (i < source.size() && predicate(source[i])) {
-        i++;
-        column_number++;
-    }
-
-    auto result = source.substr(0, i);
-    source.remove_prefix(i);
+template <typename Predicate> auto Lexer::chop_while(Predicate predicate) -> std::string_view {
+    const auto *const begin = source.data();
+    const auto *const end = begin + source.size();
+    const auto *it = begin;
+    while (it != end && predicate(*it)) {
+        it++;
+    }
+
+    const auto length = static_cast<std::size_t>(it - begin);
+    column_number += length;
+    auto result = source.substr(0, length);
+    source.remove_prefix(length);
     return result;
 }
 
@@ -32,13 +35,7 @@ auto Lexer::peek() -> std::optional<char> {
 }
 
 void Lexer::trim_whitespace() {
-    while (auto c = peek()) {
-        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
-            chop();
-        } else {
-            break;
-        }
-    }
+    chop_while(char_class::Is<char_class::WHITESPACE>{});
 }
 
 auto Lexer::make_error(std::string&& message, std::optional<uint32_t> col) -> Error {
@@ -52,7 +49,7 @@ auto Lexer::make_error(sim::Error&& error, std::optional<uint32_t> col) -> Error
 }
 
 auto Lexer::parse_directive() -> std::expected<Token, Error> {
-    const auto keyword = chop_while([](char c) {return !is_whitespace(c);});
+    const auto keyword = chop_while(char_class::IsNot<char_class::WHITESPACE>{});
 
     if (keyword == "blocks") {
         return Token{.token_type=token::BlocksDirective{}, .col=column_number};
@@ -62,6 +59,32 @@ auto Lexer::parse_directive() -> std::expected<Token, Error> {
         return Token{.token_type=token::WarpsDirective{}, .col=column_number};
     }
 
+    // Exports a label to other modules, see linker.hpp
+    if (keyword == "global") {
+        return Token{.token_type=token::GlobalDirective{}, .col=column_number};
+    }
+
+    // Expanded before parsing, see expander.hpp
+    if (keyword == "equ") {
+        return Token{.token_type=token::EquDirective{}, .col=column_number};
+    }
+
+    if (keyword == "macro") {
+        return Token{.token_type=token::MacroDirective{}, .col=column_number};
+    }
+
+    if (keyword == "endm") {
+        return Token{.token_type=token::EndmDirective{}, .col=column_number};
+    }
+
+    if (keyword == "rept") {
+        return Token{.token_type=token::ReptDirective{}, .col=column_number};
+    }
+
+    if (keyword == "endr") {
+        return Token{.token_type=token::EndrDirective{}, .col=column_number};
+    }
+
     if (keyword.empty()) {
         return std::unexpected(make_error(std::format("Unexpected whitespace after '.',  expected a directive name after '.'")));
     }
@@ -74,8 +97,13 @@ auto Lexer::parse_number() -> std::expected<Token, Error> {
     const auto source_size_before = source.size();
     auto number = parse_num(source);
     if (!number.has_value()) {
+        // Skip past the bad number, otherwise the next token starts at the same place again
+        if (source.size() == source_size_before) {
+            source.remove_prefix(1);
+        }
+        column_number += source_size_before - source.size();
         auto error = number.error();
-        return std::unexpected(make_error(std::move(error)));
+        return std::unexpected(make_error(std::move(error), starting_col));
     }
     column_number += source_size_before - source.size();
     return Token{.token_type=token::Immediate{*number}, .col=starting_col};
@@ -84,7 +112,7 @@ auto Lexer::parse_number() -> std::expected<Token, Error> {
 auto Lexer::parse_keyword() -> std::expected<Token, Error> {
     const auto starting_col = column_number;
 
-    auto word = chop_while([](char c) { return is_alphanumeric(c) || is_label_char(c) || c == '.' || c == ':'; });
+    auto word = chop_while(char_class::Is<char_class::KEYWORD>{});
     const auto opcode = sim::str_to_mnemonic(word);
 
     // 1. Check if it's an opcode
@@ -92,10 +120,15 @@ auto Lexer::parse_keyword() -> std::expected<Token, Error> {
         return Token{.token_type=token::Mnemonic{.mnemonic = *opcode}, .col=starting_col};
     }
 
+    // Pseudo-instructions look the same, the expander replaces them
+    if (const auto pseudo = str_to_pseudo(word); pseudo.has_value()) {
+        return Token{.token_type=token::Pseudo{.pseudo = *pseudo}, .col=starting_col};
+    }
+
     // 2. Check if it's a label
     if (word.back() == ':') {
         word.remove_suffix(1);
-        if (str_check_predicate(word, is_label_char)) {
+        if (str_check_predicate(word, char_class::Is<char_class::LABEL>{})) {
             return Token{.token_type=token::Label{.name = word}, .col=starting_col};
         }
     }
@@ -112,7 +145,7 @@ auto Lexer::parse_keyword() -> std::expected<Token, Error> {
     }
 
     // 4. Check if it's a label reference
-    if (str_check_predicate(word, is_label_char)) {
+    if (str_check_predicate(word, char_class::Is<char_class::LABEL>{})) {
         return Token{.token_type=token::LabelRef{.label_name = word}, .col=starting_col};
     }
 
@@ -165,6 +198,31 @@ auto Lexer::next_token() -> std::optional<std::expected<Token, Error>> {
     return std::unexpected(make_error(std::format("Unexpected character '{}'", c), first_char_column));
 }
 
+auto Lexer::next_line(std::pmr::vector<Token> &tokens, std::vector<Error> &errors) -> bool {
+    tokens.clear();
+    if (source.empty()) {
+        return false;
+    }
+
+    const auto line_end = source.find('\n');
+    const auto rest = line_end == std::string_view::npos ? std::string_view{} : source.substr(line_end + 1);
+    source = source.substr(0, line_end);
+    column_number = 1;
+    line_number++;
+
+    while (auto next = next_token()) {
+        if (next->has_value()) {
+            tokens.push_back(next->value());
+        } else {
+            errors.push_back(next->error().with_line(line_number));
+        }
+    }
+
+    // Whatever is left of the line after a comment is skipped
+    source = rest;
+    return true;
+}
+
 auto collect_tokens(const std::string_view source) -> std::pair<std::vector<Token>, std::vector<sim::Error>> {
     auto tokens = std::vector<Token>{};
     auto errors = std::vector<sim::Error>{};
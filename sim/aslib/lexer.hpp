@@ -2,18 +2,28 @@
 
 #include "error.hpp"
 #include "token.hpp"
-#include <functional>
+#include <memory_resource>
+#include <vector>
 
 namespace as {
 class Lexer {
   public:
     Lexer() = delete;
     explicit Lexer(const std::string_view source) : column_number(1), source(source) {}
+    // For lexing a piece of a larger file, `first_line` is the line number the source starts at
+    Lexer(const std::string_view source, std::uint32_t first_line)
+        : column_number(1), line_number(first_line - 1), source(source) {}
 
     using Error = sim::Error;
 
     auto next_token() -> std::optional<std::expected<Token, Error>>;
 
+    // Lexes the next line of the source into `tokens` (cleared first), lexer errors get appended to `errors`.
+    // Returns false once the whole source has been consumed. The token buffer is meant to be reused across lines,
+    // labels and label references are views into the source, so it has to outlive the tokens.
+    auto next_line(std::pmr::vector<Token> &tokens, std::vector<Error> &errors) -> bool;
+    [[nodiscard]] auto get_line_number() const -> std::uint32_t { return line_number; }
+
     class Iterator {
       public:
         using iterator_category = std::input_iterator_tag;
@@ -53,7 +63,7 @@ class Lexer {
 
   private:
     auto chop() -> char;
-    auto chop_while(const std::function<bool(char)> &predicate) -> std::string_view;
+    template <typename Predicate> auto chop_while(Predicate predicate) -> std::string_view;
     auto peek() -> std::optional<char>;
     void trim_whitespace();
 
@@ -65,6 +75,7 @@ class Lexer {
     auto parse_keyword() -> std::expected<Token, Error>;
 
     uint32_t column_number;
+    uint32_t line_number = 0;
     std::string_view source;
 };
 
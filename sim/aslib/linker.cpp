@@ -0,0 +1,261 @@
+#include "linker.hpp"
+#include "emitter.hpp"
+#include <algorithm>
+#include <format>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace as {
+
+namespace {
+
+// The bits of the immediate every relocation type patches, see InstructionBits
+constexpr auto BRANCH_IMMEDIATE_MASK = IData{0xFE000F80};
+constexpr auto JUMP_IMMEDIATE_MASK = IData{0xFFFFF000};
+constexpr auto ITYPE_IMMEDIATE_MASK = IData{0xFFF00000};
+// jalr sign extends its immediate, and the label form has x0 as the base
+constexpr auto ABSOLUTE_TARGET_LIMIT = IData{1} << 11u;
+
+auto binding(const sim::KernelObjectContents &object, std::size_t symbol) -> sim::SymbolBinding {
+    return object.bindings.empty() ? sim::SymbolBinding::LOCAL : object.bindings[symbol];
+}
+
+// Where an instruction of an input came from, for error messages
+auto location(const LinkInput &input, IData instruction) -> std::string {
+    if (!input.object.source_lines.empty()) {
+        return std::format("{}:{}", input.name, input.object.source_lines[instruction]);
+    }
+    return std::format("{}: instruction {}", input.name, instruction);
+}
+
+struct Definition {
+    std::size_t input; // Index into the selected inputs
+    IData instruction;
+};
+
+} // namespace
+
+auto make_relocatable_object(const parser::Program &program, std::span<const sim::InstructionBits> machine_code,
+                             bool with_source_lines) -> sim::KernelObjectContents {
+    auto contents = make_kernel_object(program, machine_code, with_source_lines);
+    contents.relocatable = true;
+
+    auto symbol_indices = std::unordered_map<std::string_view, std::uint32_t>{};
+    for (const auto &[name, instruction] : contents.symbols) {
+        symbol_indices.emplace(name, (std::uint32_t)symbol_indices.size());
+        contents.bindings.push_back(std::ranges::contains(program.globals, name) ? sim::SymbolBinding::GLOBAL
+                                                                                  : sim::SymbolBinding::LOCAL);
+    }
+
+    // Labels of other modules are added as they are first used
+    auto symbol_index = [&](std::string_view name) {
+        const auto [it, inserted] = symbol_indices.emplace(name, (std::uint32_t)contents.symbols.size());
+        if (inserted) {
+            contents.symbols.emplace_back(std::string{name}, 0);
+            contents.bindings.push_back(sim::SymbolBinding::UNDEFINED);
+        }
+        return it->second;
+    };
+    auto relocate = [&](std::uint32_t index, sim::RelocationType type, const parser::ImmediateOrLabelref &target,
+                        bool only_undefined) {
+        const auto *label = std::get_if<token::LabelRef>(&target);
+        if (label == nullptr || (only_undefined && program.label_mappings.contains(label->label_name))) {
+            return;
+        }
+        contents.relocations.push_back({.instruction = index, .type = type, .symbol = symbol_index(label->label_name)});
+    };
+
+    for (auto index = 0u; index < program.instructions.size(); index++) {
+        std::visit(overloaded{
+                       [&](const parser::BtypeOperands &operands) {
+                           relocate(index, sim::RelocationType::BRANCH, operands.offset_or_label_ref, true);
+                       },
+                       [&](const parser::JtypeOperands &operands) {
+                           relocate(index, sim::RelocationType::JUMP, operands.offset_or_label_ref, true);
+                       },
+                       [&](const parser::JalrOperands &operands) {
+                           relocate(index, sim::RelocationType::ABSOLUTE, operands.immediate_or_label_ref, false);
+                       },
+                       [](const auto &) {},
+                   },
+                   program.instructions[index].operands);
+    }
+
+    return contents;
+}
+
+auto link(std::span<const LinkInput> objects, std::span<const LinkInput> library, const LinkOptions &options)
+    -> std::expected<sim::KernelObjectContents, std::vector<std::string>> {
+    auto errors = std::vector<std::string>{};
+    if (objects.empty()) {
+        return std::unexpected{std::vector<std::string>{"Nothing to link"}};
+    }
+    for (const auto &inputs : {objects, library}) {
+        for (const auto &input : inputs) {
+            if (!input.object.relocatable) {
+                errors.push_back(std::format("{} is not a relocatable object", input.name));
+            }
+        }
+    }
+    if (!errors.empty()) {
+        return std::unexpected{std::move(errors)};
+    }
+
+    // The inputs that make it into the image, in the order they are placed
+    auto selected = std::vector<const LinkInput *>{};
+    auto definitions = std::unordered_map<std::string_view, Definition>{};
+    auto undefined = std::unordered_set<std::string_view>{};
+    auto select = [&](const LinkInput &input) {
+        const auto &object = input.object;
+        for (auto i = 0u; i < object.symbols.size(); i++) {
+            const auto &[name, instruction] = object.symbols[i];
+            if (binding(object, i) != sim::SymbolBinding::GLOBAL) {
+                continue;
+            }
+            const auto [it, inserted] = definitions.try_emplace(name, Definition{selected.size(), instruction});
+            if (!inserted) {
+                errors.push_back(std::format("Symbol '{}' is defined by both {} and {}", name,
+                                             selected[it->second.input]->name, input.name));
+            }
+            undefined.erase(name);
+        }
+        for (auto i = 0u; i < object.symbols.size(); i++) {
+            if (binding(object, i) == sim::SymbolBinding::UNDEFINED && !definitions.contains(object.symbols[i].first)) {
+                undefined.insert(object.symbols[i].first);
+            }
+        }
+        selected.push_back(&input);
+    };
+
+    for (const auto &object : objects) {
+        select(object);
+    }
+    // Library members can need each other, so the library is gone through until it has nothing more to add
+    auto pulled = std::vector<bool>(library.size(), false);
+    for (auto changed = true; changed && !undefined.empty();) {
+        changed = false;
+        for (auto member = 0u; member < library.size(); member++) {
+            const auto &object = library[member].object;
+            auto needed = false;
+            for (auto i = 0u; i < object.symbols.size() && !needed; i++) {
+                needed = binding(object, i) == sim::SymbolBinding::GLOBAL && undefined.contains(object.symbols[i].first);
+            }
+            if (!pulled[member] && needed) {
+                pulled[member] = true;
+                changed = true;
+                select(library[member]);
+            }
+        }
+    }
+
+    for (const auto *input : selected) {
+        const auto &object = input->object;
+        for (auto i = 0u; i < object.symbols.size(); i++) {
+            if (binding(object, i) == sim::SymbolBinding::UNDEFINED && !definitions.contains(object.symbols[i].first)) {
+                errors.push_back(std::format("Undefined symbol '{}' referenced by {}", object.symbols[i].first,
+                                             input->name));
+            }
+        }
+    }
+    if (!errors.empty()) {
+        return std::unexpected{std::move(errors)};
+    }
+
+    // Placement, the image starts at the first object
+    const auto &entry = objects.front();
+    auto image = sim::KernelObjectContents{
+        .num_blocks = entry.object.num_blocks,
+        .num_warps_per_block = entry.object.num_warps_per_block,
+        .base_instructions_address = entry.address.value_or(options.base_instructions_address),
+        .base_data_address = options.base_data_address,
+    };
+    const auto base = image.base_instructions_address;
+    auto addresses = std::vector<IData>{};
+    auto end = base;
+    for (const auto *input : selected) {
+        const auto address = input->address.value_or(end);
+        if (address < end) {
+            errors.push_back(std::format("{} is placed at {}, which overlaps the code before it up to {}", input->name,
+                                         address, end));
+            addresses.push_back(end);
+        } else {
+            addresses.push_back(address);
+        }
+        image.instructions.resize(addresses.back() - base, sim::instructions::halt().bits);
+        image.instructions.insert(image.instructions.end(), input->object.instructions.begin(),
+                                  input->object.instructions.end());
+        end = addresses.back() + (IData)input->object.instructions.size();
+    }
+
+    for (auto k = 0u; k < selected.size(); k++) {
+        const auto &input = *selected[k];
+        for (const auto &relocation : input.object.relocations) {
+            const auto &name = input.object.symbols[relocation.symbol].first;
+            const auto target = binding(input.object, relocation.symbol) == sim::SymbolBinding::UNDEFINED
+                                    ? addresses[definitions.at(name).input] + definitions.at(name).instruction
+                                    : addresses[k] + input.object.symbols[relocation.symbol].second;
+            const auto address = addresses[k] + relocation.instruction;
+            auto &word = image.instructions[address - base];
+
+            const auto offset = (std::int64_t)target - address;
+            const auto check_offset = [&](unsigned bits, std::string_view kind) {
+                if (sim::fits_offset(offset, bits)) {
+                    return true;
+                }
+                const auto reach = std::int64_t{1} << (bits - 1u);
+                errors.push_back(std::format("{}: {} target '{}' is {} instructions away, a {}-bit immediate reaches "
+                                             "{} to {}",
+                                             location(input, relocation.instruction), kind, name, offset, bits + 1u,
+                                             -reach, reach - 1));
+                return false;
+            };
+            switch (relocation.type) {
+            case sim::RelocationType::BRANCH:
+                if (check_offset(sim::BRANCH_OFFSET_BITS, "Branch")) {
+                    word = sim::InstructionBits{word & ~BRANCH_IMMEDIATE_MASK}.set_imm13((IData)offset << 1u).bits;
+                }
+                break;
+            case sim::RelocationType::JUMP:
+                if (check_offset(sim::JUMP_OFFSET_BITS, "Jump")) {
+                    word = sim::InstructionBits{word & ~JUMP_IMMEDIATE_MASK}.set_imm21((IData)offset << 1u).bits;
+                }
+                break;
+            case sim::RelocationType::ABSOLUTE:
+                if (target >= ABSOLUTE_TARGET_LIMIT) {
+                    errors.push_back(std::format("{}: jalr target '{}' is at {}, a 12-bit immediate reaches up to {}",
+                                                 location(input, relocation.instruction), name, target,
+                                                 ABSOLUTE_TARGET_LIMIT - 1));
+                } else {
+                    word = sim::InstructionBits{word & ~ITYPE_IMMEDIATE_MASK}.set_imm12(target).bits;
+                }
+                break;
+            }
+        }
+    }
+    if (!errors.empty()) {
+        return std::unexpected{std::move(errors)};
+    }
+
+    // The labels of every module, sorted like make_kernel_object does. Source lines are left out since they point
+    // into different files.
+    auto symbols = std::vector<std::tuple<IData, std::string_view, sim::SymbolBinding>>{};
+    for (auto k = 0u; k < selected.size(); k++) {
+        const auto &object = selected[k]->object;
+        for (auto i = 0u; i < object.symbols.size(); i++) {
+            if (binding(object, i) != sim::SymbolBinding::UNDEFINED) {
+                symbols.emplace_back(addresses[k] - base + object.symbols[i].second, object.symbols[i].first,
+                                     binding(object, i));
+            }
+        }
+    }
+    std::ranges::sort(symbols);
+    for (const auto &[instruction, name, symbol_binding] : symbols) {
+        image.symbols.emplace_back(std::string{name}, instruction);
+        image.bindings.push_back(symbol_binding);
+    }
+
+    return image;
+}
+
+} // namespace as
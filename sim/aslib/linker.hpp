@@ -0,0 +1,50 @@
+#pragma once
+
+#include "instructions.hpp"
+#include "kernel_object.hpp"
+#include "parser.hpp"
+#include <expected>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace as {
+
+// Linker
+//
+// A kernel can be assembled from several modules (parse_module) into relocatable objects, which are linked into one
+// kernel image. Modules export labels with `.global name` and refer to the labels of other modules by name. The
+// assembler leaves those references at 0 and records a relocation for them, as well as for every jalr to a label,
+// since jalr takes the absolute address of its target and a module doesn't know where it will be placed. Branches
+// and jumps within a module are relative and need nothing.
+//
+// Only the objects given to link() are always part of the image. The library is a set of objects that are only
+// pulled in when they define a symbol the image still needs, so a library of shared routines can be assembled once
+// and linked into every kernel without growing the ones that don't use it.
+
+// The labels become symbols, global when they are listed in .global, and the labels the module uses without defining
+// become undefined symbols
+auto make_relocatable_object(const parser::Program& program, std::span<const sim::InstructionBits> machine_code,
+                             bool with_source_lines = true) -> sim::KernelObjectContents;
+
+struct LinkInput {
+    std::string name; // For error messages, usually the file name
+    sim::KernelObjectContents object;
+    // Address of the first instruction of the object. By default it goes right after the previous one, and the first
+    // one at LinkOptions::base_instructions_address. Gaps are filled with halt.
+    std::optional<IData> address;
+};
+
+struct LinkOptions {
+    IData base_instructions_address = 0;
+    IData base_data_address = 0;
+};
+
+// Links the objects, in order, and the members of the library they need, in the order of the library, into a kernel
+// image. The first object is the entry point and gives the image its .blocks and .warps. Every symbol the objects
+// define is kept in the image, so it disassembles with the labels of all modules.
+auto link(std::span<const LinkInput> objects, std::span<const LinkInput> library, const LinkOptions& options = {})
+    -> std::expected<sim::KernelObjectContents, std::vector<std::string>>;
+
+} // namespace as
@@ -0,0 +1,254 @@
+#include "optimizer.hpp"
+#include "dataflow.hpp"
+#include "decoder.hpp"
+#include <algorithm>
+#include <format>
+#include <optional>
+
+namespace as {
+
+namespace {
+
+using parser::Instruction;
+
+auto is_zero(const sim::Register &reg) -> bool { return reg.register_number == 0; }
+
+auto same_operation(const Instruction &first, const Instruction &second) -> bool {
+    auto without_label = [](Instruction instruction) {
+        instruction.label.reset();
+        return instruction.to_str();
+    };
+    return first.mnemonic == second.mnemonic && without_label(first) == without_label(second);
+}
+
+auto to_alu_instruction(sim::MnemonicName name) -> std::optional<sim::AluInstruction> {
+    switch (name) {
+    case sim::MnemonicName::ADDI: return sim::AluInstruction::ADDI;
+    case sim::MnemonicName::SLTI: return sim::AluInstruction::SLTI;
+    case sim::MnemonicName::XORI: return sim::AluInstruction::XORI;
+    case sim::MnemonicName::ORI: return sim::AluInstruction::ORI;
+    case sim::MnemonicName::ANDI: return sim::AluInstruction::ANDI;
+    case sim::MnemonicName::SLLI: return sim::AluInstruction::SLLI;
+    case sim::MnemonicName::SRLI: return sim::AluInstruction::SRLI;
+    default: return std::nullopt;
+    }
+}
+
+// The immediates are written as their 12-bit encoding and sign extended by the decoder
+auto immediate_value(const token::Immediate &immediate) -> std::optional<IData> {
+    if (immediate.value < 0 || immediate.value >= 4096) {
+        return std::nullopt;
+    }
+    return sim::sign_extend((IData)immediate.value, 12);
+}
+
+auto encode_immediate(IData value) -> std::optional<token::Immediate> {
+    const auto encoded = value & 0xFFFu;
+    if (sim::sign_extend(encoded, 12) != value) {
+        return std::nullopt;
+    }
+    return token::Immediate{.value = (std::int32_t)encoded};
+}
+
+// The immediate of `first; second` as a single instruction of the same kind as `first`, both have to be immediate
+// arithmetic on the same destination, with `second` reading what `first` wrote
+auto fold_immediates(const Instruction &first, const Instruction &second) -> std::optional<Instruction> {
+    const auto *a = std::get_if<parser::ItypeOperands>(&first.operands);
+    const auto *b = std::get_if<parser::ItypeOperands>(&second.operands);
+    const auto first_op = to_alu_instruction(first.mnemonic.get_name());
+    const auto second_op = to_alu_instruction(second.mnemonic.get_name());
+    if (a == nullptr || b == nullptr || !first_op || !second_op || first.mnemonic.is_scalar() != second.mnemonic.is_scalar() ||
+        b->rd != a->rd || b->rs1 != a->rd || is_read_only(a->rd)) {
+        return std::nullopt;
+    }
+    const auto first_imm = immediate_value(a->imm12);
+    const auto second_imm = immediate_value(b->imm12);
+    if (!first_imm || !second_imm) {
+        return std::nullopt;
+    }
+
+    auto folded = first;
+    auto &imm12 = std::get<parser::ItypeOperands>(folded.operands).imm12;
+    auto set_immediate = [&](IData value) -> std::optional<Instruction> {
+        const auto encoded = encode_immediate(value);
+        if (!encoded) {
+            return std::nullopt;
+        }
+        imm12 = *encoded;
+        return folded;
+    };
+
+    if (*first_op == *second_op) {
+        switch (*first_op) {
+        case sim::AluInstruction::ADDI: return set_immediate(*first_imm + *second_imm);
+        case sim::AluInstruction::XORI: return set_immediate(*first_imm ^ *second_imm);
+        case sim::AluInstruction::ORI: return set_immediate(*first_imm | *second_imm);
+        case sim::AluInstruction::ANDI: return set_immediate(*first_imm & *second_imm);
+        case sim::AluInstruction::SLLI:
+        case sim::AluInstruction::SRLI:
+            if (*first_imm + *second_imm < 32u) {
+                return set_immediate(*first_imm + *second_imm);
+            }
+            break;
+        default: break;
+        }
+    }
+
+    // `addi rd, zero, imm` makes rd a constant, the same for every thread, so whatever follows can be computed here
+    if (*first_op == sim::AluInstruction::ADDI && is_zero(a->rs1)) {
+        return set_immediate(sim::alu(*second_op, 0, *first_imm, 0, *second_imm));
+    }
+    return std::nullopt;
+}
+
+class Optimizer {
+  public:
+    explicit Optimizer(parser::Program &program)
+        : program(program), removed(program.instructions.size(), false), block_starts(find_block_starts(program)) {}
+
+    auto run() -> std::vector<Optimization> {
+        if (const auto *culprit = find_address_dependency(program); culprit != nullptr) {
+            return {{culprit->line, std::format("Left the program unchanged, '{}' depends on the address of every "
+                                                "instruction", culprit->to_str())}};
+        }
+
+        for (auto changed = true; changed;) {
+            const auto before = report.size();
+            remove_read_only_writes();
+            fold_arithmetic();
+            remove_repeated_mask_writes();
+            changed = report.size() != before;
+        }
+
+        compact();
+        std::ranges::stable_sort(report, {}, &Optimization::line);
+        return std::move(report);
+    }
+
+  private:
+    // The next instruction that is left, if it can only be reached from `index`
+    [[nodiscard]] auto next_in_block(std::uint32_t index) const -> std::optional<std::uint32_t> {
+        for (auto next = index + 1; next < program.instructions.size(); next++) {
+            if (block_starts[next]) {
+                return std::nullopt;
+            }
+            if (!removed[next]) {
+                return next;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void remove(std::uint32_t index, std::string description) {
+        removed[index] = true;
+        report.push_back({program.instructions[index].line, std::move(description)});
+    }
+
+    void remove_read_only_writes() {
+        for (auto i = 0u; i < program.instructions.size(); i++) {
+            const auto &instruction = program.instructions[i];
+            const auto rd = pure_destination(instruction);
+            if (!removed[i] && rd.has_value() && is_read_only(*rd)) {
+                remove(i, std::format("Removed '{}', {} is read-only", instruction.to_str(), rd->to_str()));
+            }
+        }
+    }
+
+    void fold_arithmetic() {
+        for (auto i = 0u; i < program.instructions.size(); i++) {
+            if (removed[i]) {
+                continue;
+            }
+            for (auto next = next_in_block(i); next.has_value(); next = next_in_block(i)) {
+                auto folded = fold_immediates(program.instructions[i], program.instructions[*next]);
+                if (!folded) {
+                    break;
+                }
+                const auto description = std::format("Folded '{}' and '{}' into '{}'", program.instructions[i].to_str(),
+                                                      program.instructions[*next].to_str(), folded->to_str());
+                program.instructions[i] = std::move(*folded);
+                remove(*next, description);
+            }
+        }
+    }
+
+    // Writing the mask again with the same operation and the same inputs can't change it. That holds for sx.slt and
+    // sx.slti as well, the threads they masked out in the first place are the ones that stay masked out.
+    void remove_repeated_mask_writes() {
+        auto last_write = std::optional<std::uint32_t>{};
+        for (auto i = 0u; i < program.instructions.size(); i++) {
+            if (block_starts[i]) {
+                last_write.reset();
+            }
+            if (removed[i]) {
+                continue;
+            }
+
+            const auto &instruction = program.instructions[i];
+            const auto rd = destination(instruction);
+            if (rd == EXECUTION_MASK) {
+                const auto repeatable = pure_destination(instruction).has_value() && !reads_operand(instruction, EXECUTION_MASK);
+                if (repeatable && last_write.has_value() && same_operation(instruction, program.instructions[*last_write])) {
+                    remove(i, std::format("Removed '{}', the mask already holds its result", instruction.to_str()));
+                    continue;
+                }
+                last_write = repeatable ? std::optional{i} : std::nullopt;
+            } else if (last_write.has_value() && rd.has_value() && reads_operand(program.instructions[*last_write], *rd)) {
+                last_write.reset();
+            }
+        }
+    }
+
+    // Drops the removed instructions and moves the labels and numeric offsets along with the rest
+    void compact() {
+        const auto size = program.instructions.size();
+        // new_index[i] is where the first instruction left at or after i ends up
+        auto new_index = std::vector<std::int64_t>(size + 1);
+        auto kept = std::int64_t{0};
+        for (auto i = 0u; i < size; i++) {
+            new_index[i] = kept;
+            kept += removed[i] ? 0 : 1;
+        }
+        new_index[size] = kept;
+        if (kept == (std::int64_t)size) {
+            return;
+        }
+
+        for (auto i = 0u; i < size; i++) {
+            const auto target = target_index(program, i);
+            if (removed[i] || !target.has_value() || *target < 0 || *target > (std::int64_t)size) {
+                continue;
+            }
+            auto &operands = program.instructions[i].operands;
+            auto *offset_or_label = std::holds_alternative<parser::BtypeOperands>(operands)
+                                        ? &std::get<parser::BtypeOperands>(operands).offset_or_label_ref
+                                        : &std::get<parser::JtypeOperands>(operands).offset_or_label_ref;
+            if (auto *offset = std::get_if<token::Immediate>(offset_or_label); offset != nullptr) {
+                offset->value = (std::int32_t)(new_index[*target] - new_index[i]);
+            }
+        }
+        for (auto &[label, index] : program.label_mappings) {
+            index = (std::uint32_t)new_index[std::min<std::size_t>(index, size)];
+        }
+
+        auto instructions = std::pmr::vector<Instruction>{program.instructions.get_allocator()};
+        instructions.reserve((std::size_t)kept);
+        for (auto i = 0u; i < size; i++) {
+            if (!removed[i]) {
+                instructions.push_back(std::move(program.instructions[i]));
+            }
+        }
+        program.instructions = std::move(instructions);
+    }
+
+    parser::Program &program;
+    std::vector<bool> removed;
+    std::vector<bool> block_starts;
+    std::vector<Optimization> report;
+};
+
+} // namespace
+
+auto optimize(parser::Program &program) -> std::vector<Optimization> { return Optimizer{program}.run(); }
+
+} // namespace as
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "parser.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace as {
+
+// One change made by the optimizer
+struct Optimization {
+    std::uint32_t line; // Source line of the instruction that was rewritten or removed
+    std::string description;
+};
+
+// Peephole optimizer, runs on the result of parse_program before translate_to_binary
+//
+// Rewrites the program in place:
+// - removes instructions whose only effect is a write to x0-x3 or s0, which are read-only
+// - folds consecutive immediate arithmetic of the same kind on the same register (addi, xori, ori, andi, slli, srli)
+// - folds immediate arithmetic on a register that was just set to a constant (`addi rd, x0, imm`) into that addi
+// - removes writes of the execution mask s1 that repeat the previous one while none of its sources changed
+// Every rewrite stays inside a basic block, so no label, branch or jump target ever changes its meaning. The labels
+// and numeric offsets are remapped to the remaining instructions. Programs with a jalr through a register or an
+// auipc depend on the address of every instruction and are left as they are.
+//
+// Returns what was changed, ordered by source line
+auto optimize(parser::Program &program) -> std::vector<Optimization>;
+
+} // namespace as
@@ -1,7 +1,12 @@
 #include "parser.hpp"
+#include "expander.hpp"
 #include "instructions.hpp"
 #include "lexer.hpp"
 #include "token.hpp"
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <thread>
 
 #define EXPECT_OR_RETURN(opt, ...) \
     auto opt = expect<__VA_ARGS__>();     \
@@ -20,11 +25,24 @@ auto to_string(const ImmediateOrLabelref &imm) -> std::string {
                       imm);
 }
 
+auto target_offset(const Program &program, std::uint32_t index, const ImmediateOrLabelref &target)
+    -> std::optional<std::int64_t> {
+    if (const auto *label = std::get_if<token::LabelRef>(&target)) {
+        const auto mapping = program.label_mappings.find(label->label_name);
+        if (mapping == program.label_mappings.end()) {
+            return std::nullopt;
+        }
+        return (std::int64_t)mapping->second - index;
+    }
+    return std::get<token::Immediate>(target).value;
+}
+
 auto line_to_str(const parser::Line &line) -> std::string {
     return std::visit(overloaded{
                           [](const parser::JustLabel &label) { return std::format("{}:", label.label.name); },
                           [](const parser::BlocksDirective &blocks) { return std::format(".blocks {}", blocks.number); },
                           [](const parser::WarpsDirective &warps) { return std::format(".warps {}", warps.number); },
+                          [](const parser::GlobalDirective &global) { return std::format(".global {}", global.name); },
                           [](const parser::Instruction &instruction) {
                               return instruction.to_str();
                           },
@@ -34,6 +52,18 @@ auto line_to_str(const parser::Line &line) -> std::string {
 
 }
 
+namespace {
+
+// `target` is a LabelRef or an Immediate
+auto to_immediate_or_label_ref(const Token &target) -> parser::ImmediateOrLabelref {
+    if (target.is_of_type<token::LabelRef>()) {
+        return target.as<token::LabelRef>();
+    }
+    return target.as<token::Immediate>();
+}
+
+}
+
 #define CHECK_REG(reg, should_be_scalar) \
     if (!check_register_correct_type(reg, should_be_scalar)) { \
         return std::nullopt; \
@@ -49,6 +79,23 @@ auto Parser::check_register_correct_type(const Token &reg_token, bool should_be_
     return true;
 }
 
+#define CHECK_IMM(imm, bits) \
+    if (!check_immediate_fits(imm, bits)) { \
+        return std::nullopt; \
+    }
+
+auto Parser::check_immediate_fits(const Token &imm_token, unsigned bits) -> bool {
+    const auto value = imm_token.as<token::Immediate>().value;
+    if (!sim::fits_immediate(value, bits)) {
+        const auto reach = std::int64_t{1} << (bits - 1u);
+        push_err(std::format("Immediate {} doesn't fit {} bits, expected {} to {}", value, bits, -reach, 2 * reach - 1),
+                 imm_token.col);
+        return false;
+    }
+
+    return true;
+}
+
 auto Parser::chop() -> std::optional<Token> {
     if (tokens.empty()) {
         return std::nullopt;
@@ -116,6 +163,11 @@ auto Parser::parse_instruction() -> std::optional<Result> {
         return parse_utype_instruction(mnemonic);
     }
 
+    // BEQ, BNE, BLT, BGE
+    if (parser::is_btype(mnemonic.get_name())) {
+        return parse_branch_instruction(mnemonic);
+    }
+
     if (mnemonic.get_name() == sim::MnemonicName::JALR) {
         return parse_jalr_instruction(mnemonic);
     }
@@ -134,6 +186,7 @@ auto Parser::parse_utype_instruction(const sim::Mnemonic& mnemonic) -> std::opti
     EXPECT_OR_RETURN(imm20, token::Immediate);
 
     CHECK_REG(*rd, mnemonic.is_scalar());
+    CHECK_IMM(*imm20, sim::UPPER_IMMEDIATE_BITS);
 
     auto instruction = parser::Instruction{
         .label = {},
@@ -163,6 +216,15 @@ auto Parser::parse_itype_arithemtic_instruction(const sim::Mnemonic &mnemonic) -
         CHECK_REG(*rd, mnemonic.is_scalar());
         CHECK_REG(*rs1, mnemonic.is_scalar());
     }
+    CHECK_IMM(*imm12, sim::IMMEDIATE_BITS);
+    if (sim::is_itype_shift(mnemonic.get_name())) {
+        const auto amount = imm12->as<token::Immediate>().value;
+        if (amount < 0 || amount >= (1 << sim::SHIFT_AMOUNT_BITS)) {
+            push_err(std::format("Shift amount {} out of range, expected 0 to {}", amount, (1 << sim::SHIFT_AMOUNT_BITS) - 1),
+                     imm12->col);
+            return std::nullopt;
+        }
+    }
 
     auto instruction = parser::Instruction{
         .label = {},
@@ -218,6 +280,7 @@ auto Parser::parse_load_instruction(const sim::Mnemonic& mnemonic) -> std::optio
 
     CHECK_REG(*rd, mnemonic.is_scalar());
     CHECK_REG(*rs1, mnemonic.is_scalar());
+    CHECK_IMM(*offset, sim::IMMEDIATE_BITS);
 
     auto instruction = parser::Instruction{
         .label = {},
@@ -243,6 +306,7 @@ auto Parser::parse_store_instruction(const sim::Mnemonic& mnemonic) -> std::opti
 
     CHECK_REG(*rs1, mnemonic.is_scalar());
     CHECK_REG(*rs2, mnemonic.is_scalar());
+    CHECK_IMM(*offset, sim::IMMEDIATE_BITS);
 
     auto instruction = parser::Instruction{
         .label = {},
@@ -257,17 +321,41 @@ auto Parser::parse_store_instruction(const sim::Mnemonic& mnemonic) -> std::opti
     return instruction;
 }
 
+// <opcode> <rs1>, <rs2>, <offset or label>
+// Branches compare scalar registers, the whole warp takes the branch or doesn't
+auto Parser::parse_branch_instruction(const sim::Mnemonic& mnemonic) -> std::optional<parser::Instruction> {
+    EXPECT_OR_RETURN(rs1, token::Register);
+    EXPECT_OR_RETURN(comma1, token::Comma);
+    EXPECT_OR_RETURN(rs2, token::Register);
+    EXPECT_OR_RETURN(comma2, token::Comma);
+    EXPECT_OR_RETURN(target, token::LabelRef, token::Immediate);
+
+    CHECK_REG(*rs1, mnemonic.is_scalar());
+    CHECK_REG(*rs2, mnemonic.is_scalar());
+
+    return parser::Instruction {
+        .label = {},
+        .mnemonic = mnemonic,
+        .operands = parser::BtypeOperands {
+            .rs1 = rs1->as<token::Register>().register_data,
+            .rs2 = rs2->as<token::Register>().register_data,
+            .offset_or_label_ref = to_immediate_or_label_ref(*target),
+        }
+    };
+}
+
+// JAL rd, offset or JAL rd, labelref
 auto Parser::parse_jal_instruction(const sim::Mnemonic& mnemonic) -> std::optional<parser::Instruction> {
     EXPECT_OR_RETURN(rd, token::Register);
     EXPECT_OR_RETURN(comma, token::Comma);
-    EXPECT_OR_RETURN(immediate, token::Immediate);
+    EXPECT_OR_RETURN(target, token::LabelRef, token::Immediate);
 
     return parser::Instruction {
         .label = {},
         .mnemonic = mnemonic,
         .operands = parser::JtypeOperands {
             .rd = rd->as<token::Register>().register_data,
-            .imm20 = immediate->as<token::Immediate>()
+            .offset_or_label_ref = to_immediate_or_label_ref(*target),
         }
     };
 }
@@ -297,6 +385,7 @@ auto Parser::parse_jalr_instruction(const sim::Mnemonic& mnemonic) -> std::optio
     EXPECT_OR_RETURN(lparen, token::Lparen);
     EXPECT_OR_RETURN(rs1, token::Register);
     EXPECT_OR_RETURN(rparen, token::Rparen);
+    CHECK_IMM(*next, sim::IMMEDIATE_BITS);
 
     return parser::Instruction {
         .label = {},
@@ -342,6 +431,19 @@ auto Parser::parse_directive() -> std::optional<Result> {
     return std::nullopt;
 }
 
+// .global <label>
+auto Parser::parse_global_directive() -> std::optional<Result> {
+    chop();
+    EXPECT_OR_RETURN(name, token::LabelRef);
+
+    if (peek() != nullptr) {
+        throw_unexpected_token("End of line", *peek());
+        return std::nullopt;
+    }
+
+    return parser::GlobalDirective{.name = name->as<token::LabelRef>().label_name};
+}
+
 auto Parser::parse_line() -> std::optional<Result> {
     if (tokens.empty()) {
         return std::nullopt;
@@ -353,6 +455,10 @@ auto Parser::parse_line() -> std::optional<Result> {
         return parse_directive();
     }
 
+    if (token.is_of_type<token::GlobalDirective>()) {
+        return parse_global_directive();
+    }
+
     std::optional<as::token::Label> label = std::nullopt;
 
     if (token.is_of_type<token::Label>()) {
@@ -397,85 +503,320 @@ auto parse_line(std::span<Token> tokens) -> std::expected<Parser::Result, std::v
     return result.value();
 }
 
-auto parse_program(const std::span<const std::string> lines) -> std::expected<as::parser::Program, std::vector<sim::Error>> {
-    auto program = as::parser::Program{};
-    auto errors = std::vector<sim::Error>{};
- 
-    std::optional<std::uint32_t> block_count{};
-    std::optional<std::uint32_t> warp_count{};
+namespace {
+
+// Collects the parsed lines of a program, or of a consecutive piece of one. Labels and directives are only recorded
+// while the lines come in and get resolved in finish(), so the pieces of a program can be parsed independently and
+// appended in order afterwards with the same result as parsing the whole program at once. That doesn't hold for
+// macros, constants and repeats, which affect the lines after them, see uses_expander().
+class ProgramBuilder {
+  public:
+    ProgramBuilder(std::pmr::memory_resource *resource, std::size_t max_instructions)
+        : tokens{resource}, instructions{resource}, labels{resource}, globals{resource}, directives{resource} {
+        // Growing the vector would leave the old storage behind in a monotonic arena
+        instructions.reserve(max_instructions);
+    }
 
-    auto line_nr = 0u;
-    auto instr_count = 0u;
-
-    auto add_label = [&](const std::string_view label_name) {
-        if (program.label_mappings.contains(label_name)) {
-            auto previous_declaration_line = program.label_mappings[label_name];
-            errors.emplace_back(std::format("Duplicate label declaration on line {}", line_nr), 0, line_nr);
-        } else {
-            program.label_mappings[label_name] = instr_count;
+    void add_line(std::span<Token> tokens, std::uint32_t line_nr) {
+        // Skip empty lines
+        if (tokens.empty()) {
+            return;
         }
-    };
 
+        if (expander.passes_through(tokens)) {
+            parse_line(tokens, line_nr);
+            return;
+        }
+        expanded.clear();
+        expander.expand(tokens, line_nr, expanded, errors);
+        for (auto &line : expanded) {
+            parse_line(line.tokens, line.line);
+        }
+    }
 
-    for(const auto& line : lines) {
-        line_nr++;
+    // `other` has to hold the lines right after the ones in this builder
+    void append(ProgramBuilder &&other) {
+        const auto offset = static_cast<std::uint32_t>(instructions.size());
+        instructions.insert(instructions.end(), std::make_move_iterator(other.instructions.begin()),
+                            std::make_move_iterator(other.instructions.end()));
+        for (const auto &label : other.labels) {
+            labels.push_back({label.name, label.instruction + offset, label.line});
+        }
+        globals.insert(globals.end(), other.globals.begin(), other.globals.end());
+        directives.insert(directives.end(), other.directives.begin(), other.directives.end());
+        errors.insert(errors.end(), std::make_move_iterator(other.errors.begin()),
+                      std::make_move_iterator(other.errors.end()));
+    }
 
-        // Tokenize
-        auto [tokens, lexer_errors] = as::collect_tokens(line);
-        if (!lexer_errors.empty()) {
-            for (auto error : lexer_errors) {
-                errors.push_back(error.with_line(line_nr));
+    // A module may refer to labels it doesn't define, see parse_module
+    auto finish(bool is_module = false) -> std::expected<as::parser::Program, std::vector<sim::Error>> {
+        expander.finish(errors);
+
+        auto *resource = instructions.get_allocator().resource();
+        auto program = as::parser::Program{.blocks = {}, .warps = {}, .instructions = std::move(instructions),
+                                           .label_mappings = std::pmr::unordered_map<std::string_view, std::uint32_t>{resource},
+                                           .globals = std::pmr::vector<std::string_view>{resource}};
+
+        for (const auto &[name, instruction, line_nr] : labels) {
+            if (program.label_mappings.contains(name)) {
+                errors.emplace_back(std::format("Duplicate label declaration on line {}", line_nr), 0, line_nr);
+            } else if (expander.is_constant(name)) {
+                // References to it would have been replaced by the value
+                errors.emplace_back(std::format("Label '{}' has the name of a constant", name), 0, line_nr);
+            } else {
+                program.label_mappings[name] = instruction;
             }
         }
 
-        // Skip empty lines
-        if (tokens.empty()) {
-            continue;
+        // Branch and jump targets can only be checked once every label is known
+        for (auto i = 0u; i < program.instructions.size(); i++) {
+            check_targets(program, i, is_module);
+        }
+
+        for (const auto &[name, line_nr] : globals) {
+            if (!program.label_mappings.contains(name)) {
+                errors.emplace_back(std::format("Global label '{}' is not defined", name), 0, line_nr);
+            } else if (!std::ranges::contains(program.globals, name)) {
+                program.globals.push_back(name);
+            }
+        }
+
+        std::optional<std::uint32_t> block_count{};
+        std::optional<std::uint32_t> warp_count{};
+        for (const auto &[is_blocks, number, line_nr] : directives) {
+            auto &count = is_blocks ? block_count : warp_count;
+            if (count.has_value()) {
+                errors.emplace_back(is_blocks ? "Duplicate blocks directive" : "Duplicate warps directive", 0, line_nr);
+            }
+            count = number;
+        }
+        program.blocks = block_count.value_or(1);
+        program.warps = warp_count.value_or(1);
+
+        if (!errors.empty()) {
+            // The errors found while resolving go in between the others
+            std::ranges::stable_sort(errors, {}, &sim::Error::line);
+            return std::unexpected{std::move(errors)};
         }
 
-        const auto output = as::parse_line(tokens);
-        if(!output.has_value()) {
-            for (auto err : output.error()) {
+        return program;
+    }
+
+    std::vector<sim::Error> errors;
+    std::pmr::vector<Token> tokens; // Reused for every line
+
+  private:
+    void parse_line(std::span<Token> tokens, std::uint32_t line_nr) {
+        Parser parser{tokens};
+        auto output = parser.parse_line();
+        if (!output.has_value()) {
+            for (auto err : parser.consume_errors()) {
                 errors.push_back(err.with_line(line_nr));
             }
-            continue;
+            return;
         }
 
-        const auto& val = output.value();
+        const auto instr_count = static_cast<std::uint32_t>(instructions.size());
         std::visit(as::overloaded{
                 [&](const as::parser::JustLabel& label) {
-                    add_label(label.label.name);
+                    labels.push_back({label.label.name, instr_count, line_nr});
                 },
-                [&](const as::parser::Instruction& instr) {
-                    program.instructions.push_back(instr);
+                [&](as::parser::Instruction& instr) {
+                    instr.line = line_nr;
                     if (instr.label.has_value()) {
-                        add_label(instr.label->name);
+                        labels.push_back({instr.label->name, instr_count, line_nr});
                     }
-                    instr_count++;
+                    instructions.push_back(std::move(instr));
                 },
                 [&](const as::parser::BlocksDirective& block) {
-                    if(block_count.has_value()) {
-                        errors.emplace_back("Duplicate blocks directive", 0, line_nr);
-                    }
-                    block_count = block.number;
+                    directives.push_back({.is_blocks = true, .number = block.number, .line = line_nr});
                 },
                 [&](const as::parser::WarpsDirective& warp) {
-                    if(warp_count.has_value()) {
-                        errors.emplace_back("Duplicate warps directive", 0, line_nr);
+                    directives.push_back({.is_blocks = false, .number = warp.number, .line = line_nr});
+                },
+                [&](const as::parser::GlobalDirective& global) {
+                    globals.push_back({global.name, line_nr});
+                },
+        }, output.value());
+    }
+
+    // Labels a module doesn't define belong to other modules, the linker checks those
+    void check_targets(const as::parser::Program &program, std::uint32_t index, bool is_module) {
+        const auto &instruction = program.instructions[index];
+        auto undefined_label = [&](const token::LabelRef &label) {
+            if (!is_module) {
+                errors.emplace_back(std::format("Undefined label '{}'", label.label_name), 0, instruction.line);
+            }
+        };
+        auto check_offset = [&](const as::parser::ImmediateOrLabelref &target, unsigned bits, std::string_view kind) {
+            const auto offset = as::parser::target_offset(program, index, target);
+            if (!offset.has_value()) {
+                undefined_label(std::get<token::LabelRef>(target));
+            } else if (!sim::fits_offset(*offset, bits)) {
+                const auto reach = std::int64_t{1} << (bits - 1u);
+                errors.emplace_back(std::format("{} target is {} instructions away, a {}-bit immediate reaches {} to {}",
+                                                kind, *offset, bits + 1u, -reach, reach - 1),
+                                    0, instruction.line);
+            }
+        };
+
+        std::visit(as::overloaded{
+                [&](const as::parser::BtypeOperands &operands) {
+                    check_offset(operands.offset_or_label_ref, sim::BRANCH_OFFSET_BITS, "Branch");
+                },
+                [&](const as::parser::JtypeOperands &operands) {
+                    check_offset(operands.offset_or_label_ref, sim::JUMP_OFFSET_BITS, "Jump");
+                },
+                [&](const as::parser::JalrOperands &operands) {
+                    const auto *label = std::get_if<token::LabelRef>(&operands.immediate_or_label_ref);
+                    if (label != nullptr && !program.label_mappings.contains(label->label_name)) {
+                        undefined_label(*label);
                     }
-                    warp_count = warp.number;
                 },
-        }, val);
+                [](const auto &) {},
+        }, instruction.operands);
+    }
+
+    struct LabelDefinition {
+        std::string_view name;
+        std::uint32_t instruction;
+        std::uint32_t line;
+    };
+
+    struct GlobalDefinition {
+        std::string_view name;
+        std::uint32_t line;
+    };
+
+    struct Directive {
+        bool is_blocks; // .warps otherwise
+        std::uint32_t number;
+        std::uint32_t line;
+    };
+
+    std::pmr::vector<as::parser::Instruction> instructions;
+    std::pmr::vector<LabelDefinition> labels;
+    std::pmr::vector<GlobalDefinition> globals;
+    std::pmr::vector<Directive> directives;
+    Expander expander;
+    std::vector<ExpandedLine> expanded; // Reused for every line that gets expanded
+};
+
+// Pieces smaller than this aren't worth a thread
+constexpr auto MIN_PARALLEL_CHUNK_SIZE = std::size_t{1} << 16;
+
+// Whether the source may define macros, constants or repeats. Occurrences in comments give false positives, which
+// only cost the parallelism.
+auto uses_expander(const std::string_view source) -> bool {
+    using namespace std::string_view_literals;
+    return std::ranges::any_of(std::array{".equ"sv, ".macro"sv, ".rept"sv},
+                               [&](std::string_view directive) { return source.contains(directive); });
+}
+
+}
+
+auto parse_program(const std::span<const std::string> lines, std::pmr::memory_resource *resource)
+    -> std::expected<as::parser::Program, std::vector<sim::Error>> {
+    auto builder = ProgramBuilder{resource, lines.size()};
+
+    auto line_nr = 0u;
+    for(const auto& line : lines) {
+        line_nr++;
+
+        auto lexer = Lexer{line, line_nr};
+        lexer.next_line(builder.tokens, builder.errors);
+        builder.add_line(builder.tokens, line_nr);
+    }
+
+    return builder.finish();
+}
+
+auto parse_program(const std::string_view source, std::pmr::memory_resource *resource)
+    -> std::expected<as::parser::Program, std::vector<sim::Error>> {
+    // Every instruction takes a line, so the number of lines bounds the number of instructions, unless macros,
+    // repeats or pseudo-instructions expand to more
+    const auto max_lines = static_cast<std::size_t>(std::ranges::count(source, '\n')) + 1;
+    auto builder = ProgramBuilder{resource, max_lines};
+
+    auto lexer = Lexer{source};
+    while (lexer.next_line(builder.tokens, builder.errors)) {
+        builder.add_line(builder.tokens, lexer.get_line_number());
+    }
+
+    return builder.finish();
+}
+
+auto parse_module(const std::string_view source, std::pmr::memory_resource *resource)
+    -> std::expected<as::parser::Program, std::vector<sim::Error>> {
+    const auto max_lines = static_cast<std::size_t>(std::ranges::count(source, '\n')) + 1;
+    auto builder = ProgramBuilder{resource, max_lines};
+
+    auto lexer = Lexer{source};
+    while (lexer.next_line(builder.tokens, builder.errors)) {
+        builder.add_line(builder.tokens, lexer.get_line_number());
+    }
+
+    return builder.finish(true);
+}
+
+auto parse_program_parallel(const std::string_view source, std::uint32_t num_threads,
+                            std::pmr::memory_resource *resource)
+    -> std::expected<as::parser::Program, std::vector<sim::Error>> {
+    const auto num_chunks = std::clamp<std::size_t>(source.size() / MIN_PARALLEL_CHUNK_SIZE, 1, std::max(num_threads, 1u));
+    if (num_chunks == 1 || uses_expander(source)) {
+        return parse_program(source, resource);
     }
 
-    program.blocks = block_count.value_or(1);
-    program.warps = warp_count.value_or(1);
+    struct Chunk {
+        std::string_view source;
+        std::uint32_t first_line;
+        std::size_t num_lines;
+    };
+
+    // Split on line boundaries into roughly equal pieces
+    auto chunks = std::vector<Chunk>{};
+    auto begin = std::size_t{0};
+    auto first_line = 1u;
+    for (auto i = 1u; i <= num_chunks && begin < source.size(); i++) {
+        auto end = source.size();
+        if (i < num_chunks) {
+            const auto newline = source.find('\n', std::max(begin, source.size() * i / num_chunks));
+            end = newline == std::string_view::npos ? source.size() : newline + 1;
+        }
+        const auto chunk = source.substr(begin, end - begin);
+        const auto num_lines = static_cast<std::size_t>(std::ranges::count(chunk, '\n'));
+        chunks.push_back({.source = chunk, .first_line = first_line, .num_lines = num_lines});
+        first_line += num_lines;
+        begin = end;
+    }
 
-    if (!errors.empty()) {
-        return std::unexpected{errors};
+    // Arenas aren't thread safe, every piece gets its own until they are merged
+    auto arenas = std::vector<std::unique_ptr<Arena>>{};
+    auto builders = std::vector<ProgramBuilder>{};
+    builders.reserve(chunks.size());
+    for (const auto &chunk : chunks) {
+        arenas.push_back(std::make_unique<Arena>());
+        builders.emplace_back(arenas.back().get(), chunk.num_lines + 1);
     }
 
-    return program;
+    {
+        auto threads = std::vector<std::jthread>{};
+        for (auto i = 0u; i < chunks.size(); i++) {
+            threads.emplace_back([&, i]() {
+                auto &builder = builders[i];
+                auto lexer = Lexer{chunks[i].source, chunks[i].first_line};
+                while (lexer.next_line(builder.tokens, builder.errors)) {
+                    builder.add_line(builder.tokens, lexer.get_line_number());
+                }
+            });
+        }
+    }
+
+    auto program = ProgramBuilder{resource, static_cast<std::size_t>(first_line)};
+    for (auto &builder : builders) {
+        program.append(std::move(builder));
+    }
+    return program.finish();
 }
 
 }
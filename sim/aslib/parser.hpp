@@ -5,6 +5,9 @@
 #include "token.hpp"
 #include "error.hpp"
 #include <expected>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
 
 namespace as {
 
@@ -18,6 +21,10 @@ struct BlocksDirective {
     std::uint32_t number;
 };
 
+struct GlobalDirective {
+    std::string_view name;
+};
+
 // FIXME: This is hacky since we can't access the column number just from the token type,
 //        technically we should be getting a full Token struct here
 using ImmediateOrLabelref = std::variant<token::Immediate, token::LabelRef>;
@@ -47,9 +54,16 @@ struct UtypeOperands {
     token::Immediate imm20;
 };
 
+// Immediate offsets count instructions from the branch or jump itself, labels are resolved to such an offset
+struct BtypeOperands {
+    sim::Register rs1;
+    sim::Register rs2;
+    ImmediateOrLabelref offset_or_label_ref;
+};
+
 struct JtypeOperands {
     sim::Register rd;
-    token::Immediate imm20;
+    ImmediateOrLabelref offset_or_label_ref;
 };
 
 struct JalrOperands {
@@ -59,7 +73,7 @@ struct JalrOperands {
 };
 
 /*using Operands = std::variant<Rtype, Itype, Load, Store, Branch, Jump, Utype, Sx>;*/
-using Operands = std::variant<ItypeOperands, RtypeOperands, StypeOperands, UtypeOperands, JtypeOperands, JalrOperands>;
+using Operands = std::variant<ItypeOperands, RtypeOperands, StypeOperands, UtypeOperands, BtypeOperands, JtypeOperands, JalrOperands>;
 
 constexpr auto is_itype_arithmetic(sim::MnemonicName name) -> bool {
     return name == sim::MnemonicName::ADDI || name == sim::MnemonicName::SLTI || name == sim::MnemonicName::XORI ||
@@ -86,17 +100,28 @@ constexpr auto is_utype(sim::MnemonicName name) -> bool {
     return name == sim::MnemonicName::LUI || name == sim::MnemonicName::AUIPC;
 }
 
+constexpr auto is_btype(sim::MnemonicName name) -> bool {
+    return name == sim::MnemonicName::BEQ || name == sim::MnemonicName::BNE || name == sim::MnemonicName::BLT ||
+           name == sim::MnemonicName::BGE;
+}
+
 struct Instruction {
     std::optional<as::token::Label> label;
     sim::Mnemonic mnemonic;
     Operands operands;
+    std::uint32_t line{}; // Source line, filled in by parse_program
 
     [[nodiscard]] auto to_str() const -> std::string {
           std::string result;
           if (label.has_value()) {
               result += std::format("{}: ", label->name);
           }
-          result += mnemonic.to_str() + " ";
+          result += mnemonic.to_str();
+          // halt has no operands, the default ones it's parsed with aren't printed
+          if (mnemonic.get_name() == sim::MnemonicName::HALT) {
+              return result;
+          }
+          result += " ";
           std::visit(
               overloaded{
                   [&](const parser::ItypeOperands &operands) {
@@ -119,12 +144,12 @@ struct Instruction {
                   [&result](const parser::UtypeOperands &operands) {
                       result += operands.rd.to_str() + ", " + std::to_string(operands.imm20.value);
                   },
-                  /*[&result](const parser::BtypeOperands &operands) {*/
-                  /*    result += operands.rs1.to_str() + ", " + operands.rs2.to_str() + ", " +*/
-                  /*              std::to_string(operands.imm12);*/
-                  /*},*/
+                  [&result](const parser::BtypeOperands &operands) {
+                      result += operands.rs1.to_str() + ", " + operands.rs2.to_str() + ", " +
+                                to_string(operands.offset_or_label_ref);
+                  },
                   [&result](const parser::JtypeOperands &operands) {
-                      result += operands.rd.to_str() + ", " + std::to_string(operands.imm20.value);
+                      result += operands.rd.to_str() + ", " + to_string(operands.offset_or_label_ref);
                   },
                   [&result](const parser::JalrOperands &operands) {
                       result += operands.rd.to_str() + ", ";
@@ -149,16 +174,24 @@ struct JustLabel{
     as::token::Label label;
 };
 
-using Line = std::variant<JustLabel, WarpsDirective, BlocksDirective, Instruction>;
+using Line = std::variant<JustLabel, WarpsDirective, BlocksDirective, GlobalDirective, Instruction>;
 auto line_to_str(const Line &line) -> std::string;
 
+// The containers use the memory resource parse_program was given, see as::Arena
 struct Program {
     std::uint32_t blocks{};
     std::uint32_t warps{};
-    std::vector<Instruction> instructions;
-    std::unordered_map<std::string_view, std::uint32_t> label_mappings;
+    std::pmr::vector<Instruction> instructions;
+    std::pmr::unordered_map<std::string_view, std::uint32_t> label_mappings;
+    std::pmr::vector<std::string_view> globals; // Labels exported with .global, in the order of the source
 };
 
+// Offset of a branch or jump target from the instruction at `index`, in instructions. std::nullopt for undefined
+// labels, parse_program reports those so the programs it returns always resolve. Programs from parse_module can
+// refer to labels of other modules.
+auto target_offset(const Program &program, std::uint32_t index, const ImmediateOrLabelref &target)
+    -> std::optional<std::int64_t>;
+
 }
 
 // The parsing function return nulloptr if an error has occured and push the error to
@@ -192,6 +225,7 @@ class Parser {
 
     auto parse_line() -> std::optional<Result>;
     auto parse_directive() -> std::optional<Result>;
+    auto parse_global_directive() -> std::optional<Result>;
     auto parse_instruction() -> std::optional<Result>;
 
     auto parse_rtype_instruction(const sim::Mnemonic& mnemonic) -> std::optional<parser::Instruction>;
@@ -213,10 +247,32 @@ class Parser {
   private:
 
     auto check_register_correct_type(const Token &reg_token, bool should_be_scalar) -> bool;
+    auto check_immediate_fits(const Token &imm_token, unsigned bits) -> bool;
     std::span<Token> tokens;
     std::vector<sim::Error> errors;
 };
 
 auto parse_line(std::span<Token> tokens) -> std::expected<Parser::Result, std::vector<Parser::Error>>;
-auto parse_program(const std::span<const std::string> lines) -> std::expected<as::parser::Program, std::vector<sim::Error>>;
+// Per-assembly arena, everything the assembler allocates for a program can come from it and is released at once.
+// It has to outlive the Program.
+using Arena = std::pmr::monotonic_buffer_resource;
+
+auto parse_program(const std::span<const std::string> lines,
+                   std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    -> std::expected<as::parser::Program, std::vector<sim::Error>>;
+// Lexes and parses a whole file in one pass, the labels in the program are views into `source`
+auto parse_program(const std::string_view source,
+                   std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    -> std::expected<as::parser::Program, std::vector<sim::Error>>;
+// Parses one module of a kernel that is linked from several (see linker.hpp). Labels that aren't defined in the
+// module are left for the linker to resolve, everything else is checked like parse_program does.
+auto parse_module(const std::string_view source,
+                  std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    -> std::expected<as::parser::Program, std::vector<sim::Error>>;
+// Same as parse_program, but splits large sources into pieces on line boundaries that get lexed and parsed on up to
+// num_threads threads. The result, errors included, is the same as with parse_program. Sources with macros,
+// constants or repeats (see expander.hpp) are parsed on a single thread, as those affect every line after them.
+auto parse_program_parallel(const std::string_view source, std::uint32_t num_threads,
+                            std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    -> std::expected<as::parser::Program, std::vector<sim::Error>>;
 } // namespace as
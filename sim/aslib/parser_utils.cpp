@@ -5,6 +5,7 @@
 #include <string_view>
 #include <expected>
 #include <cstdint>
+#include <limits>
 
 namespace as {
 
@@ -37,17 +38,21 @@ auto parse_num(std::string_view &source) -> std::expected<word_type, sim::Error>
             i++;
         }
         const char* end = source.data() + i;
-        int32_t result = 0;
-        auto [ptr, ec] = std::from_chars(begin, end, result, base);
+        // The magnitude is parsed wider than a word, so the most negative word fits before the sign is applied
+        int64_t magnitude = 0;
+        auto [ptr, ec] = std::from_chars(begin, end, magnitude, base);
+        const auto limit = is_negative ? -int64_t{std::numeric_limits<word_type>::min()} : int64_t{std::numeric_limits<word_type>::max()};
+        if (ec == std::errc{} && magnitude > limit) {
+            ec = std::errc::result_out_of_range;
+        }
         if (ec != std::errc{}) {
             auto failing_part = std::string_view(begin, end - begin);
+            // The digits are consumed anyway, so whoever reads next continues after them
+            source.remove_prefix(i);
             return std::unexpected(sim::Error(std::format("Failed to parse number '{}': {}", failing_part, std::make_error_code(ec).message())));
         }
         source.remove_prefix(ptr - begin);
-        if (is_negative) {
-            result = -result;
-        }
-        return result;
+        return static_cast<word_type>(is_negative ? -magnitude : magnitude);
     };
 
     // Check for number format
@@ -69,10 +74,6 @@ auto parse_num(std::string_view &source) -> std::expected<word_type, sim::Error>
 }
 
 
-auto str_check_predicate(const std::string_view str, const std::function<bool(char)>& predicate) -> bool {
-    return std::ranges::all_of(str, predicate);
-}
-
 auto str_to_reg(std::string_view str) -> std::expected<sim::Register, sim::Error> {
     if (str.size() < 2) {
         return std::unexpected(sim::Error(std::format("Invalid register name: '{}'", str)));
@@ -8,7 +8,15 @@
 namespace as {
 
 auto parse_num(std::string_view &source) -> std::expected<word_type, sim::Error>;
-auto str_check_predicate(const std::string_view str, const std::function<bool(char)>& predicate) -> bool;
+template <typename Predicate>
+constexpr auto str_check_predicate(const std::string_view str, Predicate predicate) -> bool {
+    for (const auto c : str) {
+        if (!predicate(c)) {
+            return false;
+        }
+    }
+    return true;
+}
 auto str_to_reg(std::string_view str) -> std::expected<sim::Register, sim::Error>;
 
 }
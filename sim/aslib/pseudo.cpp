@@ -0,0 +1,58 @@
+#include "pseudo.hpp"
+#include <array>
+#include <utility>
+
+namespace as {
+
+namespace {
+
+constexpr auto PSEUDO_NAMES = std::array<std::pair<std::string_view, PseudoName>, 6>{{
+    {"li", PseudoName::LI},
+    {"mv", PseudoName::MV},
+    {"nop", PseudoName::NOP},
+    {"j", PseudoName::J},
+    {"not", PseudoName::NOT},
+    {"neg", PseudoName::NEG},
+}};
+
+} // namespace
+
+auto PseudoMnemonic::to_str() const -> std::string {
+    for (const auto &[str, pseudo] : PSEUDO_NAMES) {
+        if (pseudo == name) {
+            return std::string{is_scalar ? "s." : ""} + std::string{str};
+        }
+    }
+    return "<pseudo>";
+}
+
+auto str_to_pseudo(std::string_view str) -> std::optional<PseudoMnemonic> {
+    const auto is_scalar = str.starts_with("s.");
+    if (is_scalar) {
+        str.remove_prefix(2);
+    }
+    for (const auto &[name, pseudo] : PSEUDO_NAMES) {
+        // Jumps are scalar anyway
+        if (name == str && !(is_scalar && pseudo == PseudoName::J)) {
+            return PseudoMnemonic{.name = pseudo, .is_scalar = is_scalar};
+        }
+    }
+    return std::nullopt;
+}
+
+auto materialize_constant(std::int32_t value) -> ConstantParts {
+    const auto bits = static_cast<std::uint32_t>(value);
+    const auto lower = bits & 0xFFFu;
+    if (value >= -2048 && value < 2048) {
+        return {.upper = std::nullopt, .lower = static_cast<std::int32_t>(lower)};
+    }
+
+    // addi sign-extends, a lower part with bit 11 set subtracts 4096 that the upper part has to make up for
+    const auto upper = ((bits >> 12u) + (lower >> 11u)) & 0xFFFFFu;
+    if (lower == 0) {
+        return {.upper = static_cast<std::int32_t>(upper), .lower = std::nullopt};
+    }
+    return {.upper = static_cast<std::int32_t>(upper), .lower = static_cast<std::int32_t>(lower)};
+}
+
+} // namespace as
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace as {
+
+// Pseudo-instructions, the expander (expander.hpp) replaces them by real instructions before parsing
+//
+//   li rd, value      rd := value, in as few instructions as possible, see materialize_constant
+//   mv rd, rs         addi rd, rs, 0
+//   nop               addi x0, x0, 0
+//   j target          jal s0, target
+//   not rd, rs        xori rd, rs, -1
+//   neg rd, rs        sub rd, x0, rs
+//
+// All but j have a scalar form with the s. prefix, which expands to the scalar instructions.
+enum class PseudoName : std::uint8_t { LI, MV, NOP, J, NOT, NEG };
+
+struct PseudoMnemonic {
+    PseudoName name;
+    bool is_scalar;
+
+    [[nodiscard]] auto to_str() const -> std::string;
+    auto operator==(const PseudoMnemonic &) const -> bool = default;
+};
+
+auto str_to_pseudo(std::string_view str) -> std::optional<PseudoMnemonic>;
+
+// The immediates of the shortest lui/addi sequence that loads `value`: a single addi from zero when the value fits
+// the sign-extended 12-bit immediate, a single lui when its low 12 bits are zero and lui followed by addi otherwise.
+// The addi sign-extends its immediate, so the upper part gets one added whenever bit 11 of the value is set.
+// Both are in the raw encoding the parser takes, 12 and 20 bits.
+struct ConstantParts {
+    std::optional<std::int32_t> upper; // lui
+    std::optional<std::int32_t> lower; // addi
+};
+
+auto materialize_constant(std::int32_t value) -> ConstantParts;
+
+} // namespace as
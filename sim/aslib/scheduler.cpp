@@ -0,0 +1,239 @@
+#include "scheduler.hpp"
+#include "dataflow.hpp"
+#include <algorithm>
+#include <format>
+#include <optional>
+#include <unordered_map>
+
+namespace as {
+
+namespace {
+
+using parser::Instruction;
+
+struct Edge {
+    std::uint32_t node; // Position in the region of the instruction at the other end
+    std::uint32_t latency;
+};
+
+// Dependence graph of a region, every edge goes from an earlier instruction to a later one
+class DependenceGraph {
+  public:
+    DependenceGraph(std::span<const Instruction> instructions, const SchedulerOptions &options)
+        : predecessors(instructions.size()), successors(instructions.size()) {
+        // Per register, the last instruction that wrote it and the ones that read it since
+        auto last_writer = std::unordered_map<IData, std::uint32_t>{};
+        auto readers = std::unordered_map<IData, std::vector<std::uint32_t>>{};
+        auto last_store = std::optional<std::uint32_t>{};
+        auto loads_since_store = std::vector<std::uint32_t>{};
+        auto key = [](const sim::Register &reg) { return reg.register_number + (reg.is_scalar() ? 32u : 0u); };
+
+        for (auto i = 0u; i < instructions.size(); i++) {
+            const auto &instruction = instructions[i];
+            for (const auto &source : operand_sources(instruction)) {
+                if (is_read_only(source)) {
+                    continue;
+                }
+                if (const auto writer = last_writer.find(key(source)); writer != last_writer.end()) {
+                    const auto from = writer->second;
+                    add(from, i, is_load(instructions[from]) ? options.load_latency : 1u);
+                }
+                readers[key(source)].push_back(i);
+            }
+
+            if (const auto rd = destination(instruction); rd.has_value() && !is_read_only(*rd)) {
+                for (const auto reader : readers[key(*rd)]) {
+                    if (reader != i) {
+                        add(reader, i, 1);
+                    }
+                }
+                if (const auto writer = last_writer.find(key(*rd)); writer != last_writer.end()) {
+                    add(writer->second, i, 1);
+                }
+                readers[key(*rd)].clear();
+                last_writer[key(*rd)] = i;
+            }
+
+            // Without knowing the addresses, loads may only pass other loads
+            if (is_load(instruction)) {
+                if (last_store.has_value()) {
+                    add(*last_store, i, options.load_latency);
+                }
+                loads_since_store.push_back(i);
+            } else if (is_store(instruction)) {
+                if (last_store.has_value()) {
+                    add(*last_store, i, 1);
+                }
+                for (const auto load : loads_since_store) {
+                    add(load, i, 1);
+                }
+                loads_since_store.clear();
+                last_store = i;
+            }
+        }
+    }
+
+    [[nodiscard]] auto size() const -> std::uint32_t { return (std::uint32_t)predecessors.size(); }
+
+    // Slots spent waiting on dependences when `order` is issued one instruction per slot
+    [[nodiscard]] auto stalls(std::span<const std::uint32_t> order) const -> std::uint32_t {
+        auto slot = std::vector<std::uint32_t>(size());
+        auto next_slot = 0u;
+        for (const auto node : order) {
+            auto earliest = next_slot;
+            for (const auto &[from, latency] : predecessors[node]) {
+                earliest = std::max(earliest, slot[from] + latency);
+            }
+            slot[node] = earliest;
+            next_slot = earliest + 1;
+        }
+        return next_slot - size();
+    }
+
+    // List scheduling, among the instructions whose operands are ready the one with the longest path to the end
+    // of the region goes first, ties keep the original order
+    [[nodiscard]] auto list_schedule() const -> std::vector<std::uint32_t> {
+        auto height = std::vector<std::uint32_t>(size(), 0);
+        for (auto node = size(); node-- > 0;) {
+            for (const auto &[to, latency] : successors[node]) {
+                height[node] = std::max(height[node], height[to] + latency);
+            }
+        }
+
+        auto remaining_predecessors = std::vector<std::uint32_t>(size());
+        auto earliest = std::vector<std::uint32_t>(size(), 0);
+        auto ready = std::vector<std::uint32_t>{};
+        for (auto node = 0u; node < size(); node++) {
+            remaining_predecessors[node] = (std::uint32_t)predecessors[node].size();
+            if (remaining_predecessors[node] == 0) {
+                ready.push_back(node);
+            }
+        }
+
+        auto order = std::vector<std::uint32_t>{};
+        order.reserve(size());
+        for (auto slot = 0u; !ready.empty(); slot++) {
+            // Prefers what can issue right away, otherwise whatever stalls the least
+            auto better = [&](std::uint32_t a, std::uint32_t b) {
+                const auto a_waits = std::max(earliest[a], slot);
+                const auto b_waits = std::max(earliest[b], slot);
+                if (a_waits != b_waits) {
+                    return a_waits < b_waits;
+                }
+                if (height[a] != height[b]) {
+                    return height[a] > height[b];
+                }
+                return a < b;
+            };
+            const auto chosen = std::ranges::min_element(ready, better);
+            const auto node = *chosen;
+            ready.erase(chosen);
+
+            slot = std::max(slot, earliest[node]);
+            order.push_back(node);
+            for (const auto &[to, latency] : successors[node]) {
+                earliest[to] = std::max(earliest[to], slot + latency);
+                if (--remaining_predecessors[to] == 0) {
+                    ready.push_back(to);
+                }
+            }
+        }
+        return order;
+    }
+
+  private:
+    void add(std::uint32_t from, std::uint32_t to, std::uint32_t latency) {
+        predecessors[to].push_back({from, latency});
+        successors[from].push_back({to, latency});
+    }
+
+    std::vector<std::vector<Edge>> predecessors;
+    std::vector<std::vector<Edge>> successors;
+};
+
+// Instructions that stay where they are and split the regions
+auto is_barrier(const Instruction &instruction) -> bool {
+    return is_control_transfer(instruction) || destination(instruction) == EXECUTION_MASK;
+}
+
+} // namespace
+
+auto schedule(parser::Program &program, const SchedulerOptions &options)
+    -> std::expected<std::vector<ScheduledRegion>, sim::Error> {
+    if (const auto *culprit = find_address_dependency(program); culprit != nullptr) {
+        return std::unexpected{sim::Error{
+            std::format("'{}' depends on the address of every instruction, the program can't be scheduled", culprit->to_str()),
+            0, culprit->line}};
+    }
+
+    const auto block_starts = find_block_starts(program);
+    auto &instructions = program.instructions;
+    auto regions = std::vector<ScheduledRegion>{};
+    for (auto begin = 0u; begin < instructions.size();) {
+        if (is_barrier(instructions[begin])) {
+            begin++;
+            continue;
+        }
+        auto end = begin + 1;
+        while (end < instructions.size() && !block_starts[end] && !is_barrier(instructions[end])) {
+            end++;
+        }
+        if (end - begin < 2) {
+            begin = end;
+            continue;
+        }
+
+        const auto region = std::span{instructions}.subspan(begin, end - begin);
+        const auto graph = DependenceGraph{region, options};
+        auto original = std::vector<std::uint32_t>(region.size());
+        for (auto i = 0u; i < original.size(); i++) {
+            original[i] = i;
+        }
+        auto scheduled = graph.list_schedule();
+        const auto stalls_before = graph.stalls(original);
+        const auto stalls_after = graph.stalls(scheduled);
+        if (stalls_after >= stalls_before) {
+            scheduled = original;
+        }
+
+        // Labels belong to the position, not to the instruction that happens to be there
+        auto reordered = std::vector<Instruction>{};
+        reordered.reserve(region.size());
+        for (const auto node : scheduled) {
+            reordered.push_back(region[node]);
+        }
+        for (auto i = 0u; i < region.size(); i++) {
+            reordered[i].label = region[i].label;
+        }
+        std::ranges::move(reordered, region.begin());
+
+        auto order = std::vector<std::uint32_t>{};
+        for (const auto node : scheduled) {
+            order.push_back(begin + node);
+        }
+        regions.push_back({.begin = begin,
+                           .order = std::move(order),
+                           .stalls_before = stalls_before,
+                           .stalls_after = std::min(stalls_before, stalls_after)});
+        begin = end;
+    }
+    return regions;
+}
+
+auto dump_schedule(const parser::Program &program, std::span<const ScheduledRegion> regions) -> std::string {
+    auto dump = std::string{};
+    for (const auto &region : regions) {
+        const auto end = region.begin + (std::uint32_t)region.order.size();
+        dump += std::format("Instructions {}-{}, estimated stalls {} -> {}\n", region.begin, end - 1, region.stalls_before,
+                            region.stalls_after);
+        for (auto index = region.begin; index < end; index++) {
+            const auto &instruction = program.instructions[index];
+            const auto original = region.order[index - region.begin];
+            dump += std::format("  {:4}: {:32} # line {}{}\n", index, instruction.to_str(), instruction.line,
+                                original == index ? "" : std::format(", was {}", original));
+        }
+    }
+    return dump;
+}
+
+} // namespace as
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "error.hpp"
+#include "parser.hpp"
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace as {
+
+struct SchedulerOptions {
+    // How many instructions should separate a load (or a store and a later load) from the instruction that
+    // depends on it, so the memory access can overlap with independent work
+    std::uint32_t load_latency = 4;
+};
+
+// A stretch of instructions the scheduler was free to reorder
+struct ScheduledRegion {
+    std::uint32_t begin;              // Index of the first instruction
+    std::vector<std::uint32_t> order; // Original index of the instructions at begin, begin + 1, ...
+    std::uint32_t stalls_before;      // Estimated slots spent waiting on dependences, in the original order
+    std::uint32_t stalls_after;       // and in the scheduled one
+};
+
+// Latency-aware list scheduler, runs on the result of parse_program (or optimize) before translate_to_binary
+//
+// Every basic block is split into regions at the instructions that may not move: branches, jumps, halt and writes
+// of the execution mask s1. Within a region the instructions form a dependence graph over the vector and scalar
+// registers, the mask and memory (stores stay ordered with every other memory access). Instructions are then
+// placed greedily, the one with the longest latency-weighted path to the end of the region first, which moves
+// independent work between memory accesses and their consumers. A region keeps its original order unless the new
+// one is estimated to stall less. Labels stay where they were, as regions never cross them.
+//
+// Programs with a jalr through a register or an auipc can't be rearranged, the error names the instruction.
+auto schedule(parser::Program &program, const SchedulerOptions &options = {})
+    -> std::expected<std::vector<ScheduledRegion>, sim::Error>;
+
+// Lists every region of `program` after scheduling, with the source line and original position of each instruction
+auto dump_schedule(const parser::Program &program, std::span<const ScheduledRegion> regions) -> std::string;
+
+} // namespace as
@@ -0,0 +1,23 @@
+#include "source_file.hpp"
+#include <format>
+#include <fstream>
+#include <sstream>
+
+namespace as {
+
+auto SourceFile::open(const std::filesystem::path &path) -> std::expected<SourceFile, std::string> {
+    if (auto mapping = sim::MappedFile::open(path)) {
+        return SourceFile{std::move(*mapping)};
+    }
+
+    // Not mappable (empty files, pipes...), read it in one go instead
+    auto stream = std::ifstream{path, std::ios::binary};
+    if (!stream.is_open()) {
+        return std::unexpected{std::format("Failed to open file: {}", path.c_str())};
+    }
+    auto buffer = std::ostringstream{};
+    buffer << stream.rdbuf();
+    return SourceFile{std::move(buffer).str()};
+}
+
+} // namespace as
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "common.hpp"
+#include "mapped_file.hpp"
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace as {
+
+// A whole source file in memory, mapped read-only when possible and read in one go otherwise.
+// Everything the lexer produces points into it, so it has to outlive the parsed program.
+class SourceFile {
+  public:
+    static auto open(const std::filesystem::path &path) -> std::expected<SourceFile, std::string>;
+
+    [[nodiscard]] auto view() const -> std::string_view {
+        return std::visit(overloaded{
+                              [](const sim::MappedFile &mapping) { return mapping.view(); },
+                              [](const std::string &string) { return std::string_view{string}; },
+                          },
+                          contents);
+    }
+
+  private:
+    explicit SourceFile(sim::MappedFile &&mapping) : contents(std::move(mapping)) {}
+    explicit SourceFile(std::string &&contents) : contents(std::move(contents)) {}
+
+    std::variant<sim::MappedFile, std::string> contents;
+};
+
+} // namespace as
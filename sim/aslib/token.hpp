@@ -1,6 +1,7 @@
 #pragma once
 #include "common.hpp"
 #include "instructions.hpp"
+#include "pseudo.hpp"
 #include <string_view>
 #include <variant>
 #include <cstdint>
@@ -18,7 +19,14 @@ namespace as {
 namespace token {
 DEFINE_TOKEN_TYPE(BlocksDirective)
 DEFINE_TOKEN_TYPE(WarpsDirective)
+DEFINE_TOKEN_TYPE(GlobalDirective)
+DEFINE_TOKEN_TYPE(EquDirective)
+DEFINE_TOKEN_TYPE(MacroDirective)
+DEFINE_TOKEN_TYPE(EndmDirective)
+DEFINE_TOKEN_TYPE(ReptDirective)
+DEFINE_TOKEN_TYPE(EndrDirective)
 DEFINE_TOKEN_TYPE(Mnemonic, sim::Mnemonic mnemonic;)
+DEFINE_TOKEN_TYPE(Pseudo, PseudoMnemonic pseudo;)
 DEFINE_TOKEN_TYPE(Label, std::string_view name;)
 DEFINE_TOKEN_TYPE(LabelRef, std::string_view label_name;)
 DEFINE_TOKEN_TYPE(Immediate, std::int32_t value;)
@@ -27,7 +35,8 @@ DEFINE_TOKEN_TYPE(Comma);
 DEFINE_TOKEN_TYPE(Lparen);
 DEFINE_TOKEN_TYPE(Rparen);
 
-using TokenType = std::variant<BlocksDirective, WarpsDirective, Mnemonic, Label, LabelRef, Immediate, Register, Comma, Lparen, Rparen>;
+using TokenType = std::variant<BlocksDirective, WarpsDirective, GlobalDirective, EquDirective, MacroDirective, EndmDirective, ReptDirective,
+                               EndrDirective, Mnemonic, Pseudo, Label, LabelRef, Immediate, Register, Comma, Lparen, Rparen>;
 
 template<typename T, typename... Ts>
 inline auto token_type_to_str() -> std::string {
@@ -36,8 +45,22 @@ inline auto token_type_to_str() -> std::string {
             return ".blocks";
         } else if constexpr (std::is_same_v<T, WarpsDirective>) {
             return ".warps";
+        } else if constexpr (std::is_same_v<T, GlobalDirective>) {
+            return ".global";
+        } else if constexpr (std::is_same_v<T, EquDirective>) {
+            return ".equ";
+        } else if constexpr (std::is_same_v<T, MacroDirective>) {
+            return ".macro";
+        } else if constexpr (std::is_same_v<T, EndmDirective>) {
+            return ".endm";
+        } else if constexpr (std::is_same_v<T, ReptDirective>) {
+            return ".rept";
+        } else if constexpr (std::is_same_v<T, EndrDirective>) {
+            return ".endr";
         } else if constexpr (std::is_same_v<T, Mnemonic>) {
             return "mnemonic";
+        } else if constexpr (std::is_same_v<T, Pseudo>) {
+            return "pseudo-instruction";
         } else if constexpr (std::is_same_v<T, Label>) {
             return "label";
         } else if constexpr (std::is_same_v<T, LabelRef>) {
@@ -87,7 +110,14 @@ struct Token {
         return std::visit(overloaded{
                           [](const token::BlocksDirective &) -> std::string { return ".threads"; },
                           [](const token::WarpsDirective &) -> std::string { return ".warps"; },
+                          [](const token::GlobalDirective &) -> std::string { return ".global"; },
+                          [](const token::EquDirective &) -> std::string { return ".equ"; },
+                          [](const token::MacroDirective &) -> std::string { return ".macro"; },
+                          [](const token::EndmDirective &) -> std::string { return ".endm"; },
+                          [](const token::ReptDirective &) -> std::string { return ".rept"; },
+                          [](const token::EndrDirective &) -> std::string { return ".endr"; },
                           [](const token::Mnemonic &m) -> std::string { return m.mnemonic.to_str(); },
+                          [](const token::Pseudo &p) -> std::string { return p.pseudo.to_str(); },
                           [](const token::Label &l) -> std::string { return std::string(l.name); },
                           [](const token::LabelRef &lr) -> std::string { return std::string(lr.label_name); },
                           [](const token::Immediate &i) -> std::string { return std::to_string(i.value); },
@@ -0,0 +1,217 @@
+// Fits the parameters of the approximate timing model (see simlib/timing_model.hpp) against the RTL
+//
+// Every benchmark kernel (.as and an optional .data file) is simulated cycle-accurately once, after that
+// the model is evaluated as many times as needed, which is cheap as it only replays the traces.
+// The parameters are fitted with a simple coordinate descent that minimizes the mean relative error and written to a
+// parameter file, which the simulator's --model-params reads.
+
+#include <Vgpu.h>
+#include <Vgpu_gpu.h>
+#include <print>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include "common.hpp"
+#include "data_reader.hpp"
+#include "emitter.hpp"
+#include "parser.hpp"
+#include "source_file.hpp"
+#include "sim.hpp"
+#include "executor.hpp"
+#include "timing_model.hpp"
+namespace fs = std::filesystem;
+
+constexpr auto NUM_CHANNELS = Vgpu_gpu::DATA_MEM_NUM_CHANNELS;
+constexpr auto MAX_CYCLES = 1'000'000u;
+constexpr auto MAX_PARAMETER_VALUE = 64u;
+constexpr auto DEFAULT_OUTPUT = "timing_parameters.txt";
+
+struct Benchmark {
+    std::string name;
+    sim::ExecutorConfig config;
+    std::vector<IData> program;
+    sim::data_memory_container_t data;
+    sim::KernelTrace trace;
+    uint32_t rtl_cycles{};
+};
+
+constexpr auto GPU_SHAPE = sim::GpuShape{
+    .num_cores = Vgpu_gpu::NUM_CORES,
+    .data_mem_channels = NUM_CHANNELS,
+};
+
+auto load_benchmark(const fs::path& as_file) -> std::expected<Benchmark, std::string> {
+    auto benchmark = Benchmark{};
+    benchmark.name = as_file.stem().string();
+
+    const auto data_file = fs::path{as_file}.replace_extension(".data");
+    if (fs::exists(data_file)) {
+        const auto data = as::read_data(data_file);
+        if (!data) {
+            return std::unexpected(std::format("Failed to read data file '{}': {}", data_file.string(), data.error()));
+        }
+        benchmark.data = *data;
+    }
+
+    const auto source = as::SourceFile::open(as_file);
+    if (!source) {
+        return std::unexpected(std::format("Failed to open '{}'", as_file.string()));
+    }
+
+    auto arena = as::Arena{};
+    const auto program_or_err = as::parse_program(source->view(), &arena);
+    if (!program_or_err) {
+        return std::unexpected(std::format("Failed to parse '{}'", as_file.string()));
+    }
+
+    const auto& [blocks, warps, instructions, label_mappings, globals] = program_or_err.value();
+    for (const auto& instruction : as::translate_to_binary(*program_or_err)) {
+        benchmark.program.push_back(instruction.bits);
+    }
+
+    benchmark.config = sim::ExecutorConfig{
+        .warps_per_core = Vgpu_gpu::WARPS_PER_CORE,
+        .threads_per_warp = Vgpu_gpu::THREADS_PER_WARP,
+        .base_instructions_address = 0,
+        .base_data_address = 0,
+        .num_blocks = blocks,
+        .num_warps_per_block = warps,
+    };
+    return benchmark;
+}
+
+auto run_rtl(const Benchmark& benchmark) -> std::optional<uint32_t> {
+    auto top = std::make_unique<Vgpu>();
+    auto data_mem = sim::make_data_memory<NUM_CHANNELS>(top.get());
+    auto instruction_mem = sim::make_instruction_memory<NUM_CHANNELS>(top.get());
+    data_mem.memory = benchmark.data;
+    for (auto i = 0u; i < benchmark.program.size(); i++) {
+        instruction_mem.memory[i] = benchmark.program[i];
+    }
+    sim::set_kernel_config(*top, 0, 0, benchmark.config.num_blocks, benchmark.config.num_warps_per_block);
+    return sim::simulate_cycles(*top, instruction_mem, data_mem, MAX_CYCLES);
+}
+
+auto relative_error(const Benchmark& benchmark, const sim::TimingParameters& parameters) -> double {
+    const auto modeled = (double)sim::model_cycles(benchmark.trace, GPU_SHAPE, parameters);
+    const auto measured = (double)benchmark.rtl_cycles;
+    return std::abs(modeled - measured) / measured;
+}
+
+auto mean_error(const std::vector<Benchmark>& benchmarks, const sim::TimingParameters& parameters) -> double {
+    auto total = 0.0;
+    for (const auto& benchmark : benchmarks) {
+        total += relative_error(benchmark, parameters);
+    }
+    return total / (double)benchmarks.size();
+}
+
+// Moves one parameter at a time by one cycle for as long as that lowers the error
+auto fit(const std::vector<Benchmark>& benchmarks, sim::TimingParameters parameters) -> sim::TimingParameters {
+    auto best_error = mean_error(benchmarks, parameters);
+    auto improved = true;
+    while (improved) {
+        improved = false;
+        for (const auto& [name, field] : sim::TIMING_PARAMETERS) {
+            for (const auto direction : {-1, 1}) {
+                while (true) {
+                    auto candidate = parameters;
+                    const auto value = (int64_t)(candidate.*field) + direction;
+                    if (value < 0 || value > (int64_t)MAX_PARAMETER_VALUE) {
+                        break;
+                    }
+                    candidate.*field = (uint32_t)value;
+
+                    const auto error = mean_error(benchmarks, candidate);
+                    if (error >= best_error) {
+                        break;
+                    }
+                    best_error = error;
+                    parameters = candidate;
+                    improved = true;
+                }
+            }
+        }
+    }
+    return parameters;
+}
+
+void print_report(const std::vector<Benchmark>& benchmarks, const sim::TimingParameters& parameters) {
+    std::println("{:<20} {:>10} {:>10} {:>8}", "kernel", "rtl", "model", "error");
+    for (const auto& benchmark : benchmarks) {
+        std::println("{:<20} {:>10} {:>10} {:>7.1f}%", benchmark.name, benchmark.rtl_cycles,
+                     sim::model_cycles(benchmark.trace, GPU_SHAPE, parameters), relative_error(benchmark, parameters) * 100.0);
+    }
+    std::println("Mean error: {:.1f}%", mean_error(benchmarks, parameters) * 100.0);
+}
+
+auto main(int argc, char** argv) -> int {
+    auto benchmarks_dir = fs::path{BENCHMARKS_DIR};
+    auto output = fs::path{DEFAULT_OUTPUT};
+    auto usage = false;
+    for (auto arg = 1; arg < argc; arg++) {
+        const auto current = std::string_view{argv[arg]};
+        if (current == "--output" && arg + 1 < argc) {
+            output = argv[++arg];
+        } else if (!current.starts_with("--")) {
+            benchmarks_dir = current;
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || !fs::is_directory(benchmarks_dir)) {
+        std::println(stderr, "Usage: {} [benchmarks directory] [--output parameter file]", argv[0]);
+        return 1;
+    }
+
+    auto as_files = std::vector<fs::path>{};
+    for (const auto& entry : fs::directory_iterator(benchmarks_dir)) {
+        if (entry.path().extension() == ".as") {
+            as_files.push_back(entry.path());
+        }
+    }
+    std::ranges::sort(as_files);
+
+    auto benchmarks = std::vector<Benchmark>{};
+    for (const auto& as_file : as_files) {
+        auto benchmark = load_benchmark(as_file);
+        if (!benchmark) {
+            std::println(stderr, "{}", benchmark.error());
+            return 1;
+        }
+
+        const auto rtl_cycles = run_rtl(*benchmark);
+        if (!rtl_cycles) {
+            std::println(stderr, "Kernel '{}' didn't finish in {} cycles", benchmark->name, MAX_CYCLES);
+            return 1;
+        }
+        benchmark->rtl_cycles = *rtl_cycles;
+        benchmark->trace = sim::trace_kernel(benchmark->config, benchmark->program, benchmark->data);
+        benchmarks.push_back(std::move(*benchmark));
+    }
+
+    if (benchmarks.empty()) {
+        std::println(stderr, "No kernels found in '{}'", benchmarks_dir.string());
+        return 1;
+    }
+
+    std::println("Default parameters:");
+    print_report(benchmarks, sim::TimingParameters{});
+
+    const auto fitted = fit(benchmarks, sim::TimingParameters{});
+    std::println("\nFitted parameters:");
+    print_report(benchmarks, fitted);
+    for (const auto& [name, field] : sim::TIMING_PARAMETERS) {
+        std::println("  {:<20} {}", name, fitted.*field);
+    }
+
+    if (const auto written = sim::write_timing_parameters(output, fitted); !written) {
+        std::println(stderr, "Error: {}.", written.error());
+        return 1;
+    }
+    std::println("Wrote the fitted parameters to {}, use them with --model-params", output.string());
+    return 0;
+}
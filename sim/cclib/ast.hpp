@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace cc {
+
+// Syntax tree of a kernel, see kernel_parser.hpp for the language
+
+enum class BinaryOp : std::uint8_t {
+    ADD,
+    SUB,
+    MUL, // One side has to be a constant, the GPU has no multiplier
+    AND,
+    OR,
+    XOR,
+    SHL,
+    SHR,
+    LT,
+    GT,
+    LE,
+    GE,
+    EQ,
+    NE,
+    LOGICAL_AND,
+    LOGICAL_OR,
+};
+
+enum class UnaryOp : std::uint8_t { NEG, NOT, LOGICAL_NOT };
+
+// thread_id, block_id and block_size, which live in x1-x3
+enum class Builtin : std::uint8_t { THREAD_ID = 1, BLOCK_ID = 2, BLOCK_SIZE = 3 };
+
+struct Expr;
+using ExprPtr = std::unique_ptr<Expr>;
+
+struct Number {
+    std::int32_t value;
+};
+
+// Local variables are numbered in the order they are declared, names are resolved by the parser
+struct Variable {
+    std::uint32_t id;
+};
+
+struct BuiltinRef {
+    Builtin builtin;
+};
+
+struct Load {
+    std::uint32_t array;
+    ExprPtr index;
+};
+
+struct Unary {
+    UnaryOp op;
+    ExprPtr operand;
+};
+
+struct Binary {
+    BinaryOp op;
+    ExprPtr lhs;
+    ExprPtr rhs;
+};
+
+struct Expr {
+    std::variant<Number, Variable, BuiltinRef, Load, Unary, Binary> node;
+    std::uint32_t line;
+    std::uint32_t column;
+};
+
+struct Stmt;
+using StmtPtr = std::unique_ptr<Stmt>;
+
+// Declarations without a value start at zero
+struct Declaration {
+    std::uint32_t variable;
+    ExprPtr value;
+};
+
+struct Assignment {
+    std::uint32_t variable;
+    ExprPtr value;
+};
+
+struct Store {
+    std::uint32_t array;
+    ExprPtr index;
+    ExprPtr value;
+};
+
+struct If {
+    ExprPtr condition;
+    StmtPtr then_branch;
+    StmtPtr else_branch; // nullptr without else
+};
+
+// while and for, the initialization of a for goes in front of it in a Block
+struct Loop {
+    ExprPtr condition;
+    StmtPtr body;
+    StmtPtr step; // nullptr for while
+};
+
+// Variables declared in a block go out of scope at its end
+struct Block {
+    std::vector<StmtPtr> statements;
+    std::vector<std::uint32_t> declared;
+};
+
+struct Stmt {
+    std::variant<Declaration, Assignment, Store, If, Loop, Block> node;
+    std::uint32_t line;
+};
+
+struct Array {
+    std::string_view name;
+    std::int32_t address; // Of the first element in data memory, elements are words
+};
+
+struct Kernel {
+    std::uint32_t blocks = 1;
+    std::uint32_t warps = 1;
+    std::vector<Array> arrays;
+    std::vector<std::string_view> variables; // Names by id
+    Block body;
+};
+
+} // namespace cc
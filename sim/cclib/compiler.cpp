@@ -0,0 +1,976 @@
+#include "compiler.hpp"
+#include "common.hpp"
+#include "instructions.hpp"
+#include "kernel_parser.hpp"
+#include "pseudo.hpp"
+#include <algorithm>
+#include <bitset>
+#include <format>
+#include <optional>
+#include <utility>
+
+namespace cc {
+
+namespace {
+
+using sim::Register;
+using sim::RegisterType;
+
+constexpr auto EXECUTION_MASK = Register{1, RegisterType::SCALAR};
+
+// Bodies estimated to take more instructions than this are branched over when no thread runs them
+constexpr auto SKIP_THRESHOLD = 4u;
+
+auto fits_immediate(std::int64_t value) -> bool {
+    return value >= -2048 && value < 2048;
+}
+
+// The assembler takes 12-bit immediates as their encoding, -1 is written 4095
+auto raw(std::int64_t immediate) -> std::int64_t {
+    return immediate & 0xFFF;
+}
+
+auto zero(RegisterType type) -> Register {
+    return Register{0, type};
+}
+
+auto mnemonic(RegisterType type, std::string_view name) -> std::string {
+    return std::format("{}{}", type == RegisterType::SCALAR ? "s." : "", name);
+}
+
+auto as_number(const Expr &expr) -> std::optional<std::int32_t> {
+    if (const auto *number = std::get_if<Number>(&expr.node)) {
+        return number->value;
+    }
+    return std::nullopt;
+}
+
+// Evaluates to 0 or 1
+auto is_boolean(const Expr &expr) -> bool {
+    if (const auto *binary = std::get_if<Binary>(&expr.node)) {
+        return binary->op >= BinaryOp::LT;
+    }
+    if (const auto *unary = std::get_if<Unary>(&expr.node)) {
+        return unary->op == UnaryOp::LOGICAL_NOT;
+    }
+    const auto number = as_number(expr);
+    return number == 0 || number == 1;
+}
+
+// Rough instruction counts, to decide which bodies are worth a branch
+auto estimate_size(const Expr &expr) -> std::uint32_t {
+    return std::visit(as::overloaded{
+                          [](const Load &load) -> std::uint32_t { return 1 + estimate_size(*load.index); },
+                          [](const Unary &unary) -> std::uint32_t { return 1 + estimate_size(*unary.operand); },
+                          [](const Binary &binary) -> std::uint32_t {
+                              return (binary.op == BinaryOp::MUL ? 3 : 1) + estimate_size(*binary.lhs) +
+                                     estimate_size(*binary.rhs);
+                          },
+                          [](const auto &) -> std::uint32_t { return 0; },
+                      },
+                      expr.node);
+}
+
+auto estimate_size(const Stmt &stmt) -> std::uint32_t {
+    return std::visit(as::overloaded{
+                          [](const Declaration &declaration) -> std::uint32_t {
+                              return declaration.value ? std::max(estimate_size(*declaration.value), 1u) : 1;
+                          },
+                          [](const Assignment &assignment) -> std::uint32_t {
+                              return std::max(estimate_size(*assignment.value), 1u);
+                          },
+                          [](const Store &store) -> std::uint32_t {
+                              return 1 + estimate_size(*store.index) + estimate_size(*store.value);
+                          },
+                          [](const If &statement) -> std::uint32_t {
+                              return 3 + estimate_size(*statement.condition) + estimate_size(*statement.then_branch) +
+                                     (statement.else_branch ? estimate_size(*statement.else_branch) : 0);
+                          },
+                          [](const Loop &) -> std::uint32_t { return SKIP_THRESHOLD + 1; },
+                          [](const Block &block) -> std::uint32_t {
+                              auto size = std::uint32_t{0};
+                              for (const auto &statement : block.statements) {
+                                  size += estimate_size(*statement);
+                              }
+                              return size;
+                          },
+                      },
+                      stmt.node);
+}
+
+// A register holding a value, temporaries go back to their pool once used
+struct Value {
+    Register reg;
+    bool temporary;
+};
+
+class RegisterPool {
+  public:
+    RegisterPool(RegisterType type, IData first) : type(type), first(first) {}
+
+    auto allocate() -> std::optional<Register> {
+        for (auto number = first; number < used.size(); number++) {
+            if (!used[number]) {
+                used.set(number);
+                return Register{number, type};
+            }
+        }
+        return std::nullopt;
+    }
+
+    void release(Register reg) {
+        if (reg.register_number >= first) {
+            used.reset(reg.register_number);
+        }
+    }
+
+  private:
+    RegisterType type;
+    IData first;
+    std::bitset<32> used;
+};
+
+class Compiler {
+  public:
+    explicit Compiler(const Kernel &kernel)
+        : kernel(kernel), uniform(kernel.variables.size(), true), needs_vector(kernel.variables.size(), false),
+          declared_depth(kernel.variables.size(), 0), scalar_home(kernel.variables.size()),
+          vector_home(kernel.variables.size()) {}
+
+    auto compile() -> std::expected<std::string, sim::Error> {
+        analyze();
+        generate(kernel.body);
+        emit("halt");
+        if (error) {
+            return std::unexpected(std::move(*error));
+        }
+
+        auto text = std::format(".blocks {}\n.warps {}\n", kernel.blocks, kernel.warps);
+        if (if_converted) {
+            // The mask starts with bits for threads that do not exist, which would never leave a loop
+            text += "    sx.slti s1, x0, 1\n";
+        }
+        for (const auto &output_line : lines) {
+            text += output_line;
+            text += '\n';
+        }
+        return text;
+    }
+
+  private:
+    const Kernel &kernel;
+    std::vector<bool> uniform;
+    std::vector<bool> needs_vector; // Uniform variables read by vector code
+    std::vector<std::uint32_t> declared_depth;
+    std::vector<std::optional<Register>> scalar_home;
+    std::vector<std::optional<Register>> vector_home; // The vector copy of uniform variables
+
+    RegisterPool vector_registers{RegisterType::VECTOR, 4};
+    RegisterPool scalar_registers{RegisterType::SCALAR, 2};
+    std::vector<std::string> lines;
+    std::uint32_t labels = 0;
+    std::uint32_t line = 0;  // Of the statement being compiled
+    bool if_converted = false;
+    std::optional<sim::Error> error;
+
+    // Analysis
+
+    void analyze() {
+        // Assignments only ever make variables non-uniform, and vector reads only add vector copies
+        for (auto changed = true; changed;) {
+            changed = false;
+            find_divergent(kernel.body, 0, changed);
+        }
+        for (auto changed = true; changed;) {
+            changed = false;
+            find_vector_uses(kernel.body, 0, changed);
+        }
+    }
+
+    auto is_uniform(const Expr &expr) const -> bool {
+        return std::visit(as::overloaded{
+                              [](const Number &) -> bool { return true; },
+                              [&](const Variable &variable) -> bool { return uniform[variable.id]; },
+                              [](const BuiltinRef &) -> bool { return false; },
+                              [&](const Load &load) -> bool { return is_uniform(*load.index); },
+                              [&](const Unary &unary) -> bool { return is_uniform(*unary.operand); },
+                              [&](const Binary &binary) -> bool {
+                                  return is_uniform(*binary.lhs) && is_uniform(*binary.rhs);
+                              },
+                          },
+                          expr.node);
+    }
+
+    static void set(std::vector<bool> &flags, std::uint32_t variable, bool value, bool &changed) {
+        if (flags[variable] != value) {
+            flags[variable] = value;
+            changed = true;
+        }
+    }
+
+    // A variable assigned under a narrower mask than it was declared under differs between threads, even when the
+    // assigned value does not
+    void find_divergent(const Block &block, std::uint32_t at_depth, bool &changed) {
+        for (const auto &statement : block.statements) {
+            find_divergent(*statement, at_depth, changed);
+        }
+    }
+
+    void find_divergent(const Stmt &stmt, std::uint32_t at_depth, bool &changed) {
+        std::visit(as::overloaded{
+                       [&](const Declaration &declaration) {
+                           declared_depth[declaration.variable] = at_depth;
+                           if (declaration.value && !is_uniform(*declaration.value)) {
+                               set(uniform, declaration.variable, false, changed);
+                           }
+                       },
+                       [&](const Assignment &assignment) {
+                           if (at_depth != declared_depth[assignment.variable] || !is_uniform(*assignment.value)) {
+                               set(uniform, assignment.variable, false, changed);
+                           }
+                       },
+                       [](const Store &) {},
+                       [&](const If &statement) {
+                           const auto inner = is_uniform(*statement.condition) ? at_depth : at_depth + 1;
+                           find_divergent(*statement.then_branch, inner, changed);
+                           if (statement.else_branch) {
+                               find_divergent(*statement.else_branch, inner, changed);
+                           }
+                       },
+                       [&](const Loop &loop) {
+                           const auto inner = is_uniform(*loop.condition) ? at_depth : at_depth + 1;
+                           find_divergent(*loop.body, inner, changed);
+                           if (loop.step) {
+                               find_divergent(*loop.step, inner, changed);
+                           }
+                       },
+                       [&](const Block &block) { find_divergent(block, at_depth, changed); },
+                   },
+                   stmt.node);
+    }
+
+    void read_by_vector_code(const Expr &expr, bool &changed) {
+        std::visit(as::overloaded{
+                       [&](const Variable &variable) {
+                           if (uniform[variable.id]) {
+                               set(needs_vector, variable.id, true, changed);
+                           }
+                       },
+                       [&](const Load &load) { read_by_vector_code(*load.index, changed); },
+                       [&](const Unary &unary) { read_by_vector_code(*unary.operand, changed); },
+                       [&](const Binary &binary) {
+                           read_by_vector_code(*binary.lhs, changed);
+                           read_by_vector_code(*binary.rhs, changed);
+                       },
+                       [](const auto &) {},
+                   },
+                   expr.node);
+    }
+
+    void find_vector_uses(const Block &block, std::uint32_t at_depth, bool &changed) {
+        for (const auto &statement : block.statements) {
+            find_vector_uses(*statement, at_depth, changed);
+        }
+    }
+
+    void find_vector_uses(const Stmt &stmt, std::uint32_t at_depth, bool &changed) {
+        auto assigned = [&](std::uint32_t variable, const ExprPtr &value) {
+            if (value && (!uniform[variable] || needs_vector[variable])) {
+                read_by_vector_code(*value, changed);
+            }
+        };
+        std::visit(as::overloaded{
+                       [&](const Declaration &declaration) { assigned(declaration.variable, declaration.value); },
+                       [&](const Assignment &assignment) { assigned(assignment.variable, assignment.value); },
+                       // There are no scalar stores, their opcode is the one of the branches
+                       [&](const Store &store) {
+                           read_by_vector_code(*store.index, changed);
+                           read_by_vector_code(*store.value, changed);
+                       },
+                       [&](const If &statement) {
+                           auto inner = at_depth;
+                           if (!is_uniform(*statement.condition)) {
+                               read_by_vector_code(*statement.condition, changed);
+                               inner++;
+                           }
+                           find_vector_uses(*statement.then_branch, inner, changed);
+                           if (statement.else_branch) {
+                               find_vector_uses(*statement.else_branch, inner, changed);
+                           }
+                       },
+                       [&](const Loop &loop) {
+                           auto inner = at_depth;
+                           if (!is_uniform(*loop.condition)) {
+                               read_by_vector_code(*loop.condition, changed);
+                               inner++;
+                           }
+                           find_vector_uses(*loop.body, inner, changed);
+                           if (loop.step) {
+                               find_vector_uses(*loop.step, inner, changed);
+                           }
+                       },
+                       [&](const Block &block) { find_vector_uses(block, at_depth, changed); },
+                   },
+                   stmt.node);
+    }
+
+    // Output
+
+    void emit(std::string instruction) {
+        lines.push_back("    " + instruction);
+    }
+
+    void emit(std::string_view name, Register rd, Register rs1, Register rs2) {
+        emit(std::format("{} {}, {}, {}", name, rd.to_str(), rs1.to_str(), rs2.to_str()));
+    }
+
+    void emit(std::string_view name, Register rd, Register rs1, std::int64_t immediate) {
+        emit(std::format("{} {}, {}, {}", name, rd.to_str(), rs1.to_str(), raw(immediate)));
+    }
+
+    void place(const std::string &label) {
+        lines.push_back(label + ":");
+    }
+
+    auto new_label(std::string_view kind) -> std::string {
+        return std::format("{}_{}", kind, labels++);
+    }
+
+    void fail(std::string message, std::uint32_t column = 0, std::optional<std::uint32_t> at_line = std::nullopt) {
+        if (!error) {
+            error = sim::Error(std::move(message), column, at_line.value_or(line));
+        }
+    }
+
+    // Registers
+
+    auto allocate(RegisterType type) -> Register {
+        auto &pool = type == RegisterType::VECTOR ? vector_registers : scalar_registers;
+        if (const auto reg = pool.allocate()) {
+            return *reg;
+        }
+        fail(std::format("Out of {} registers", type == RegisterType::VECTOR ? "vector" : "scalar"));
+        return zero(type);
+    }
+
+    void release(Value value) {
+        if (value.temporary) {
+            (value.reg.is_vector() ? vector_registers : scalar_registers).release(value.reg);
+        }
+    }
+
+    auto target(RegisterType type, std::optional<Register> into) -> Value {
+        return into ? Value{*into, false} : Value{allocate(type), true};
+    }
+
+    auto move(Value value, std::optional<Register> into) -> Value {
+        if (!into || value.reg == *into) {
+            return value;
+        }
+        release(value);
+        emit(mnemonic(into->type, "addi"), *into, value.reg, 0);
+        return Value{*into, false};
+    }
+
+    // Expressions, computed into `into` when given. Only the last instruction of an expression may read its operands
+    // after `into` has been written, since `into` may be one of them.
+
+    auto value(const Expr &expr, RegisterType type, std::optional<Register> into = std::nullopt) -> Value {
+        return std::visit(as::overloaded{
+                              [&](const Number &number) -> Value { return constant(number.value, type, into); },
+                              [&](const Variable &variable) -> Value {
+                                  const auto &home = type == RegisterType::SCALAR ? scalar_home[variable.id]
+                                                                                  : vector_home[variable.id];
+                                  return move(Value{*home, false}, into);
+                              },
+                              [&](const BuiltinRef &builtin) -> Value {
+                                  return move(Value{Register{static_cast<IData>(builtin.builtin), type}, false}, into);
+                              },
+                              [&](const Load &load) -> Value { return this->load(load, type, into); },
+                              [&](const Unary &unary) -> Value { return this->unary(unary, type, into); },
+                              [&](const Binary &binary) -> Value { return this->binary(expr, binary, type, into); },
+                          },
+                          expr.node);
+    }
+
+    auto constant(std::int32_t number, RegisterType type, std::optional<Register> into) -> Value {
+        if (number == 0 && !into) {
+            return Value{zero(type), false};
+        }
+        const auto result = target(type, into);
+        const auto parts = as::materialize_constant(number);
+        if (parts.upper) {
+            emit(std::format("{} {}, {}", mnemonic(type, "lui"), result.reg.to_str(), *parts.upper));
+        }
+        if (parts.lower || !parts.upper) {
+            emit(mnemonic(type, "addi"), result.reg, parts.upper ? result.reg : zero(type), parts.lower.value_or(0));
+        }
+        return result;
+    }
+
+    // The base register and offset of an array element. Constant parts of the index go into the offset.
+    auto address(const Expr &index, std::int32_t array_address, RegisterType type) -> std::pair<Value, std::int32_t> {
+        auto offset = static_cast<std::uint32_t>(array_address);
+        const auto *variable_part = &index;
+        if (const auto number = as_number(index)) {
+            offset += static_cast<std::uint32_t>(*number);
+            variable_part = nullptr;
+        } else if (const auto *sum = std::get_if<Binary>(&index.node);
+                   sum != nullptr && (sum->op == BinaryOp::ADD || sum->op == BinaryOp::SUB)) {
+            if (const auto number = as_number(*sum->rhs)) {
+                const auto part = static_cast<std::uint32_t>(*number);
+                offset += sum->op == BinaryOp::ADD ? part : 0u - part;
+                variable_part = sum->lhs.get();
+            } else if (const auto number = as_number(*sum->lhs); number && sum->op == BinaryOp::ADD) {
+                offset += static_cast<std::uint32_t>(*number);
+                variable_part = sum->rhs.get();
+            }
+        }
+
+        const auto signed_offset = static_cast<std::int32_t>(offset);
+        auto base = variable_part != nullptr ? value(*variable_part, type) : Value{zero(type), false};
+        if (fits_immediate(signed_offset)) {
+            return {base, signed_offset};
+        }
+        if (variable_part == nullptr) {
+            return {constant(signed_offset, type, std::nullopt), 0};
+        }
+        const auto part = constant(signed_offset, type, std::nullopt);
+        release(base);
+        release(part);
+        const auto result = target(type, std::nullopt);
+        emit(mnemonic(type, "add"), result.reg, base.reg, part.reg);
+        return {result, 0};
+    }
+
+    auto load(const Load &load, RegisterType type, std::optional<Register> into) -> Value {
+        const auto [base, offset] = address(*load.index, kernel.arrays[load.array].address, type);
+        release(base);
+        const auto result = target(type, into);
+        emit(std::format("{} {}, {}({})", mnemonic(type, "lw"), result.reg.to_str(), raw(offset), base.reg.to_str()));
+        return result;
+    }
+
+    auto unary(const Unary &unary, RegisterType type, std::optional<Register> into) -> Value {
+        const auto operand = value(*unary.operand, type);
+        release(operand);
+        const auto result = target(type, into);
+        switch (unary.op) {
+            case UnaryOp::NEG: emit(mnemonic(type, "sub"), result.reg, zero(type), operand.reg); break;
+            case UnaryOp::NOT: emit(mnemonic(type, "xori"), result.reg, operand.reg, -1); break;
+            case UnaryOp::LOGICAL_NOT: emit(mnemonic(type, "slti"), result.reg, operand.reg, 1); break;
+        }
+        return result;
+    }
+
+    auto binary(const Expr &expr, const Binary &binary, RegisterType type, std::optional<Register> into) -> Value {
+        switch (binary.op) {
+            case BinaryOp::MUL: return multiply(expr, binary, type, into);
+            case BinaryOp::GT: return arithmetic(BinaryOp::LT, *binary.rhs, *binary.lhs, type, into);
+            case BinaryOp::LE: return invert(arithmetic(BinaryOp::LT, *binary.rhs, *binary.lhs, type, into), into);
+            case BinaryOp::GE: return invert(arithmetic(BinaryOp::LT, *binary.lhs, *binary.rhs, type, into), into);
+            case BinaryOp::EQ: case BinaryOp::NE: {
+                const auto difference = this->difference(*binary.lhs, *binary.rhs, type);
+                release(difference);
+                const auto result = target(type, into);
+                if (binary.op == BinaryOp::EQ) {
+                    emit(mnemonic(type, "slti"), result.reg, difference.reg, 1);
+                } else {
+                    emit(mnemonic(type, "slt"), result.reg, zero(type), difference.reg);
+                }
+                return result;
+            }
+            case BinaryOp::LOGICAL_AND: case BinaryOp::LOGICAL_OR: {
+                const auto lhs = boolean(*binary.lhs, type);
+                const auto rhs = boolean(*binary.rhs, type);
+                release(lhs);
+                release(rhs);
+                const auto result = target(type, into);
+                emit(mnemonic(type, binary.op == BinaryOp::LOGICAL_AND ? "and" : "or"), result.reg, lhs.reg, rhs.reg);
+                return result;
+            }
+            default: return arithmetic(binary.op, *binary.lhs, *binary.rhs, type, into);
+        }
+    }
+
+    // Operators with an instruction of their own, and its immediate form
+    auto arithmetic(BinaryOp op, const Expr &lhs, const Expr &rhs, RegisterType type, std::optional<Register> into)
+        -> Value {
+        struct Forms {
+            std::string_view reg;
+            std::string_view immediate;
+            bool commutative;
+        };
+        const auto forms = [&]() -> Forms {
+            switch (op) {
+                case BinaryOp::ADD: return {"add", "addi", true};
+                case BinaryOp::SUB: return {"sub", "addi", false}; // Adds the negated constant
+                case BinaryOp::AND: return {"and", "andi", true};
+                case BinaryOp::OR: return {"or", "ori", true};
+                case BinaryOp::XOR: return {"xor", "xori", true};
+                case BinaryOp::SHL: return {"sll", "slli", false};
+                case BinaryOp::SHR: return {"srl", "srli", false};
+                case BinaryOp::LT: return {"slt", "slti", false};
+                default: std::unreachable();
+            }
+        }();
+
+        const auto *a = &lhs;
+        const auto *b = &rhs;
+        if (forms.commutative && as_number(*a) && !as_number(*b)) {
+            std::swap(a, b);
+        }
+        if (const auto number = as_number(*b)) {
+            auto immediate = std::int64_t{*number};
+            if (op == BinaryOp::SUB) {
+                immediate = -immediate;
+            } else if (op == BinaryOp::SHL || op == BinaryOp::SHR) {
+                immediate &= 31;
+            }
+            if (fits_immediate(immediate)) {
+                const auto operand = value(*a, type);
+                release(operand);
+                const auto result = target(type, into);
+                emit(mnemonic(type, forms.immediate), result.reg, operand.reg, immediate);
+                return result;
+            }
+        }
+
+        const auto first = value(*a, type);
+        const auto second = value(*b, type);
+        release(first);
+        release(second);
+        const auto result = target(type, into);
+        emit(mnemonic(type, forms.reg), result.reg, first.reg, second.reg);
+        return result;
+    }
+
+    auto invert(Value boolean, std::optional<Register> into) -> Value {
+        release(boolean);
+        const auto result = target(boolean.reg.type, into);
+        emit(mnemonic(boolean.reg.type, "xori"), result.reg, boolean.reg, 1);
+        return result;
+    }
+
+    // Zero exactly when both sides are equal
+    auto difference(const Expr &lhs, const Expr &rhs, RegisterType type) -> Value {
+        if (as_number(rhs) == 0) {
+            return value(lhs, type);
+        }
+        if (as_number(lhs) == 0) {
+            return value(rhs, type);
+        }
+        return arithmetic(BinaryOp::XOR, lhs, rhs, type, std::nullopt);
+    }
+
+    auto boolean(const Expr &expr, RegisterType type) -> Value {
+        if (is_boolean(expr)) {
+            return value(expr, type);
+        }
+        const auto operand = value(expr, type);
+        release(operand);
+        const auto result = target(type, std::nullopt);
+        emit(mnemonic(type, "slt"), result.reg, zero(type), operand.reg);
+        return result;
+    }
+
+    // Strength-reduced to a sum of shifts, negative factors negate the sum
+    auto multiply(const Expr &expr, const Binary &binary, RegisterType type, std::optional<Register> into) -> Value {
+        const auto *operand_expr = binary.lhs.get();
+        auto factor = as_number(*binary.rhs);
+        if (!factor) {
+            operand_expr = binary.rhs.get();
+            factor = as_number(*binary.lhs);
+        }
+        if (!factor) {
+            fail("The GPU has no multiplier, one side of '*' has to be a constant", expr.column, expr.line);
+            return Value{zero(type), false};
+        }
+
+        const auto negative = *factor < 0;
+        const auto magnitude = negative ? 0u - static_cast<std::uint32_t>(*factor) : static_cast<std::uint32_t>(*factor);
+        if (magnitude == 0) {
+            return constant(0, type, into);
+        }
+        if (magnitude == 1 && !negative) {
+            return value(*operand_expr, type, into);
+        }
+
+        auto shifts = std::vector<std::int64_t>{};
+        for (auto bit = 31; bit >= 0; bit--) {
+            if (((magnitude >> bit) & 1u) != 0) {
+                shifts.push_back(bit);
+            }
+        }
+
+        const auto operand = value(*operand_expr, type);
+        auto shifted = [&](std::int64_t shift, std::optional<Register> to) -> Value {
+            if (shift == 0) {
+                return Value{operand.reg, false};
+            }
+            const auto term = target(type, to);
+            emit(mnemonic(type, "slli"), term.reg, operand.reg, shift);
+            return term;
+        };
+
+        auto product = Value{};
+        if (shifts.size() == 1) {
+            release(operand);
+            product = shifted(shifts[0], negative ? std::nullopt : into);
+        } else {
+            product = shifted(shifts[0], std::nullopt);
+            for (auto i = std::size_t{1}; i < shifts.size(); i++) {
+                const auto term = shifted(shifts[i], std::nullopt);
+                if (i + 1 < shifts.size()) {
+                    emit(mnemonic(type, "add"), product.reg, product.reg, term.reg);
+                    release(term);
+                    continue;
+                }
+                release(term);
+                release(product);
+                release(operand);
+                const auto sum = target(type, negative ? std::nullopt : into);
+                emit(mnemonic(type, "add"), sum.reg, product.reg, term.reg);
+                product = sum;
+            }
+        }
+
+        if (!negative) {
+            return product;
+        }
+        release(product);
+        const auto result = target(type, into);
+        emit(mnemonic(type, "sub"), result.reg, zero(type), product.reg);
+        return result;
+    }
+
+    // Conditions over uniform values, jumps to `label` when the condition is `when`
+
+    void branch(const Expr &condition, const std::string &label, bool when) {
+        if (const auto number = as_number(condition)) {
+            if ((*number != 0) == when) {
+                emit("j " + label);
+            }
+            return;
+        }
+        if (const auto *unary = std::get_if<Unary>(&condition.node); unary && unary->op == UnaryOp::LOGICAL_NOT) {
+            branch(*unary->operand, label, !when);
+            return;
+        }
+        if (const auto *binary = std::get_if<Binary>(&condition.node)) {
+            if (binary->op == BinaryOp::LOGICAL_AND || binary->op == BinaryOp::LOGICAL_OR) {
+                // Either side decides when it is `when` for ||, or not `when` for &&
+                if ((binary->op == BinaryOp::LOGICAL_OR) == when) {
+                    branch(*binary->lhs, label, when);
+                    branch(*binary->rhs, label, when);
+                } else {
+                    const auto next = new_label("next");
+                    branch(*binary->lhs, next, !when);
+                    branch(*binary->rhs, label, when);
+                    place(next);
+                }
+                return;
+            }
+            if (binary->op >= BinaryOp::LT && binary->op <= BinaryOp::NE) {
+                compare_and_branch(*binary, label, when);
+                return;
+            }
+        }
+        const auto operand = value(condition, RegisterType::SCALAR);
+        release(operand);
+        emit(std::format("{} {}, s0, {}", when ? "bne" : "beq", operand.reg.to_str(), label));
+    }
+
+    void compare_and_branch(const Binary &comparison, const std::string &label, bool when) {
+        auto op = comparison.op;
+        if (!when) {
+            switch (op) {
+                case BinaryOp::LT: op = BinaryOp::GE; break;
+                case BinaryOp::GE: op = BinaryOp::LT; break;
+                case BinaryOp::GT: op = BinaryOp::LE; break;
+                case BinaryOp::LE: op = BinaryOp::GT; break;
+                case BinaryOp::EQ: op = BinaryOp::NE; break;
+                default: op = BinaryOp::EQ; break;
+            }
+        }
+        // a > b is b < a and a <= b is b >= a
+        const auto swapped = op == BinaryOp::GT || op == BinaryOp::LE;
+        const auto name = [&] {
+            switch (op) {
+                case BinaryOp::LT: case BinaryOp::GT: return "blt";
+                case BinaryOp::GE: case BinaryOp::LE: return "bge";
+                case BinaryOp::EQ: return "beq";
+                default: return "bne";
+            }
+        }();
+        const auto first = value(swapped ? *comparison.rhs : *comparison.lhs, RegisterType::SCALAR);
+        const auto second = value(swapped ? *comparison.lhs : *comparison.rhs, RegisterType::SCALAR);
+        release(first);
+        release(second);
+        emit(std::format("{} {}, {}, {}", name, first.reg.to_str(), second.reg.to_str(), label));
+    }
+
+    // Conditions that differ between threads, as the mask of the active threads for which they hold
+
+    auto mask(const Expr &condition, std::optional<Register> into) -> Value {
+        if (const auto number = as_number(condition)) {
+            return move(Value{*number != 0 ? EXECUTION_MASK : zero(RegisterType::SCALAR), false}, into);
+        }
+        if (const auto *unary = std::get_if<Unary>(&condition.node); unary && unary->op == UnaryOp::LOGICAL_NOT) {
+            return complement(mask(*unary->operand, std::nullopt), into);
+        }
+        if (const auto *binary = std::get_if<Binary>(&condition.node)) {
+            switch (binary->op) {
+                case BinaryOp::LOGICAL_AND: case BinaryOp::LOGICAL_OR: {
+                    const auto lhs = mask(*binary->lhs, std::nullopt);
+                    const auto rhs = mask(*binary->rhs, std::nullopt);
+                    release(lhs);
+                    release(rhs);
+                    const auto result = target(RegisterType::SCALAR, into);
+                    emit(binary->op == BinaryOp::LOGICAL_AND ? "s.and" : "s.or", result.reg, lhs.reg, rhs.reg);
+                    return result;
+                }
+                case BinaryOp::LT: return less(*binary->lhs, *binary->rhs, into);
+                case BinaryOp::GT: return less(*binary->rhs, *binary->lhs, into);
+                case BinaryOp::GE: return complement(less(*binary->lhs, *binary->rhs, std::nullopt), into);
+                case BinaryOp::LE: return complement(less(*binary->rhs, *binary->lhs, std::nullopt), into);
+                case BinaryOp::EQ: case BinaryOp::NE: {
+                    const auto difference = this->difference(*binary->lhs, *binary->rhs, RegisterType::VECTOR);
+                    release(difference);
+                    const auto result = target(RegisterType::SCALAR, into);
+                    if (binary->op == BinaryOp::EQ) {
+                        emit("sx.slti", result.reg, difference.reg, 1);
+                    } else {
+                        emit("sx.slt", result.reg, zero(RegisterType::VECTOR), difference.reg);
+                    }
+                    return result;
+                }
+                default: break;
+            }
+        }
+        const auto operand = value(condition, RegisterType::VECTOR);
+        release(operand);
+        const auto result = target(RegisterType::SCALAR, into);
+        emit("sx.slt", result.reg, zero(RegisterType::VECTOR), operand.reg);
+        return result;
+    }
+
+    auto less(const Expr &lhs, const Expr &rhs, std::optional<Register> into) -> Value {
+        if (const auto number = as_number(rhs); number && fits_immediate(*number)) {
+            const auto operand = value(lhs, RegisterType::VECTOR);
+            release(operand);
+            const auto result = target(RegisterType::SCALAR, into);
+            emit("sx.slti", result.reg, operand.reg, *number);
+            return result;
+        }
+        const auto first = value(lhs, RegisterType::VECTOR);
+        const auto second = value(rhs, RegisterType::VECTOR);
+        release(first);
+        release(second);
+        const auto result = target(RegisterType::SCALAR, into);
+        emit("sx.slt", result.reg, first.reg, second.reg);
+        return result;
+    }
+
+    // The active threads not in the mask
+    auto complement(Value mask, std::optional<Register> into) -> Value {
+        release(mask);
+        const auto result = target(RegisterType::SCALAR, into);
+        emit("s.xor", result.reg, EXECUTION_MASK, mask.reg);
+        return result;
+    }
+
+    // Statements
+
+    void generate(const Block &block) {
+        for (const auto &statement : block.statements) {
+            generate(*statement);
+        }
+        for (const auto variable : block.declared) {
+            for (auto *home : {&scalar_home[variable], &vector_home[variable]}) {
+                if (*home) {
+                    release(Value{**home, true});
+                    home->reset();
+                }
+            }
+        }
+    }
+
+    void generate(const Stmt &stmt) {
+        line = stmt.line;
+        std::visit(as::overloaded{
+                       [&](const Declaration &declaration) {
+                           if (uniform[declaration.variable]) {
+                               scalar_home[declaration.variable] = allocate(RegisterType::SCALAR);
+                           }
+                           if (!uniform[declaration.variable] || needs_vector[declaration.variable]) {
+                               vector_home[declaration.variable] = allocate(RegisterType::VECTOR);
+                           }
+                           assign(declaration.variable, declaration.value.get());
+                       },
+                       [&](const Assignment &assignment) { assign(assignment.variable, assignment.value.get()); },
+                       [&](const Store &store) { this->store(store); },
+                       [&](const If &statement) {
+                           if (const auto number = as_number(*statement.condition)) {
+                               if (*number != 0) {
+                                   generate(*statement.then_branch);
+                               } else if (statement.else_branch) {
+                                   generate(*statement.else_branch);
+                               }
+                           } else if (is_uniform(*statement.condition)) {
+                               branch_if(statement);
+                           } else {
+                               convert_if(statement);
+                           }
+                       },
+                       [&](const Loop &loop) {
+                           if (is_uniform(*loop.condition)) {
+                               branch_loop(loop);
+                           } else {
+                               convert_loop(loop);
+                           }
+                       },
+                       [&](const Block &block) { generate(block); },
+                   },
+                   stmt.node);
+    }
+
+    // Declarations without a value start at zero
+    void assign(std::uint32_t variable, const Expr *expr) {
+        auto assign_to = [&](RegisterType type, Register home) {
+            if (expr != nullptr) {
+                value(*expr, type, home);
+            } else {
+                constant(0, type, home);
+            }
+        };
+        if (scalar_home[variable]) {
+            assign_to(RegisterType::SCALAR, *scalar_home[variable]);
+        }
+        if (vector_home[variable]) {
+            assign_to(RegisterType::VECTOR, *vector_home[variable]);
+        }
+    }
+
+    void store(const Store &store) {
+        const auto stored = value(*store.value, RegisterType::VECTOR);
+        const auto [base, offset] = address(*store.index, kernel.arrays[store.array].address, RegisterType::VECTOR);
+        emit(std::format("sw {}, {}({})", stored.reg.to_str(), raw(offset), base.reg.to_str()));
+        release(stored);
+        release(base);
+    }
+
+    void branch_if(const If &statement) {
+        const auto end = new_label("end");
+        if (!statement.else_branch) {
+            branch(*statement.condition, end, false);
+            generate(*statement.then_branch);
+            place(end);
+            return;
+        }
+        const auto otherwise = new_label("else");
+        branch(*statement.condition, otherwise, false);
+        generate(*statement.then_branch);
+        emit("j " + end);
+        place(otherwise);
+        generate(*statement.else_branch);
+        place(end);
+    }
+
+    // Saves the mask of the enclosing code, the top of the mask stack
+    auto push_mask() -> Register {
+        if_converted = true;
+        const auto saved = allocate(RegisterType::SCALAR);
+        emit("s.addi", saved, EXECUTION_MASK, 0);
+        return saved;
+    }
+
+    void pop_mask(Register saved) {
+        emit("s.addi", EXECUTION_MASK, saved, 0);
+        release(Value{saved, true});
+    }
+
+    // Branches over the body when no thread runs it, if that saves anything
+    auto skip_if_empty(const Stmt &body, const std::string &label) -> bool {
+        if (estimate_size(body) <= SKIP_THRESHOLD) {
+            return false;
+        }
+        emit(std::format("beq s1, s0, {}", label));
+        return true;
+    }
+
+    void convert_if(const If &statement) {
+        const auto saved = push_mask();
+        mask(*statement.condition, EXECUTION_MASK);
+        const auto otherwise = new_label("else");
+        const auto end = new_label("end");
+        const auto skipped_then = skip_if_empty(*statement.then_branch, statement.else_branch ? otherwise : end);
+        generate(*statement.then_branch);
+        auto skipped_else = false;
+        if (statement.else_branch) {
+            if (skipped_then) {
+                place(otherwise);
+            }
+            // An empty then mask leaves the whole saved mask
+            emit("s.xor", EXECUTION_MASK, saved, EXECUTION_MASK);
+            skipped_else = skip_if_empty(*statement.else_branch, end);
+            generate(*statement.else_branch);
+        }
+        if ((skipped_then && !statement.else_branch) || skipped_else) {
+            place(end);
+        }
+        pop_mask(saved);
+    }
+
+    // Checked once on entry and then at the bottom, so an iteration takes a single branch
+    void branch_loop(const Loop &loop) {
+        const auto top = new_label("loop");
+        const auto end = new_label("end");
+        branch(*loop.condition, end, false);
+        place(top);
+        generate(*loop.body);
+        if (loop.step) {
+            generate(*loop.step);
+        }
+        branch(*loop.condition, top, true);
+        place(end);
+    }
+
+    // Threads leave the mask as their condition fails, the loop ends when none is left
+    void convert_loop(const Loop &loop) {
+        const auto saved = push_mask();
+        const auto top = new_label("loop");
+        const auto end = new_label("end");
+        mask(*loop.condition, EXECUTION_MASK);
+        emit(std::format("beq s1, s0, {}", end));
+        place(top);
+        generate(*loop.body);
+        if (loop.step) {
+            generate(*loop.step);
+        }
+        mask(*loop.condition, EXECUTION_MASK);
+        emit(std::format("bne s1, s0, {}", top));
+        place(end);
+        pop_mask(saved);
+    }
+};
+
+} // namespace
+
+auto compile(const Kernel &kernel) -> std::expected<std::string, std::vector<sim::Error>> {
+    auto assembly = Compiler{kernel}.compile();
+    if (!assembly.has_value()) {
+        return std::unexpected(std::vector{std::move(assembly.error())});
+    }
+    return std::move(*assembly);
+}
+
+auto compile(std::string_view source) -> std::expected<std::string, std::vector<sim::Error>> {
+    const auto kernel = parse_kernel(source);
+    if (!kernel.has_value()) {
+        return std::unexpected(kernel.error());
+    }
+    return compile(*kernel);
+}
+
+} // namespace cc
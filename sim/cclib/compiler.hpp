@@ -0,0 +1,34 @@
+#pragma once
+
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.hpp"
+#include "error.hpp"
+
+namespace cc {
+
+// Compiles a kernel (kernel_parser.hpp) into assembly for the assembler (aslib/parser.hpp).
+//
+// Uniform values are scalarized. A variable is uniform when every assignment to it is made by the whole warp and
+// computes the same value for every thread, that is when it only depends on constants, other uniform variables and
+// loads from uniform addresses. Uniform variables live in scalar registers, so their updates and loads run once per
+// warp and conditions over them become plain scalar branches. Vector code that reads a uniform variable reads a
+// vector copy, which is kept up to date next to the scalar register where it is needed, since nothing moves values
+// from scalar to vector registers.
+//
+// Conditions that differ between threads are if-converted: sx.slt and sx.slti set one bit per active thread, so
+// writing them to the execution mask (s1) narrows it to the threads that take the branch. The enclosing mask is saved
+// to a scalar register first and restored afterwards, nested saves form a software mask stack, and the else branch
+// runs under the saved mask without the then mask. Bodies longer than a few instructions are branched over when the
+// mask is empty. Loops over such conditions run until the mask of the threads still in the loop is empty.
+//
+// Vector values go to x4-x31 and scalar ones to s2-s31, both shared between variables, which hold their registers
+// for their scope, and expression temporaries. Running out of registers is a compile error.
+auto compile(const Kernel &kernel) -> std::expected<std::string, std::vector<sim::Error>>;
+
+// Parses and compiles
+auto compile(std::string_view source) -> std::expected<std::string, std::vector<sim::Error>>;
+
+} // namespace cc
@@ -0,0 +1,679 @@
+#include "kernel_parser.hpp"
+#include "common.hpp"
+#include "parser_utils.hpp"
+#include <algorithm>
+#include <array>
+#include <format>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#define PARSE_OR_RETURN(var, ...)  \
+    auto var = __VA_ARGS__;        \
+    if (!var.has_value()) {        \
+        return std::nullopt;       \
+    }
+
+namespace cc {
+
+namespace {
+
+struct Token {
+    enum class Kind : std::uint8_t { IDENTIFIER, NUMBER, SYMBOL, END };
+
+    Kind kind;
+    std::string_view text;
+    std::int32_t value = 0;
+    std::uint32_t line;
+    std::uint32_t column;
+};
+
+// Longest match first
+constexpr auto SYMBOLS = std::array<std::string_view, 32>{
+    "<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "+=", "-=", "++", "--", "{", "}", "(", ")",
+    "[",  "]",  ";",  ",",  "=",  "+",  "-",  "*",  "&",  "|",  "^",  "~",  "!",  "<",  ">",  "@",
+};
+
+auto tokenize(std::string_view source) -> std::expected<std::vector<Token>, sim::Error> {
+    auto tokens = std::vector<Token>{};
+    auto line = std::uint32_t{1};
+    auto line_start = source.data();
+    auto rest = source;
+    auto chop = [&](std::size_t count) { rest.remove_prefix(count); };
+
+    while (!rest.empty()) {
+        const auto column = static_cast<std::uint32_t>(rest.data() - line_start) + 1;
+        const auto c = rest.front();
+        if (c == '\n') {
+            chop(1);
+            line++;
+            line_start = rest.data();
+        } else if (as::is_whitespace(c)) {
+            chop(1);
+        } else if (rest.starts_with("//")) {
+            const auto end = rest.find('\n');
+            chop(end == std::string_view::npos ? rest.size() : end);
+        } else if (as::is_numeric(c)) {
+            auto number = rest;
+            const auto value = as::parse_num(number);
+            if (!value.has_value()) {
+                return std::unexpected(sim::Error(value.error().message, column, line));
+            }
+            const auto length = static_cast<std::size_t>(number.data() - rest.data());
+            tokens.push_back(Token{Token::Kind::NUMBER, rest.substr(0, length), static_cast<std::int32_t>(*value), line,
+                                   column});
+            chop(length);
+        } else if (as::is_alphabetic(c) || c == '_') {
+            auto length = std::size_t{1};
+            while (length < rest.size() && (as::is_alphanumeric(rest[length]) || rest[length] == '_')) {
+                length++;
+            }
+            tokens.push_back(Token{Token::Kind::IDENTIFIER, rest.substr(0, length), 0, line, column});
+            chop(length);
+        } else {
+            const auto symbol = std::ranges::find_if(SYMBOLS, [&](auto s) { return rest.starts_with(s); });
+            if (symbol == SYMBOLS.end()) {
+                return std::unexpected(sim::Error(std::format("Unexpected character '{}'", c), column, line));
+            }
+            tokens.push_back(Token{Token::Kind::SYMBOL, *symbol, 0, line, column});
+            chop(symbol->size());
+        }
+    }
+    tokens.push_back(Token{Token::Kind::END, "", 0, line, static_cast<std::uint32_t>(rest.data() - line_start) + 1});
+    return tokens;
+}
+
+constexpr auto KEYWORDS = std::array<std::string_view, 7>{"int", "const", "kernel", "if", "else", "for", "while"};
+
+// What a name refers to
+struct Local {
+    std::uint32_t id;
+};
+struct Constant {
+    std::int32_t value;
+};
+struct ArrayName {
+    std::uint32_t id;
+};
+using Name = std::variant<Local, Constant, ArrayName, Builtin>;
+
+// Binary operators by increasing precedence
+struct Level {
+    std::vector<std::pair<std::string_view, BinaryOp>> operators;
+};
+
+const auto LEVELS = std::array<Level, 9>{{
+    {{{"||", BinaryOp::LOGICAL_OR}}},
+    {{{"&&", BinaryOp::LOGICAL_AND}}},
+    {{{"|", BinaryOp::OR}}},
+    {{{"^", BinaryOp::XOR}}},
+    {{{"&", BinaryOp::AND}}},
+    {{{"==", BinaryOp::EQ}, {"!=", BinaryOp::NE}}},
+    {{{"<", BinaryOp::LT}, {">", BinaryOp::GT}, {"<=", BinaryOp::LE}, {">=", BinaryOp::GE}}},
+    {{{"<<", BinaryOp::SHL}, {">>", BinaryOp::SHR}}},
+    {{{"+", BinaryOp::ADD}, {"-", BinaryOp::SUB}}},
+}};
+
+// Same semantics as the generated code: wrapping arithmetic, unsigned comparisons and logical shifts
+auto fold(BinaryOp op, std::int32_t lhs, std::int32_t rhs) -> std::int32_t {
+    const auto a = static_cast<std::uint32_t>(lhs);
+    const auto b = static_cast<std::uint32_t>(rhs);
+    switch (op) {
+        case BinaryOp::ADD: return static_cast<std::int32_t>(a + b);
+        case BinaryOp::SUB: return static_cast<std::int32_t>(a - b);
+        case BinaryOp::MUL: return static_cast<std::int32_t>(a * b);
+        case BinaryOp::AND: return static_cast<std::int32_t>(a & b);
+        case BinaryOp::OR: return static_cast<std::int32_t>(a | b);
+        case BinaryOp::XOR: return static_cast<std::int32_t>(a ^ b);
+        case BinaryOp::SHL: return static_cast<std::int32_t>(a << (b & 31));
+        case BinaryOp::SHR: return static_cast<std::int32_t>(a >> (b & 31));
+        case BinaryOp::LT: return a < b;
+        case BinaryOp::GT: return a > b;
+        case BinaryOp::LE: return a <= b;
+        case BinaryOp::GE: return a >= b;
+        case BinaryOp::EQ: return a == b;
+        case BinaryOp::NE: return a != b;
+        case BinaryOp::LOGICAL_AND: return a != 0 && b != 0;
+        case BinaryOp::LOGICAL_OR: return a != 0 || b != 0;
+    }
+    std::unreachable();
+}
+
+auto clone(const Expr &expr) -> ExprPtr {
+    auto node = std::visit(as::overloaded{
+                               [](const Load &load) -> decltype(Expr::node) {
+                                   return Load{load.array, clone(*load.index)};
+                               },
+                               [](const Unary &unary) -> decltype(Expr::node) {
+                                   return Unary{unary.op, clone(*unary.operand)};
+                               },
+                               [](const Binary &binary) -> decltype(Expr::node) {
+                                   return Binary{binary.op, clone(*binary.lhs), clone(*binary.rhs)};
+                               },
+                               [](const auto &leaf) -> decltype(Expr::node) { return leaf; },
+                           },
+                           expr.node);
+    return std::make_unique<Expr>(Expr{std::move(node), expr.line, expr.column});
+}
+
+class Parser {
+  public:
+    explicit Parser(std::vector<Token> tokens) : tokens(std::move(tokens)) {
+        scopes.emplace_back();
+        scopes.back().emplace("thread_id", Builtin::THREAD_ID);
+        scopes.back().emplace("block_id", Builtin::BLOCK_ID);
+        scopes.back().emplace("block_size", Builtin::BLOCK_SIZE);
+    }
+
+    auto parse() -> std::expected<Kernel, sim::Error> {
+        auto has_kernel = false;
+        while (peek().kind != Token::Kind::END && !error) {
+            if (accept("const")) {
+                parse_constant();
+            } else if (accept("int")) {
+                parse_array();
+            } else if (is("kernel")) {
+                if (has_kernel) {
+                    fail("A file holds a single kernel");
+                    break;
+                }
+                has_kernel = true;
+                next();
+                parse_kernel_body();
+            } else {
+                fail(std::format("Expected 'const', 'int' or 'kernel', found '{}'", peek().text));
+            }
+        }
+        if (!error && !has_kernel) {
+            fail("Expected a kernel");
+        }
+        if (error) {
+            return std::unexpected(std::move(*error));
+        }
+        return std::move(kernel);
+    }
+
+  private:
+    std::vector<Token> tokens;
+    std::size_t position = 0;
+    Kernel kernel;
+    std::vector<std::unordered_map<std::string_view, Name>> scopes;
+    std::optional<sim::Error> error;
+
+    auto peek() const -> const Token & { return tokens[position]; }
+
+    auto next() -> const Token & {
+        const auto &token = tokens[position];
+        if (token.kind != Token::Kind::END) {
+            position++;
+        }
+        return token;
+    }
+
+    auto is(std::string_view text) const -> bool {
+        return peek().kind != Token::Kind::NUMBER && peek().kind != Token::Kind::END && peek().text == text;
+    }
+
+    auto accept(std::string_view text) -> bool {
+        if (is(text)) {
+            next();
+            return true;
+        }
+        return false;
+    }
+
+    auto fail(std::string message) -> std::nullopt_t {
+        if (!error) {
+            error = sim::Error(std::move(message), peek().column, peek().line);
+        }
+        return std::nullopt;
+    }
+
+    auto expect(std::string_view text) -> bool {
+        if (accept(text)) {
+            return true;
+        }
+        fail(std::format("Expected '{}', found '{}'", text, peek().text));
+        return false;
+    }
+
+    auto expect_name() -> std::optional<std::string_view> {
+        if (peek().kind != Token::Kind::IDENTIFIER) {
+            return fail(std::format("Expected a name, found '{}'", peek().text));
+        }
+        if (std::ranges::contains(KEYWORDS, peek().text)) {
+            return fail(std::format("'{}' is a keyword", peek().text));
+        }
+        return next().text;
+    }
+
+    auto lookup(std::string_view name) const -> std::optional<Name> {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); scope++) {
+            if (const auto found = scope->find(name); found != scope->end()) {
+                return found->second;
+            }
+        }
+        return std::nullopt;
+    }
+
+    auto declare(std::string_view name, Name value) -> bool {
+        if (!scopes.back().emplace(name, value).second) {
+            fail(std::format("'{}' is already declared", name));
+            return false;
+        }
+        return true;
+    }
+
+    auto parse_constant_expression(std::string_view what) -> std::optional<std::int32_t> {
+        PARSE_OR_RETURN(expr, parse_expression());
+        if (const auto *number = std::get_if<Number>(&(*expr)->node)) {
+            return number->value;
+        }
+        error = sim::Error(std::format("The {} has to be known at compile time", what), (*expr)->column, (*expr)->line);
+        return std::nullopt;
+    }
+
+    // const int NAME = value;
+    void parse_constant() {
+        if (!expect("int")) {
+            return;
+        }
+        const auto name = expect_name();
+        if (!name || !expect("=")) {
+            return;
+        }
+        const auto value = parse_constant_expression("value of a constant");
+        if (value && expect(";")) {
+            declare(*name, Constant{*value});
+        }
+    }
+
+    // int NAME[size] @ address;
+    void parse_array() {
+        const auto name = expect_name();
+        if (!name || !expect("[")) {
+            return;
+        }
+        if (!is("]") && !parse_constant_expression("size of an array")) {
+            return;
+        }
+        if (!expect("]") || !expect("@")) {
+            return;
+        }
+        const auto address = parse_constant_expression("address of an array");
+        if (address && expect(";") && declare(*name, ArrayName{static_cast<std::uint32_t>(kernel.arrays.size())})) {
+            kernel.arrays.push_back(Array{*name, *address});
+        }
+    }
+
+    // kernel(blocks = 4, warps = 2) { ... }
+    void parse_kernel_body() {
+        if (accept("(") && !accept(")")) {
+            do {
+                const auto &token = peek();
+                const auto name = expect_name();
+                if (!name || !expect("=")) {
+                    return;
+                }
+                const auto value = parse_constant_expression("number of blocks or warps");
+                if (!value) {
+                    return;
+                }
+                if (*value <= 0) {
+                    error = sim::Error(std::format("'{}' has to be positive", *name), token.column, token.line);
+                    return;
+                }
+                if (*name == "blocks") {
+                    kernel.blocks = static_cast<std::uint32_t>(*value);
+                } else if (*name == "warps") {
+                    kernel.warps = static_cast<std::uint32_t>(*value);
+                } else {
+                    error = sim::Error(std::format("Unknown kernel parameter '{}', expected 'blocks' or 'warps'", *name),
+                                       token.column, token.line);
+                    return;
+                }
+            } while (accept(","));
+            if (!expect(")")) {
+                return;
+            }
+        }
+        if (!is("{")) {
+            fail(std::format("Expected '{{', found '{}'", peek().text));
+            return;
+        }
+        auto body = parse_block();
+        if (body) {
+            kernel.body = std::move(std::get<Block>((*body)->node));
+        }
+    }
+
+    auto make_stmt(decltype(Stmt::node) node, const Token &token) -> StmtPtr {
+        return std::make_unique<Stmt>(Stmt{std::move(node), token.line});
+    }
+
+    auto make_expr(decltype(Expr::node) node, const Token &token) -> ExprPtr {
+        return std::make_unique<Expr>(Expr{std::move(node), token.line, token.column});
+    }
+
+    auto parse_block() -> std::optional<StmtPtr> {
+        const auto &token = peek();
+        if (!expect("{")) {
+            return std::nullopt;
+        }
+        scopes.emplace_back();
+        auto block = Block{};
+        while (!is("}")) {
+            if (peek().kind == Token::Kind::END) {
+                return fail("Expected '}' at the end of the block");
+            }
+            PARSE_OR_RETURN(statement, parse_statement(block));
+            block.statements.push_back(std::move(*statement));
+        }
+        next();
+        scopes.pop_back();
+        return make_stmt(std::move(block), token);
+    }
+
+    // Declarations are recorded in the enclosing block, so they go out of scope with it
+    auto parse_statement(Block &block) -> std::optional<StmtPtr> {
+        const auto &token = peek();
+        if (is("{")) {
+            return parse_block();
+        }
+        if (accept("if")) {
+            if (!expect("(")) {
+                return std::nullopt;
+            }
+            PARSE_OR_RETURN(condition, parse_expression());
+            if (!expect(")")) {
+                return std::nullopt;
+            }
+            PARSE_OR_RETURN(then_branch, parse_scoped_statement());
+            auto else_branch = StmtPtr{};
+            if (accept("else")) {
+                PARSE_OR_RETURN(parsed, parse_scoped_statement());
+                else_branch = std::move(*parsed);
+            }
+            return make_stmt(If{std::move(*condition), std::move(*then_branch), std::move(else_branch)}, token);
+        }
+        if (accept("while")) {
+            if (!expect("(")) {
+                return std::nullopt;
+            }
+            PARSE_OR_RETURN(condition, parse_expression());
+            if (!expect(")")) {
+                return std::nullopt;
+            }
+            PARSE_OR_RETURN(body, parse_scoped_statement());
+            return make_stmt(Loop{std::move(*condition), std::move(*body), nullptr}, token);
+        }
+        if (accept("for")) {
+            return parse_for(token);
+        }
+        if (accept(";")) {
+            return make_stmt(Block{}, token);
+        }
+        PARSE_OR_RETURN(simple, parse_simple_statement(block));
+        if (!expect(";")) {
+            return std::nullopt;
+        }
+        return simple;
+    }
+
+    // The branches of if and loops get their own scope even without braces
+    auto parse_scoped_statement() -> std::optional<StmtPtr> {
+        const auto &token = peek();
+        scopes.emplace_back();
+        auto block = Block{};
+        PARSE_OR_RETURN(statement, parse_statement(block));
+        scopes.pop_back();
+        if (block.declared.empty()) {
+            return statement;
+        }
+        block.statements.push_back(std::move(*statement));
+        return make_stmt(std::move(block), token);
+    }
+
+    // for (init; condition; step) body, as a block holding the initialization and a loop
+    auto parse_for(const Token &token) -> std::optional<StmtPtr> {
+        if (!expect("(")) {
+            return std::nullopt;
+        }
+        scopes.emplace_back();
+        auto block = Block{};
+        if (!is(";")) {
+            PARSE_OR_RETURN(init, parse_simple_statement(block));
+            block.statements.push_back(std::move(*init));
+        }
+        if (!expect(";")) {
+            return std::nullopt;
+        }
+        auto condition = make_expr(Number{1}, peek());
+        if (!is(";")) {
+            PARSE_OR_RETURN(parsed, parse_expression());
+            condition = std::move(*parsed);
+        }
+        if (!expect(";")) {
+            return std::nullopt;
+        }
+        auto step = StmtPtr{};
+        if (!is(")")) {
+            auto unused = Block{};
+            PARSE_OR_RETURN(parsed, parse_simple_statement(unused));
+            if (!unused.declared.empty()) {
+                return fail("The step of a for loop cannot declare variables");
+            }
+            step = std::move(*parsed);
+        }
+        if (!expect(")")) {
+            return std::nullopt;
+        }
+        PARSE_OR_RETURN(body, parse_scoped_statement());
+        scopes.pop_back();
+        block.statements.push_back(make_stmt(Loop{std::move(condition), std::move(*body), std::move(step)}, token));
+        return make_stmt(std::move(block), token);
+    }
+
+    // Declarations, assignments and stores
+    auto parse_simple_statement(Block &block) -> std::optional<StmtPtr> {
+        const auto &token = peek();
+        if (accept("int")) {
+            const auto name = expect_name();
+            if (!name) {
+                return std::nullopt;
+            }
+            auto value = ExprPtr{};
+            if (accept("=")) {
+                // Parsed before the name is declared, so it may refer to an outer variable of the same name
+                PARSE_OR_RETURN(parsed, parse_expression());
+                value = std::move(*parsed);
+            }
+            const auto id = static_cast<std::uint32_t>(kernel.variables.size());
+            if (!declare(*name, Local{id})) {
+                return std::nullopt;
+            }
+            kernel.variables.push_back(*name);
+            block.declared.push_back(id);
+            return make_stmt(Declaration{id, std::move(value)}, token);
+        }
+
+        const auto name = expect_name();
+        if (!name) {
+            return std::nullopt;
+        }
+        const auto target = lookup(*name);
+        if (!target) {
+            error = sim::Error(std::format("Undeclared name '{}'", *name), token.column, token.line);
+            return std::nullopt;
+        }
+
+        // The current value of the target, for compound assignments
+        auto current = ExprPtr{};
+        auto index = ExprPtr{};
+        if (const auto *array = std::get_if<ArrayName>(&*target)) {
+            if (!expect("[")) {
+                return std::nullopt;
+            }
+            PARSE_OR_RETURN(parsed, parse_expression());
+            index = std::move(*parsed);
+            if (!expect("]")) {
+                return std::nullopt;
+            }
+            current = make_expr(Load{array->id, clone(*index)}, token);
+        } else if (const auto *local = std::get_if<Local>(&*target)) {
+            current = make_expr(Variable{local->id}, token);
+        } else {
+            error = sim::Error(std::format("Cannot assign to '{}'", *name), token.column, token.line);
+            return std::nullopt;
+        }
+
+        auto value = ExprPtr{};
+        const auto &op = peek();
+        if (accept("=")) {
+            PARSE_OR_RETURN(parsed, parse_expression());
+            value = std::move(*parsed);
+        } else if (accept("+=") || accept("-=")) {
+            PARSE_OR_RETURN(parsed, parse_expression());
+            value = make_binary(op.text == "+=" ? BinaryOp::ADD : BinaryOp::SUB, std::move(current),
+                                std::move(*parsed), op);
+        } else if (accept("++") || accept("--")) {
+            value = make_binary(op.text == "++" ? BinaryOp::ADD : BinaryOp::SUB, std::move(current),
+                                make_expr(Number{1}, op), op);
+        } else {
+            return fail(std::format("Expected an assignment, found '{}'", op.text));
+        }
+
+        if (const auto *array = std::get_if<ArrayName>(&*target)) {
+            return make_stmt(Store{array->id, std::move(index), std::move(value)}, token);
+        }
+        return make_stmt(Assignment{std::get<Local>(*target).id, std::move(value)}, token);
+    }
+
+    // Constant operands are folded right away
+    auto make_binary(BinaryOp op, ExprPtr lhs, ExprPtr rhs, const Token &token) -> ExprPtr {
+        const auto *a = std::get_if<Number>(&lhs->node);
+        const auto *b = std::get_if<Number>(&rhs->node);
+        if (a != nullptr && b != nullptr) {
+            return make_expr(Number{fold(op, a->value, b->value)}, token);
+        }
+        return make_expr(Binary{op, std::move(lhs), std::move(rhs)}, token);
+    }
+
+    auto parse_expression(std::size_t level = 0) -> std::optional<ExprPtr> {
+        if (level == LEVELS.size()) {
+            return parse_product();
+        }
+        PARSE_OR_RETURN(lhs, parse_expression(level + 1));
+        auto result = std::move(*lhs);
+        while (true) {
+            const auto &token = peek();
+            const auto match = std::ranges::find_if(LEVELS[level].operators, [&](const auto &op) {
+                return token.kind == Token::Kind::SYMBOL && token.text == op.first;
+            });
+            if (match == LEVELS[level].operators.end()) {
+                return result;
+            }
+            next();
+            PARSE_OR_RETURN(rhs, parse_expression(level + 1));
+            result = make_binary(match->second, std::move(result), std::move(*rhs), token);
+        }
+    }
+
+    auto parse_product() -> std::optional<ExprPtr> {
+        PARSE_OR_RETURN(lhs, parse_unary());
+        auto result = std::move(*lhs);
+        while (is("*")) {
+            const auto &token = next();
+            PARSE_OR_RETURN(rhs, parse_unary());
+            result = make_binary(BinaryOp::MUL, std::move(result), std::move(*rhs), token);
+        }
+        return result;
+    }
+
+    auto parse_unary() -> std::optional<ExprPtr> {
+        const auto &token = peek();
+        auto op = std::optional<UnaryOp>{};
+        if (accept("-")) {
+            op = UnaryOp::NEG;
+        } else if (accept("~")) {
+            op = UnaryOp::NOT;
+        } else if (accept("!")) {
+            op = UnaryOp::LOGICAL_NOT;
+        }
+        if (!op) {
+            return parse_primary();
+        }
+        PARSE_OR_RETURN(operand, parse_unary());
+        if (const auto *number = std::get_if<Number>(&(*operand)->node)) {
+            const auto value = static_cast<std::uint32_t>(number->value);
+            const auto folded = *op == UnaryOp::NEG ? 0u - value : *op == UnaryOp::NOT ? ~value : value == 0;
+            return make_expr(Number{static_cast<std::int32_t>(folded)}, token);
+        }
+        return make_expr(Unary{*op, std::move(*operand)}, token);
+    }
+
+    auto parse_primary() -> std::optional<ExprPtr> {
+        const auto &token = peek();
+        if (token.kind == Token::Kind::NUMBER) {
+            next();
+            return make_expr(Number{token.value}, token);
+        }
+        if (accept("(")) {
+            PARSE_OR_RETURN(inner, parse_expression());
+            if (!expect(")")) {
+                return std::nullopt;
+            }
+            return inner;
+        }
+        if (token.kind != Token::Kind::IDENTIFIER) {
+            return fail(std::format("Expected an expression, found '{}'", token.text));
+        }
+        const auto name = expect_name();
+        if (!name) {
+            return std::nullopt;
+        }
+        const auto found = lookup(*name);
+        if (!found) {
+            error = sim::Error(std::format("Undeclared name '{}'", *name), token.column, token.line);
+            return std::nullopt;
+        }
+        return std::visit(as::overloaded{
+                              [&](Local local) -> std::optional<ExprPtr> {
+                                  return make_expr(Variable{local.id}, token);
+                              },
+                              [&](Constant constant) -> std::optional<ExprPtr> {
+                                  return make_expr(Number{constant.value}, token);
+                              },
+                              [&](Builtin builtin) -> std::optional<ExprPtr> {
+                                  return make_expr(BuiltinRef{builtin}, token);
+                              },
+                              [&](ArrayName array) -> std::optional<ExprPtr> {
+                                  if (!expect("[")) {
+                                      return std::nullopt;
+                                  }
+                                  PARSE_OR_RETURN(index, parse_expression());
+                                  if (!expect("]")) {
+                                      return std::nullopt;
+                                  }
+                                  return make_expr(Load{array.id, std::move(*index)}, token);
+                              },
+                          },
+                          *found);
+    }
+};
+
+} // namespace
+
+auto parse_kernel(std::string_view source) -> std::expected<Kernel, std::vector<sim::Error>> {
+    auto tokens = tokenize(source);
+    if (!tokens.has_value()) {
+        return std::unexpected(std::vector{std::move(tokens.error())});
+    }
+    auto kernel = Parser{std::move(*tokens)}.parse();
+    if (!kernel.has_value()) {
+        return std::unexpected(std::vector{std::move(kernel.error())});
+    }
+    return std::move(*kernel);
+}
+
+} // namespace cc
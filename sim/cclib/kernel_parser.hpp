@@ -0,0 +1,34 @@
+#pragma once
+
+#include <expected>
+#include <string_view>
+#include <vector>
+#include "ast.hpp"
+#include "error.hpp"
+
+namespace cc {
+
+// Parses a kernel written in the kernel language, a small C subset:
+//
+//   const int N = 64;               // Compile-time constants, folded into the code
+//   int input[] @ 0;                // Arrays of words at fixed data memory addresses, an optional size is ignored
+//   int output[N] @ 256;
+//
+//   kernel(blocks = 4, warps = 2) {  // Both default to 1
+//       int i = block_id * N + thread_id;
+//       if (input[i] < 10) {
+//           output[i] = input[i] << 1;
+//       } else {
+//           output[i] = 0;
+//       }
+//   }
+//
+// Values are 32-bit ints. Statements are declarations, assignments (=, +=, -=, ++, --), array stores, if/else, for,
+// while and blocks. Expressions have C precedence over + - * & | ^ << >> < > <= >= == != && || and unary - ~ !.
+// thread_id, block_id and block_size read x1-x3. Comparisons and >> are unsigned like the ALU, && and || do not
+// short-circuit, and * needs a constant on one side since the GPU has no multiplier.
+//
+// Names are resolved here: every local variable gets a distinct id and constants are replaced by their values.
+auto parse_kernel(std::string_view source) -> std::expected<Kernel, std::vector<sim::Error>>;
+
+} // namespace cc
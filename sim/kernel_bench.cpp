@@ -0,0 +1,134 @@
+// Benchmarks the kernel library (aslib/kernel_library.hpp) on the RTL
+//
+// Every routine runs on the same number of elements over a sweep of grid shapes, the results are checked against
+// the reference before the cycles of all its launches are reported, in total and per element. The estimate of the
+// timing model (simlib/timing_model.hpp) is reported next to them.
+
+#include <Vgpu.h>
+#include <Vgpu_gpu.h>
+#include <print>
+#include <array>
+#include <charconv>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "kernel_library.hpp"
+#include "sim.hpp"
+#include "timing_model.hpp"
+namespace fs = std::filesystem;
+
+constexpr auto INST_NUM_CHANNELS = Vgpu_gpu::INSTRUCTION_MEM_NUM_CHANNELS;
+constexpr auto DATA_NUM_CHANNELS = Vgpu_gpu::DATA_MEM_NUM_CHANNELS;
+constexpr auto MAX_CYCLES = 10'000'000u;
+constexpr auto DEFAULT_NUM_ELEMENTS = 1024u;
+constexpr auto BLOCK_COUNTS = std::array{1u, 2u, 4u, 8u};
+constexpr auto WARP_COUNTS = std::array{1u, 2u};
+constexpr auto GPU_SHAPE = sim::GpuShape{
+    .num_cores = Vgpu_gpu::NUM_CORES,
+    .data_mem_channels = DATA_NUM_CHANNELS,
+};
+
+struct BenchResult {
+    uint32_t cycles{};
+    uint64_t model_cycles{};
+    sim::data_memory_container_t memory;
+};
+
+auto run_rtl(const as::KernelJob& job, const sim::KernelObjectContents& image) -> std::optional<BenchResult> {
+    auto result = BenchResult{.memory = job.memory};
+    for (const auto& launch : job.launches) {
+        auto top = std::make_unique<Vgpu>();
+        auto data_mem = sim::make_data_memory<DATA_NUM_CHANNELS>(top.get());
+        auto instruction_mem = sim::make_instruction_memory<INST_NUM_CHANNELS>(top.get());
+        for (auto i = 0u; i < image.instructions.size(); i++) {
+            instruction_mem.memory[image.base_instructions_address + i] = image.instructions[i];
+        }
+        as::write_arguments(launch, result.memory);
+        const auto config = sim::ExecutorConfig{
+            .warps_per_core = Vgpu_gpu::WARPS_PER_CORE,
+            .threads_per_warp = Vgpu_gpu::THREADS_PER_WARP,
+            .base_instructions_address = image.base_instructions_address,
+            .num_blocks = launch.num_blocks,
+            .num_warps_per_block = launch.num_warps_per_block,
+        };
+        result.model_cycles +=
+            sim::model_cycles(sim::trace_kernel(config, image.instructions, result.memory), GPU_SHAPE);
+        data_mem.memory = std::move(result.memory);
+        sim::set_kernel_config(*top, image.base_instructions_address, 0, launch.num_blocks, launch.num_warps_per_block);
+        const auto cycles = sim::simulate_cycles(*top, instruction_mem, data_mem, MAX_CYCLES);
+        if (!cycles.has_value()) {
+            return std::nullopt;
+        }
+        result.cycles += *cycles;
+        result.memory = std::move(data_mem.memory);
+    }
+    return result;
+}
+
+auto main(int argc, char** argv) -> int {
+    auto kernels_dir = fs::path{KERNELS_DIR};
+    auto num_elements = DEFAULT_NUM_ELEMENTS;
+    auto routines = std::vector<std::string_view>{};
+    for (auto arg = 1; arg < argc; arg++) {
+        const auto current = std::string_view{argv[arg]};
+        if (current == "--kernels" && arg + 1 < argc) {
+            kernels_dir = argv[++arg];
+        } else if (current == "--elements" && arg + 1 < argc) {
+            const auto value = std::string_view{argv[++arg]};
+            const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), num_elements);
+            if (ec != std::errc{} || ptr != value.data() + value.size()) {
+                std::println(stderr, "Option '{}' expects a number", current);
+                return 1;
+            }
+        } else if (current.starts_with("--")) {
+            std::println(stderr, "Usage: {} [routine...] [--elements n] [--kernels directory]", argv[0]);
+            return 1;
+        } else {
+            routines.push_back(current);
+        }
+    }
+    if (routines.empty()) {
+        routines.assign(as::KERNEL_ROUTINES.begin(), as::KERNEL_ROUTINES.end());
+    }
+
+    std::println("{:<10} {:>6} {:>5} {:>8} {:>10} {:>12} {:>10}", "routine", "blocks", "warps", "launches", "cycles",
+                 "cycles/elem", "model");
+    for (const auto routine : routines) {
+        const auto image = as::link_kernel_routine(kernels_dir, routine);
+        if (!image.has_value()) {
+            for (const auto& error : image.error()) {
+                std::println(stderr, "{}", error);
+            }
+            return 1;
+        }
+
+        for (const auto num_blocks : BLOCK_COUNTS) {
+            for (const auto num_warps : WARP_COUNTS) {
+                const auto job = as::make_kernel_job(routine, num_elements, num_blocks, num_warps);
+                if (!job.has_value()) {
+                    std::println(stderr, "Error: {}.", job.error());
+                    return 1;
+                }
+                const auto result = run_rtl(*job, *image);
+                if (!result.has_value()) {
+                    std::println(stderr, "{} on {} blocks of {} warps didn't finish in {} cycles", routine, num_blocks,
+                                 num_warps, MAX_CYCLES);
+                    return 1;
+                }
+                const auto errors = as::check_kernel_job(*job, result->memory);
+                for (const auto& error : errors) {
+                    std::println(stderr, "{}", error);
+                }
+                if (!errors.empty()) {
+                    return 1;
+                }
+                std::println("{:<10} {:>6} {:>5} {:>8} {:>10} {:>12.2f} {:>10}", routine, num_blocks, num_warps,
+                             job->launches.size(), result->cycles, (double)result->cycles / num_elements,
+                             result->model_cycles);
+            }
+        }
+    }
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <Vgpu.h>
+#include <Vgpu_gpu.h>
 #include <print>
 #include <fstream>
 #include <expected>
@@ -6,44 +7,122 @@
 #include "data_reader.hpp"
 #include "emitter.hpp"
 #include "parser.hpp"
+#include "source_file.hpp"
+#include "assembly_cache.hpp"
+#include "kernel_object.hpp"
 #include "error.hpp"
 #include "sim.hpp"
+#include "sampling.hpp"
+#include "executor.hpp"
+#include "jit.hpp"
+#include "timing_model.hpp"
+#include <charconv>
+#include <filesystem>
 #include <vector>
 #include <string_view>
 
-auto main(int argc, char** argv) -> int {
-    if (argc < 2 || argc > 3) {
-        std::println("Usage: {} <input file> [data file]", argv[0]);
-        return 1;
+struct Options {
+    bool jit = false;                         // Run the kernel natively instead of simulating the RTL
+    bool model = false;                       // Estimate the cycle count with the timing model instead of simulating
+    std::optional<std::filesystem::path> model_parameters{}; // Timing model parameters written by calibrate
+    std::optional<uint64_t> fast_forward{};   // Instructions per warp executed functionally before the RTL takes over
+    std::optional<IData> until_pc{};          // Fast-forward every warp until it reaches this PC
+    std::optional<uint64_t> sample_period{};  // Periodic sampling instead of a single detailed run
+    uint32_t window_cycles = 500u;
+    uint32_t assembler_threads = 1u;          // Threads lexing, parsing and encoding the source
+    std::optional<std::filesystem::path> assembler_cache{}; // Directory of the assembly cache shared between runs
+};
+
+auto parse_number(std::string_view str) -> std::optional<uint64_t> {
+    auto base = 10;
+    if (str.starts_with("0x")) {
+        str.remove_prefix(2);
+        base = 16;
     }
+    auto value = uint64_t{};
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value, base);
+    if (ec != std::errc{} || ptr != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
 
-    const std::string_view input_filename = argv[1];
-    auto data = std::optional<sim::data_memory_container_t>{};
-    if (argc == 3) {
-        auto data_or_error = as::read_data(argv[2]);
+struct Kernel {
+    IData blocks = 1;
+    IData warps = 1;
+    IData base_instructions_address = 0;
+    IData base_data_address = 0;
+    std::vector<IData> program;
+};
 
-        if (!data_or_error) {
-            std::println(stderr, "Failed to read data file '{}': {}", argv[2], data_or_error.error());
-            return 1;
+// Kernel objects written by smol-as are loaded as they are, anything else is assembled
+auto load_kernel(const std::filesystem::path& path, const Options& options) -> std::optional<Kernel> {
+    if (sim::KernelObject::is_kernel_object(path)) {
+        const auto object = sim::KernelObject::load(path);
+        if (!object.has_value()) {
+            std::println(stderr, "Error: {}.", object.error());
+            return std::nullopt;
+        }
+        if (object->is_relocatable()) {
+            std::println(stderr, "Error: {} is a relocatable object, link it with smol-ld first.", path.string());
+            return std::nullopt;
         }
 
-        data = data_or_error.value();
+        const auto& header = object->header();
+        std::println("Loaded a kernel object with {} instructions and {} symbols", header.num_instructions,
+                     header.num_symbols);
+        std::println("Warps: {}, Blocks: {}", header.num_warps_per_block, header.num_blocks);
+        const auto instructions = object->instructions();
+        return Kernel{
+            .blocks = header.num_blocks,
+            .warps = header.num_warps_per_block,
+            .base_instructions_address = header.base_instructions_address,
+            .base_data_address = header.base_data_address,
+            .program = {instructions.begin(), instructions.end()},
+        };
+    }
+
+    // Has to stay alive as long as the program, the labels point into it
+    const auto source = as::SourceFile::open(path);
+    if (!source.has_value()) {
+        std::println(stderr, "Error: {}.", source.error());
+        return std::nullopt;
     }
+    // Repeated runs of the same source reuse the machine code assembled by the first one
+    if (options.assembler_cache.has_value()) {
+        auto cache = as::AssemblyCache{options.assembler_cache};
+        const auto assembled = cache.assemble(source->view(), options.assembler_threads);
+        if (!assembled.has_value()) {
+            for (const auto& error : assembled.error()) {
+                sim::print_error(error);
+            }
+            return std::nullopt;
+        }
 
-    auto input_file = sim::unwrap(as::open_file(input_filename));
-    const auto lines = as::get_lines(input_file);
-    input_file.close();
+        const auto& contents = **assembled;
+        std::println("{} {} instructions", cache.stats().misses != 0 ? "Assembled" : "Loaded from the assembly cache",
+                     contents.instructions.size());
+        std::println("Warps: {}, Blocks: {}", contents.num_warps_per_block, contents.num_blocks);
+        return Kernel{
+            .blocks = contents.num_blocks,
+            .warps = contents.num_warps_per_block,
+            .base_instructions_address = contents.base_instructions_address,
+            .base_data_address = contents.base_data_address,
+            .program = contents.instructions,
+        };
+    }
 
-    auto program_or_err = as::parse_program(lines);
+    auto arena = as::Arena{};
+    auto program_or_err = as::parse_program_parallel(source->view(), options.assembler_threads, &arena);
 
     if (!program_or_err.has_value()) {
         for (const auto& error : program_or_err.error()) {
             sim::print_error(error);
         }
-        return 1;
+        return std::nullopt;
     }
 
-    const auto& [blocks, warps, instructions, label_mappings] = program_or_err.value();
+    const auto& [blocks, warps, instructions, label_mappings, globals] = program_or_err.value();
 
     std::println("\nSuccesfully parsed the entire file.");
     std::println("Warps: {}, Blocks: {}", warps, blocks);
@@ -61,7 +140,177 @@ auto main(int argc, char** argv) -> int {
         i++;
     }
 
-    const auto machine_code = as::translate_to_binary(*program_or_err);
+    auto kernel = Kernel{.blocks = blocks, .warps = warps};
+    for (const auto& instruction : as::translate_to_binary(*program_or_err, options.assembler_threads)) {
+        kernel.program.push_back(instruction.bits);
+    }
+    return kernel;
+}
+
+auto main(int argc, char** argv) -> int {
+    auto positional = std::vector<std::string_view>{};
+    auto options = Options{};
+    for (auto arg = 1; arg < argc; arg++) {
+        const auto current = std::string_view{argv[arg]};
+        if (!current.starts_with("--")) {
+            positional.push_back(current);
+            continue;
+        }
+
+        if (current == "--jit") {
+            options.jit = true;
+            continue;
+        }
+
+        if (current == "--model") {
+            options.model = true;
+            continue;
+        }
+
+        if (current == "--model-params") {
+            if (arg + 1 >= argc) {
+                std::println(stderr, "Option '{}' expects a file", current);
+                return 1;
+            }
+            options.model = true;
+            options.model_parameters = argv[++arg];
+            continue;
+        }
+
+        if (current == "--as-cache") {
+            if (arg + 1 >= argc) {
+                std::println(stderr, "Option '{}' expects a directory", current);
+                return 1;
+            }
+            options.assembler_cache = argv[++arg];
+            continue;
+        }
+
+        const auto value = arg + 1 < argc ? parse_number(argv[arg + 1]) : std::nullopt;
+        if (!value.has_value()) {
+            std::println(stderr, "Option '{}' expects a number", current);
+            return 1;
+        }
+        arg++;
+
+        if (current == "--fast-forward") {
+            options.fast_forward = *value;
+        } else if (current == "--until-pc") {
+            options.until_pc = (IData)*value;
+        } else if (current == "--sample-period") {
+            options.sample_period = *value;
+        } else if (current == "--window") {
+            options.window_cycles = (uint32_t)*value;
+        } else if (current == "--as-threads") {
+            if (*value == 0) {
+                std::println(stderr, "Option '{}' expects at least 1 thread", current);
+                return 1;
+            }
+            options.assembler_threads = (uint32_t)*value;
+        } else {
+            std::println(stderr, "Unknown option '{}'", current);
+            return 1;
+        }
+    }
+
+    if (positional.empty() || positional.size() > 2) {
+        std::println("Usage: {} <input file> [data file] [options]", argv[0]);
+        std::println("Options:");
+        std::println("  --fast-forward <n>     Execute n instructions per warp functionally, then switch to the RTL");
+        std::println("  --until-pc <pc>        Execute functionally until every warp reaches pc, then switch to the RTL");
+        std::println("  --sample-period <n>    Estimate the cycle count by sampling the RTL every n instructions per warp");
+        std::println("  --window <cycles>      Cycles simulated in detail per sample (default 500)");
+        std::println("  --jit                  Compile the kernel to native code and run it without simulating the GPU");
+        std::println("  --as-threads <n>       Assemble large sources on n threads");
+        std::println("  --as-cache <dir>       Reuse machine code assembled by earlier runs from the same source");
+        std::println("  --model                Estimate the cycle count with the timing model (see calibrate)");
+        std::println("  --model-params <file>  Same as --model with the parameters calibrate wrote to file");
+        return 1;
+    }
+
+    const std::string_view input_filename = positional[0];
+    auto data = std::optional<sim::data_memory_container_t>{};
+    if (positional.size() == 2) {
+        auto data_or_error = as::read_data(positional[1]);
+
+        if (!data_or_error) {
+            std::println(stderr, "Failed to read data file '{}': {}", positional[1], data_or_error.error());
+            return 1;
+        }
+
+        data = data_or_error.value();
+    }
+
+    const auto kernel = load_kernel(input_filename, options);
+    if (!kernel.has_value()) {
+        return 1;
+    }
+    const auto& [blocks, warps, base_instructions_address, base_data_address, program] = *kernel;
+
+    const auto executor_config = sim::ExecutorConfig{
+        .warps_per_core = Vgpu_gpu::WARPS_PER_CORE,
+        .threads_per_warp = Vgpu_gpu::THREADS_PER_WARP,
+        .base_instructions_address = base_instructions_address,
+        .base_data_address = base_data_address,
+        .num_blocks = blocks,
+        .num_warps_per_block = warps,
+    };
+
+    if (options.jit) {
+        constexpr auto jit_memory_size = 1u << 16u;
+        const auto kernel = sim::jit_compile(executor_config, program);
+        if (!kernel) {
+            sim::print_error(kernel.error());
+            return 1;
+        }
+        auto memory = std::vector<IData>(jit_memory_size, 0u);
+        for (const auto& [address, value] : data.value_or(sim::data_memory_container_t{})) {
+            if (address < jit_memory_size) {
+                memory[address] = value;
+            }
+        }
+
+        const auto executed = kernel->run(memory);
+        if (!executed) {
+            sim::print_error(executed.error());
+            return 1;
+        }
+        std::println("Executed {} instructions", *executed);
+        for (auto address = 0u; address < 100u; address++) {
+            std::println("Memory[{}]: {}", address, memory[address]);
+        }
+        return 0;
+    }
+
+    if (options.model) {
+        auto parameters = sim::TimingParameters{};
+        if (options.model_parameters.has_value()) {
+            const auto read = sim::read_timing_parameters(*options.model_parameters);
+            if (!read.has_value()) {
+                std::println(stderr, "Error: {}.", read.error());
+                return 1;
+            }
+            parameters = *read;
+        }
+        const auto trace = sim::trace_kernel(executor_config, program, data.value_or(sim::data_memory_container_t{}));
+        const auto shape = sim::GpuShape{
+            .num_cores = Vgpu_gpu::NUM_CORES,
+            .data_mem_channels = Vgpu_gpu::DATA_MEM_NUM_CHANNELS,
+        };
+        std::println("Estimated cycles: {}", sim::model_cycles(trace, shape, parameters));
+        return 0;
+    }
+
+    if (options.sample_period.has_value()) {
+        const auto estimate = sim::estimate_cycles<Vgpu_gpu::DATA_MEM_NUM_CHANNELS>(
+            executor_config, program, data.value_or(sim::data_memory_container_t{}),
+            sim::SamplingConfig{.period = *options.sample_period, .window_cycles = options.window_cycles});
+        std::println("Samples: {}, sampled cycles: {}, sampled instructions: {}", estimate.num_samples,
+                     estimate.sampled_cycles, estimate.sampled_instructions);
+        std::println("Total instructions: {}, estimated cycles: {:.0f}", estimate.total_instructions, estimate.estimated_cycles);
+        return 0;
+    }
+
     Vgpu top{};
 
     constexpr auto num_channels = 8;
@@ -71,13 +320,27 @@ auto main(int argc, char** argv) -> int {
     }
     auto instruction_mem = sim::make_instruction_memory<num_channels>(&top);
 
-    for (auto i = 0u; i < machine_code.size(); i++) {
-        instruction_mem.memory[i] = machine_code[i].bits;
+    for (auto i = 0u; i < program.size(); i++) {
+        instruction_mem.memory[base_instructions_address + i] = program[i];
     }
 
-    sim::set_kernel_config(top, 0, 0, blocks, warps);
+    sim::set_kernel_config(top, base_instructions_address, base_data_address, blocks, warps);
 
-    auto done = sim::simulate(top, instruction_mem, data_mem, 200);
+    auto done = false;
+    if (options.fast_forward.has_value() || options.until_pc.has_value()) {
+        auto executor = sim::Executor{executor_config, program, data_mem.memory};
+        const auto skipped = executor.run(sim::StopCondition{
+            .max_instructions_per_warp = options.fast_forward,
+            .marker_pc = options.until_pc,
+        });
+        std::println("Fast-forwarded {} instructions", skipped);
+
+        const auto result = sim::simulate_sampled(top, instruction_mem, data_mem, executor, 200);
+        std::println("Detailed simulation: {} cycles ({} spent injecting state)", result.cycles, result.injection_cycles);
+        done = result.done;
+    } else {
+        done = sim::simulate(top, instruction_mem, data_mem, 200);
+    }
 
     if(!done) {
         std::println("Simulation didn't finish before the max operation limit!");
@@ -0,0 +1,178 @@
+#pragma once
+#include "mapped_file.hpp"
+#include "verilated.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace sim {
+
+// Data memory image format
+//
+// A binary alternative to the text data files (see aslib/data_reader.hpp) that loads without any parsing.
+// Every field is a 32-bit word in host byte order:
+//   DataImageHeader
+//   num_segments times:
+//     DataImageSegment
+//     length words, stored at base_address, base_address + 1, ...
+// The writer emits one segment per run of consecutive addresses, in ascending order.
+
+using data_memory_container_t = std::map<IData, IData>;
+
+constexpr auto DATA_IMAGE_MAGIC = std::array<char, 8>{'S', 'M', 'O', 'L', 'D', 'A', 'T', 'A'};
+constexpr auto DATA_IMAGE_VERSION = std::uint32_t{1};
+
+struct DataImageHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t num_segments;
+};
+
+struct DataImageSegment {
+    IData base_address;
+    std::uint32_t length;
+};
+
+static_assert(std::is_trivially_copyable_v<DataImageHeader> && sizeof(DataImageHeader) % sizeof(IData) == 0);
+static_assert(std::is_trivially_copyable_v<DataImageSegment> && sizeof(DataImageSegment) % sizeof(IData) == 0);
+
+// Writes count consecutive words starting at base_address, value_at(i) gives the i-th one. Every insertion is
+// hinted with the position after the previous one, so a range costs one search instead of one per word.
+template <typename ValueAt>
+void write_words(data_memory_container_t &memory, IData base_address, IData count, ValueAt &&value_at) {
+    auto hint = memory.lower_bound(base_address);
+    for (auto i = IData{0}; i < count; i++) {
+        hint = std::next(memory.insert_or_assign(hint, base_address + i, value_at(i)));
+    }
+}
+
+inline auto write_data_image(const std::filesystem::path &path, const data_memory_container_t &memory)
+    -> std::expected<void, std::string> {
+    auto segments = std::vector<DataImageSegment>{};
+    auto words = std::vector<IData>{};
+    words.reserve(memory.size());
+    for (const auto &[address, value] : memory) {
+        if (segments.empty() || segments.back().base_address + segments.back().length != address) {
+            segments.push_back({.base_address = address, .length = 0});
+        }
+        segments.back().length++;
+        words.push_back(value);
+    }
+
+    auto file = std::ofstream{path, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+        return std::unexpected{std::format("Failed to open file: {}", path.c_str())};
+    }
+    auto write = [&](const void *data, std::size_t size) { file.write(static_cast<const char *>(data), (std::streamsize)size); };
+
+    const auto header = DataImageHeader{
+        .magic = DATA_IMAGE_MAGIC, .version = DATA_IMAGE_VERSION, .num_segments = (std::uint32_t)segments.size()};
+    write(&header, sizeof(header));
+    auto next_word = words.data();
+    for (const auto &segment : segments) {
+        write(&segment, sizeof(segment));
+        write(next_word, segment.length * sizeof(IData));
+        next_word += segment.length;
+    }
+
+    if (!file.good()) {
+        return std::unexpected{std::format("Failed to write file: {}", path.c_str())};
+    }
+    return {};
+}
+
+// A data image mapped into memory, the words are copied straight out of the mapping
+class DataImage {
+  public:
+    struct Segment {
+        IData base_address;
+        std::span<const IData> words;
+    };
+
+    static auto load(const std::filesystem::path &path) -> std::expected<DataImage, std::string> {
+        auto file = MappedFile::open(path);
+        if (!file) {
+            return std::unexpected{std::move(file.error())};
+        }
+
+        const auto bytes = file->bytes();
+        auto header = DataImageHeader{};
+        if (bytes.size() < sizeof(header)) {
+            return std::unexpected{std::format("Not a data image: {}", path.c_str())};
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (header.magic != DATA_IMAGE_MAGIC) {
+            return std::unexpected{std::format("Not a data image: {}", path.c_str())};
+        }
+        if (header.version != DATA_IMAGE_VERSION) {
+            return std::unexpected{std::format("Unsupported data image version {}, expected {}: {}", header.version,
+                                               DATA_IMAGE_VERSION, path.c_str())};
+        }
+
+        // Walks the segment headers once, so the segments can be used without any checks later
+        auto image = DataImage{std::move(*file)};
+        auto offset = sizeof(header);
+        for (auto i = 0u; i < header.num_segments; i++) {
+            auto segment = DataImageSegment{};
+            if (bytes.size() - offset < sizeof(segment)) {
+                return std::unexpected{std::format("Truncated data image: {}", path.c_str())};
+            }
+            std::memcpy(&segment, bytes.data() + offset, sizeof(segment));
+            offset += sizeof(segment);
+
+            if ((bytes.size() - offset) / sizeof(IData) < segment.length) {
+                return std::unexpected{std::format("Truncated data image: {}", path.c_str())};
+            }
+            if (segment.length != 0 && segment.base_address > ~IData{0} - (segment.length - 1)) {
+                return std::unexpected{std::format("Malformed data image, segment {} wraps around: {}", i, path.c_str())};
+            }
+            // The mapping is page aligned and every field is a word, so the words can be used in place
+            image.image_segments.push_back(Segment{
+                .base_address = segment.base_address,
+                .words = {reinterpret_cast<const IData *>(bytes.data() + offset), segment.length},
+            });
+            image.num_words += segment.length;
+            offset += segment.length * sizeof(IData);
+        }
+        if (offset != bytes.size()) {
+            return std::unexpected{std::format("Malformed data image, trailing bytes: {}", path.c_str())};
+        }
+        return image;
+    }
+
+    // Only looks at the magic, for telling data images and text data files apart
+    static auto is_data_image(const std::filesystem::path &path) -> bool {
+        auto file = std::ifstream{path, std::ios::binary};
+        auto magic = std::array<char, DATA_IMAGE_MAGIC.size()>{};
+        return file.read(magic.data(), magic.size()) && magic == DATA_IMAGE_MAGIC;
+    }
+
+    [[nodiscard]] auto segments() const -> std::span<const Segment> { return image_segments; }
+    [[nodiscard]] auto size() const -> std::size_t { return num_words; }
+
+    // Copies every segment into memory, see write_words
+    void load_into(data_memory_container_t &memory) const {
+        for (const auto &[base_address, words] : image_segments) {
+            write_words(memory, base_address, (IData)words.size(), [&](IData i) { return words[i]; });
+        }
+    }
+
+  private:
+    explicit DataImage(MappedFile &&file) : file(std::move(file)) {}
+
+    MappedFile file;
+    std::vector<Segment> image_segments;
+    std::size_t num_words = 0;
+};
+
+} // namespace sim
@@ -0,0 +1,219 @@
+#pragma once
+#include "instructions.hpp"
+
+namespace sim {
+
+// C++ model of src/decoder.sv
+// The decoded fields and their defaults mirror the RTL so that software models (executor, timing model)
+// agree with the verilated GPU, including its quirks.
+
+// Mirrors alu_instruction_t in src/common/common.sv
+enum class AluInstruction : IData {
+    ADDI,
+    SLTI,
+    XORI,
+    ORI,
+    ANDI,
+    SLLI,
+    SRLI,
+    SRAI,
+    ADD,
+    SUB,
+    SLL,
+    SLT,
+    XOR,
+    SRL,
+    SRA,
+    OR,
+    AND,
+    BEQ,
+    BNE,
+    BLT,
+    BGE,
+    JAL,
+    JALR
+};
+
+// Mirrors reg_input_mux_t in src/common/common.sv
+enum class RegInputMux : IData {
+    ALU_OUT,
+    LSU_OUT,
+    IMMEDIATE,
+    PC_PLUS_1,
+    VECTOR_TO_SCALAR
+};
+
+struct DecodedInstruction {
+    bool reg_write_enable{};
+    bool mem_write_enable{};
+    bool mem_read_enable{};
+    bool branch{};
+    bool scalar_instruction{};
+    bool halt{};
+    RegInputMux reg_input_mux{RegInputMux::ALU_OUT};
+    AluInstruction alu_instruction{AluInstruction::ADDI};
+    IData immediate{};
+    IData rd{};
+    IData rs1{};
+    IData rs2{};
+};
+
+constexpr auto sign_extend(IData value, unsigned bits) -> IData {
+    const auto sign_bit = (IData)1 << (bits - 1u);
+    value &= (sign_bit << 1u) - 1u;
+    return (value ^ sign_bit) - sign_bit;
+}
+
+constexpr auto decode(IData instruction) -> DecodedInstruction {
+    const auto opcode = instruction & 0b1111111u;
+    const auto inst = instruction & 0b111111u;
+    const auto rd = (instruction >> 7u) & 0b11111u;
+    const auto funct3 = (instruction >> 12u) & 0b111u;
+    const auto rs1 = (instruction >> 15u) & 0b11111u;
+    const auto rs2 = (instruction >> 20u) & 0b11111u;
+    const auto funct7 = instruction >> 25u;
+    const auto imm_i = instruction >> 20u;
+    const auto imm_b = (((instruction >> 31u) & 1u) << 12u) | (((instruction >> 7u) & 1u) << 11u) |
+                       (((instruction >> 25u) & 0b111111u) << 5u) | (((instruction >> 8u) & 0b1111u) << 1u);
+    const auto imm_u = instruction & 0xFFFFF000u;
+    const auto imm_j = (((instruction >> 31u) & 1u) << 20u) | (((instruction >> 12u) & 0xFFu) << 12u) |
+                       (((instruction >> 20u) & 1u) << 11u) | (((instruction >> 21u) & 0x3FFu) << 1u);
+    const auto imm_s = ((instruction >> 25u) << 5u) | rd;
+
+    auto decoded = DecodedInstruction{};
+    decoded.scalar_instruction = is_scalar(opcode);
+
+    if (opcode == (IData)Opcode::HALT) {
+        decoded.halt = true;
+    } else if (opcode == (IData)Opcode::SX_SLT) {
+        decoded.scalar_instruction = false; // This is a vector-scalar instruction
+        decoded.rd = rd;
+        decoded.rs1 = rs1;
+        decoded.rs2 = rs2;
+        decoded.reg_write_enable = true;
+        decoded.reg_input_mux = RegInputMux::VECTOR_TO_SCALAR;
+        decoded.alu_instruction = AluInstruction::SLT;
+    } else if (opcode == (IData)Opcode::SX_SLTI) {
+        decoded.scalar_instruction = false; // This is a vector-scalar instruction
+        decoded.rd = rd;
+        decoded.rs1 = rs1;
+        decoded.immediate = sign_extend(imm_i, 12);
+        decoded.reg_write_enable = true;
+        decoded.reg_input_mux = RegInputMux::VECTOR_TO_SCALAR;
+        decoded.alu_instruction = AluInstruction::SLTI;
+    } else if (opcode == (IData)Opcode::BTYPE) {
+        decoded.rs1 = rs1;
+        decoded.rs2 = rs2;
+        decoded.immediate = sign_extend(imm_b >> 1u, BRANCH_OFFSET_BITS); // Bit 0 isn't encoded, see BRANCH_OFFSET_BITS
+        decoded.branch = true;
+        switch (funct3) {
+        case (IData)Funct3::BEQ: decoded.alu_instruction = AluInstruction::BEQ; break;
+        case (IData)Funct3::BNE: decoded.alu_instruction = AluInstruction::BNE; break;
+        case (IData)Funct3::BLT: decoded.alu_instruction = AluInstruction::BLT; break;
+        case (IData)Funct3::BGE: decoded.alu_instruction = AluInstruction::BGE; break;
+        default: break;
+        }
+    } else if (opcode == (IData)Opcode::JTYPE) {
+        decoded.rd = rd;
+        decoded.reg_write_enable = true;
+        decoded.reg_input_mux = RegInputMux::PC_PLUS_1;
+        decoded.scalar_instruction = true;
+        decoded.alu_instruction = AluInstruction::JAL;
+        decoded.immediate = sign_extend(imm_j >> 1u, JUMP_OFFSET_BITS);
+    } else if (opcode == (IData)Opcode::JALR) {
+        decoded.rd = rd;
+        decoded.rs1 = rs1;
+        decoded.reg_write_enable = true;
+        decoded.reg_input_mux = RegInputMux::PC_PLUS_1;
+        decoded.scalar_instruction = true;
+        decoded.alu_instruction = AluInstruction::JALR;
+        decoded.immediate = sign_extend(imm_i, 12);
+    } else if (inst == (IData)Opcode::RTYPE) {
+        decoded.rd = rd;
+        decoded.rs1 = rs1;
+        decoded.rs2 = rs2;
+        decoded.reg_write_enable = true;
+        switch (funct3) {
+        case 0b000: decoded.alu_instruction = funct7 == (IData)Funct7::SUB ? AluInstruction::SUB : AluInstruction::ADD; break;
+        case 0b001: decoded.alu_instruction = AluInstruction::SLL; break;
+        case 0b010: decoded.alu_instruction = AluInstruction::SLT; break;
+        case 0b100: decoded.alu_instruction = AluInstruction::XOR; break;
+        case 0b101: decoded.alu_instruction = funct7 == (IData)Funct7::SRA ? AluInstruction::SRA : AluInstruction::SRL; break;
+        case 0b110: decoded.alu_instruction = AluInstruction::OR; break;
+        case 0b111: decoded.alu_instruction = AluInstruction::AND; break;
+        default: break;
+        }
+    } else if (inst == (IData)Opcode::ITYPE) {
+        decoded.rd = rd;
+        decoded.rs1 = rs1;
+        decoded.reg_write_enable = true;
+        decoded.immediate = sign_extend(imm_i, 12);
+        switch (funct3) {
+        case 0b000: decoded.alu_instruction = AluInstruction::ADDI; break;
+        case 0b010: decoded.alu_instruction = AluInstruction::SLTI; break;
+        case 0b100: decoded.alu_instruction = AluInstruction::XORI; break;
+        case 0b110: decoded.alu_instruction = AluInstruction::ORI; break;
+        case 0b111: decoded.alu_instruction = AluInstruction::ANDI; break;
+        case 0b001: decoded.alu_instruction = AluInstruction::SLLI; break;
+        case 0b101: decoded.alu_instruction = funct7 == (IData)Funct7::SRAI ? AluInstruction::SRAI : AluInstruction::SRLI; break;
+        default: break;
+        }
+    } else if (inst == (IData)Opcode::LOAD) {
+        decoded.rd = rd;
+        decoded.rs1 = rs1;
+        decoded.reg_write_enable = true;
+        decoded.reg_input_mux = RegInputMux::LSU_OUT;
+        decoded.immediate = sign_extend(imm_i, 12);
+        decoded.mem_read_enable = true;
+    } else if (inst == (IData)Opcode::STYPE) {
+        decoded.rs1 = rs1;
+        decoded.rs2 = rs2;
+        decoded.immediate = sign_extend(imm_s, 12);
+        decoded.mem_write_enable = true;
+    } else if (inst == (IData)Opcode::LUI) {
+        decoded.rd = rd;
+        decoded.immediate = imm_u;
+        decoded.reg_write_enable = true;
+        decoded.reg_input_mux = RegInputMux::IMMEDIATE;
+    } else if (inst == (IData)Opcode::AUIPC) {
+        // The RTL decodes AUIPC as an ADD of the (default) x0 sources, we keep that behaviour
+        decoded.rd = rd;
+        decoded.immediate = imm_u;
+        decoded.reg_write_enable = true;
+        decoded.alu_instruction = AluInstruction::ADD;
+    }
+
+    return decoded;
+}
+
+// Mirrors src/alu.sv, data_t is unsigned so comparisons and `>>>` are unsigned as well
+constexpr auto alu(AluInstruction instruction, IData pc, IData rs1, IData rs2, IData imm) -> IData {
+    switch (instruction) {
+    case AluInstruction::ADDI: return rs1 + imm;
+    case AluInstruction::SLTI: return rs1 < imm ? 1u : 0u;
+    case AluInstruction::XORI: return rs1 ^ imm;
+    case AluInstruction::ORI: return rs1 | imm;
+    case AluInstruction::ANDI: return rs1 & imm;
+    case AluInstruction::SLLI: return imm >= 32u ? 0u : rs1 << imm;
+    case AluInstruction::SRLI: return imm >= 32u ? 0u : rs1 >> imm;
+    case AluInstruction::SRAI: return imm >= 32u ? 0u : rs1 >> imm;
+    case AluInstruction::ADD: return rs1 + rs2;
+    case AluInstruction::SUB: return rs1 - rs2;
+    case AluInstruction::SLL: return rs2 >= 32u ? 0u : rs1 << rs2;
+    case AluInstruction::SLT: return rs1 < rs2 ? 1u : 0u;
+    case AluInstruction::XOR: return rs1 ^ rs2;
+    case AluInstruction::SRL: return rs2 >= 32u ? 0u : rs1 >> rs2;
+    case AluInstruction::SRA: return rs2 >= 32u ? 0u : rs1 >> rs2;
+    case AluInstruction::OR: return rs1 | rs2;
+    case AluInstruction::AND: return rs1 & rs2;
+    case AluInstruction::BEQ: return rs1 == rs2 ? 1u : 0u;
+    case AluInstruction::BNE: return rs1 != rs2 ? 1u : 0u;
+    case AluInstruction::BLT: return rs1 < rs2 ? 1u : 0u;
+    case AluInstruction::BGE: return rs1 >= rs2 ? 1u : 0u;
+    case AluInstruction::JAL: return pc + imm;
+    case AluInstruction::JALR: return rs1 + imm;
+    }
+    return 0u;
+}
+
+} // namespace sim
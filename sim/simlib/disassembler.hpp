@@ -0,0 +1,480 @@
+#pragma once
+#include "decoder.hpp"
+#include "instructions.hpp"
+#include "kernel_object.hpp"
+#include "verilated.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sim {
+
+// Disassembler
+//
+// Turns machine code back into the assembly smol-as takes. It decodes like src/decoder.sv (see decoder.hpp), so the
+// text says what the GPU executes: a scalar store is a branch since they share the opcode, funct7 only picks sub, sra
+// and srai when it is exactly 0100000, and encodings the decoder gives no meaning to come out as a .word.
+//
+// Immediates are printed as their encoding, which is how the assembler takes them (-1 is 4095). Branch and jump
+// targets are printed as the label at the target when the symbol table has one and as the offset otherwise.
+//
+// The mnemonic and operand layout of every encoding come from a single lookup into a table indexed by the opcode,
+// funct3 and the funct7 bit, and the text is appended to a caller provided std::string, so disassembling into a
+// reused buffer doesn't allocate. That keeps annotating instruction traces cheaper than reading them.
+
+// Labels by instruction address
+class SymbolTable {
+  public:
+    SymbolTable() = default;
+
+    // Names and the instruction they point to, counted from `base_address`
+    explicit SymbolTable(std::span<const std::pair<std::string, IData>> symbols, IData base_address = 0) {
+        for (const auto &[name, instruction] : symbols) {
+            entries.push_back({.address = base_address + instruction, .offset = (std::uint32_t)names.size(),
+                               .size = (std::uint32_t)name.size()});
+            names += name;
+        }
+        index();
+    }
+
+    // The symbols a kernel object defines, at its base instruction address
+    explicit SymbolTable(const KernelObject &object) {
+        const auto base_address = object.header().base_instructions_address;
+        for (const auto &symbol : object.symbols()) {
+            if (symbol.binding == SymbolBinding::UNDEFINED) {
+                continue;
+            }
+            const auto name = object.symbol_name(symbol);
+            entries.push_back({.address = base_address + symbol.instruction, .offset = (std::uint32_t)names.size(),
+                               .size = (std::uint32_t)name.size()});
+            names += name;
+        }
+        index();
+    }
+
+    // The first symbol at `address`, empty when there is none
+    [[nodiscard]] auto find(IData address) const -> std::string_view {
+        const auto first = first_at(address);
+        return first == NONE ? std::string_view{} : name(entries[first]);
+    }
+
+    // Calls `visit` with every symbol at `address`
+    template <typename Visit> void for_each_at(IData address, Visit &&visit) const {
+        for (auto i = first_at(address); i < entries.size() && entries[i].address == address; i++) {
+            visit(name(entries[i]));
+        }
+    }
+
+    [[nodiscard]] auto empty() const -> bool { return entries.empty(); }
+
+  private:
+    static constexpr auto NONE = std::numeric_limits<std::uint32_t>::max();
+
+    struct Entry {
+        IData address;
+        std::uint32_t offset; // Into names
+        std::uint32_t size;
+    };
+
+    // Sorts the entries and builds the address lookup, which is dense over the addresses the symbols span since
+    // they all point into one kernel
+    void index() {
+        std::ranges::stable_sort(entries, {}, &Entry::address);
+        if (entries.empty()) {
+            return;
+        }
+        lowest = entries.front().address;
+        first.assign(entries.back().address - lowest + 1, NONE);
+        for (auto i = (std::uint32_t)entries.size(); i-- > 0;) {
+            first[entries[i].address - lowest] = i;
+        }
+    }
+
+    [[nodiscard]] auto first_at(IData address) const -> std::uint32_t {
+        // Addresses below the lowest one wrap around and fail the bounds check
+        const auto slot = address - lowest;
+        return slot < first.size() ? first[slot] : NONE;
+    }
+
+    [[nodiscard]] auto name(const Entry &entry) const -> std::string_view {
+        return std::string_view{names}.substr(entry.offset, entry.size);
+    }
+
+    std::vector<Entry> entries;
+    std::string names;
+    IData lowest = 0;
+    std::vector<std::uint32_t> first; // Index of the first entry at every address from `lowest`, or NONE
+};
+
+namespace disassembler {
+
+// Operand layout
+enum class Format : std::uint8_t {
+    INVALID, // .word
+    UTYPE,   // rd, imm20
+    ITYPE,   // rd, rs1, imm12
+    SHIFT,   // rd, rs1, shift amount
+    RTYPE,   // rd, rs1, rs2
+    LOAD,    // rd, imm12(rs1)
+    STORE,   // rs2, imm12(rs1)
+    BTYPE,   // rs1, rs2, target
+    JTYPE,   // rd, target
+    JALR,    // rd, imm12(rs1) or rd, label
+    HALT,    // Nothing
+    SX_RTYPE, // Scalar rd, vector rs1 and rs2
+    SX_ITYPE, // Scalar rd, vector rs1, imm12
+};
+
+struct Entry {
+    std::array<char, 8> text{}; // Mnemonic with the s. prefix, the longest is "s.auipc"
+    std::uint8_t size{};
+    Format format{Format::INVALID};
+    bool scalar{}; // Whether the registers are scalar ones, the sx. formats fix their own
+};
+
+constexpr auto mnemonic_entry(bool scalar, std::string_view mnemonic, Format format) -> Entry {
+    auto entry = Entry{.text = {}, .size = 0, .format = format, .scalar = scalar};
+    const auto prefix = scalar && format != Format::BTYPE && format != Format::JTYPE && format != Format::JALR
+                            ? std::string_view{"s."}
+                            : std::string_view{};
+    for (const auto c : prefix) {
+        entry.text[entry.size++] = c;
+    }
+    for (const auto c : mnemonic) {
+        entry.text[entry.size++] = c;
+    }
+    return entry;
+}
+
+// Indexed by opcode << 4 | funct3 << 1 | (funct7 == 0100000)
+constexpr auto TABLE_SIZE = std::size_t{1} << 11u;
+
+constexpr auto table_index(IData instruction) -> std::size_t {
+    const auto opcode = instruction & 0b1111111u;
+    const auto funct3 = (instruction >> 12u) & 0b111u;
+    const auto alternate = (instruction >> 25u) == 0b0100000u ? 1u : 0u;
+    return (opcode << 4u) | (funct3 << 1u) | alternate;
+}
+
+// Checked in the order of decode(), the full 7-bit opcodes first
+constexpr auto make_entry(IData opcode, IData funct3, bool alternate) -> Entry {
+    const auto scalar = is_scalar(opcode);
+    const auto inst = opcode & 0b111111u;
+
+    if (opcode == (IData)Opcode::HALT) {
+        return mnemonic_entry(false, "halt", Format::HALT);
+    }
+    if (opcode == (IData)Opcode::SX_SLT) {
+        return mnemonic_entry(false, "sx.slt", Format::SX_RTYPE);
+    }
+    if (opcode == (IData)Opcode::SX_SLTI) {
+        return mnemonic_entry(false, "sx.slti", Format::SX_ITYPE);
+    }
+    if (opcode == (IData)Opcode::BTYPE) {
+        switch (funct3) {
+        case (IData)Funct3::BEQ: return mnemonic_entry(true, "beq", Format::BTYPE);
+        case (IData)Funct3::BNE: return mnemonic_entry(true, "bne", Format::BTYPE);
+        case (IData)Funct3::BLT: return mnemonic_entry(true, "blt", Format::BTYPE);
+        case (IData)Funct3::BGE: return mnemonic_entry(true, "bge", Format::BTYPE);
+        default: return {};
+        }
+    }
+    if (opcode == (IData)Opcode::JTYPE) {
+        return mnemonic_entry(true, "jal", Format::JTYPE);
+    }
+    if (opcode == (IData)Opcode::JALR) {
+        return mnemonic_entry(true, "jalr", Format::JALR);
+    }
+    if (inst == (IData)Opcode::RTYPE) {
+        switch (funct3) {
+        case 0b000: return mnemonic_entry(scalar, alternate ? "sub" : "add", Format::RTYPE);
+        case 0b001: return mnemonic_entry(scalar, "sll", Format::RTYPE);
+        case 0b010: return mnemonic_entry(scalar, "slt", Format::RTYPE);
+        case 0b100: return mnemonic_entry(scalar, "xor", Format::RTYPE);
+        case 0b101: return mnemonic_entry(scalar, alternate ? "sra" : "srl", Format::RTYPE);
+        case 0b110: return mnemonic_entry(scalar, "or", Format::RTYPE);
+        case 0b111: return mnemonic_entry(scalar, "and", Format::RTYPE);
+        default: return {};
+        }
+    }
+    if (inst == (IData)Opcode::ITYPE) {
+        switch (funct3) {
+        case 0b000: return mnemonic_entry(scalar, "addi", Format::ITYPE);
+        case 0b010: return mnemonic_entry(scalar, "slti", Format::ITYPE);
+        case 0b100: return mnemonic_entry(scalar, "xori", Format::ITYPE);
+        case 0b110: return mnemonic_entry(scalar, "ori", Format::ITYPE);
+        case 0b111: return mnemonic_entry(scalar, "andi", Format::ITYPE);
+        case 0b001: return mnemonic_entry(scalar, "slli", Format::ITYPE);
+        case 0b101: return alternate ? mnemonic_entry(scalar, "srai", Format::SHIFT) : mnemonic_entry(scalar, "srli", Format::ITYPE);
+        default: return {};
+        }
+    }
+    if (inst == (IData)Opcode::LOAD) {
+        switch (funct3) {
+        case (IData)Funct3::LB: return mnemonic_entry(scalar, "lb", Format::LOAD);
+        case (IData)Funct3::LH: return mnemonic_entry(scalar, "lh", Format::LOAD);
+        case (IData)Funct3::LW: return mnemonic_entry(scalar, "lw", Format::LOAD);
+        default: return {};
+        }
+    }
+    if (inst == (IData)Opcode::STYPE) {
+        switch (funct3) {
+        case (IData)Funct3::SB: return mnemonic_entry(scalar, "sb", Format::STORE);
+        case (IData)Funct3::SH: return mnemonic_entry(scalar, "sh", Format::STORE);
+        case (IData)Funct3::SW: return mnemonic_entry(scalar, "sw", Format::STORE);
+        default: return {};
+        }
+    }
+    if (inst == (IData)Opcode::LUI) {
+        return mnemonic_entry(scalar, "lui", Format::UTYPE);
+    }
+    if (inst == (IData)Opcode::AUIPC) {
+        return mnemonic_entry(scalar, "auipc", Format::UTYPE);
+    }
+    return {};
+}
+
+constexpr auto make_table() -> std::array<Entry, TABLE_SIZE> {
+    auto table = std::array<Entry, TABLE_SIZE>{};
+    for (auto i = IData{0}; i < TABLE_SIZE; i++) {
+        table[i] = make_entry(i >> 4u, (i >> 1u) & 0b111u, (i & 1u) != 0u);
+    }
+    return table;
+}
+
+constexpr auto table = make_table();
+
+static_assert(table[table_index(0b0110011)].format == Format::RTYPE && !table[table_index(0b0110011)].scalar);
+static_assert(table[table_index(0b0100011 | (IData)1 << 6u)].format == Format::BTYPE); // s.sw is beq
+static_assert(table[table_index(0b1111111)].format == Format::HALT);
+
+constexpr auto register_names = std::array<std::string_view, 64>{
+    "x0",  "x1",  "x2",  "x3",  "x4",  "x5",  "x6",  "x7",  "x8",  "x9",  "x10", "x11", "x12", "x13", "x14", "x15",
+    "x16", "x17", "x18", "x19", "x20", "x21", "x22", "x23", "x24", "x25", "x26", "x27", "x28", "x29", "x30", "x31",
+    "s0",  "s1",  "s2",  "s3",  "s4",  "s5",  "s6",  "s7",  "s8",  "s9",  "s10", "s11", "s12", "s13", "s14", "s15",
+    "s16", "s17", "s18", "s19", "s20", "s21", "s22", "s23", "s24", "s25", "s26", "s27", "s28", "s29", "s30", "s31",
+};
+
+// Everything but a label fits, so a line is built here and appended to the output at once
+class Line {
+  public:
+    void put(char c) { data[size++] = c; }
+
+    void put(std::string_view str) {
+        std::ranges::copy(str, data.begin() + size);
+        size += str.size();
+    }
+
+    void put_register(IData number, bool scalar) { put(register_names[(scalar ? 32u : 0u) + (number & 0b11111u)]); }
+
+    template <typename T> void put_number(T value) {
+        size = (std::size_t)(std::to_chars(data.data() + size, data.data() + data.size(), value).ptr - data.data());
+    }
+
+    void put_hex(IData value) {
+        constexpr auto digits = std::string_view{"0123456789abcdef"};
+        for (auto i = 8u; i-- > 0; value >>= 4u) {
+            data[size + i] = digits[value & 0xFu];
+        }
+        size += 8;
+    }
+
+    // A label when there is one at the target, the offset from the instruction otherwise
+    void put_target(std::string &out, IData address, std::int32_t offset, const SymbolTable &symbols) {
+        const auto label = symbols.find(address + (IData)offset);
+        if (label.empty()) {
+            put_number(offset);
+            return;
+        }
+        flush(out);
+        out += label;
+    }
+
+    void flush(std::string &out) {
+        out.append(data.data(), size);
+        size = 0;
+    }
+
+  private:
+    std::array<char, 64> data;
+    std::size_t size = 0;
+};
+
+} // namespace disassembler
+
+// Appends the disassembly of `instruction` at `address` to `out`, without a newline
+inline void append_disassembly(std::string &out, IData instruction, IData address, const SymbolTable &symbols = {}) {
+    using namespace disassembler;
+    const auto &entry = table[table_index(instruction)];
+    const auto rd = (instruction >> 7u) & 0b11111u;
+    const auto rs1 = (instruction >> 15u) & 0b11111u;
+    const auto rs2 = (instruction >> 20u) & 0b11111u;
+    const auto imm_i = instruction >> 20u;
+    const auto scalar = entry.scalar;
+
+    auto line = Line{};
+    if (entry.format == Format::INVALID) {
+        line.put(".word 0x");
+        line.put_hex(instruction);
+        line.flush(out);
+        return;
+    }
+
+    line.put(std::string_view{entry.text.data(), entry.size});
+    if (entry.format != Format::HALT) {
+        line.put(' ');
+    }
+
+    switch (entry.format) {
+    case Format::UTYPE:
+        line.put_register(rd, scalar);
+        line.put(", ");
+        line.put_number(instruction >> 12u);
+        break;
+    case Format::ITYPE:
+    case Format::SHIFT:
+        line.put_register(rd, scalar);
+        line.put(", ");
+        line.put_register(rs1, scalar);
+        line.put(", ");
+        line.put_number(entry.format == Format::SHIFT ? imm_i & 0b11111u : imm_i);
+        break;
+    case Format::RTYPE:
+        line.put_register(rd, scalar);
+        line.put(", ");
+        line.put_register(rs1, scalar);
+        line.put(", ");
+        line.put_register(rs2, scalar);
+        break;
+    case Format::LOAD:
+        line.put_register(rd, scalar);
+        line.put(", ");
+        line.put_number(imm_i);
+        line.put('(');
+        line.put_register(rs1, scalar);
+        line.put(')');
+        break;
+    case Format::STORE:
+        // The immediate is split around rd, like decode() reads it
+        line.put_register(rs2, scalar);
+        line.put(", ");
+        line.put_number(((instruction >> 25u) << 5u) | rd);
+        line.put('(');
+        line.put_register(rs1, scalar);
+        line.put(')');
+        break;
+    case Format::BTYPE: {
+        const auto imm_b = (((instruction >> 31u) & 1u) << 12u) | (((instruction >> 7u) & 1u) << 11u) |
+                           (((instruction >> 25u) & 0b111111u) << 5u) | (((instruction >> 8u) & 0b1111u) << 1u);
+        line.put_register(rs1, true);
+        line.put(", ");
+        line.put_register(rs2, true);
+        line.put(", ");
+        line.put_target(out, address, (std::int32_t)sign_extend(imm_b >> 1u, BRANCH_OFFSET_BITS), symbols);
+        break;
+    }
+    case Format::JTYPE: {
+        const auto imm_j = (((instruction >> 31u) & 1u) << 20u) | (((instruction >> 12u) & 0xFFu) << 12u) |
+                           (((instruction >> 20u) & 1u) << 11u) | (((instruction >> 21u) & 0x3FFu) << 1u);
+        line.put_register(rd, true);
+        line.put(", ");
+        line.put_target(out, address, (std::int32_t)sign_extend(imm_j >> 1u, JUMP_OFFSET_BITS), symbols);
+        break;
+    }
+    case Format::JALR: {
+        line.put_register(rd, true);
+        line.put(", ");
+        // The assembler turns `jalr rd, label` into an absolute jump off s0
+        const auto label = rs1 == 0u ? symbols.find(imm_i) : std::string_view{};
+        if (!label.empty()) {
+            line.flush(out);
+            out += label;
+            break;
+        }
+        line.put_number(imm_i);
+        line.put('(');
+        line.put_register(rs1, true);
+        line.put(')');
+        break;
+    }
+    case Format::SX_RTYPE:
+        line.put_register(rd, true);
+        line.put(", ");
+        line.put_register(rs1, false);
+        line.put(", ");
+        line.put_register(rs2, false);
+        break;
+    case Format::SX_ITYPE:
+        line.put_register(rd, true);
+        line.put(", ");
+        line.put_register(rs1, false);
+        line.put(", ");
+        line.put_number(imm_i);
+        break;
+    case Format::INVALID:
+    case Format::HALT:
+        break;
+    }
+    line.flush(out);
+}
+
+inline auto disassemble(IData instruction, IData address = 0, const SymbolTable &symbols = {}) -> std::string {
+    auto text = std::string{};
+    append_disassembly(text, instruction, address, symbols);
+    return text;
+}
+
+// Listing of a stream of instructions that can be fed in chunks of any size
+//
+// Every symbol gets a label line before its instruction and every instruction an indented line, so the listing of a
+// whole kernel assembles back into it. With `annotate` every instruction is followed by a comment with its address
+// and encoding.
+class Disassembler {
+  public:
+    // `symbols` has to outlive the disassembler
+    explicit Disassembler(const SymbolTable &symbols, IData address = 0, bool annotate = false)
+        : symbols(&symbols), next_address(address), annotate(annotate) {}
+
+    // Appends the listing of `instructions`, which follow the ones fed before, to `out`
+    void feed(std::span<const IData> instructions, std::string &out) {
+        constexpr auto ANNOTATION_COLUMN = std::size_t{36};
+        for (const auto instruction : instructions) {
+            symbols->for_each_at(next_address, [&](std::string_view label) {
+                out += label;
+                out += ":\n";
+            });
+
+            const auto line_start = out.size();
+            out += "    ";
+            append_disassembly(out, instruction, next_address, *symbols);
+            if (annotate) {
+                out.append(std::max<std::size_t>(ANNOTATION_COLUMN - (out.size() - line_start), 1), ' ');
+                auto annotation = disassembler::Line{};
+                annotation.put("# ");
+                annotation.put_number(next_address);
+                annotation.put(": ");
+                annotation.put_hex(instruction);
+                annotation.flush(out);
+            }
+            out += '\n';
+            next_address++;
+        }
+    }
+
+    // Address of the next instruction to be fed
+    [[nodiscard]] auto address() const -> IData { return next_address; }
+
+  private:
+    const SymbolTable *symbols;
+    IData next_address;
+    bool annotate;
+};
+
+} // namespace sim
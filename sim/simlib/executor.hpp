@@ -0,0 +1,255 @@
+#pragma once
+#include "decoder.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace sim {
+
+using data_memory_container_t = std::map<IData, IData>;
+
+// Architectural (functional) simulator of the GPU
+//
+// It executes the same machine code as the verilated model but without any notion of time:
+// every warp of every block runs to completion (or to a stop condition) one after another.
+// The architectural state it produces (PCs, vector and scalar registers, masks and memory) is exactly
+// what the RTL would hold at the same point, which is what the sampled simulation injects into the GPU.
+//
+// Known differences from the RTL:
+// - sx.slt/sx.slti write 0 for masked out threads, the RTL writes the stale ALU output of that thread
+// - warps don't interleave, so kernels that communicate between warps through memory may differ
+
+struct ExecutorConfig {
+    std::uint32_t warps_per_core = 2;   // Every block runs WARPS_PER_CORE warps (see compute_core.sv)
+    std::uint32_t threads_per_warp = 32;
+    IData base_instructions_address = 0;
+    IData base_data_address = 0;       // Not used by the executor, passed on to the RTL kernel configuration
+    IData num_blocks = 1;
+    IData num_warps_per_block = 1;      // Only used for the block size register (x3)
+};
+
+struct WarpState {
+    static constexpr IData NUM_REGISTERS = 32;
+    static constexpr IData EXECUTION_MASK_REG = 1;
+    static constexpr IData FIRST_WRITABLE_VECTOR_REG = 4;
+
+    using RegisterSet = std::array<IData, NUM_REGISTERS>;
+
+    IData pc{};
+    bool done{};
+    std::uint64_t instructions_executed{};
+    RegisterSet scalar_registers{};
+    std::vector<RegisterSet> vector_registers; // One set per thread
+
+    [[nodiscard]] auto execution_mask() const -> IData { return scalar_registers[EXECUTION_MASK_REG]; }
+};
+
+struct BlockState {
+    IData block_id{};
+    std::vector<WarpState> warps;
+};
+
+// When to stop fast-forwarding a warp
+// The warp stops before executing the instruction that would break the condition
+struct StopCondition {
+    std::optional<std::uint64_t> max_instructions_per_warp{}; // Stop after this many instructions
+    std::optional<IData> marker_pc{};                         // Stop when the warp reaches this PC
+};
+
+class Executor {
+  public:
+    Executor(const ExecutorConfig &config, std::span<const IData> program, data_memory_container_t memory = {})
+        : config(config), program(program.begin(), program.end()), memory(std::move(memory)) {
+        blocks.reserve(config.num_blocks);
+        for (auto block_id = 0u; block_id < config.num_blocks; block_id++) {
+            blocks.push_back(make_block(block_id));
+        }
+    }
+
+    // Runs every warp of every block until it halts or hits the stop condition
+    // Returns the number of instructions executed
+    auto run(const StopCondition &stop = {}) -> std::uint64_t {
+        return run(stop, [](IData, IData, const WarpState &, const DecodedInstruction &) {});
+    }
+
+    // Same as above, `observer(block_id, warp_id, warp, decoded)` is called before every instruction is executed
+    template <typename Observer>
+    auto run(const StopCondition &stop, Observer &&observer) -> std::uint64_t {
+        auto executed = std::uint64_t{};
+        for (auto &block : blocks) {
+            for (auto warp_id = 0u; warp_id < block.warps.size(); warp_id++) {
+                executed += run_warp(block.block_id, warp_id, block.warps[warp_id], stop, observer);
+            }
+        }
+        return executed;
+    }
+
+    [[nodiscard]] auto done() const -> bool {
+        return std::ranges::all_of(blocks, [](const BlockState &block) {
+            return std::ranges::all_of(block.warps, [](const WarpState &warp) { return warp.done; });
+        });
+    }
+
+    [[nodiscard]] auto instructions_executed() const -> std::uint64_t {
+        auto total = std::uint64_t{};
+        for (const auto &block : blocks) {
+            for (const auto &warp : block.warps) {
+                total += warp.instructions_executed;
+            }
+        }
+        return total;
+    }
+
+    [[nodiscard]] auto get_config() const -> const ExecutorConfig & { return config; }
+    [[nodiscard]] auto get_blocks() const -> std::span<const BlockState> { return blocks; }
+    [[nodiscard]] auto get_memory() const -> const data_memory_container_t & { return memory; }
+    [[nodiscard]] auto get_memory() -> data_memory_container_t & { return memory; }
+
+    // The state a warp has right after the core has been reset and started
+    [[nodiscard]] auto initial_warp_state(IData block_id, IData warp_id) const -> WarpState {
+        auto warp = WarpState{};
+        warp.pc = config.base_instructions_address;
+        warp.scalar_registers[WarpState::EXECUTION_MASK_REG] = ~IData{0};
+        warp.vector_registers.resize(config.threads_per_warp);
+        for (auto thread = 0u; thread < config.threads_per_warp; thread++) {
+            set_read_only_registers(warp.vector_registers[thread], block_id, warp_id, thread);
+        }
+        return warp;
+    }
+
+  private:
+    auto make_block(IData block_id) const -> BlockState {
+        auto block = BlockState{.block_id = block_id, .warps = {}};
+        block.warps.reserve(config.warps_per_core);
+        for (auto warp_id = 0u; warp_id < config.warps_per_core; warp_id++) {
+            block.warps.push_back(initial_warp_state(block_id, warp_id));
+        }
+        return block;
+    }
+
+    // x0 - zero, x1 - thread id, x2 - block id, x3 - block size (see reg_file.sv)
+    void set_read_only_registers(WarpState::RegisterSet &registers, IData block_id, IData warp_id, IData thread) const {
+        registers[0] = 0;
+        registers[1] = warp_id * config.threads_per_warp + thread;
+        registers[2] = block_id;
+        registers[3] = config.num_warps_per_block * config.threads_per_warp;
+    }
+
+    auto fetch(IData pc) const -> IData {
+        const auto index = pc - config.base_instructions_address;
+        // Instruction memory reads outside of the program return 0, which decodes to a no-op
+        return index < program.size() ? program[index] : 0u;
+    }
+
+    auto load(IData address) -> IData {
+        const auto it = memory.find(address);
+        return it != memory.end() ? it->second : 0u;
+    }
+
+    template <typename Observer>
+    auto run_warp(IData block_id, IData warp_id, WarpState &warp, const StopCondition &stop, Observer &observer) -> std::uint64_t {
+        auto executed = std::uint64_t{};
+        while (!warp.done) {
+            if (stop.max_instructions_per_warp && warp.instructions_executed >= *stop.max_instructions_per_warp) {
+                break;
+            }
+            if (stop.marker_pc && warp.pc == *stop.marker_pc) {
+                break;
+            }
+            const auto decoded = decode(fetch(warp.pc));
+            observer(block_id, warp_id, std::as_const(warp), decoded);
+            step(warp, decoded);
+            executed++;
+        }
+        return executed;
+    }
+
+    void step(WarpState &warp, const DecodedInstruction &decoded) {
+        warp.instructions_executed++;
+
+        if (decoded.halt) {
+            warp.done = true;
+            return;
+        }
+
+        auto next_pc = warp.pc + 1;
+
+        if (decoded.scalar_instruction) {
+            auto &registers = warp.scalar_registers;
+            const auto rs1 = registers[decoded.rs1];
+            const auto rs2 = registers[decoded.rs2];
+            const auto alu_out = alu(decoded.alu_instruction, warp.pc, rs1, rs2, decoded.immediate);
+
+            if (decoded.branch) {
+                if (alu_out == 1) {
+                    next_pc = warp.pc + decoded.immediate;
+                }
+            } else if (decoded.alu_instruction == AluInstruction::JAL || decoded.alu_instruction == AluInstruction::JALR) {
+                next_pc = alu_out;
+            }
+
+            if (decoded.mem_write_enable) {
+                memory[rs1 + decoded.immediate] = rs2;
+            }
+
+            if (decoded.reg_write_enable && decoded.rd > 0) {
+                switch (decoded.reg_input_mux) {
+                case RegInputMux::ALU_OUT: registers[decoded.rd] = alu_out; break;
+                case RegInputMux::LSU_OUT: registers[decoded.rd] = load(rs1 + decoded.immediate); break;
+                case RegInputMux::IMMEDIATE: registers[decoded.rd] = decoded.immediate; break;
+                case RegInputMux::PC_PLUS_1: registers[decoded.rd] = warp.pc + 1; break;
+                case RegInputMux::VECTOR_TO_SCALAR: break;
+                }
+            }
+        } else {
+            const auto mask = warp.execution_mask();
+            auto vector_to_scalar_data = IData{};
+
+            for (auto thread = 0u; thread < config.threads_per_warp; thread++) {
+                if (((mask >> thread) & 1u) == 0u) {
+                    continue;
+                }
+
+                auto &registers = warp.vector_registers[thread];
+                const auto rs1 = registers[decoded.rs1];
+                const auto rs2 = registers[decoded.rs2];
+                const auto alu_out = alu(decoded.alu_instruction, warp.pc, rs1, rs2, decoded.immediate);
+
+                if (decoded.mem_write_enable) {
+                    memory[rs1 + decoded.immediate] = rs2;
+                }
+
+                // Prevent writes to read-only registers
+                if (decoded.reg_write_enable && decoded.rd >= WarpState::FIRST_WRITABLE_VECTOR_REG) {
+                    switch (decoded.reg_input_mux) {
+                    case RegInputMux::ALU_OUT: registers[decoded.rd] = alu_out; break;
+                    case RegInputMux::LSU_OUT: registers[decoded.rd] = load(rs1 + decoded.immediate); break;
+                    case RegInputMux::IMMEDIATE: registers[decoded.rd] = decoded.immediate; break;
+                    case RegInputMux::PC_PLUS_1: break;
+                    case RegInputMux::VECTOR_TO_SCALAR: break;
+                    }
+                }
+
+                vector_to_scalar_data |= (alu_out & 1u) << thread;
+            }
+
+            if (decoded.reg_input_mux == RegInputMux::VECTOR_TO_SCALAR && decoded.rd > 0) {
+                warp.scalar_registers[decoded.rd] = vector_to_scalar_data;
+            }
+        }
+
+        warp.pc = next_pc;
+    }
+
+    ExecutorConfig config;
+    std::vector<IData> program;
+    data_memory_container_t memory;
+    std::vector<BlockState> blocks;
+};
+
+} // namespace sim
@@ -4,6 +4,7 @@
 #include <array>
 #include <algorithm>
 #include <bitset>
+#include <cstdint>
 
 namespace sim {
 
@@ -66,117 +67,6 @@ constexpr auto to_scalar(IData opcode) -> IData {
     return opcode | ((IData)1 << 6u);
 }
 
-// This returns IData rather than Opcode because it can return a scalar version of the opcode
-// if the input string is prefixed with "s."
-constexpr auto str_to_opcode(std::string_view str) -> std::optional<IData> {
-    auto is_scalar = str.starts_with("s.");
-    if (is_scalar) {
-        str.remove_prefix(2);
-    }
-
-    IData opcode{} ;
-
-    if (str == "lui") {
-        opcode = (IData)Opcode::LUI;
-    } else if (str == "auipc") {
-        opcode = (IData)Opcode::AUIPC;
-    } else if (str == "addi") {
-        opcode = (IData)Opcode::ITYPE;
-    } else if (str == "add") {
-        opcode = (IData)Opcode::RTYPE;
-    } else if (str == "sub") {
-        opcode = (IData)Opcode::RTYPE;
-    } else if (str == "slli") {
-        opcode = (IData)Opcode::ITYPE;
-    } else if (str == "slti") {
-        opcode = (IData)Opcode::ITYPE;
-    } else if (str == "sltiu") {
-        opcode = (IData)Opcode::ITYPE;
-    } else if (str == "xori") {
-        opcode = (IData)Opcode::ITYPE;
-    } else if (str == "srli") {
-        opcode = (IData)Opcode::ITYPE;
-    } else if (str == "srai") {
-        opcode = (IData)Opcode::ITYPE;
-    } else if (str == "ori") {
-        opcode = (IData)Opcode::ITYPE;
-    } else if (str == "andi") {
-        opcode = (IData)Opcode::ITYPE;
-    } else if (str == "lb") {
-        opcode = (IData)Opcode::LOAD;
-    } else if (str == "lh") {
-        opcode = (IData)Opcode::LOAD;
-    } else if (str == "lw") {
-        opcode = (IData)Opcode::LOAD;
-    } else if (str == "sb") {
-        opcode = (IData)Opcode::STYPE;
-    } else if (str == "sh") {
-        opcode = (IData)Opcode::STYPE;
-    } else if (str == "sw") {
-        opcode = (IData)Opcode::STYPE;
-    } else if (str == "beq") {
-        opcode = (IData)Opcode::BTYPE;
-    } else if (str == "bne") {
-        opcode = (IData)Opcode::BTYPE;
-    } else if (str == "blt") {
-        opcode = (IData)Opcode::BTYPE;
-    } else if (str == "bge") {
-        opcode = (IData)Opcode::BTYPE;
-    } else if (str == "jal") {
-        opcode = (IData)Opcode::JTYPE;
-    } else if (str == "jalr") {
-        opcode = (IData)Opcode::JALR;
-    } else if (str == "halt") {
-        opcode = (IData)Opcode::HALT;
-    } else if (str == "sx.slt") {
-        opcode = (IData)Opcode::SX_SLT;
-    } else if (str == "sx.slti") {
-        opcode = (IData)Opcode::SX_SLTI;
-    } else {
-        return std::nullopt;
-    }
-
-    if (is_scalar) {
-        opcode = to_scalar(opcode);
-    }
-
-    return opcode;
-}
-
-constexpr auto opcode_to_str(IData opcode) -> std::string_view {
-    switch (opcode) {
-    case (IData)Opcode::LUI:
-        return is_scalar(opcode) ? "s.lui" : "lui";
-    case (IData)Opcode::AUIPC:
-        return is_scalar(opcode) ? "s.auipc" : "auipc";
-    case (IData)Opcode::ITYPE:
-        return is_scalar(opcode) ? "s.<itype>" : "<itype>";
-    case (IData)Opcode::RTYPE:
-        return is_scalar(opcode) ? "s.<rtype>" : "<rtype>";
-    case (IData)Opcode::LOAD:
-        return is_scalar(opcode) ? "s.<load>" : "<load>";
-    case (IData)Opcode::STYPE:
-        return is_scalar(opcode) ? "s.<store>" : "<store>";
-    case (IData)Opcode::JTYPE:
-        return "jal";
-    case (IData)Opcode::JALR:
-        return "jalr";
-    case (IData)Opcode::BTYPE:
-        return "beq";
-    case (IData)Opcode::HALT:
-        return "halt";
-    case (IData)Opcode::SX_SLT:
-        return "sx.slt";
-    case (IData)Opcode::SX_SLTI:
-        return "sx.slti";
-    default:
-        return "unknown";
-    }
-}
-
-
-
-
 // Funct3
 enum class Funct3 : IData {
 // I-type
@@ -384,6 +274,14 @@ struct InstructionBits {
         return *this;
     }
 
+    // imm[11:5] go to bits 31:25 and imm[4:0] to bits 11:7, where the other types have rd
+    constexpr auto set_store_imm12(IData imm) -> InstructionBits& {
+        assert_or_err(imm < 4096, Error(std::format("Invalid immediate: '{}', expected 12-bit.", imm)));
+        bits |= (imm >> 5u) << 25u;
+        bits |= (imm & 0b11111u) << 7u;
+        return *this;
+    }
+
     constexpr auto set_funct7(Funct7 funct7) -> InstructionBits& {
         validate_instr_id("funct7", funct7, funct7s);
         bits |= (IData)funct7 << 25u;
@@ -396,24 +294,21 @@ struct InstructionBits {
         return *this;
     }
 
+    // imm[20|10:1|11|19:12] go to bits 31:12, bit 0 of the immediate isn't encoded
     constexpr auto set_imm21(IData imm21) -> InstructionBits& {
-        // FIXME: Need to double check whether this is correct
-        assert_or_err(imm21 < 2097152, Error(std::format("Invalid immediate: '{}', expected 21-bit.", imm21)));
-
-        auto imm_j = std::bitset<32>{};
-        auto imm = std::bitset<21>(imm21);
-
-        imm_j[31] = imm[20];
-        for(auto i = 21u; i <= 30u; i++) {
-            imm_j[i] = imm[i - 20];
-        }
-        imm_j[20] = imm[11];
-        for(auto i = 12u; i <= 19u; i++) {
-            imm_j[i] = imm[i];
-        }
-        imm_j[0] = 0;
+        bits |= ((imm21 >> 20u) & 1u) << 31u;
+        bits |= ((imm21 >> 1u) & 0x3FFu) << 21u;
+        bits |= ((imm21 >> 11u) & 1u) << 20u;
+        bits |= ((imm21 >> 12u) & 0xFFu) << 12u;
+        return *this;
+    }
 
-        bits |= imm_j.to_ulong();
+    // imm[12|10:5] go to bits 31:25 and imm[4:1|11] to bits 11:7, bit 0 of the immediate isn't encoded
+    constexpr auto set_imm13(IData imm13) -> InstructionBits& {
+        bits |= ((imm13 >> 12u) & 1u) << 31u;
+        bits |= ((imm13 >> 5u) & 0b111111u) << 25u;
+        bits |= ((imm13 >> 1u) & 0b1111u) << 8u;
+        bits |= ((imm13 >> 11u) & 1u) << 7u;
         return *this;
     }
 
@@ -428,6 +323,25 @@ struct InstructionBits {
     }
 };
 
+// Branch and jump offsets count instructions and are relative to the branch or jump itself, since the PC is an
+// instruction index. They take the place of RISC-V's byte offsets: the offset is stored as imm[12:1] of the B-type
+// and imm[20:1] of the J-type immediate, so a 13-bit B-type immediate reaches 2048 instructions in either direction.
+constexpr auto BRANCH_OFFSET_BITS = 12u;
+constexpr auto JUMP_OFFSET_BITS = 20u;
+
+constexpr auto fits_offset(std::int64_t offset, unsigned bits) -> bool {
+    return offset >= -(std::int64_t{1} << (bits - 1u)) && offset < (std::int64_t{1} << (bits - 1u));
+}
+
+// The I-type, S-type and jalr immediates are 12 bits and the U-type ones 20. They are written either sign extended or
+// as the raw bits of the field, so 12 bits take -2048 to 4095.
+constexpr auto IMMEDIATE_BITS = 12u;
+constexpr auto UPPER_IMMEDIATE_BITS = 20u;
+
+constexpr auto fits_immediate(std::int64_t value, unsigned bits) -> bool {
+    return value >= -(std::int64_t{1} << (bits - 1u)) && value < (std::int64_t{1} << bits);
+}
+
 namespace instructions {
 
 // Helper functions for creating instructions
@@ -444,16 +358,19 @@ constexpr auto create_itype_shift_instruction(Opcode opcode, Funct3 funct3, Func
 constexpr auto create_rtype_instruction(Opcode opcode, Funct3 funct3, Funct7 funct7, Register rd, Register rs1, Register rs2) -> InstructionBits {
     return InstructionBits().set_opcode(opcode).set_funct3(funct3).set_funct7(funct7).set_rd(rd).set_rs1(rs1).set_rs2(rs2);
 }
-constexpr auto create_jtype_instruction(Opcode opcode, Register rd, IData imm21) -> InstructionBits {
-    return InstructionBits().set_opcode(opcode).set_rd(rd).set_imm21(imm21);
+// The offsets are in instructions, see BRANCH_OFFSET_BITS
+constexpr auto create_jtype_instruction(Opcode opcode, Register rd, IData offset) -> InstructionBits {
+    assert_or_err(fits_offset((std::int32_t)offset, JUMP_OFFSET_BITS),
+                  Error(std::format("Invalid jump offset: '{}', expected {}-bit.", (std::int32_t)offset, JUMP_OFFSET_BITS)));
+    return InstructionBits().set_opcode(opcode).set_rd(rd).set_imm21(offset << 1u);
 }
-constexpr auto create_btype_instruction(Opcode opcode, Funct3 funct3, Register rs1, Register rs2, IData imm12) -> InstructionBits {
-    // TODO: Implement this
-    return InstructionBits{};
-    /*return Instruction().set_opcode(opcode).set_funct3(funct3).set_rs1(rs1).set_rs2(rs2);*/
+constexpr auto create_btype_instruction(Opcode opcode, Funct3 funct3, Register rs1, Register rs2, IData offset) -> InstructionBits {
+    assert_or_err(fits_offset((std::int32_t)offset, BRANCH_OFFSET_BITS),
+                  Error(std::format("Invalid branch offset: '{}', expected {}-bit.", (std::int32_t)offset, BRANCH_OFFSET_BITS)));
+    return InstructionBits().set_opcode(opcode).set_funct3(funct3).set_rs1(rs1).set_rs2(rs2).set_imm13(offset << 1u);
 }
 constexpr auto create_stype_instruction(Opcode opcode, Funct3 funct3, Register rs1, Register rs2, IData imm12) -> InstructionBits {
-    return InstructionBits().set_opcode(opcode).set_funct3(funct3).set_rs1(rs1).set_rs2(rs2).set_imm12(imm12);
+    return InstructionBits().set_opcode(opcode).set_funct3(funct3).set_rs1(rs1).set_rs2(rs2).set_store_imm12(imm12);
 }
 
 // Instruction constructors
@@ -544,8 +461,8 @@ constexpr auto sw(Register rs1, Register rs2, IData imm12) -> InstructionBits {
 }
 
 // J-type
-constexpr auto jal(Register rd, IData imm21) -> InstructionBits {
-    return create_jtype_instruction(Opcode::JTYPE, rd, imm21);
+constexpr auto jal(Register rd, IData offset) -> InstructionBits {
+    return create_jtype_instruction(Opcode::JTYPE, rd, offset);
 }
 
 // JALR
@@ -554,17 +471,17 @@ constexpr auto jalr(Register rd, Register rs1, IData imm12) -> InstructionBits {
 }
 
 // B-type
-constexpr auto beq(Register rs1, Register rs2, IData imm12) -> InstructionBits {
-    return create_btype_instruction(Opcode::BTYPE, Funct3::BEQ, rs1, rs2, imm12);
+constexpr auto beq(Register rs1, Register rs2, IData offset) -> InstructionBits {
+    return create_btype_instruction(Opcode::BTYPE, Funct3::BEQ, rs1, rs2, offset);
 }
-constexpr auto bne(Register rs1, Register rs2, IData imm12) -> InstructionBits {
-    return create_btype_instruction(Opcode::BTYPE, Funct3::BNE, rs1, rs2, imm12);
+constexpr auto bne(Register rs1, Register rs2, IData offset) -> InstructionBits {
+    return create_btype_instruction(Opcode::BTYPE, Funct3::BNE, rs1, rs2, offset);
 }
-constexpr auto blt(Register rs1, Register rs2, IData imm12) -> InstructionBits {
-    return create_btype_instruction(Opcode::BTYPE, Funct3::BLT, rs1, rs2, imm12);
+constexpr auto blt(Register rs1, Register rs2, IData offset) -> InstructionBits {
+    return create_btype_instruction(Opcode::BTYPE, Funct3::BLT, rs1, rs2, offset);
 }
-constexpr auto bge(Register rs1, Register rs2, IData imm12) -> InstructionBits {
-    return create_btype_instruction(Opcode::BTYPE, Funct3::BGE, rs1, rs2, imm12);
+constexpr auto bge(Register rs1, Register rs2, IData offset) -> InstructionBits {
+    return create_btype_instruction(Opcode::BTYPE, Funct3::BGE, rs1, rs2, offset);
 }
 
 // Custom opcodes
@@ -632,79 +549,7 @@ enum class MnemonicName {
     SX_SLTI
 };
 
-constexpr auto str_to_mnemonic_name(const std::string_view name) -> std::optional<MnemonicName> {
-    if (name == "lui") {
-        return MnemonicName::LUI;
-    } else if (name == "auipc") {
-        return MnemonicName::AUIPC;
-    } else if (name == "addi") {
-        return MnemonicName::ADDI;
-    } else if (name == "slti") {
-        return MnemonicName::SLTI;
-    } else if (name == "xori") {
-        return MnemonicName::XORI;
-    } else if (name == "ori") {
-        return MnemonicName::ORI;
-    } else if (name == "andi") {
-        return MnemonicName::ANDI;
-    } else if (name == "slli") {
-        return MnemonicName::SLLI;
-    } else if (name == "srli") {
-        return MnemonicName::SRLI;
-    } else if (name == "srai") {
-        return MnemonicName::SRAI;
-    } else if (name == "add") {
-        return MnemonicName::ADD;
-    } else if (name == "sub") {
-        return MnemonicName::SUB;
-    } else if (name == "sll") {
-        return MnemonicName::SLL;
-    } else if (name == "slt") {
-        return MnemonicName::SLT;
-    } else if (name == "xor") {
-        return MnemonicName::XOR;
-    } else if (name == "srl") {
-        return MnemonicName::SRL;
-    } else if (name == "sra") {
-        return MnemonicName::SRA;
-    } else if (name == "or") {
-        return MnemonicName::OR;
-    } else if (name == "and") {
-        return MnemonicName::AND;
-    } else if (name == "lb") {
-        return MnemonicName::LB;
-    } else if (name == "lh") {
-        return MnemonicName::LH;
-    } else if (name == "lw") {
-        return MnemonicName::LW;
-    } else if (name == "sb") {
-        return MnemonicName::SB;
-    } else if (name == "sh") {
-        return MnemonicName::SH;
-    } else if (name == "sw") {
-        return MnemonicName::SW;
-    } else if (name == "jal") {
-        return MnemonicName::JAL;
-    } else if (name == "jalr") {
-        return MnemonicName::JALR;
-    } else if (name == "beq") {
-        return MnemonicName::BEQ;
-    } else if (name == "bne") {
-        return MnemonicName::BNE;
-    } else if (name == "blt") {
-        return MnemonicName::BLT;
-    } else if (name == "bge") {
-        return MnemonicName::BGE;
-    } else if (name == "halt") {
-        return MnemonicName::HALT;
-    } else if (name == "sx.slt") {
-        return MnemonicName::SX_SLT;
-    } else if (name == "sx.slti") {
-        return MnemonicName::SX_SLTI;
-    }
-
-    return std::nullopt;
-}
+constexpr auto NUM_MNEMONIC_NAMES = (std::size_t)MnemonicName::SX_SLTI + 1;
 
 constexpr auto to_string(const MnemonicName name) -> std::string_view {
     switch (name) {
@@ -854,10 +699,128 @@ constexpr auto mnemonic_name_to_opcode(MnemonicName name) -> Opcode {
     }
 }
 
+// Mnemonic lookup
+//
+// Every spelling, including the "s." prefixed ones, is resolved with a single probe into a perfect hash table
+// that is generated at compile time. The table maps to the mnemonic name and whether it was prefixed.
+namespace mnemonic_lookup {
+
+struct Entry {
+    std::string_view spelling; // Without the "s." prefix
+    MnemonicName name;
+    bool has_s_prefix;
+
+    [[nodiscard]] constexpr auto matches(std::string_view str) const -> bool {
+        if (has_s_prefix) {
+            return str.size() == spelling.size() + 2 && str.starts_with("s.") && str.substr(2) == spelling;
+        }
+        return str == spelling;
+    }
+};
+
+constexpr auto make_entries() -> std::array<Entry, NUM_MNEMONIC_NAMES * 2> {
+    auto entries = std::array<Entry, NUM_MNEMONIC_NAMES * 2>{};
+    for (auto i = 0u; i < NUM_MNEMONIC_NAMES; i++) {
+        const auto name = static_cast<MnemonicName>(i);
+        entries[2 * i] = Entry{.spelling = to_string(name), .name = name, .has_s_prefix = false};
+        entries[2 * i + 1] = Entry{.spelling = to_string(name), .name = name, .has_s_prefix = true};
+    }
+    return entries;
+}
+
+constexpr auto entries = make_entries();
+
+constexpr auto TABLE_BITS = 9u;
+constexpr auto TABLE_SIZE = 1u << TABLE_BITS;
+constexpr auto EMPTY_SLOT = std::uint8_t{0xff};
+static_assert(entries.size() < EMPTY_SLOT);
+
+// Seeded FNV-1a followed by a multiplicative hash down to TABLE_BITS
+constexpr auto fnv1a(std::string_view str, std::uint32_t h) -> std::uint32_t {
+    for (const auto c : str) {
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return h;
+}
+
+constexpr auto to_slot(std::uint32_t h) -> std::uint32_t { return (h * 2654435761u) >> (32u - TABLE_BITS); }
+
+constexpr auto hash(std::string_view str, std::uint32_t seed) -> std::uint32_t {
+    return to_slot(fnv1a(str, 2166136261u ^ seed));
+}
+
+// The prefixed spellings don't exist as strings, so hash the prefix and the rest separately
+constexpr auto entry_hash(const Entry &entry, std::uint32_t seed) -> std::uint32_t {
+    if (!entry.has_s_prefix) {
+        return hash(entry.spelling, seed);
+    }
+    return to_slot(fnv1a(entry.spelling, fnv1a("s.", 2166136261u ^ seed)));
+}
+
+struct Table {
+    std::uint32_t seed;
+    std::array<std::uint8_t, TABLE_SIZE> slots;
+};
+
+// Tries seeds until every spelling lands in its own slot
+constexpr auto make_table() -> Table {
+    for (auto seed = 0u;; seed++) {
+        auto table = Table{.seed = seed, .slots = {}};
+        table.slots.fill(EMPTY_SLOT);
+
+        auto collision = false;
+        for (auto i = 0u; i < entries.size() && !collision; i++) {
+            auto &slot = table.slots[entry_hash(entries[i], seed)];
+            collision = slot != EMPTY_SLOT;
+            slot = static_cast<std::uint8_t>(i);
+        }
+        if (!collision) {
+            return table;
+        }
+    }
+}
+
+constexpr auto table = make_table();
+
+constexpr auto find(std::string_view str) -> const Entry * {
+    const auto slot = table.slots[hash(str, table.seed)];
+    if (slot == EMPTY_SLOT || !entries[slot].matches(str)) {
+        return nullptr;
+    }
+    return &entries[slot];
+}
+
+static_assert(find("addi") != nullptr && find("addi")->name == MnemonicName::ADDI && !find("addi")->has_s_prefix);
+static_assert(find("s.sx.slti") != nullptr && find("s.sx.slti")->name == MnemonicName::SX_SLTI);
+static_assert(find("s.") == nullptr && find("addi.") == nullptr);
+
+} // namespace mnemonic_lookup
+
+// Only matches the unprefixed spellings
+constexpr auto str_to_mnemonic_name(const std::string_view name) -> std::optional<MnemonicName> {
+    const auto *entry = mnemonic_lookup::find(name);
+    if (entry == nullptr || entry->has_s_prefix) {
+        return std::nullopt;
+    }
+    return entry->name;
+}
+
+// This returns IData rather than Opcode because it can return a scalar version of the opcode
+// if the input string is prefixed with "s."
+constexpr auto str_to_opcode(std::string_view str) -> std::optional<IData> {
+    const auto *entry = mnemonic_lookup::find(str);
+    if (entry == nullptr) {
+        return std::nullopt;
+    }
+
+    const auto opcode = (IData)mnemonic_name_to_opcode(entry->name);
+    return entry->has_s_prefix ? to_scalar(opcode) : opcode;
+}
+
 struct Mnemonic {
-    Mnemonic(MnemonicName name, bool is_scalar) : name(name), has_s_prefix(is_scalar) {}
+    constexpr Mnemonic(MnemonicName name, bool is_scalar) : name(name), has_s_prefix(is_scalar) {}
 
-    [[nodiscard]] auto get_name() const -> MnemonicName {
+    [[nodiscard]] constexpr auto get_name() const -> MnemonicName {
         return name;
     }
 
@@ -873,20 +836,20 @@ struct Mnemonic {
         return opcode;
     }
 
-    [[nodiscard]] auto is_vector_scalar() const -> bool {
+    [[nodiscard]] constexpr auto is_vector_scalar() const -> bool {
         return name == MnemonicName::SX_SLT || name == MnemonicName::SX_SLTI;
     }
 
-    [[nodiscard]] auto is_branch() const -> bool {
+    [[nodiscard]] constexpr auto is_branch() const -> bool {
         return name == MnemonicName::BEQ || name == MnemonicName::BNE || name == MnemonicName::BLT || name == MnemonicName::BGE;
     }
 
-    [[nodiscard]] auto is_jump() const -> bool {
+    [[nodiscard]] constexpr auto is_jump() const -> bool {
         return name == MnemonicName::JAL || name == MnemonicName::JALR;
     }
 
     // in practice, that is equivalent to MSB of the opcode being 1
-    [[nodiscard]] auto is_scalar() const -> bool {
+    [[nodiscard]] constexpr auto is_scalar() const -> bool {
         return has_s_prefix || is_vector_scalar() || is_branch() || is_jump();
     }
 
@@ -901,102 +864,74 @@ private:
 };
 
 constexpr auto str_to_mnemonic(std::string_view str) -> std::optional<Mnemonic> {
-    auto is_scalar = str.starts_with("s.");
-    if (is_scalar) {
-        str.remove_prefix(2);
-    }
-
-    auto name = str_to_mnemonic_name(str);
-    if (!name) {
+    const auto *entry = mnemonic_lookup::find(str);
+    if (entry == nullptr) {
         return std::nullopt;
     }
 
-    return Mnemonic(*name, is_scalar);
+    return Mnemonic(entry->name, entry->has_s_prefix);
 }
 
+constexpr auto make_determinant_table() -> std::array<InstructionDeterminant, NUM_MNEMONIC_NAMES> {
+    auto table = std::array<InstructionDeterminant, NUM_MNEMONIC_NAMES>{};
+    // U-type
+    table[(std::size_t)MnemonicName::LUI] = {Opcode::LUI, {}, {}};
+    table[(std::size_t)MnemonicName::AUIPC] = {Opcode::AUIPC, {}, {}};
+    // I-type arithmetic
+    table[(std::size_t)MnemonicName::ADDI] = {Opcode::ITYPE, Funct3::ADDI, {}};
+    table[(std::size_t)MnemonicName::SLTI] = {Opcode::ITYPE, Funct3::SLTI, {}};
+    table[(std::size_t)MnemonicName::XORI] = {Opcode::ITYPE, Funct3::XORI, {}};
+    table[(std::size_t)MnemonicName::ORI] = {Opcode::ITYPE, Funct3::ORI, {}};
+    table[(std::size_t)MnemonicName::ANDI] = {Opcode::ITYPE, Funct3::ANDI, {}};
+    table[(std::size_t)MnemonicName::SLLI] = {Opcode::ITYPE, Funct3::SLLI, Funct7::SLLI};
+    table[(std::size_t)MnemonicName::SRLI] = {Opcode::ITYPE, Funct3::SRLI, Funct7::SRLI};
+    table[(std::size_t)MnemonicName::SRAI] = {Opcode::ITYPE, Funct3::SRAI, Funct7::SRAI};
+    // R-type
+    table[(std::size_t)MnemonicName::ADD] = {Opcode::RTYPE, Funct3::ADD, Funct7::ADD};
+    table[(std::size_t)MnemonicName::SUB] = {Opcode::RTYPE, Funct3::SUB, Funct7::SUB};
+    table[(std::size_t)MnemonicName::SLL] = {Opcode::RTYPE, Funct3::SLL, Funct7::SLL};
+    table[(std::size_t)MnemonicName::SLT] = {Opcode::RTYPE, Funct3::SLT, Funct7::SLT};
+    table[(std::size_t)MnemonicName::XOR] = {Opcode::RTYPE, Funct3::XOR, Funct7::XOR};
+    table[(std::size_t)MnemonicName::SRL] = {Opcode::RTYPE, Funct3::SRL, Funct7::SRL};
+    table[(std::size_t)MnemonicName::SRA] = {Opcode::RTYPE, Funct3::SRA, Funct7::SRA};
+    table[(std::size_t)MnemonicName::OR] = {Opcode::RTYPE, Funct3::OR, Funct7::OR};
+    table[(std::size_t)MnemonicName::AND] = {Opcode::RTYPE, Funct3::AND, Funct7::AND};
+    // Load
+    table[(std::size_t)MnemonicName::LB] = {Opcode::LOAD, Funct3::LB, {}};
+    table[(std::size_t)MnemonicName::LH] = {Opcode::LOAD, Funct3::LH, {}};
+    table[(std::size_t)MnemonicName::LW] = {Opcode::LOAD, Funct3::LW, {}};
+    // Store
+    table[(std::size_t)MnemonicName::SB] = {Opcode::STYPE, Funct3::SB, {}};
+    table[(std::size_t)MnemonicName::SH] = {Opcode::STYPE, Funct3::SH, {}};
+    table[(std::size_t)MnemonicName::SW] = {Opcode::STYPE, Funct3::SW, {}};
+    // J-type
+    table[(std::size_t)MnemonicName::JAL] = {Opcode::JTYPE, {}, {}};
+    // I-type jumps
+    table[(std::size_t)MnemonicName::JALR] = {Opcode::JALR, Funct3::JALR, {}};
+    // B-type
+    table[(std::size_t)MnemonicName::BEQ] = {Opcode::BTYPE, Funct3::BEQ, {}};
+    table[(std::size_t)MnemonicName::BNE] = {Opcode::BTYPE, Funct3::BNE, {}};
+    table[(std::size_t)MnemonicName::BLT] = {Opcode::BTYPE, Funct3::BLT, {}};
+    table[(std::size_t)MnemonicName::BGE] = {Opcode::BTYPE, Funct3::BGE, {}};
+    // Halt
+    table[(std::size_t)MnemonicName::HALT] = {Opcode::HALT, {}, {}};
+    // SX-type
+    table[(std::size_t)MnemonicName::SX_SLT] = {Opcode::SX_SLT, Funct3::SLT, Funct7::SLT};
+    table[(std::size_t)MnemonicName::SX_SLTI] = {Opcode::SX_SLTI, Funct3::SLTI, {}};
+    return table;
+}
+
+constexpr auto determinant_table = make_determinant_table();
+
 constexpr auto name_to_determinant(MnemonicName name) -> InstructionDeterminant {
-    switch (name) {
-        // U-type
-        case MnemonicName::LUI:
-            return {Opcode::LUI, {}, {}};
-        case MnemonicName::AUIPC:
-            return {Opcode::AUIPC, {}, {}};
-        // I-type arithmetic
-        case MnemonicName::ADDI:
-            return {Opcode::ITYPE, Funct3::ADDI, {}};
-        case MnemonicName::SLTI:
-            return {Opcode::ITYPE, Funct3::SLTI, {}};
-        case MnemonicName::XORI:
-            return {Opcode::ITYPE, Funct3::XORI, {}};
-        case MnemonicName::ORI:
-            return {Opcode::ITYPE, Funct3::ORI, {}};
-        case MnemonicName::ANDI:
-            return {Opcode::ITYPE, Funct3::ANDI, {}};
-        case MnemonicName::SLLI:
-            return {Opcode::ITYPE, Funct3::SLLI, Funct7::SLLI};
-        case MnemonicName::SRLI:
-            return {Opcode::ITYPE, Funct3::SRLI, Funct7::SRLI};
-        case MnemonicName::SRAI:
-            return {Opcode::ITYPE, Funct3::SRAI, Funct7::SRAI};
-        // R-type
-        case MnemonicName::ADD:
-            return {Opcode::RTYPE, Funct3::ADD, Funct7::ADD};
-        case MnemonicName::SUB:
-            return {Opcode::RTYPE, Funct3::SUB, Funct7::SUB};
-        case MnemonicName::SLL:
-            return {Opcode::RTYPE, Funct3::SLL, Funct7::SLL};
-        case MnemonicName::SLT:
-            return {Opcode::RTYPE, Funct3::SLT, Funct7::SLT};
-        case MnemonicName::XOR:
-            return {Opcode::RTYPE, Funct3::XOR, Funct7::XOR};
-        case MnemonicName::SRL:
-            return {Opcode::RTYPE, Funct3::SRL, Funct7::SRL};
-        case MnemonicName::SRA:
-            return {Opcode::RTYPE, Funct3::SRA, Funct7::SRA};
-        case MnemonicName::OR:
-            return {Opcode::RTYPE, Funct3::OR, Funct7::OR};
-        case MnemonicName::AND:
-            return {Opcode::RTYPE, Funct3::AND, Funct7::AND};
-        // Load
-        case MnemonicName::LB:
-            return {Opcode::LOAD, Funct3::LB, {}};
-        case MnemonicName::LH:
-            return {Opcode::LOAD, Funct3::LH, {}};
-        case MnemonicName::LW:
-            return {Opcode::LOAD, Funct3::LW, {}};
-        // Store
-        case MnemonicName::SB:
-            return {Opcode::STYPE, Funct3::SB, {}};
-        case MnemonicName::SH:
-            return {Opcode::STYPE, Funct3::SH, {}};
-        case MnemonicName::SW:
-            return {Opcode::STYPE, Funct3::SW, {}};
-        // J-type
-        case MnemonicName::JAL:
-            return {Opcode::JTYPE, {}, {}};
-        // I-type jumps
-        case MnemonicName::JALR:
-            return {Opcode::JALR, Funct3::JALR, {}};
-        // B-type
-        case MnemonicName::BEQ:
-            return {Opcode::BTYPE, Funct3::BEQ, {}};
-        case MnemonicName::BNE:
-            return {Opcode::BTYPE, Funct3::BNE, {}};
-        case MnemonicName::BLT:
-            return {Opcode::BTYPE, Funct3::BLT, {}};
-        case MnemonicName::BGE:
-            return {Opcode::BTYPE, Funct3::BGE, {}};
-        // Halt
-        case MnemonicName::HALT:
-            return {Opcode::HALT, {}, {}};
-        // SX-type
-        case MnemonicName::SX_SLT:
-            return {Opcode::SX_SLT, Funct3::SLT, Funct7::SLT};
-        case MnemonicName::SX_SLTI:
-            return {Opcode::SX_SLTI, Funct3::SLTI, {}};
-    }
-
-    std::unreachable();
+    return determinant_table[(std::size_t)name];
+}
+
+// slli, srli and srai keep funct7 above a 5-bit shift amount, it's what tells srai from srli
+constexpr auto SHIFT_AMOUNT_BITS = 5u;
+
+constexpr auto is_itype_shift(MnemonicName name) -> bool {
+    return name == MnemonicName::SLLI || name == MnemonicName::SRLI || name == MnemonicName::SRAI;
 }
 
 }
@@ -0,0 +1,579 @@
+#pragma once
+#include <cstddef>
+#include <expected>
+#include <format>
+#include <span>
+#include <utility>
+#include <vector>
+#include "decoder.hpp"
+#include "error.hpp"
+#include "executor.hpp"
+#include "x64_emitter.hpp"
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#define SIM_JIT_SUPPORTED 1
+#else
+#define SIM_JIT_SUPPORTED 0
+#endif
+
+namespace sim {
+
+// JIT compiler from the GPU machine code to native x86-64 code
+//
+// A kernel is translated once into a function that runs one warp to completion on a JitWarpState and a flat
+// data memory. Vector instructions become SSE2 code over groups of 4 threads (masked with s1), loads, stores and
+// shifts by a register are unrolled per thread, scalar branches and jumps become native jumps.
+// The semantics are those of the executor (executor.hpp) with two exceptions:
+// - the data memory is flat, out of bounds loads return 0 and out of bounds stores are dropped
+// - jumping outside of the program stops the warp with JitStatus::INVALID_PC instead of executing no-ops
+
+// State of one warp, the layout is what the generated code expects
+struct alignas(16) JitWarpState {
+    static constexpr IData MAX_THREADS = 32; // s1 masks at most 32 threads
+
+    // Register major so that SIMD code can load the same register of consecutive threads
+    std::array<std::array<IData, MAX_THREADS>, WarpState::NUM_REGISTERS> vector_registers{};
+    std::array<IData, WarpState::NUM_REGISTERS> scalar_registers{};
+    IData pc{};
+    IData done{};
+    std::uint64_t instructions_executed{};
+};
+
+enum class JitStatus : IData {
+    HALTED,
+    INVALID_PC,
+};
+
+// Owns a block of executable memory
+class ExecutableBuffer {
+  public:
+    ExecutableBuffer() = default;
+    ExecutableBuffer(const ExecutableBuffer &) = delete;
+    auto operator=(const ExecutableBuffer &) -> ExecutableBuffer & = delete;
+    ExecutableBuffer(ExecutableBuffer &&other) noexcept
+        : memory(std::exchange(other.memory, nullptr)), size(std::exchange(other.size, 0)) {}
+    auto operator=(ExecutableBuffer &&other) noexcept -> ExecutableBuffer & {
+        std::swap(memory, other.memory);
+        std::swap(size, other.size);
+        return *this;
+    }
+    ~ExecutableBuffer() {
+#if SIM_JIT_SUPPORTED
+        if (memory != nullptr) {
+            munmap(memory, size);
+        }
+#endif
+    }
+
+    // Maps writable memory, lets `emitter` write the code and makes the memory executable
+    static auto create(x64::Emitter &emitter) -> std::expected<ExecutableBuffer, Error> {
+#if SIM_JIT_SUPPORTED
+        auto buffer = ExecutableBuffer{};
+        buffer.size = emitter.finished_size();
+        auto *memory = mmap(nullptr, buffer.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return std::unexpected(Error("Failed to map memory for the JIT"));
+        }
+        buffer.memory = memory;
+        emitter.finish(static_cast<uint8_t *>(memory));
+        if (mprotect(memory, buffer.size, PROT_READ | PROT_EXEC) != 0) {
+            return std::unexpected(Error("Failed to make the JIT memory executable"));
+        }
+        return buffer;
+#else
+        return std::unexpected(Error("The JIT is only supported on x86-64 unix systems"));
+#endif
+    }
+
+    [[nodiscard]] auto data() const -> const void * { return memory; }
+
+  private:
+    void *memory = nullptr;
+    size_t size = 0;
+};
+
+class JitKernel {
+  public:
+    using Function = IData (*)(JitWarpState *, IData *, IData);
+
+    JitKernel(const ExecutorConfig &config, ExecutableBuffer code) : config(config), code(std::move(code)) {}
+
+    // Runs a single warp until it halts
+    auto run_warp(JitWarpState &warp, std::span<IData> memory) const -> JitStatus {
+        const auto function = reinterpret_cast<Function>(const_cast<void *>(code.data()));
+        const auto memory_size = (IData)std::min<size_t>(memory.size(), std::numeric_limits<IData>::max());
+        return (JitStatus)function(&warp, memory.data(), memory_size);
+    }
+
+    // Runs every warp of every block, like Executor::run
+    // Returns the number of executed instructions
+    auto run(std::span<IData> memory) const -> std::expected<std::uint64_t, Error> {
+        auto executed = std::uint64_t{};
+        for (auto block_id = 0u; block_id < config.num_blocks; block_id++) {
+            for (auto warp_id = 0u; warp_id < config.warps_per_core; warp_id++) {
+                auto warp = initial_warp_state(block_id, warp_id);
+                if (run_warp(warp, memory) != JitStatus::HALTED) {
+                    return std::unexpected(Error(std::format("Block {} warp {} jumped outside of the program to {}", block_id, warp_id, warp.pc)));
+                }
+                executed += warp.instructions_executed;
+            }
+        }
+        return executed;
+    }
+
+    // Same initial state as Executor::initial_warp_state
+    [[nodiscard]] auto initial_warp_state(IData block_id, IData warp_id) const -> JitWarpState {
+        auto warp = JitWarpState{};
+        warp.pc = config.base_instructions_address;
+        warp.scalar_registers[WarpState::EXECUTION_MASK_REG] = ~IData{0};
+        for (auto thread = 0u; thread < config.threads_per_warp; thread++) {
+            warp.vector_registers[1][thread] = warp_id * config.threads_per_warp + thread;
+            warp.vector_registers[2][thread] = block_id;
+            warp.vector_registers[3][thread] = config.num_warps_per_block * config.threads_per_warp;
+        }
+        return warp;
+    }
+
+    [[nodiscard]] auto get_config() const -> const ExecutorConfig & { return config; }
+
+  private:
+    ExecutorConfig config;
+    ExecutableBuffer code;
+};
+
+namespace jit_detail {
+
+using namespace x64;
+
+// Arguments of the generated function (System V ABI)
+constexpr auto STATE = RDI;
+constexpr auto MEMORY = RSI;
+constexpr auto MEMORY_SIZE = RDX;
+
+constexpr auto scalar_register(IData reg) -> Mem {
+    return mem(STATE, (int32_t)(offsetof(JitWarpState, scalar_registers) + reg * sizeof(IData)));
+}
+
+constexpr auto vector_register(IData reg, IData thread) -> Mem {
+    return mem(STATE, (int32_t)(offsetof(JitWarpState, vector_registers) + (reg * JitWarpState::MAX_THREADS + thread) * sizeof(IData)));
+}
+
+constexpr auto PC = mem(STATE, (int32_t)offsetof(JitWarpState, pc));
+constexpr auto DONE = mem(STATE, (int32_t)offsetof(JitWarpState, done));
+constexpr auto INSTRUCTIONS_EXECUTED = mem(STATE, (int32_t)offsetof(JitWarpState, instructions_executed));
+
+constexpr auto is_shift(AluInstruction instruction) -> bool {
+    return instruction == AluInstruction::SLL || instruction == AluInstruction::SRL || instruction == AluInstruction::SRA ||
+           instruction == AluInstruction::SLLI || instruction == AluInstruction::SRLI || instruction == AluInstruction::SRAI;
+}
+
+constexpr auto uses_rs2(AluInstruction instruction) -> bool {
+    return instruction >= AluInstruction::ADD && instruction <= AluInstruction::BGE;
+}
+
+class Compiler {
+  public:
+    Compiler(const ExecutorConfig &config, std::span<const IData> program) : config(config), program(program) {}
+
+    auto compile() -> std::expected<JitKernel, Error> {
+        if (config.threads_per_warp == 0 || config.threads_per_warp > JitWarpState::MAX_THREADS || config.threads_per_warp % 4 != 0) {
+            return std::unexpected(Error(std::format("The JIT needs a multiple of 4 threads per warp (at most 32), got {}", config.threads_per_warp)));
+        }
+
+        for (auto i = 0u; i < program.size(); i++) {
+            instruction_labels.push_back(emitter.make_label());
+        }
+        jump_table = emitter.make_label();
+        invalid_pc = emitter.make_label();
+        for (auto group = 0u; group < JitWarpState::MAX_THREADS / 4; group++) {
+            const auto bit = 1u << (group * 4);
+            thread_bits.push_back(emitter.constant({bit, bit << 1u, bit << 2u, bit << 3u}));
+        }
+        sign_bits = emitter.constant({0x80000000u, 0x80000000u, 0x80000000u, 0x80000000u});
+        all_ones = emitter.constant({~0u, ~0u, ~0u, ~0u});
+
+        for (auto i = 0u; i < program.size(); i++) {
+            emitter.bind(instruction_labels[i]);
+            emit_instruction(config.base_instructions_address + i, decode(program[i]));
+        }
+        // Falling off the end of the program
+        exit_with_invalid_pc(config.base_instructions_address + (IData)program.size());
+
+        // Jumps to a PC computed at runtime (jalr) have their PC in eax
+        emitter.bind(invalid_pc);
+        emitter.mov(RAX, (IData)JitStatus::INVALID_PC);
+        emitter.ret();
+
+        for (const auto &[pc, label] : invalid_targets) {
+            emitter.bind(label);
+            exit_with_invalid_pc(pc);
+        }
+
+        emitter.align(8);
+        emitter.bind(jump_table);
+        for (const auto label : instruction_labels) {
+            emitter.address_of(label);
+        }
+
+        auto code = ExecutableBuffer::create(emitter);
+        if (!code) {
+            return std::unexpected(code.error());
+        }
+        return JitKernel{config, std::move(*code)};
+    }
+
+  private:
+    void exit_with_invalid_pc(IData pc) {
+        emitter.mov(PC, pc);
+        emitter.mov(RAX, (IData)JitStatus::INVALID_PC);
+        emitter.ret();
+    }
+
+    auto label_for(IData pc) -> Label {
+        const auto index = pc - config.base_instructions_address;
+        if (index < program.size()) {
+            return instruction_labels[index];
+        }
+        const auto label = emitter.make_label();
+        invalid_targets.emplace_back(pc, label);
+        return label;
+    }
+
+    void emit_instruction(IData pc, const DecodedInstruction &decoded) {
+        emitter.inc64(INSTRUCTIONS_EXECUTED);
+
+        if (decoded.halt) {
+            emitter.mov(PC, pc);
+            emitter.mov(DONE, 1u);
+            emitter.mov(RAX, (IData)JitStatus::HALTED);
+            emitter.ret();
+        } else if (decoded.scalar_instruction) {
+            emit_scalar(pc, decoded);
+        } else if (decoded.mem_read_enable || decoded.mem_write_enable || (is_shift(decoded.alu_instruction) && uses_rs2(decoded.alu_instruction))) {
+            emit_vector_per_thread(decoded);
+        } else {
+            emit_vector_simd(decoded);
+        }
+    }
+
+    // eax := alu(eax, ecx), clobbers ecx and r11
+    void emit_scalar_alu(AluInstruction instruction, IData pc) {
+        switch (instruction) {
+        case AluInstruction::ADDI:
+        case AluInstruction::ADD:
+        case AluInstruction::JALR: emitter.alu(AluOp::ADD, RAX, RCX); break;
+        case AluInstruction::SUB: emitter.alu(AluOp::SUB, RAX, RCX); break;
+        case AluInstruction::XORI:
+        case AluInstruction::XOR: emitter.alu(AluOp::XOR, RAX, RCX); break;
+        case AluInstruction::ORI:
+        case AluInstruction::OR: emitter.alu(AluOp::OR, RAX, RCX); break;
+        case AluInstruction::ANDI:
+        case AluInstruction::AND: emitter.alu(AluOp::AND, RAX, RCX); break;
+        case AluInstruction::SLTI:
+        case AluInstruction::SLT:
+        case AluInstruction::BLT: compare(Condition::BELOW); break;
+        case AluInstruction::BGE: compare(Condition::ABOVE_OR_EQUAL); break;
+        case AluInstruction::BEQ: compare(Condition::EQUAL); break;
+        case AluInstruction::BNE: compare(Condition::NOT_EQUAL); break;
+        case AluInstruction::SLLI:
+        case AluInstruction::SLL: shift(ShiftOp::SHL); break;
+        case AluInstruction::SRLI:
+        case AluInstruction::SRL:
+        case AluInstruction::SRAI:
+        case AluInstruction::SRA: shift(ShiftOp::SHR); break;
+        case AluInstruction::JAL: emitter.mov(RAX, pc); emitter.alu(AluOp::ADD, RAX, RCX); break;
+        }
+    }
+
+    void compare(Condition condition) {
+        emitter.alu(AluOp::CMP, RAX, RCX);
+        emitter.set_eax(condition);
+    }
+
+    // Shifts by 32 or more give 0 like in the ALU, x86 would only use the low 5 bits of the count
+    void shift(ShiftOp op) {
+        emitter.shift_cl(op, RAX);
+        emitter.alu(AluOp::XOR, R11, R11);
+        emitter.alu(AluOp::CMP, RCX, 32u);
+        emitter.cmov(Condition::ABOVE_OR_EQUAL, RAX, R11);
+    }
+
+    // r9d := memory[eax] or 0 when out of bounds
+    void load() {
+        const auto out_of_bounds = emitter.make_label();
+        emitter.alu(AluOp::XOR, R9, R9);
+        emitter.alu(AluOp::CMP, RAX, MEMORY_SIZE);
+        emitter.jcc(Condition::ABOVE_OR_EQUAL, out_of_bounds);
+        emitter.mov(R9, mem(MEMORY, RAX, 4));
+        emitter.bind(out_of_bounds);
+    }
+
+    // memory[eax] := ecx, dropped when out of bounds
+    void store() {
+        const auto out_of_bounds = emitter.make_label();
+        emitter.alu(AluOp::CMP, RAX, MEMORY_SIZE);
+        emitter.jcc(Condition::ABOVE_OR_EQUAL, out_of_bounds);
+        emitter.mov(mem(MEMORY, RAX, 4), RCX);
+        emitter.bind(out_of_bounds);
+    }
+
+    void load_operands(const Mem &rs1, const Mem &rs2, const DecodedInstruction &decoded) {
+        emitter.mov(RAX, rs1);
+        if (uses_rs2(decoded.alu_instruction)) {
+            emitter.mov(RCX, rs2);
+        } else {
+            emitter.mov(RCX, decoded.immediate);
+        }
+    }
+
+    void emit_scalar(IData pc, const DecodedInstruction &decoded) {
+        const auto rs1 = scalar_register(decoded.rs1);
+        const auto rs2 = scalar_register(decoded.rs2);
+        const auto writes_rd = decoded.reg_write_enable && decoded.rd > 0;
+
+        if (decoded.branch) {
+            load_operands(rs1, rs2, decoded);
+            emit_scalar_alu(decoded.alu_instruction, pc);
+            emitter.alu(AluOp::CMP, RAX, 1u);
+            emitter.jcc(Condition::EQUAL, label_for(pc + decoded.immediate));
+            return;
+        }
+
+        if (decoded.alu_instruction == AluInstruction::JAL) {
+            if (writes_rd) {
+                emitter.mov(scalar_register(decoded.rd), pc + 1);
+            }
+            emitter.jmp(label_for(pc + decoded.immediate));
+            return;
+        }
+
+        if (decoded.alu_instruction == AluInstruction::JALR) {
+            // The target is computed before rd is written as rd may be rs1
+            emitter.mov(RAX, rs1);
+            emitter.alu(AluOp::ADD, RAX, decoded.immediate);
+            if (writes_rd) {
+                emitter.mov(scalar_register(decoded.rd), pc + 1);
+            }
+            emitter.mov(PC, RAX);
+            if (config.base_instructions_address != 0) {
+                emitter.alu(AluOp::SUB, RAX, config.base_instructions_address);
+            }
+            emitter.alu(AluOp::CMP, RAX, (IData)program.size());
+            emitter.jcc(Condition::ABOVE_OR_EQUAL, invalid_pc);
+            emitter.lea(RCX, rip(jump_table));
+            emitter.jmp(mem(RCX, RAX, 8));
+            return;
+        }
+
+        if (decoded.mem_write_enable) {
+            emitter.mov(RAX, rs1);
+            emitter.alu(AluOp::ADD, RAX, decoded.immediate);
+            emitter.mov(RCX, rs2);
+            store();
+        }
+
+        if (!writes_rd) {
+            return;
+        }
+
+        switch (decoded.reg_input_mux) {
+        case RegInputMux::ALU_OUT:
+            load_operands(rs1, rs2, decoded);
+            emit_scalar_alu(decoded.alu_instruction, pc);
+            emitter.mov(scalar_register(decoded.rd), RAX);
+            break;
+        case RegInputMux::LSU_OUT:
+            emitter.mov(RAX, rs1);
+            emitter.alu(AluOp::ADD, RAX, decoded.immediate);
+            load();
+            emitter.mov(scalar_register(decoded.rd), R9);
+            break;
+        case RegInputMux::IMMEDIATE: emitter.mov(scalar_register(decoded.rd), decoded.immediate); break;
+        case RegInputMux::PC_PLUS_1: emitter.mov(scalar_register(decoded.rd), pc + 1); break;
+        case RegInputMux::VECTOR_TO_SCALAR: break;
+        }
+    }
+
+    // Loads, stores and shifts by a register, one thread at a time
+    void emit_vector_per_thread(const DecodedInstruction &decoded) {
+        const auto writes_rd = decoded.reg_write_enable && decoded.rd >= WarpState::FIRST_WRITABLE_VECTOR_REG;
+        if (!writes_rd && !decoded.mem_write_enable) {
+            return;
+        }
+
+        emitter.mov(R8, scalar_register(WarpState::EXECUTION_MASK_REG));
+        for (auto thread = 0u; thread < config.threads_per_warp; thread++) {
+            const auto masked_out = emitter.make_label();
+            emitter.test(R8, 1u << thread);
+            emitter.jcc(Condition::EQUAL, masked_out);
+
+            if (decoded.mem_write_enable) {
+                emitter.mov(RAX, vector_register(decoded.rs1, thread));
+                emitter.alu(AluOp::ADD, RAX, decoded.immediate);
+                emitter.mov(RCX, vector_register(decoded.rs2, thread));
+                store();
+            }
+
+            if (writes_rd) {
+                switch (decoded.reg_input_mux) {
+                case RegInputMux::ALU_OUT:
+                    load_operands(vector_register(decoded.rs1, thread), vector_register(decoded.rs2, thread), decoded);
+                    emit_scalar_alu(decoded.alu_instruction, 0);
+                    emitter.mov(vector_register(decoded.rd, thread), RAX);
+                    break;
+                case RegInputMux::LSU_OUT:
+                    emitter.mov(RAX, vector_register(decoded.rs1, thread));
+                    emitter.alu(AluOp::ADD, RAX, decoded.immediate);
+                    load();
+                    emitter.mov(vector_register(decoded.rd, thread), R9);
+                    break;
+                case RegInputMux::IMMEDIATE: emitter.mov(vector_register(decoded.rd, thread), decoded.immediate); break;
+                case RegInputMux::PC_PLUS_1:
+                case RegInputMux::VECTOR_TO_SCALAR: break;
+                }
+            }
+
+            emitter.bind(masked_out);
+        }
+    }
+
+    // xmm0 := alu(xmm0, xmm1), clobbers xmm1
+    void emit_simd_alu(const DecodedInstruction &decoded) {
+        switch (decoded.alu_instruction) {
+        case AluInstruction::ADDI:
+        case AluInstruction::ADD: emitter.sse(SseOp::PADDD, XMM0, XMM1); break;
+        case AluInstruction::SUB: emitter.sse(SseOp::PSUBD, XMM0, XMM1); break;
+        case AluInstruction::XORI:
+        case AluInstruction::XOR: emitter.sse(SseOp::PXOR, XMM0, XMM1); break;
+        case AluInstruction::ORI:
+        case AluInstruction::OR: emitter.sse(SseOp::POR, XMM0, XMM1); break;
+        case AluInstruction::ANDI:
+        case AluInstruction::AND: emitter.sse(SseOp::PAND, XMM0, XMM1); break;
+        case AluInstruction::SLTI:
+        case AluInstruction::SLT:
+        case AluInstruction::BLT: simd_less_than(false); break;
+        case AluInstruction::BGE: simd_less_than(true); break;
+        case AluInstruction::BEQ:
+        case AluInstruction::BNE:
+            emitter.sse(SseOp::PCMPEQD, XMM0, XMM1);
+            if (decoded.alu_instruction == AluInstruction::BNE) {
+                emitter.sse(SseOp::PXOR, XMM0, rip(all_ones));
+            }
+            emitter.psrld(XMM0, 31);
+            break;
+        case AluInstruction::SLLI:
+        case AluInstruction::SRLI:
+        case AluInstruction::SRAI:
+            if (decoded.immediate >= 32u) {
+                emitter.sse(SseOp::PXOR, XMM0, XMM0);
+            } else if (decoded.alu_instruction == AluInstruction::SLLI) {
+                emitter.pslld(XMM0, (uint8_t)decoded.immediate);
+            } else {
+                emitter.psrld(XMM0, (uint8_t)decoded.immediate);
+            }
+            break;
+        // Handled per thread or never vector instructions
+        case AluInstruction::SLL:
+        case AluInstruction::SRL:
+        case AluInstruction::SRA:
+        case AluInstruction::JAL:
+        case AluInstruction::JALR: break;
+        }
+    }
+
+    // Unsigned comparison, SSE2 only compares signed integers so the sign bits are flipped first
+    void simd_less_than(bool negate) {
+        emitter.sse(SseOp::PXOR, XMM0, rip(sign_bits));
+        emitter.sse(SseOp::PXOR, XMM1, rip(sign_bits));
+        emitter.sse(SseOp::PCMPGTD, XMM1, XMM0);
+        emitter.movdqa(XMM0, XMM1);
+        if (negate) {
+            emitter.sse(SseOp::PXOR, XMM0, rip(all_ones));
+        }
+        emitter.psrld(XMM0, 31);
+    }
+
+    void emit_vector_simd(const DecodedInstruction &decoded) {
+        const auto writes_rd = decoded.reg_write_enable && decoded.rd >= WarpState::FIRST_WRITABLE_VECTOR_REG &&
+                               (decoded.reg_input_mux == RegInputMux::ALU_OUT || decoded.reg_input_mux == RegInputMux::IMMEDIATE);
+        const auto writes_scalar = decoded.reg_input_mux == RegInputMux::VECTOR_TO_SCALAR && decoded.rd > 0;
+        if (!writes_rd && !writes_scalar) {
+            return;
+        }
+
+        // xmm5 := s1 in every lane, xmm4 := immediate in every lane
+        emitter.mov(RAX, scalar_register(WarpState::EXECUTION_MASK_REG));
+        emitter.movd(XMM5, RAX);
+        emitter.pshufd(XMM5, XMM5, 0);
+        emitter.mov(RAX, decoded.immediate);
+        emitter.movd(XMM4, RAX);
+        emitter.pshufd(XMM4, XMM4, 0);
+        if (writes_scalar) {
+            emitter.alu(AluOp::XOR, R10, R10);
+        }
+
+        for (auto group = 0u; group < config.threads_per_warp / 4; group++) {
+            const auto thread = group * 4;
+
+            // xmm7 := all ones in the lanes of enabled threads
+            emitter.movdqa(XMM7, XMM5);
+            emitter.sse(SseOp::PAND, XMM7, rip(thread_bits[group]));
+            emitter.sse(SseOp::PCMPEQD, XMM7, rip(thread_bits[group]));
+
+            if (decoded.reg_input_mux == RegInputMux::IMMEDIATE) {
+                emitter.movdqa(XMM0, XMM4);
+            } else {
+                emitter.movdqu(XMM0, vector_register(decoded.rs1, thread));
+                if (uses_rs2(decoded.alu_instruction)) {
+                    emitter.movdqu(XMM1, vector_register(decoded.rs2, thread));
+                } else {
+                    emitter.movdqa(XMM1, XMM4);
+                }
+                emit_simd_alu(decoded);
+            }
+
+            if (writes_scalar) {
+                // Bit 0 of every enabled lane goes to bit `thread` of the scalar register
+                emitter.pslld(XMM0, 31);
+                emitter.sse(SseOp::PAND, XMM0, XMM7);
+                emitter.movmskps(RAX, XMM0);
+                if (thread > 0) {
+                    emitter.shift(ShiftOp::SHL, RAX, (uint8_t)thread);
+                }
+                emitter.alu(AluOp::OR, R10, RAX);
+            } else {
+                // rd := enabled ? xmm0 : rd
+                emitter.movdqu(XMM2, vector_register(decoded.rd, thread));
+                emitter.sse(SseOp::PAND, XMM0, XMM7);
+                emitter.sse(SseOp::PANDN, XMM7, XMM2);
+                emitter.sse(SseOp::POR, XMM0, XMM7);
+                emitter.movdqu(vector_register(decoded.rd, thread), XMM0);
+            }
+        }
+
+        if (writes_scalar) {
+            emitter.mov(scalar_register(decoded.rd), R10);
+        }
+    }
+
+    ExecutorConfig config;
+    std::span<const IData> program;
+    Emitter emitter{};
+    std::vector<Label> instruction_labels{};
+    std::vector<std::pair<IData, Label>> invalid_targets{};
+    std::vector<Label> thread_bits{};
+    Label jump_table{};
+    Label invalid_pc{};
+    Label sign_bits{};
+    Label all_ones{};
+};
+
+} // namespace jit_detail
+
+// Translates `program` (placed at config.base_instructions_address) into native code
+inline auto jit_compile(const ExecutorConfig &config, std::span<const IData> program) -> std::expected<JitKernel, Error> {
+    return jit_detail::Compiler{config, program}.compile();
+}
+
+} // namespace sim
@@ -0,0 +1,291 @@
+#pragma once
+#include "mapped_file.hpp"
+#include "verilated.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sim {
+
+// Kernel object format
+//
+// An assembled kernel, written by smol-as and loaded by the simulator without going through the assembler.
+// Every field is a 32-bit word in host byte order, the sections follow each other in this order:
+//   KernelObjectHeader
+//   instructions   num_instructions words
+//   symbols        num_symbols KernelObjectSymbol
+//   relocations    num_relocations KernelObjectRelocation
+//   source lines   num_source_lines words, the source line of every instruction (none at all or one per instruction)
+//   string table   string_table_size bytes with the symbol names
+//
+// Objects assembled from a module (smol-as --relocatable) have the RELOCATABLE flag set. Their instructions are
+// numbered from 0, their symbols include the labels they use without defining, and the relocations say which
+// instructions have to be patched once the linker (aslib/linker.hpp) knows where every symbol ends up. The simulator
+// only runs linked kernels.
+
+constexpr auto KERNEL_OBJECT_MAGIC = std::array<char, 8>{'S', 'M', 'O', 'L', 'K', 'O', 'B', 'J'};
+constexpr auto KERNEL_OBJECT_VERSION = std::uint32_t{2};
+constexpr auto KERNEL_OBJECT_RELOCATABLE = std::uint32_t{1};
+
+struct KernelObjectHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t num_blocks;
+    std::uint32_t num_warps_per_block;
+    std::uint32_t base_instructions_address;
+    std::uint32_t base_data_address;
+    std::uint32_t num_instructions;
+    std::uint32_t num_symbols;
+    std::uint32_t num_source_lines;
+    std::uint32_t string_table_size;
+    std::uint32_t flags;
+    std::uint32_t num_relocations;
+};
+
+enum class SymbolBinding : std::uint32_t {
+    LOCAL,     // Only visible inside the object
+    GLOBAL,    // Exported with .global, other objects can refer to it
+    UNDEFINED, // Used by the object and defined by another one, the instruction is meaningless
+};
+
+struct KernelObjectSymbol {
+    std::uint32_t name_offset; // Into the string table
+    std::uint32_t name_size;
+    std::uint32_t instruction;
+    SymbolBinding binding;
+};
+
+enum class RelocationType : std::uint32_t {
+    BRANCH,   // 12-bit offset of a branch, relative to the instruction
+    JUMP,     // 20-bit offset of jal, relative to the instruction
+    ABSOLUTE, // 12-bit immediate of jalr, the address of the symbol
+};
+
+struct KernelObjectRelocation {
+    std::uint32_t instruction;
+    RelocationType type;
+    std::uint32_t symbol; // Index into the symbols
+};
+
+static_assert(std::is_trivially_copyable_v<KernelObjectHeader> && sizeof(KernelObjectHeader) % sizeof(IData) == 0);
+static_assert(std::is_trivially_copyable_v<KernelObjectSymbol> && sizeof(KernelObjectSymbol) % sizeof(IData) == 0);
+static_assert(std::is_trivially_copyable_v<KernelObjectRelocation> &&
+              sizeof(KernelObjectRelocation) % sizeof(IData) == 0);
+
+// Everything that goes into a kernel object
+struct KernelObjectContents {
+    IData num_blocks = 1;
+    IData num_warps_per_block = 1;
+    IData base_instructions_address = 0;
+    IData base_data_address = 0;
+    std::vector<IData> instructions;
+    std::vector<std::pair<std::string, IData>> symbols; // Name and the instruction it points to
+    std::vector<std::uint32_t> source_lines;            // Empty or one per instruction
+    bool relocatable = false;
+    std::vector<SymbolBinding> bindings;                // Empty when every symbol is local, or one per symbol
+    std::vector<KernelObjectRelocation> relocations;
+};
+
+inline auto write_kernel_object(const std::filesystem::path &path, const KernelObjectContents &contents)
+    -> std::expected<void, std::string> {
+    if (!contents.source_lines.empty() && contents.source_lines.size() != contents.instructions.size()) {
+        return std::unexpected{std::string{"Expected a source line for every instruction"}};
+    }
+    if (!contents.bindings.empty() && contents.bindings.size() != contents.symbols.size()) {
+        return std::unexpected{std::string{"Expected a binding for every symbol"}};
+    }
+    for (const auto &relocation : contents.relocations) {
+        if (relocation.instruction >= contents.instructions.size() || relocation.symbol >= contents.symbols.size()) {
+            return std::unexpected{std::string{"Relocation out of range"}};
+        }
+    }
+
+    auto symbols = std::vector<KernelObjectSymbol>{};
+    auto string_table = std::string{};
+    for (auto i = 0u; i < contents.symbols.size(); i++) {
+        const auto &[name, instruction] = contents.symbols[i];
+        symbols.push_back({.name_offset = (std::uint32_t)string_table.size(),
+                           .name_size = (std::uint32_t)name.size(),
+                           .instruction = instruction,
+                           .binding = contents.bindings.empty() ? SymbolBinding::LOCAL : contents.bindings[i]});
+        string_table += name;
+    }
+
+    const auto header = KernelObjectHeader{
+        .magic = KERNEL_OBJECT_MAGIC,
+        .version = KERNEL_OBJECT_VERSION,
+        .num_blocks = contents.num_blocks,
+        .num_warps_per_block = contents.num_warps_per_block,
+        .base_instructions_address = contents.base_instructions_address,
+        .base_data_address = contents.base_data_address,
+        .num_instructions = (std::uint32_t)contents.instructions.size(),
+        .num_symbols = (std::uint32_t)symbols.size(),
+        .num_source_lines = (std::uint32_t)contents.source_lines.size(),
+        .string_table_size = (std::uint32_t)string_table.size(),
+        .flags = contents.relocatable ? KERNEL_OBJECT_RELOCATABLE : 0u,
+        .num_relocations = (std::uint32_t)contents.relocations.size(),
+    };
+
+    auto file = std::ofstream{path, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+        return std::unexpected{std::format("Failed to open file: {}", path.c_str())};
+    }
+    auto write = [&](const void *data, std::size_t size) { file.write(static_cast<const char *>(data), (std::streamsize)size); };
+    write(&header, sizeof(header));
+    write(contents.instructions.data(), contents.instructions.size() * sizeof(IData));
+    write(symbols.data(), symbols.size() * sizeof(KernelObjectSymbol));
+    write(contents.relocations.data(), contents.relocations.size() * sizeof(KernelObjectRelocation));
+    write(contents.source_lines.data(), contents.source_lines.size() * sizeof(std::uint32_t));
+    write(string_table.data(), string_table.size());
+
+    if (!file.good()) {
+        return std::unexpected{std::format("Failed to write file: {}", path.c_str())};
+    }
+    return {};
+}
+
+// A kernel object mapped into memory, the sections are used in place
+class KernelObject {
+  public:
+    static auto load(const std::filesystem::path &path) -> std::expected<KernelObject, std::string> {
+        auto file = MappedFile::open(path);
+        if (!file) {
+            return std::unexpected{std::move(file.error())};
+        }
+
+        const auto bytes = file->bytes();
+        auto header = KernelObjectHeader{};
+        if (bytes.size() < sizeof(header)) {
+            return std::unexpected{std::format("Not a kernel object: {}", path.c_str())};
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (header.magic != KERNEL_OBJECT_MAGIC) {
+            return std::unexpected{std::format("Not a kernel object: {}", path.c_str())};
+        }
+        if (header.version != KERNEL_OBJECT_VERSION) {
+            return std::unexpected{std::format("Unsupported kernel object version {}, expected {}: {}", header.version,
+                                               KERNEL_OBJECT_VERSION, path.c_str())};
+        }
+        if (header.num_source_lines != 0 && header.num_source_lines != header.num_instructions) {
+            return std::unexpected{std::format("Malformed kernel object: {}", path.c_str())};
+        }
+
+        const auto expected_size = sizeof(header) + (std::size_t)header.num_instructions * sizeof(IData) +
+                                   (std::size_t)header.num_symbols * sizeof(KernelObjectSymbol) +
+                                   (std::size_t)header.num_relocations * sizeof(KernelObjectRelocation) +
+                                   (std::size_t)header.num_source_lines * sizeof(std::uint32_t) + header.string_table_size;
+        if (bytes.size() != expected_size) {
+            return std::unexpected{std::format("Truncated kernel object: {}", path.c_str())};
+        }
+
+        auto object = KernelObject{std::move(*file), header};
+        for (const auto &symbol : object.symbols()) {
+            if ((std::size_t)symbol.name_offset + symbol.name_size > header.string_table_size ||
+                symbol.binding > SymbolBinding::UNDEFINED) {
+                return std::unexpected{std::format("Malformed kernel object: {}", path.c_str())};
+            }
+        }
+        for (const auto &relocation : object.relocations()) {
+            if (relocation.instruction >= header.num_instructions || relocation.symbol >= header.num_symbols ||
+                relocation.type > RelocationType::ABSOLUTE) {
+                return std::unexpected{std::format("Malformed kernel object: {}", path.c_str())};
+            }
+        }
+        return object;
+    }
+
+    // Only looks at the magic, for telling kernel objects and assembly sources apart
+    static auto is_kernel_object(const std::filesystem::path &path) -> bool {
+        auto file = std::ifstream{path, std::ios::binary};
+        auto magic = std::array<char, KERNEL_OBJECT_MAGIC.size()>{};
+        return file.read(magic.data(), magic.size()) && magic == KERNEL_OBJECT_MAGIC;
+    }
+
+    [[nodiscard]] auto header() const -> const KernelObjectHeader & { return object_header; }
+
+    [[nodiscard]] auto is_relocatable() const -> bool {
+        return (object_header.flags & KERNEL_OBJECT_RELOCATABLE) != 0;
+    }
+
+    [[nodiscard]] auto instructions() const -> std::span<const IData> {
+        return {section<IData>(0), object_header.num_instructions};
+    }
+
+    [[nodiscard]] auto symbols() const -> std::span<const KernelObjectSymbol> {
+        return {section<KernelObjectSymbol>(instructions().size_bytes()), object_header.num_symbols};
+    }
+
+    [[nodiscard]] auto relocations() const -> std::span<const KernelObjectRelocation> {
+        return {section<KernelObjectRelocation>(instructions().size_bytes() + symbols().size_bytes()),
+                object_header.num_relocations};
+    }
+
+    [[nodiscard]] auto source_lines() const -> std::span<const std::uint32_t> {
+        return {section<std::uint32_t>(instructions().size_bytes() + symbols().size_bytes() +
+                                       relocations().size_bytes()),
+                object_header.num_source_lines};
+    }
+
+    [[nodiscard]] auto symbol_name(const KernelObjectSymbol &symbol) const -> std::string_view {
+        const auto offset = instructions().size_bytes() + symbols().size_bytes() + relocations().size_bytes() +
+                            source_lines().size_bytes();
+        return std::string_view{section<char>(offset), object_header.string_table_size}.substr(symbol.name_offset,
+                                                                                             symbol.name_size);
+    }
+
+    // Copies the instructions into anything indexable by address (InstructionMemory, a map...) at the base address
+    template <typename Memory> void load_instructions(Memory &memory) const {
+        const auto program = instructions();
+        for (auto i = 0u; i < program.size(); i++) {
+            memory[object_header.base_instructions_address + i] = program[i];
+        }
+    }
+
+    // Copies everything out of the mapping
+    [[nodiscard]] auto contents() const -> KernelObjectContents {
+        auto contents = KernelObjectContents{
+            .num_blocks = object_header.num_blocks,
+            .num_warps_per_block = object_header.num_warps_per_block,
+            .base_instructions_address = object_header.base_instructions_address,
+            .base_data_address = object_header.base_data_address,
+            .instructions = {instructions().begin(), instructions().end()},
+            .symbols = {},
+            .source_lines = {source_lines().begin(), source_lines().end()},
+            .relocatable = is_relocatable(),
+            .bindings = {},
+            .relocations = {relocations().begin(), relocations().end()},
+        };
+        const auto all_local = std::ranges::all_of(
+            symbols(), [](const auto &symbol) { return symbol.binding == SymbolBinding::LOCAL; });
+        for (const auto &symbol : symbols()) {
+            contents.symbols.emplace_back(std::string{symbol_name(symbol)}, symbol.instruction);
+            if (!all_local) {
+                contents.bindings.push_back(symbol.binding);
+            }
+        }
+        return contents;
+    }
+
+  private:
+    KernelObject(MappedFile &&file, const KernelObjectHeader &header) : file(std::move(file)), object_header(header) {}
+
+    // Every section starts on a word boundary of the page aligned mapping
+    template <typename T> [[nodiscard]] auto section(std::size_t offset) const -> const T * {
+        return reinterpret_cast<const T *>(file.bytes().data() + sizeof(KernelObjectHeader) + offset);
+    }
+
+    MappedFile file;
+    KernelObjectHeader object_header;
+};
+
+} // namespace sim
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <expected>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace sim {
+
+// Read-only mapping of a whole regular file
+class MappedFile {
+  public:
+    static auto open(const std::filesystem::path &path) -> std::expected<MappedFile, std::string> {
+        const auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return std::unexpected{std::format("Failed to open file: {}", path.c_str())};
+        }
+
+        struct stat info {};
+        // Some regular files report a size of 0 (procfs...), those can't be mapped either
+        if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0) {
+            ::close(fd);
+            return std::unexpected{std::format("Can't map file: {}", path.c_str())};
+        }
+
+        const auto size = static_cast<std::size_t>(info.st_size);
+        auto *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            return std::unexpected{std::format("Failed to map file: {}", path.c_str())};
+        }
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+        auto file = MappedFile{};
+        file.mapping = mapping;
+        file.size = size;
+        return file;
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+    MappedFile(MappedFile &&other) noexcept
+        : mapping(std::exchange(other.mapping, nullptr)), size(std::exchange(other.size, 0)) {}
+    auto operator=(MappedFile &&other) noexcept -> MappedFile & {
+        if (this != &other) {
+            unmap();
+            mapping = std::exchange(other.mapping, nullptr);
+            size = std::exchange(other.size, 0);
+        }
+        return *this;
+    }
+    ~MappedFile() { unmap(); }
+
+    [[nodiscard]] auto bytes() const -> std::span<const std::byte> {
+        return {static_cast<const std::byte *>(mapping), size};
+    }
+    [[nodiscard]] auto view() const -> std::string_view { return {static_cast<const char *>(mapping), size}; }
+
+  private:
+    MappedFile() = default;
+
+    void unmap() {
+        if (mapping != nullptr) {
+            ::munmap(mapping, size);
+            mapping = nullptr;
+            size = 0;
+        }
+    }
+
+    void *mapping = nullptr;
+    std::size_t size = 0;
+};
+
+} // namespace sim
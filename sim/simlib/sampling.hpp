@@ -0,0 +1,199 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <span>
+#include "Vgpu.h"
+#include "Vgpu_gpu.h"
+#include "executor.hpp"
+#include "sim.hpp"
+
+namespace sim {
+
+// Sampled simulation
+//
+// The functional executor (executor.hpp) fast-forwards a kernel to a point of interest, then the architectural
+// state is injected into the verilated GPU which continues cycle-accurately from there.
+// Injection happens through the state_inject port of gpu.sv: with state_inject_hold set, every core that gets a block
+// waits in `waiting_for_state` until it receives the PCs and registers of that block and a release command.
+
+// Mirrors inject_target_t in src/common/common.sv
+enum class InjectTarget : QData {
+    NONE,
+    PC,
+    SCALAR_REG,
+    VECTOR_REG,
+    WARP_DONE,
+    RELEASE
+};
+
+// Packs a state_inject_t (see src/common/common.sv)
+constexpr auto make_state_inject(InjectTarget target, IData core, IData warp = 0, IData thread = 0,
+                                 IData register_address = 0, IData data = 0) -> QData {
+    return ((QData)target << 61u) | ((QData)(core & 0xFFu) << 53u) | ((QData)(warp & 0xFFu) << 45u) |
+           ((QData)(thread & 0xFFu) << 37u) | ((QData)(register_address & 0x1Fu) << 32u) | (QData)data;
+}
+
+// Drives the state_inject port, one command per cycle
+class StateInjector {
+  public:
+    explicit StateInjector(const Executor &executor) : executor(executor) {}
+
+    // Call once per cycle, after the memories have been processed and before the clock edge
+    void process(Vgpu &top) {
+        if (pending.empty()) {
+            for (auto core = 0u; core < (IData)Vgpu_gpu::NUM_CORES; core++) {
+                if ((top.core_waiting_for_state >> core) & 1u) {
+                    push_block(core, top.dispatched_block_id[core]);
+                    break;
+                }
+            }
+        }
+
+        if (pending.empty()) {
+            top.state_inject = make_state_inject(InjectTarget::NONE, 0);
+            return;
+        }
+
+        top.state_inject = pending.front();
+        pending.pop_front();
+        injection_cycles++;
+    }
+
+    [[nodiscard]] auto get_injection_cycles() const -> uint64_t { return injection_cycles; }
+
+  private:
+    void push_block(IData core, IData block_id) {
+        const auto blocks = executor.get_blocks();
+        // Blocks the executor doesn't know about are released with their reset state
+        if (block_id < blocks.size()) {
+            const auto &block = blocks[block_id];
+            for (auto warp_id = 0u; warp_id < block.warps.size(); warp_id++) {
+                push_warp(core, warp_id, block.warps[warp_id]);
+            }
+        }
+        pending.push_back(make_state_inject(InjectTarget::RELEASE, core));
+    }
+
+    void push_warp(IData core, IData warp_id, const WarpState &warp) {
+        if (warp.done) {
+            pending.push_back(make_state_inject(InjectTarget::WARP_DONE, core, warp_id));
+            return;
+        }
+
+        pending.push_back(make_state_inject(InjectTarget::PC, core, warp_id, 0, 0, warp.pc));
+
+        // Only registers that differ from their reset value are injected
+        for (auto reg = 1u; reg < WarpState::NUM_REGISTERS; reg++) {
+            const auto reset_value = reg == WarpState::EXECUTION_MASK_REG ? ~IData{0} : IData{0};
+            if (warp.scalar_registers[reg] != reset_value) {
+                pending.push_back(make_state_inject(InjectTarget::SCALAR_REG, core, warp_id, 0, reg, warp.scalar_registers[reg]));
+            }
+        }
+
+        for (auto thread = 0u; thread < warp.vector_registers.size(); thread++) {
+            for (auto reg = WarpState::FIRST_WRITABLE_VECTOR_REG; reg < WarpState::NUM_REGISTERS; reg++) {
+                if (warp.vector_registers[thread][reg] != 0) {
+                    pending.push_back(make_state_inject(InjectTarget::VECTOR_REG, core, warp_id, thread, reg,
+                                                        warp.vector_registers[thread][reg]));
+                }
+            }
+        }
+    }
+
+    const Executor &executor;
+    std::deque<QData> pending{};
+    uint64_t injection_cycles = 0u;
+};
+
+struct SampledSimulationResult {
+    bool done{};
+    uint64_t cycles{};                 // Including the cycles spent injecting state
+    uint64_t injection_cycles{};
+    uint64_t instructions_fetched{};
+};
+
+// Runs the RTL starting from the state of `fast_forwarded`, the data memory is replaced with the executor's memory
+// Stops after max_num_cycles even if the kernel is not done, which is how a detailed window is simulated.
+// Cycles spent injecting state don't count towards max_num_cycles.
+template <uint32_t num_channels>
+auto simulate_sampled(Vgpu &top, InstructionMemory<num_channels> &instruction_mem, DataMemory<num_channels> &data_mem,
+                      const Executor &fast_forwarded, uint32_t max_num_cycles) -> SampledSimulationResult {
+    auto injector = StateInjector{fast_forwarded};
+    auto result = SampledSimulationResult{};
+    const auto fetched_before = instruction_mem.reads_served;
+
+    data_mem.memory = fast_forwarded.get_memory();
+    top.state_inject_hold = 1;
+    top.execution_start = 1;
+
+    while (result.cycles - injector.get_injection_cycles() < max_num_cycles) {
+        top.eval();
+
+        if (top.execution_done) {
+            result.done = true;
+            break;
+        }
+
+        instruction_mem.process();
+        data_mem.process();
+        injector.process(top);
+
+        top.eval();
+
+        tick(top);
+        result.cycles++;
+    }
+
+    result.injection_cycles = injector.get_injection_cycles();
+    result.instructions_fetched = instruction_mem.reads_served - fetched_before;
+    return result;
+}
+
+struct SamplingConfig {
+    uint64_t period = 1000;      // Instructions per warp executed functionally between two samples
+    uint32_t window_cycles = 500; // Cycles simulated in detail for every sample
+};
+
+struct SamplingEstimate {
+    uint64_t num_samples{};
+    uint64_t total_instructions{};   // Warp instructions executed by the whole kernel (exact)
+    uint64_t sampled_cycles{};       // Detailed cycles, not counting state injection
+    uint64_t sampled_instructions{};
+    double estimated_cycles{};
+};
+
+// Periodic sampling: every `period` instructions the functional state is copied into a fresh GPU which runs
+// for `window_cycles`. The measured throughput is extrapolated to the whole kernel.
+template <uint32_t num_channels>
+auto estimate_cycles(const ExecutorConfig &config, std::span<const IData> program, const data_memory_container_t &data,
+                     const SamplingConfig &sampling) -> SamplingEstimate {
+    auto executor = Executor{config, program, data};
+    auto estimate = SamplingEstimate{};
+
+    for (auto sample = 0u; !executor.done(); sample++) {
+        auto top = std::make_unique<Vgpu>();
+        auto instruction_mem = make_instruction_memory<num_channels>(top.get());
+        auto data_mem = make_data_memory<num_channels>(top.get());
+        for (auto i = 0u; i < program.size(); i++) {
+            instruction_mem.memory[config.base_instructions_address + i] = program[i];
+        }
+        set_kernel_config(*top, config.base_instructions_address, config.base_data_address, config.num_blocks,
+                          config.num_warps_per_block);
+
+        const auto result = simulate_sampled(*top, instruction_mem, data_mem, executor, sampling.window_cycles);
+        estimate.num_samples++;
+        estimate.sampled_cycles += result.cycles - result.injection_cycles;
+        estimate.sampled_instructions += result.instructions_fetched;
+
+        executor.run(StopCondition{.max_instructions_per_warp = (sample + 1) * sampling.period, .marker_pc = {}});
+    }
+
+    estimate.total_instructions = executor.instructions_executed();
+    if (estimate.sampled_instructions > 0) {
+        const auto cycles_per_instruction = (double)estimate.sampled_cycles / (double)estimate.sampled_instructions;
+        estimate.estimated_cycles = cycles_per_instruction * (double)estimate.total_instructions;
+    }
+    return estimate;
+}
+
+} // namespace sim
@@ -1,6 +1,7 @@
 #pragma once
 #include <print>
 #include <array>
+#include <optional>
 #include "Vgpu.h"
 #include "instructions.hpp"
 
@@ -50,6 +51,7 @@ struct InstructionMemory {
                     std::println(stderr, "Error: Read out of bounds {}", addr);
                 }
                 set_bit(*instruction_mem_read_ready, (int)i, true);
+                reads_served++;
             } else {
                 set_bit(*instruction_mem_read_ready, (int)i, false);
             }
@@ -74,6 +76,7 @@ struct InstructionMemory {
     }
 
     uint32_t stack_ptr = 0u;
+    uint64_t reads_served = 0u; // Every fetch is served in exactly one cycle, so this is the number of fetched instructions
 };
 
 
@@ -189,15 +192,16 @@ constexpr void set_kernel_config(Vgpu& top, IData base_instructions_address, IDa
     kernel_config[0] = num_warps_per_block;
 }
 
+// Returns the number of cycles the kernel took, std::nullopt if it didn't finish in max_num_cycles
 template <uint32_t num_channels>
-bool simulate(Vgpu& top, InstructionMemory<num_channels>& instruction_mem, DataMemory<num_channels>& data_mem, uint32_t max_num_cycles) {
+auto simulate_cycles(Vgpu& top, InstructionMemory<num_channels>& instruction_mem, DataMemory<num_channels>& data_mem, uint32_t max_num_cycles) -> std::optional<uint32_t> {
     top.execution_start = 1;
 
     for (auto cycle = 0u; cycle < max_num_cycles; ++cycle) {
         top.eval();
 
         if (top.execution_done) {
-            return true;
+            return cycle;
         }
 
         instruction_mem.process();
@@ -207,7 +211,12 @@ bool simulate(Vgpu& top, InstructionMemory<num_channels>& instruction_mem, DataM
 
         tick(top);
     }
-    return false;
+    return std::nullopt;
+}
+
+template <uint32_t num_channels>
+bool simulate(Vgpu& top, InstructionMemory<num_channels>& instruction_mem, DataMemory<num_channels>& data_mem, uint32_t max_num_cycles) {
+    return simulate_cycles(top, instruction_mem, data_mem, max_num_cycles).has_value();
 }
 
 } // namespace sim
@@ -0,0 +1,268 @@
+#pragma once
+#include "executor.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sim {
+
+// Approximate timing model
+//
+// Estimates the cycle count of a kernel without running Verilator: the functional executor records what every warp
+// executes and a simple event driven model replays those traces with a fixed cost for every step of the
+// warp state machine in compute_core.sv, the instruction fetch latency and the contention on the data memory channels
+// of mem_controller.sv.
+// The costs are parameters that are fitted against the RTL, see sim/calibrate.cpp.
+
+struct TimingParameters {
+    std::uint32_t fetch_cycles = 5;      // FETCH: fetcher request until the instruction arrives
+    std::uint32_t issue_cycles = 2;      // DECODE + REQUEST
+    std::uint32_t alu_wait_cycles = 1;   // WAIT for an instruction that doesn't touch memory
+    std::uint32_t retire_cycles = 2;     // EXECUTE + UPDATE
+    std::uint32_t memory_latency = 6;    // LSU request until the data is back, without contention
+    std::uint32_t channel_occupancy = 7; // How long a single request keeps a data memory channel busy
+    std::uint32_t dispatch_cycles = 3;   // Dispatcher handing a block to a free core
+    std::uint32_t drain_cycles = 2;      // Last warp done until execution_done is raised
+};
+
+using TimingParameter = std::pair<std::string_view, std::uint32_t TimingParameters::*>;
+constexpr auto TIMING_PARAMETERS = std::array{
+    TimingParameter{"fetch_cycles", &TimingParameters::fetch_cycles},
+    TimingParameter{"issue_cycles", &TimingParameters::issue_cycles},
+    TimingParameter{"alu_wait_cycles", &TimingParameters::alu_wait_cycles},
+    TimingParameter{"retire_cycles", &TimingParameters::retire_cycles},
+    TimingParameter{"memory_latency", &TimingParameters::memory_latency},
+    TimingParameter{"channel_occupancy", &TimingParameters::channel_occupancy},
+    TimingParameter{"dispatch_cycles", &TimingParameters::dispatch_cycles},
+    TimingParameter{"drain_cycles", &TimingParameters::drain_cycles},
+};
+
+// Parameter files hold one `name value` pair per line, written by calibrate and read by the simulator's --model.
+// Parameters that aren't in the file keep their defaults.
+inline auto write_timing_parameters(const std::filesystem::path &path, const TimingParameters &parameters)
+    -> std::expected<void, std::string> {
+    auto file = std::ofstream{path};
+    if (!file.is_open()) {
+        return std::unexpected{std::format("Failed to open file: {}", path.c_str())};
+    }
+    for (const auto &[name, field] : TIMING_PARAMETERS) {
+        file << std::format("{} {}\n", name, parameters.*field);
+    }
+    if (!file.good()) {
+        return std::unexpected{std::format("Failed to write file: {}", path.c_str())};
+    }
+    return {};
+}
+
+inline auto read_timing_parameters(const std::filesystem::path &path) -> std::expected<TimingParameters, std::string> {
+    auto file = std::ifstream{path};
+    if (!file.is_open()) {
+        return std::unexpected{std::format("Failed to open file: {}", path.c_str())};
+    }
+
+    auto parameters = TimingParameters{};
+    auto line = std::string{};
+    for (auto line_number = 1u; std::getline(file, line); line_number++) {
+        auto stream = std::istringstream{line};
+        auto name = std::string{};
+        auto value = std::int64_t{};
+        if (!(stream >> name)) {
+            continue; // Empty line
+        }
+        const auto parameter = std::ranges::find(TIMING_PARAMETERS, name, &TimingParameter::first);
+        if (parameter == TIMING_PARAMETERS.end()) {
+            return std::unexpected{std::format("{}:{}: Unknown timing parameter '{}'", path.c_str(), line_number, name)};
+        }
+        auto rest = std::string{};
+        if (!(stream >> value) || value < 0 || value > std::numeric_limits<std::uint32_t>::max() || (stream >> rest)) {
+            return std::unexpected{std::format("{}:{}: Expected a cycle count after '{}'", path.c_str(), line_number, name)};
+        }
+        parameters.*(parameter->second) = (std::uint32_t)value;
+    }
+    return parameters;
+}
+
+// Everything the model needs to know about a single executed instruction
+struct TracedInstruction {
+    std::uint8_t memory_requests{}; // Requests issued to the data memory (1 for scalar, active threads for vector)
+    bool halt{};
+};
+
+using WarpTrace = std::vector<TracedInstruction>;
+
+struct KernelTrace {
+    std::vector<std::vector<WarpTrace>> blocks; // [block][warp]
+};
+
+// Runs the kernel functionally and records a trace for every warp
+// `stop` bounds kernels that never halt, the model treats the end of a trace like a halt
+inline auto trace_kernel(const ExecutorConfig &config, std::span<const IData> program,
+                         const data_memory_container_t &data = {}, const StopCondition &stop = {}) -> KernelTrace {
+    auto trace = KernelTrace{};
+    trace.blocks.resize(config.num_blocks, std::vector<WarpTrace>(config.warps_per_core));
+
+    const auto thread_mask = config.threads_per_warp >= 32 ? ~IData{0} : (IData{1} << config.threads_per_warp) - 1u;
+    auto executor = Executor{config, program, data};
+    executor.run(stop, [&](IData block_id, IData warp_id, const WarpState &warp, const DecodedInstruction &decoded) {
+        auto traced = TracedInstruction{.memory_requests = 0, .halt = decoded.halt};
+        if (decoded.mem_read_enable || decoded.mem_write_enable) {
+            traced.memory_requests = decoded.scalar_instruction
+                                         ? std::uint8_t{1}
+                                         : (std::uint8_t)std::popcount(warp.execution_mask() & thread_mask);
+        }
+        trace.blocks[block_id][warp_id].push_back(traced);
+    });
+    return trace;
+}
+
+struct GpuShape {
+    std::uint32_t num_cores = 2;
+    std::uint32_t data_mem_channels = 8;
+};
+
+class TimingModel {
+  public:
+    TimingModel(const GpuShape &shape, const TimingParameters &parameters)
+        : shape(shape), parameters(parameters) {}
+
+    [[nodiscard]] auto estimate(const KernelTrace &trace) -> std::uint64_t {
+        channel_free = std::vector<std::uint64_t>(shape.data_mem_channels, 0u);
+        cores = std::vector<Core>(shape.num_cores);
+        next_block = 0;
+
+        // Cores only interact through the memory channels, so always advancing the one that is furthest behind
+        // keeps the memory requests in (roughly) the order the RTL would see them
+        auto end = std::uint64_t{};
+        while (true) {
+            auto *core = earliest_core(trace);
+            if (core == nullptr) {
+                break;
+            }
+            step(*core, trace);
+            end = std::max(end, core->now);
+        }
+        return end + parameters.drain_cycles;
+    }
+
+  private:
+    struct Warp {
+        const WarpTrace *trace = nullptr;
+        std::size_t next{};
+        std::uint64_t ready{}; // When the instruction fetch completes
+        bool done = true;
+    };
+
+    struct Core {
+        std::uint64_t now{};
+        std::vector<Warp> warps;
+        std::uint32_t current{};
+        bool busy{};
+    };
+
+    auto earliest_core(const KernelTrace &trace) -> Core * {
+        Core *earliest = nullptr;
+        for (auto &core : cores) {
+            if (!core.busy && next_block >= trace.blocks.size()) {
+                continue;
+            }
+            if (earliest == nullptr || core.now < earliest->now) {
+                earliest = &core;
+            }
+        }
+        return earliest;
+    }
+
+    void start_block(Core &core, const std::vector<WarpTrace> &block) {
+        core.now += parameters.dispatch_cycles;
+        core.warps.assign(block.size(), Warp{});
+        for (auto i = 0u; i < block.size(); i++) {
+            core.warps[i] = Warp{.trace = &block[i], .next = 0, .ready = core.now + parameters.fetch_cycles, .done = block[i].empty()};
+        }
+        core.current = 0;
+        core.busy = !std::ranges::all_of(core.warps, [](const Warp &warp) { return warp.done; });
+    }
+
+    // Mirrors the warp selection at UPDATE in compute_core.sv: the next warp (round robin) that has its instruction,
+    // if there is none the core stays with the current warp until its fetch is done
+    auto select_warp(const Core &core) const -> std::uint32_t {
+        const auto num_warps = (std::uint32_t)core.warps.size();
+        for (auto offset = 1u; offset <= num_warps; offset++) {
+            const auto candidate = (core.current + offset) % num_warps;
+            const auto &warp = core.warps[candidate];
+            if (!warp.done && warp.ready <= core.now) {
+                return candidate;
+            }
+        }
+        if (!core.warps[core.current].done) {
+            return core.current;
+        }
+        // The current warp is done, the core polls every cycle for whichever becomes ready first
+        auto earliest = core.current;
+        auto earliest_ready = std::numeric_limits<std::uint64_t>::max();
+        for (auto i = 0u; i < num_warps; i++) {
+            if (!core.warps[i].done && core.warps[i].ready < earliest_ready) {
+                earliest = i;
+                earliest_ready = core.warps[i].ready;
+            }
+        }
+        return earliest;
+    }
+
+    // Every request takes the channel that frees up first, returns when the last one completes
+    auto access_memory(std::uint64_t start, std::uint32_t requests) -> std::uint64_t {
+        auto completed = start;
+        for (auto i = 0u; i < requests; i++) {
+            const auto channel = std::ranges::min_element(channel_free);
+            const auto begin = std::max(start, *channel);
+            *channel = begin + parameters.channel_occupancy;
+            completed = std::max(completed, begin + parameters.memory_latency);
+        }
+        return completed;
+    }
+
+    void step(Core &core, const KernelTrace &trace) {
+        if (!core.busy) {
+            start_block(core, trace.blocks[next_block++]);
+            return;
+        }
+
+        core.current = select_warp(core);
+        auto &warp = core.warps[core.current];
+        const auto &instruction = (*warp.trace)[warp.next++];
+
+        const auto issued = std::max(core.now, warp.ready) + parameters.issue_cycles;
+        const auto waited = instruction.memory_requests > 0 ? access_memory(issued, instruction.memory_requests)
+                                                            : issued + parameters.alu_wait_cycles;
+        core.now = waited + parameters.retire_cycles;
+
+        warp.done = instruction.halt || warp.next >= warp.trace->size();
+        warp.ready = core.now + parameters.fetch_cycles;
+
+        core.busy = !std::ranges::all_of(core.warps, [](const Warp &other) { return other.done; });
+    }
+
+    GpuShape shape;
+    TimingParameters parameters;
+    std::vector<std::uint64_t> channel_free;
+    std::vector<Core> cores;
+    std::size_t next_block{};
+};
+
+inline auto model_cycles(const KernelTrace &trace, const GpuShape &shape, const TimingParameters &parameters = {})
+    -> std::uint64_t {
+    return TimingModel{shape, parameters}.estimate(trace);
+}
+
+} // namespace sim
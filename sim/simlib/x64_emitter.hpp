@@ -0,0 +1,309 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+namespace sim::x64 {
+
+// Minimal x86-64 machine code emitter used by the JIT (jit.hpp)
+// It only knows the handful of instructions the JIT needs, all 32-bit integer operations and SSE2.
+
+enum Gpr : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum Xmm : uint8_t { XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7 };
+
+// Condition codes (low nibble of Jcc/SETcc/CMOVcc)
+enum class Condition : uint8_t {
+    BELOW = 0x2,         // unsigned <
+    ABOVE_OR_EQUAL = 0x3, // unsigned >=
+    EQUAL = 0x4,
+    NOT_EQUAL = 0x5,
+};
+
+// Group 1 ALU operations, the value is the /digit of the `81 /digit id` encoding
+enum class AluOp : uint8_t { ADD = 0, OR = 1, AND = 4, SUB = 5, XOR = 6, CMP = 7 };
+
+enum class ShiftOp : uint8_t { SHL = 4, SHR = 5 };
+
+// Packed integer SSE2 operations (66 0F <opcode>)
+enum class SseOp : uint8_t {
+    PADDD = 0xFE,
+    PSUBD = 0xFA,
+    PAND = 0xDB,
+    PANDN = 0xDF,
+    POR = 0xEB,
+    PXOR = 0xEF,
+    PCMPEQD = 0x76,
+    PCMPGTD = 0x66,
+};
+
+struct Label {
+    uint32_t id;
+};
+
+// A memory operand: [base + index * scale + disp] or [rip + label]
+struct Mem {
+    Gpr base{RAX};
+    int index = -1;
+    uint8_t scale = 1;
+    int32_t disp = 0;
+    bool rip_relative = false;
+    Label label{};
+};
+
+constexpr auto mem(Gpr base, int32_t disp = 0) -> Mem {
+    return Mem{.base = base, .index = -1, .scale = 1, .disp = disp, .rip_relative = false, .label = {}};
+}
+
+constexpr auto mem(Gpr base, Gpr index, uint8_t scale, int32_t disp = 0) -> Mem {
+    return Mem{.base = base, .index = index, .scale = scale, .disp = disp, .rip_relative = false, .label = {}};
+}
+
+constexpr auto rip(Label label) -> Mem {
+    return Mem{.base = RAX, .index = -1, .scale = 1, .disp = 0, .rip_relative = true, .label = label};
+}
+
+class Emitter {
+  public:
+    auto make_label() -> Label {
+        label_offsets.push_back(UNBOUND);
+        return Label{(uint32_t)label_offsets.size() - 1};
+    }
+
+    void bind(Label label) { label_offsets[label.id] = (uint32_t)code.size(); }
+
+    [[nodiscard]] auto size() const -> size_t { return code.size(); }
+
+    // 16 byte constant, placed after the code by `finish`
+    auto constant(const std::array<uint32_t, 4> &value) -> Label {
+        const auto label = make_label();
+        constants.push_back({label, value});
+        return label;
+    }
+
+    // 64-bit absolute address of the label, used for jump tables
+    void address_of(Label label) {
+        absolute_fixups.push_back({(uint32_t)code.size(), label});
+        emit64(0);
+    }
+
+    void align(size_t alignment) {
+        while (code.size() % alignment != 0) {
+            code.push_back(0xCC); // int3
+        }
+    }
+
+    // mov r32, [mem]
+    void mov(Gpr dst, const Mem &src) { encode({}, false, dst, src, {0x8B}); }
+    // mov [mem], r32
+    void mov(const Mem &dst, Gpr src) { encode({}, false, src, dst, {0x89}); }
+    // mov r32, r32
+    void mov(Gpr dst, Gpr src) { encode_rr({}, false, src, dst, {0x89}); }
+    // mov r32, imm32
+    void mov(Gpr dst, uint32_t imm) {
+        rex(false, 0, 0, dst);
+        code.push_back(0xB8 + (dst & 7u));
+        emit32(imm);
+    }
+    // mov dword [mem], imm32
+    void mov(const Mem &dst, uint32_t imm) { encode({}, false, 0, dst, {0xC7}, imm32_bytes(imm)); }
+
+    // lea r64, [mem]
+    void lea(Gpr dst, const Mem &src) { encode({}, true, dst, src, {0x8D}); }
+
+    // op r32, r32
+    void alu(AluOp op, Gpr dst, Gpr src) {
+        static constexpr auto opcodes = std::array<uint8_t, 8>{0x01, 0x09, 0, 0, 0x21, 0x29, 0x31, 0x39};
+        encode_rr({}, false, src, dst, {opcodes[(uint8_t)op]});
+    }
+    // op r32, imm32
+    void alu(AluOp op, Gpr dst, uint32_t imm) { encode_rr({}, false, (uint8_t)op, dst, {0x81}, imm32_bytes(imm)); }
+    // cmp r32, [mem]
+    void cmp(Gpr lhs, const Mem &rhs) { encode({}, false, lhs, rhs, {0x3B}); }
+
+    // test r32, imm32
+    void test(Gpr reg, uint32_t imm) { encode_rr({}, false, 0, reg, {0xF7}, imm32_bytes(imm)); }
+
+    // shl/shr r32, cl
+    void shift_cl(ShiftOp op, Gpr reg) { encode_rr({}, false, (uint8_t)op, reg, {0xD3}); }
+    // shl/shr r32, imm8
+    void shift(ShiftOp op, Gpr reg, uint8_t count) { encode_rr({}, false, (uint8_t)op, reg, {0xC1}, {count}); }
+
+    // setcc al; movzx eax, al
+    void set_eax(Condition condition) {
+        code.insert(code.end(), {0x0F, (uint8_t)(0x90 + (uint8_t)condition), 0xC0});
+        code.insert(code.end(), {0x0F, 0xB6, 0xC0});
+    }
+
+    // cmovcc r32, r32
+    void cmov(Condition condition, Gpr dst, Gpr src) {
+        encode_rr({}, false, dst, src, {0x0F, (uint8_t)(0x40 + (uint8_t)condition)});
+    }
+
+    // inc qword [mem]
+    void inc64(const Mem &dst) { encode({}, true, 0, dst, {0xFF}); }
+
+    void jmp(Label label) {
+        code.push_back(0xE9);
+        relative_fixups.push_back({(uint32_t)code.size(), label});
+        emit32(0);
+    }
+
+    void jcc(Condition condition, Label label) {
+        code.insert(code.end(), {0x0F, (uint8_t)(0x80 + (uint8_t)condition)});
+        relative_fixups.push_back({(uint32_t)code.size(), label});
+        emit32(0);
+    }
+
+    // jmp qword [mem]
+    void jmp(const Mem &target) { encode({}, false, 4, target, {0xFF}); }
+
+    void ret() { code.push_back(0xC3); }
+
+    // movdqu xmm, [mem]
+    void movdqu(Xmm dst, const Mem &src) { encode({0xF3}, false, dst, src, {0x0F, 0x6F}); }
+    // movdqu [mem], xmm
+    void movdqu(const Mem &dst, Xmm src) { encode({0xF3}, false, src, dst, {0x0F, 0x7F}); }
+    // movdqa xmm, xmm
+    void movdqa(Xmm dst, Xmm src) { encode_rr({0x66}, false, dst, src, {0x0F, 0x6F}); }
+    // movd xmm, r32
+    void movd(Xmm dst, Gpr src) { encode_rr({0x66}, false, dst, src, {0x0F, 0x6E}); }
+    // pshufd xmm, xmm, imm8
+    void pshufd(Xmm dst, Xmm src, uint8_t order) { encode_rr({0x66}, false, dst, src, {0x0F, 0x70}, {order}); }
+    // movmskps r32, xmm
+    void movmskps(Gpr dst, Xmm src) { encode_rr({}, false, dst, src, {0x0F, 0x50}); }
+
+    // op xmm, xmm
+    void sse(SseOp op, Xmm dst, Xmm src) { encode_rr({0x66}, false, dst, src, {0x0F, (uint8_t)op}); }
+    // op xmm, [mem], the memory operand has to be 16 byte aligned
+    void sse(SseOp op, Xmm dst, const Mem &src) { encode({0x66}, false, dst, src, {0x0F, (uint8_t)op}); }
+
+    // pslld/psrld xmm, imm8
+    void pslld(Xmm reg, uint8_t count) { encode_rr({0x66}, false, 6, reg, {0x0F, 0x72}, {count}); }
+    void psrld(Xmm reg, uint8_t count) { encode_rr({0x66}, false, 2, reg, {0x0F, 0x72}, {count}); }
+
+    // Appends the constants, resolves the labels and copies the code to `destination`
+    // `destination` has to hold at least `finished_size()` bytes, it's also the address used for absolute fixups
+    void finish(uint8_t *destination) {
+        emit_constants();
+        for (const auto &[position, label] : relative_fixups) {
+            write32(position, label_offsets[label.id] - (position + 4));
+        }
+        for (const auto &[position, end, label] : rip_fixups) {
+            write32(position, label_offsets[label.id] - end);
+        }
+        for (const auto &[position, label] : absolute_fixups) {
+            const auto address = (uint64_t)(uintptr_t)(destination + label_offsets[label.id]);
+            std::memcpy(&code[position], &address, sizeof(address));
+        }
+        std::memcpy(destination, code.data(), code.size());
+    }
+
+    [[nodiscard]] auto finished_size() const -> size_t { return code.size() + 16 + constants.size() * 16; }
+
+  private:
+    static constexpr uint32_t UNBOUND = ~0u;
+
+    struct Fixup {
+        uint32_t position;
+        Label label;
+    };
+
+    struct RipFixup {
+        uint32_t position;
+        uint32_t end; // End of the instruction, rip points there
+        Label label;
+    };
+
+    struct Constant {
+        Label label;
+        std::array<uint32_t, 4> value;
+    };
+
+    static auto imm32_bytes(uint32_t imm) -> std::vector<uint8_t> {
+        return {(uint8_t)imm, (uint8_t)(imm >> 8u), (uint8_t)(imm >> 16u), (uint8_t)(imm >> 24u)};
+    }
+
+    void emit32(uint32_t value) {
+        for (auto i = 0u; i < 4u; i++) {
+            code.push_back((uint8_t)(value >> (8u * i)));
+        }
+    }
+
+    void emit64(uint64_t value) {
+        for (auto i = 0u; i < 8u; i++) {
+            code.push_back((uint8_t)(value >> (8u * i)));
+        }
+    }
+
+    void write32(uint32_t position, uint32_t value) { std::memcpy(&code[position], &value, sizeof(value)); }
+
+    void rex(bool w, uint8_t reg, uint8_t index, uint8_t base) {
+        const auto bits = (uint8_t)((w ? 8u : 0u) | ((reg >> 3u) << 2u) | ((index >> 3u) << 1u) | (base >> 3u));
+        if (bits != 0) {
+            code.push_back(0x40 | bits);
+        }
+    }
+
+    // Register-direct ModRM (mod = 11)
+    void encode_rr(std::initializer_list<uint8_t> prefixes, bool w, uint8_t reg, uint8_t rm,
+                   std::initializer_list<uint8_t> opcode, const std::vector<uint8_t> &immediate = {}) {
+        code.insert(code.end(), prefixes);
+        rex(w, reg, 0, rm);
+        code.insert(code.end(), opcode);
+        code.push_back((uint8_t)(0xC0 | ((reg & 7u) << 3u) | (rm & 7u)));
+        code.insert(code.end(), immediate.begin(), immediate.end());
+    }
+
+    // Memory ModRM, always with a 32-bit displacement to keep things simple
+    void encode(std::initializer_list<uint8_t> prefixes, bool w, uint8_t reg, const Mem &rm,
+                std::initializer_list<uint8_t> opcode, const std::vector<uint8_t> &immediate = {}) {
+        code.insert(code.end(), prefixes);
+        const auto index = rm.index >= 0 ? (uint8_t)rm.index : (uint8_t)0;
+        rex(w, reg, index, rm.rip_relative ? 0 : rm.base);
+        code.insert(code.end(), opcode);
+
+        if (rm.rip_relative) {
+            code.push_back((uint8_t)(0x05 | ((reg & 7u) << 3u)));
+            const auto position = (uint32_t)code.size();
+            emit32(0);
+            code.insert(code.end(), immediate.begin(), immediate.end());
+            rip_fixups.push_back({position, (uint32_t)code.size(), rm.label});
+            return;
+        }
+
+        if (rm.index >= 0) {
+            static constexpr auto scales = std::array<uint8_t, 9>{0, 0, 1, 0, 2, 0, 0, 0, 3};
+            code.push_back((uint8_t)(0x84 | ((reg & 7u) << 3u)));
+            code.push_back((uint8_t)((scales[rm.scale] << 6u) | ((index & 7u) << 3u) | (rm.base & 7u)));
+        } else {
+            code.push_back((uint8_t)(0x80 | ((reg & 7u) << 3u) | (rm.base & 7u)));
+            if ((rm.base & 7u) == RSP) {
+                code.push_back(0x24); // SIB without index
+            }
+        }
+        emit32((uint32_t)rm.disp);
+        code.insert(code.end(), immediate.begin(), immediate.end());
+    }
+
+    void emit_constants() {
+        align(16);
+        for (const auto &[label, value] : constants) {
+            bind(label);
+            for (const auto word : value) {
+                emit32(word);
+            }
+        }
+        constants.clear();
+    }
+
+    std::vector<uint8_t> code{};
+    std::vector<uint32_t> label_offsets{};
+    std::vector<Fixup> relative_fixups{};
+    std::vector<RipFixup> rip_fixups{};
+    std::vector<Fixup> absolute_fixups{};
+    std::vector<Constant> constants{};
+};
+
+} // namespace sim::x64
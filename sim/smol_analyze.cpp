@@ -0,0 +1,60 @@
+// Reports the instruction mix, arithmetic intensity, registers live across loads and a static cycle estimate of
+// kernels (see aslib/analyzer.hpp), without simulating them
+
+#include <Vgpu_gpu.h>
+#include <print>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+#include "analyzer.hpp"
+#include "error.hpp"
+#include "parser.hpp"
+#include "source_file.hpp"
+
+namespace fs = std::filesystem;
+
+auto main(int argc, char** argv) -> int {
+    auto inputs = std::vector<std::string_view>{};
+    for (auto arg = 1; arg < argc; arg++) {
+        const auto current = std::string_view{argv[arg]};
+        if (current.starts_with("--")) {
+            std::println(stderr, "Unknown option '{}'", current);
+            return 1;
+        }
+        inputs.push_back(current);
+    }
+
+    if (inputs.empty()) {
+        std::println("Usage: {} <input file> [input file...]", argv[0]);
+        return 1;
+    }
+
+    const auto options = as::AnalyzerOptions{
+        .shape = sim::GpuShape{
+            .num_cores = Vgpu_gpu::NUM_CORES,
+            .data_mem_channels = Vgpu_gpu::DATA_MEM_NUM_CHANNELS,
+        },
+        .warps_per_core = Vgpu_gpu::WARPS_PER_CORE,
+        .threads_per_warp = Vgpu_gpu::THREADS_PER_WARP,
+        .timing = {},
+    };
+
+    auto failed = false;
+    for (const auto input : inputs) {
+        const auto input_filename = fs::path{input};
+        const auto source = sim::unwrap(as::SourceFile::open(input_filename));
+        auto arena = as::Arena{};
+        const auto program_or_err = as::parse_program(source.view(), &arena);
+        if (!program_or_err.has_value()) {
+            for (const auto& error : program_or_err.error()) {
+                sim::print_error(error);
+            }
+            failed = true;
+            continue;
+        }
+
+        std::println("{}", input_filename.string());
+        std::print("{}", as::dump_analysis(*program_or_err, as::analyze(*program_or_err, options)));
+    }
+    return failed ? 1 : 0;
+}
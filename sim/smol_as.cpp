@@ -0,0 +1,111 @@
+// Assembles a kernel into a kernel object (see simlib/kernel_object.hpp), which the simulator loads directly
+
+#include <print>
+#include <charconv>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+#include "emitter.hpp"
+#include "error.hpp"
+#include "kernel_object.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "scheduler.hpp"
+#include "source_file.hpp"
+
+namespace fs = std::filesystem;
+
+auto main(int argc, char** argv) -> int {
+    auto positional = std::vector<std::string_view>{};
+    auto with_source_lines = true;
+    auto optimize = false;
+    auto schedule = false;
+    auto dump_schedule = false;
+    auto relocatable = false;
+    auto num_threads = 1u;
+    for (auto arg = 1; arg < argc; arg++) {
+        const auto current = std::string_view{argv[arg]};
+        if (current == "--no-source-lines") {
+            with_source_lines = false;
+        } else if (current == "--optimize") {
+            optimize = true;
+        } else if (current == "--schedule") {
+            schedule = true;
+        } else if (current == "--dump-schedule") {
+            schedule = true;
+            dump_schedule = true;
+        } else if (current == "--relocatable") {
+            relocatable = true;
+        } else if (current == "--threads" && arg + 1 < argc) {
+            const auto value = std::string_view{argv[++arg]};
+            const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), num_threads);
+            if (ec != std::errc{} || ptr != value.data() + value.size() || num_threads == 0) {
+                std::println(stderr, "Option '--threads' expects a number of at least 1");
+                return 1;
+            }
+        } else if (current.starts_with("--")) {
+            std::println(stderr, "Unknown option '{}'", current);
+            return 1;
+        } else {
+            positional.push_back(current);
+        }
+    }
+
+    if (positional.empty() || positional.size() > 2) {
+        std::println("Usage: {} <input file> [output file] [options]", argv[0]);
+        std::println("The output defaults to the input file with the .kobj extension");
+        std::println("Options:");
+        std::println("  --threads <n>          Assemble on n threads");
+        std::println("  --no-source-lines      Leave out the source line of every instruction");
+        std::println("  --optimize             Run the peephole optimizer and list what it changed");
+        std::println("  --schedule             Reorder instructions to hide the memory latency");
+        std::println("  --dump-schedule        Same as --schedule, and print the schedule");
+        std::println("  --relocatable          Assemble a module for smol-ld, which can use labels of other modules");
+        return 1;
+    }
+
+    const auto input_filename = fs::path{positional[0]};
+    const auto output_filename = positional.size() == 2 ? fs::path{positional[1]}
+                                                        : fs::path{input_filename}.replace_extension(".kobj");
+
+    const auto source = sim::unwrap(as::SourceFile::open(input_filename));
+    auto arena = as::Arena{};
+    auto program_or_err = relocatable ? as::parse_module(source.view(), &arena)
+                                      : as::parse_program_parallel(source.view(), num_threads, &arena);
+    if (!program_or_err.has_value()) {
+        for (const auto& error : program_or_err.error()) {
+            sim::print_error(error);
+        }
+        return 1;
+    }
+
+    if (optimize) {
+        const auto optimizations = as::optimize(*program_or_err);
+        for (const auto& [line, description] : optimizations) {
+            std::println("{}:{}: {}", input_filename.string(), line, description);
+        }
+        std::println("The optimizer made {} changes", optimizations.size());
+    }
+
+    if (schedule) {
+        const auto regions = as::schedule(*program_or_err);
+        if (!regions.has_value()) {
+            std::println("{}:{}: Not scheduled: {}", input_filename.string(), regions.error().line, regions.error().message);
+        } else if (dump_schedule) {
+            std::print("{}", as::dump_schedule(*program_or_err, *regions));
+        }
+    }
+
+    const auto machine_code = as::translate_to_binary(*program_or_err, num_threads);
+    const auto contents = relocatable ? as::make_relocatable_object(*program_or_err, machine_code, with_source_lines)
+                                      : as::make_kernel_object(*program_or_err, machine_code, with_source_lines);
+    if (const auto written = sim::write_kernel_object(output_filename, contents); !written) {
+        std::println(stderr, "Error: {}.", written.error());
+        return 1;
+    }
+
+    std::println("Wrote {} instructions and {} symbols to {}", contents.instructions.size(), contents.symbols.size(),
+                 output_filename.string());
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Compiles a kernel written in the kernel language (see cclib/kernel_parser.hpp) into assembly for smol-as
+
+#include <print>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+#include "compiler.hpp"
+#include "error.hpp"
+#include "source_file.hpp"
+
+namespace fs = std::filesystem;
+
+auto main(int argc, char** argv) -> int {
+    auto positional = std::vector<std::string_view>{};
+    for (auto arg = 1; arg < argc; arg++) {
+        const auto current = std::string_view{argv[arg]};
+        if (current.starts_with("--")) {
+            std::println(stderr, "Unknown option '{}'", current);
+            return 1;
+        }
+        positional.push_back(current);
+    }
+
+    if (positional.empty() || positional.size() > 2) {
+        std::println("Usage: {} <input file> [output file]", argv[0]);
+        std::println("The output defaults to the input file with the .as extension, '-' prints it instead");
+        return 1;
+    }
+
+    const auto input_filename = fs::path{positional[0]};
+    const auto output_filename = positional.size() == 2 ? fs::path{positional[1]}
+                                                        : fs::path{input_filename}.replace_extension(".as");
+
+    const auto source = sim::unwrap(as::SourceFile::open(input_filename));
+    const auto assembly = cc::compile(source.view());
+    if (!assembly.has_value()) {
+        for (const auto& error : assembly.error()) {
+            sim::print_error(error);
+        }
+        return 1;
+    }
+
+    if (output_filename == "-") {
+        std::print("{}", *assembly);
+        return 0;
+    }
+
+    auto output = std::ofstream{output_filename};
+    output << *assembly;
+    if (!output) {
+        std::println(stderr, "Error: Failed to write '{}'.", output_filename.string());
+        return 1;
+    }
+    std::println("Wrote {}", output_filename.string());
+    return 0;
+}
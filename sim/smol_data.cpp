@@ -0,0 +1,47 @@
+// Converts a text data file (see aslib/data_reader.hpp) into a data image (see simlib/data_image.hpp), which the
+// simulator loads without parsing
+
+#include <print>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+#include "data_image.hpp"
+#include "data_reader.hpp"
+
+namespace fs = std::filesystem;
+
+auto main(int argc, char** argv) -> int {
+    auto positional = std::vector<std::string_view>{};
+    for (auto arg = 1; arg < argc; arg++) {
+        const auto current = std::string_view{argv[arg]};
+        if (current.starts_with("--")) {
+            std::println(stderr, "Unknown option '{}'", current);
+            return 1;
+        }
+        positional.push_back(current);
+    }
+
+    if (positional.empty() || positional.size() > 2) {
+        std::println("Usage: {} <input file> [output file]", argv[0]);
+        std::println("The output defaults to the input file with the .dimg extension");
+        return 1;
+    }
+
+    const auto input_filename = fs::path{positional[0]};
+    const auto output_filename = positional.size() == 2 ? fs::path{positional[1]}
+                                                        : fs::path{input_filename}.replace_extension(".dimg");
+
+    const auto data = as::read_data(input_filename);
+    if (!data) {
+        std::println(stderr, "Failed to read data file '{}': {}", input_filename.string(), data.error());
+        return 1;
+    }
+
+    if (const auto written = sim::write_data_image(output_filename, *data); !written) {
+        std::println(stderr, "Error: {}.", written.error());
+        return 1;
+    }
+
+    std::println("Wrote {} words to {}", data->size(), output_filename.string());
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Disassembles a kernel object (see simlib/kernel_object.hpp) back into assembly, with its symbols as labels
+
+#include <print>
+#include <algorithm>
+#include <cstdio>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "disassembler.hpp"
+#include "kernel_object.hpp"
+
+auto main(int argc, char** argv) -> int {
+    auto positional = std::vector<std::string_view>{};
+    auto annotate = false;
+    for (auto arg = 1; arg < argc; arg++) {
+        const auto current = std::string_view{argv[arg]};
+        if (current == "--annotate") {
+            annotate = true;
+        } else if (current.starts_with("--")) {
+            std::println(stderr, "Unknown option '{}'", current);
+            return 1;
+        } else {
+            positional.push_back(current);
+        }
+    }
+
+    if (positional.size() != 1) {
+        std::println("Usage: {} <kernel object> [options]", argv[0]);
+        std::println("Options:");
+        std::println("  --annotate             Follow every instruction with its address and encoding");
+        return 1;
+    }
+
+    const auto object = sim::KernelObject::load(positional[0]);
+    if (!object.has_value()) {
+        std::println(stderr, "Error: {}.", object.error());
+        return 1;
+    }
+
+    const auto& header = object->header();
+    const auto symbols = sim::SymbolTable{*object};
+    auto disassembler = sim::Disassembler{symbols, header.base_instructions_address, annotate};
+    auto listing = std::format(".blocks {}\n.warps {}\n", header.num_blocks, header.num_warps_per_block);
+
+    // Kernels can be large, so the listing is written out a chunk at a time from the same buffer
+    constexpr auto CHUNK_SIZE = std::size_t{1} << 14;
+    const auto instructions = object->instructions();
+    for (auto begin = std::size_t{0}; begin < instructions.size(); begin += CHUNK_SIZE) {
+        disassembler.feed(instructions.subspan(begin, std::min(CHUNK_SIZE, instructions.size() - begin)), listing);
+        std::fwrite(listing.data(), 1, listing.size(), stdout);
+        listing.clear();
+    }
+    std::fwrite(listing.data(), 1, listing.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Links relocatable kernel objects (smol-as --relocatable) into a kernel object the simulator runs, see aslib/linker.hpp
+
+#include <print>
+#include <charconv>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "kernel_object.hpp"
+#include "linker.hpp"
+
+namespace {
+
+auto parse_address(std::string_view str) -> std::optional<IData> {
+    auto base = 10;
+    if (str.starts_with("0x")) {
+        str.remove_prefix(2);
+        base = 16;
+    }
+    auto value = IData{};
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value, base);
+    if (ec != std::errc{} || ptr != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// `path` or `path@address`
+auto load_input(std::string_view argument) -> std::optional<as::LinkInput> {
+    auto input = as::LinkInput{};
+    const auto at = argument.rfind('@');
+    if (at != std::string_view::npos) {
+        input.address = parse_address(argument.substr(at + 1));
+        if (!input.address.has_value()) {
+            std::println(stderr, "Invalid address in '{}'", argument);
+            return std::nullopt;
+        }
+        argument = argument.substr(0, at);
+    }
+
+    input.name = std::string{argument};
+    const auto object = sim::KernelObject::load(input.name);
+    if (!object.has_value()) {
+        std::println(stderr, "Error: {}.", object.error());
+        return std::nullopt;
+    }
+    input.object = object->contents();
+    return input;
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+    auto positional = std::vector<std::string_view>{};
+    auto library_paths = std::vector<std::string_view>{};
+    auto options = as::LinkOptions{};
+    for (auto arg = 1; arg < argc; arg++) {
+        const auto current = std::string_view{argv[arg]};
+        if (current == "--library" && arg + 1 < argc) {
+            library_paths.emplace_back(argv[++arg]);
+        } else if ((current == "--base" || current == "--data-base") && arg + 1 < argc) {
+            const auto value = parse_address(argv[++arg]);
+            if (!value.has_value()) {
+                std::println(stderr, "Option '{}' expects a number", current);
+                return 1;
+            }
+            (current == "--base" ? options.base_instructions_address : options.base_data_address) = *value;
+        } else if (current.starts_with("--")) {
+            std::println(stderr, "Unknown option '{}'", current);
+            return 1;
+        } else {
+            positional.push_back(current);
+        }
+    }
+
+    if (positional.size() < 2) {
+        std::println("Usage: {} <output file> <object[@address]>... [options]", argv[0]);
+        std::println("The first object is the entry point, the others follow it unless they are given an address");
+        std::println("Options:");
+        std::println("  --library <object>     Link the object only if it defines a symbol the kernel needs");
+        std::println("  --base <address>       Address of the first instruction, 0 by default");
+        std::println("  --data-base <address>  Base data address of the kernel, 0 by default");
+        return 1;
+    }
+
+    auto objects = std::vector<as::LinkInput>{};
+    for (const auto argument : std::span{positional}.subspan(1)) {
+        auto input = load_input(argument);
+        if (!input.has_value()) {
+            return 1;
+        }
+        objects.push_back(std::move(*input));
+    }
+    auto library = std::vector<as::LinkInput>{};
+    for (const auto argument : library_paths) {
+        auto input = load_input(argument);
+        if (!input.has_value()) {
+            return 1;
+        }
+        library.push_back(std::move(*input));
+    }
+
+    const auto image = as::link(objects, library, options);
+    if (!image.has_value()) {
+        for (const auto& error : image.error()) {
+            std::println(stderr, "Error: {}.", error);
+        }
+        return 1;
+    }
+
+    if (const auto written = sim::write_kernel_object(positional[0], *image); !written) {
+        std::println(stderr, "Error: {}.", written.error());
+        return 1;
+    }
+
+    std::println("Linked {} instructions and {} symbols into {}", image->instructions.size(), image->symbols.size(),
+                 positional[0]);
+    return 0;
+}
@@ -123,6 +123,26 @@ typedef enum logic [2:0] {
     VECTOR_TO_SCALAR
 } reg_input_mux_t;
 
+// state injection target enum
+// Used by the sampled simulation to load architectural state (computed in software) into the cores
+typedef enum logic [2:0] {
+    INJECT_NONE,
+    INJECT_PC,              // pc[warp] := data
+    INJECT_SCALAR_REG,      // scalar registers[warp][register_address] := data
+    INJECT_VECTOR_REG,      // registers[warp][thread][register_address] := data
+    INJECT_WARP_DONE,       // warp_state[warp] := WARP_DONE (the warp halted before the switch to RTL)
+    INJECT_RELEASE          // the core starts fetching with the injected state
+} inject_target_t;
+
+typedef struct packed {
+    inject_target_t target;
+    logic [7:0] core;
+    logic [7:0] warp;
+    logic [7:0] thread;
+    logic [4:0] register_address;
+    data_t data;
+} state_inject_t;
+
 // sign extend function
 function automatic data_t sign_extend(imm12_t imm12);
     data_t signed_imm12;
@@ -134,26 +154,15 @@ function automatic data_t sign_extend(imm12_t imm12);
     return signed_imm12;
 endfunction
 
-// sign extend function for 13-bit immediate values
-function automatic data_t sign_extend_13(logic[12:0] imm13);
-    data_t signed_imm13;
-    if (imm13[12]) begin
-        signed_imm13 = {{19{1'b1}}, imm13};
-    end else begin
-        signed_imm13 = {{19{1'b0}}, imm13};
-    end
-    return signed_imm13;
-endfunction
-
-// sign extend function for 21-bit immediate values
-function automatic data_t sign_extend_21(logic[20:0] imm21);
-    data_t signed_imm21;
-    if (imm21[20]) begin
-        signed_imm21 = {{11{1'b1}}, imm21};
+// sign extend function for 20-bit immediate values (jump offsets)
+function automatic data_t sign_extend_20(logic[19:0] imm20);
+    data_t signed_imm20;
+    if (imm20[19]) begin
+        signed_imm20 = {{12{1'b1}}, imm20};
     end else begin
-        signed_imm21 = {{11{1'b0}}, imm21};
+        signed_imm20 = {{12{1'b0}}, imm20};
     end
-    return signed_imm21;
+    return signed_imm20;
 endfunction
 
 `endif // COMMON_SV
@@ -16,6 +16,13 @@ module compute_core#(
     input data_t block_id,
     input kernel_config_t kernel_config,
 
+    // State injection (sampled simulation)
+    // When state_inject_hold is set on start, the warps wait in WARP_IDLE until the state is injected and released
+    input logic state_inject_hold,
+    input logic state_inject_valid,          // state_inject targets this core
+    input state_inject_t state_inject,
+    output logic waiting_for_state,
+
     // Instruction Memory
     input logic [WARPS_PER_CORE-1:0] instruction_mem_read_ready,
     input instruction_t instruction_mem_read_data [WARPS_PER_CORE],
@@ -140,6 +147,7 @@ always @(posedge clk) begin
 	if (reset) begin
         $display("Resetting core %0d", block_id);
         start_execution <= 0;
+        waiting_for_state <= 0;
         done <= 0;
         for (int i = 0; i < WARPS_PER_CORE; i = i + 1) begin
             warp_state[i] <= WARP_IDLE;
@@ -153,14 +161,40 @@ always @(posedge clk) begin
             $display("Starting execution of block %d", block_id);
             // Set all warps to fetch state on start
             start_execution <= 1;
+            waiting_for_state <= state_inject_hold;
             current_warp <= 0;
             for (int i = 0; i < WARPS_PER_CORE; i = i + 1) begin
-                warp_state[i] <= WARP_FETCH;
+                warp_state[i] <= state_inject_hold ? WARP_IDLE : WARP_FETCH;
                 fetcher_state_in[i] <= FETCHER_IDLE;
                 pc[i] <= kernel_config.base_instructions_address;
                 next_pc[i] <= kernel_config.base_instructions_address;
             end
         end
+    end else if (waiting_for_state) begin
+        // Registers are written directly by the register files, the core only handles the control state
+        if (state_inject_valid && state_inject.warp < WARPS_PER_CORE) begin
+            case (state_inject.target)
+                INJECT_PC: begin
+                    pc[state_inject.warp] <= state_inject.data;
+                    next_pc[state_inject.warp] <= state_inject.data;
+                end
+                INJECT_WARP_DONE: begin
+                    warp_state[state_inject.warp] <= WARP_DONE;
+                end
+                default: begin
+                end
+            endcase
+        end
+
+        if (state_inject_valid && state_inject.target == INJECT_RELEASE) begin
+            $display("Block: %0d: Injected state released", block_id);
+            waiting_for_state <= 0;
+            for (int i = 0; i < WARPS_PER_CORE; i = i + 1) begin
+                if (warp_state[i] == WARP_IDLE) begin
+                    warp_state[i] <= WARP_FETCH;
+                end
+            end
+        end
     end else begin
         // In parallel, check if fetchers are done, and if so, move to decode
         for (int i = 0; i < WARPS_PER_CORE; i = i + 1) begin
@@ -365,6 +399,10 @@ for (warp_i = 0; warp_i < WARPS_PER_CORE; warp_i = warp_i + 1) begin : g_warp
         .pc(pc[warp_i]),
         .vector_to_scalar_data(vector_to_scalar_data[warp_i]),
 
+        .inject_write_enable(waiting_for_state && state_inject_valid && state_inject.target == INJECT_SCALAR_REG && state_inject.warp == warp_i),
+        .inject_rd_address(state_inject.register_address),
+        .inject_data(state_inject.data),
+
         .rs1(scalar_rs1[warp_i]),
         .rs2(scalar_rs2[warp_i])
     );
@@ -397,6 +435,12 @@ for (warp_i = 0; warp_i < WARPS_PER_CORE; warp_i = warp_i + 1) begin : g_warp
             .alu_out(alu_out), // ALU outputs for all threads
             .lsu_out(lsu_out),
 
+            // State injection
+            .inject_write_enable(waiting_for_state && state_inject_valid && state_inject.target == INJECT_VECTOR_REG && state_inject.warp == warp_i),
+            .inject_thread(state_inject.thread),
+            .inject_rd_address(state_inject.register_address),
+            .inject_data(state_inject.data),
+
             // Outputs per thread
             .rs1(rs1[warp_i]),
             .rs2(rs2[warp_i])
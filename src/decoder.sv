@@ -35,9 +35,11 @@ module decoder(
     wire [6:0]   funct7 = instruction[31:25];
     wire [11:0]  imm_i  = instruction[31:20];
     wire [11:0]  imm_s  = {instruction[31:25], instruction[11:7]};
-    wire [12:0]  imm_b  = {instruction[31], instruction[7], instruction[30:25], instruction[11:8], 1'b0};
+    // Branch and jump offsets count instructions, the PC is an instruction index. RISC-V's always zero bit 0 is
+    // left out, so imm[12:1] and imm[20:1] are the offsets as they are.
+    wire [11:0]  imm_b  = {instruction[31], instruction[7], instruction[30:25], instruction[11:8]};
     wire [31:12] imm_u  = instruction[31:12];
-    wire [20:0]  imm_j  = {instruction[31], instruction[19:12], instruction[20], instruction[30:21], 1'b0};
+    wire [19:0]  imm_j  = {instruction[31], instruction[19:12], instruction[20], instruction[30:21]};
 
     always @(posedge clk) begin
         if (reset) begin
@@ -91,7 +93,7 @@ module decoder(
                 // Branch instructions (e.g., BEQ, BNE)
                 decoded_rs1_address <= rs1;
                 decoded_rs2_address <= rs2;
-                decoded_immediate <= sign_extend_13(imm_b);
+                decoded_immediate <= sign_extend(imm_b);
                 decoded_branch <= 1;
 
                 unique case (funct3)
@@ -108,7 +110,7 @@ module decoder(
                 decoded_scalar_instruction <= 1;
                 decoded_alu_instruction <= JAL;
                 $display("Decoding instruction 0b%32b", instruction);
-                decoded_immediate <= sign_extend_21(imm_j);
+                decoded_immediate <= sign_extend_20(imm_j);
             end else if (opcode == `OPCODE_JALR) begin
                 // JALR instruction decoding
                 decoded_rd_address <= rd;
@@ -19,6 +19,13 @@ module gpu #(
     // kernel configuration
     input kernel_config_t kernel_config,
 
+    // State injection (sampled simulation)
+    // With state_inject_hold set, every started core waits for its architectural state (see compute_core.sv)
+    input wire state_inject_hold,
+    input state_inject_t state_inject,
+    output wire [NUM_CORES-1:0] core_waiting_for_state,
+    output data_t dispatched_block_id [NUM_CORES],
+
     // Program Memory
     output wire [INSTRUCTION_MEM_NUM_CHANNELS-1:0] instruction_mem_read_valid,
     output instruction_memory_address_t instruction_mem_read_address [INSTRUCTION_MEM_NUM_CHANNELS],
@@ -59,6 +66,8 @@ logic [NUM_CORES-1:0] core_start;
 logic [NUM_CORES-1:0] core_reset;
 data_t core_block_id [NUM_CORES];
 
+assign dispatched_block_id = core_block_id;
+
 // LSU <> Data Memory Controller Channels
 localparam int NUM_LSUS_PER_CORE = THREADS_PER_WARP + 1;
 localparam int NUM_LSUS = NUM_CORES * NUM_LSUS_PER_CORE;
@@ -213,6 +222,8 @@ generate
 
         localparam fetcher_index = i * WARPS_PER_CORE;
 
+        wire core_state_inject_valid = (state_inject.target != INJECT_NONE) && (state_inject.core == i);
+
         // Compute Core
         compute_core #(
             .WARPS_PER_CORE(WARPS_PER_CORE),
@@ -227,6 +238,11 @@ generate
             .block_id(core_block_id[i]),
             .kernel_config(kernel_config_reg),
 
+            .state_inject_hold(state_inject_hold),
+            .state_inject_valid(core_state_inject_valid),
+            .state_inject(state_inject),
+            .waiting_for_state(core_waiting_for_state[i]),
+
             .instruction_mem_read_valid(fetcher_read_valid[fetcher_index +: WARPS_PER_CORE]),
             .instruction_mem_read_address(fetcher_read_address[fetcher_index +: WARPS_PER_CORE]),
             .instruction_mem_read_ready(fetcher_read_ready[fetcher_index +: WARPS_PER_CORE]),
@@ -30,6 +30,12 @@ module reg_file #(
     input data_t alu_out      [THREADS_PER_WARP],
     input data_t lsu_out      [THREADS_PER_WARP],
 
+    // State injection (sampled simulation)
+    input logic inject_write_enable,
+    input logic [7:0] inject_thread,
+    input logic [4:0] inject_rd_address,
+    input data_t inject_data,
+
     // Outputs per thread
     output data_t rs1         [THREADS_PER_WARP],
     output data_t rs2         [THREADS_PER_WARP]
@@ -64,6 +70,11 @@ always @(posedge clk) begin
                 registers[i][j] <= {DATA_WIDTH{1'b0}};
             end
         end
+    end else if (inject_write_enable) begin
+        // Read-only registers are derived from the warp/block ids and never injected
+        if (inject_rd_address >= 4) begin
+            registers[inject_thread][inject_rd_address] <= inject_data;
+        end
     end else if (enable) begin
         for (int i = 0; i < THREADS_PER_WARP; i++) begin
             registers[i][ZERO_REG]     <= {DATA_WIDTH{1'b0}};
@@ -27,6 +27,11 @@ module scalar_reg_file #(
     input instruction_memory_address_t pc,
     input data_t vector_to_scalar_data,
 
+    // State injection (sampled simulation)
+    input logic inject_write_enable,
+    input logic [4:0] inject_rd_address,
+    input data_t inject_data,
+
     output data_t rs1,
     output data_t rs2
 );
@@ -47,6 +52,10 @@ always @(posedge clk) begin
         for (int i = 2; i < 32; i++) begin
             registers[i] <= {DATA_WIDTH{1'b0}};
         end
+    end else if (inject_write_enable) begin
+        if (inject_rd_address > 0) begin
+            registers[inject_rd_address] <= inject_data;
+        end
     end else if (enable) begin
         if (warp_state == WARP_REQUEST) begin
             rs1 <= registers[decoded_rs1_address];
@@ -34,6 +34,11 @@ module top (
     data_t data_mem_write_data [8];
     logic [7:0] data_mem_write_ready;
 
+    // State injection is only used by the sampled simulation
+    state_inject_t state_inject = '0;
+    logic core_waiting_for_state;
+    data_t dispatched_block_id [1];
+
     gpu #(
         .DATA_MEM_NUM_CHANNELS(8),
         .INSTRUCTION_MEM_NUM_CHANNELS(8),
@@ -46,6 +51,10 @@ module top (
         .execution_start(execution_start),
         .execution_done(execution_done),
         .kernel_config(kernel_config),
+        .state_inject_hold(1'b0),
+        .state_inject(state_inject),
+        .core_waiting_for_state(core_waiting_for_state),
+        .dispatched_block_id(dispatched_block_id),
         .instruction_mem_read_valid(instruction_mem_read_valid),
         .instruction_mem_read_address(instruction_mem_read_address),
         .instruction_mem_read_ready(instruction_mem_read_ready),
@@ -0,0 +1,109 @@
+#include "analyzer.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+auto analyze_source(std::string_view source, const as::AnalyzerOptions &options = {}) -> as::KernelAnalysis {
+    const auto program = as::parse_program(source);
+    REQUIRE(program.has_value());
+    return as::analyze(*program, options);
+}
+
+auto register_strings(const std::vector<sim::Register> &registers) -> std::vector<std::string> {
+    auto strings = std::vector<std::string>{};
+    for (const auto &reg : registers) {
+        strings.push_back(reg.to_str());
+    }
+    return strings;
+}
+
+TEST_CASE("Instruction mix and arithmetic intensity") {
+    const auto analysis = analyze_source(".blocks 4\n"
+                                         ".warps 2\n"
+                                         "slli x5, x2, 6\n"
+                                         "add x5, x5, x1\n"
+                                         "lw x6, 0(x5)\n"
+                                         "lw x7, 256(x5)\n"
+                                         "add x8, x6, x7\n"
+                                         "sx.slt s5, x8, x6\n"
+                                         "sw x8, 512(x5)\n"
+                                         "halt\n"sv);
+    CHECK_EQ(analysis.blocks, 4);
+    CHECK_EQ(analysis.warps, 2);
+    REQUIRE_EQ(analysis.basic_blocks.size(), 1);
+
+    const auto &mix = analysis.mix;
+    CHECK_EQ(mix.total(), 8);
+    CHECK_EQ(mix.vector, 6);
+    CHECK_EQ(mix.scalar, 1);
+    CHECK_EQ(mix.vector_scalar, 1);
+    CHECK_EQ(mix.alu, 4);
+    CHECK_EQ(mix.loads, 2);
+    CHECK_EQ(mix.stores, 1);
+    CHECK_EQ(mix.control, 1);
+    REQUIRE(mix.arithmetic_intensity().has_value());
+    CHECK_EQ(*mix.arithmetic_intensity(), doctest::Approx(4.0 / 3.0));
+
+    // x5 is used by the second load and the store, x6 by the add after the second load
+    CHECK_EQ(register_strings(analysis.basic_blocks[0].live_across_loads), std::vector<std::string>{"x5", "x6"});
+
+    CHECK_FALSE(analyze_source("addi x5, x5, 1\nhalt\n"sv).mix.arithmetic_intensity().has_value());
+}
+
+TEST_CASE("Basic blocks and liveness around a loop") {
+    const auto analysis = analyze_source("s.addi s5, s0, 4\n"
+                                         "loop: lw x6, 0(x5)\n"
+                                         "add x7, x7, x6\n"
+                                         "s.addi s5, s5, -1\n"
+                                         "bne s5, s0, loop\n"
+                                         "sw x7, 0(x5)\n"
+                                         "halt\n"sv);
+    REQUIRE_EQ(analysis.basic_blocks.size(), 3);
+    const auto &body = analysis.basic_blocks[1];
+    CHECK_EQ(body.begin, 1);
+    CHECK_EQ(body.end, 5);
+    CHECK_EQ(body.labels, std::vector<std::string_view>{"loop"});
+    CHECK_EQ(body.mix.scalar, 2);
+    CHECK_EQ(body.mix.control, 1);
+
+    // The accumulator and the counter are needed by the next iteration, the address also by the store after it
+    CHECK_EQ(register_strings(body.live_across_loads), std::vector<std::string>{"x5", "x7", "s5"});
+    CHECK(analysis.basic_blocks[0].live_across_loads.empty());
+}
+
+TEST_CASE("Cycle estimate") {
+    const auto timing = sim::TimingParameters{};
+    const auto alu = timing.issue_cycles + timing.alu_wait_cycles + timing.retire_cycles;
+
+    SUBCASE("Instructions cost their stages") {
+        const auto analysis = analyze_source("addi x5, x5, 1\nhalt\n"sv);
+        REQUIRE_EQ(analysis.basic_blocks.size(), 1);
+        CHECK_EQ(analysis.basic_blocks[0].busy_cycles, 2 * alu);
+        CHECK_EQ(analysis.basic_blocks[0].warp_cycles, 2 * (alu + timing.fetch_cycles));
+        // Two warps, a single block
+        CHECK_EQ(analysis.cycles,
+                 timing.dispatch_cycles + std::max(4 * alu, 2 * (alu + timing.fetch_cycles)) + timing.drain_cycles);
+    }
+
+    SUBCASE("Vector accesses wait for every thread") {
+        const auto vector = analyze_source("lw x5, 0(x1)\nhalt\n"sv);
+        const auto scalar = analyze_source("s.lw s5, 0(s0)\nhalt\n"sv);
+        CHECK_EQ(scalar.basic_blocks[0].busy_cycles,
+                 alu + timing.issue_cycles + timing.memory_latency + timing.retire_cycles);
+        // 32 threads over 8 channels
+        CHECK_EQ(vector.basic_blocks[0].busy_cycles,
+                 scalar.basic_blocks[0].busy_cycles + 3 * timing.channel_occupancy);
+        CHECK_GT(vector.cycles, scalar.cycles);
+    }
+
+    SUBCASE("Blocks are spread over the cores") {
+        const auto options = as::AnalyzerOptions{.shape = {.num_cores = 2, .data_mem_channels = 8}};
+        const auto two = analyze_source(".blocks 2\naddi x5, x5, 1\nhalt\n"sv, options);
+        const auto three = analyze_source(".blocks 3\naddi x5, x5, 1\nhalt\n"sv, options);
+        CHECK_EQ(three.cycles - timing.drain_cycles, 2 * (two.cycles - timing.drain_cycles));
+    }
+}
@@ -1,7 +1,10 @@
 #pragma once
 #include "doctest.h"
 #include "instructions.hpp"
+#include "parser.hpp"
 #include "token.hpp"
+#include <string>
+#include <vector>
 
 inline void check_reg(const as::Token& token, sim::RegisterType type, std::uint32_t reg_num) {
     const auto data = sim::Register{.register_number = reg_num, .type = type};
@@ -30,3 +33,13 @@ inline void check_mnemonic(const as::Token& token, const std::string_view mnemon
     REQUIRE(m.has_value());
     REQUIRE_EQ(token.as<as::token::Mnemonic>().mnemonic, *m);
 }
+
+// The instructions of a program as source, without their labels
+inline auto instruction_strings(const as::parser::Program& program) -> std::vector<std::string> {
+    auto strings = std::vector<std::string>{};
+    for (auto instruction : program.instructions) {
+        instruction.label.reset();
+        strings.push_back(instruction.to_str());
+    }
+    return strings;
+}
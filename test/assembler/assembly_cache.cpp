@@ -0,0 +1,128 @@
+#include "assembly_cache.hpp"
+#include "emitter.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+namespace fs = std::filesystem;
+
+constexpr auto SOURCE = std::string_view{
+    ".blocks 2\n"
+    ".warps 3\n"
+    "start: addi x5, x5, 87\n"
+    "s.lw s1, 32(s2)\n"
+    "jalr x0, start\n"
+    "halt\n"};
+
+auto cache_directory() -> fs::path {
+    const auto directory = fs::temp_directory_path() / std::format("smol_gpu_{}_assembly_cache", ::getpid());
+    fs::remove_all(directory);
+    return directory;
+}
+
+TEST_CASE("Source hash") {
+    CHECK_EQ(as::hash_source(SOURCE), as::hash_source(std::string{SOURCE}));
+    CHECK_NE(as::hash_source(""), as::hash_source(std::string_view{"\0", 1}));
+    CHECK_NE(as::hash_source("halt\n"), as::hash_source("halt \n"));
+    // Differences in the bytes past the last full word
+    CHECK_NE(as::hash_source("addi x5, x5, 1"), as::hash_source("addi x5, x5, 2"));
+    CHECK_FALSE(as::assembler_version().empty());
+}
+
+auto to_hex(const std::array<std::uint8_t, 32>& digest) -> std::string {
+    auto hex = std::string{};
+    for (const auto byte : digest) {
+        hex += std::format("{:02x}", byte);
+    }
+    return hex;
+}
+
+TEST_CASE("SHA-256") {
+    CHECK_EQ(to_hex(as::sha256("")), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    CHECK_EQ(to_hex(as::sha256("abc")), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    // Padding that doesn't fit the last block
+    CHECK_EQ(to_hex(as::sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")),
+             "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    CHECK_EQ(to_hex(as::sha256(std::string(1000, 'a'))),
+             "41edece42d63e8d9bf515a9ba6932e1c20cbc9f5a5d134645adb5db1b9737ea3");
+}
+
+TEST_CASE("In-memory assembly cache") {
+    auto cache = as::AssemblyCache{};
+
+    const auto first = cache.assemble(SOURCE);
+    REQUIRE(first.has_value());
+    const auto program = as::parse_program(SOURCE);
+    REQUIRE(program.has_value());
+    const auto machine_code = as::translate_to_binary(*program);
+    const auto& contents = **first;
+    CHECK_EQ(contents.num_blocks, 2);
+    CHECK_EQ(contents.num_warps_per_block, 3);
+    REQUIRE_EQ(contents.instructions.size(), machine_code.size());
+    for (auto i = 0u; i < machine_code.size(); i++) {
+        CHECK_EQ(contents.instructions[i], machine_code[i].bits);
+    }
+
+    // The same source from a different buffer is a hit
+    const auto copy = std::string{SOURCE};
+    const auto second = cache.assemble(copy);
+    REQUIRE(second.has_value());
+    CHECK_EQ(first->get(), second->get());
+
+    const auto changed = cache.assemble(std::string{SOURCE} + "halt\n");
+    REQUIRE(changed.has_value());
+    CHECK_EQ((*changed)->instructions.size(), contents.instructions.size() + 1);
+
+    CHECK_FALSE(cache.assemble("addi x5, x5\n").has_value());
+    CHECK_FALSE(cache.assemble("addi x5, x5\n").has_value());
+
+    const auto stats = cache.stats();
+    CHECK_EQ(stats.memory_hits, 1);
+    CHECK_EQ(stats.disk_hits, 0);
+    CHECK_EQ(stats.misses, 2);
+}
+
+TEST_CASE("On-disk assembly cache") {
+    const auto directory = cache_directory();
+
+    auto first = as::AssemblyCache{directory};
+    const auto assembled = first.assemble(SOURCE);
+    REQUIRE(assembled.has_value());
+    CHECK_EQ(first.stats().misses, 1);
+
+    auto objects = std::vector<fs::path>{};
+    for (const auto& entry : fs::directory_iterator(directory)) {
+        objects.push_back(entry.path());
+    }
+    REQUIRE_EQ(objects.size(), 1);
+    CHECK_EQ(objects[0].extension(), ".kobj");
+    CHECK(objects[0].filename().string().starts_with(to_hex(as::sha256(SOURCE))));
+
+    SUBCASE("Another cache picks it up") {
+        auto second = as::AssemblyCache{directory};
+        const auto loaded = second.assemble(SOURCE);
+        REQUIRE(loaded.has_value());
+        CHECK_EQ(second.stats().disk_hits, 1);
+        CHECK_EQ(second.stats().misses, 0);
+        CHECK_EQ((*loaded)->instructions, (*assembled)->instructions);
+        CHECK_EQ((*loaded)->symbols, (*assembled)->symbols);
+        CHECK_EQ((*loaded)->source_lines, (*assembled)->source_lines);
+        CHECK_EQ((*loaded)->num_blocks, 2);
+        CHECK_EQ((*loaded)->num_warps_per_block, 3);
+    }
+
+    SUBCASE("Damaged objects get reassembled") {
+        fs::resize_file(objects[0], fs::file_size(objects[0]) - 1);
+        auto second = as::AssemblyCache{directory};
+        const auto loaded = second.assemble(SOURCE);
+        REQUIRE(loaded.has_value());
+        CHECK_EQ(second.stats().disk_hits, 0);
+        CHECK_EQ(second.stats().misses, 1);
+        CHECK_EQ((*loaded)->instructions, (*assembled)->instructions);
+        CHECK(sim::KernelObject::load(objects[0]).has_value());
+    }
+
+    fs::remove_all(directory);
+}
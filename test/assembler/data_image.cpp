@@ -0,0 +1,104 @@
+#include "data_image.hpp"
+#include "data_reader.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+namespace fs = std::filesystem;
+
+auto temp_path(std::string_view name) -> fs::path {
+    return fs::temp_directory_path() / std::format("smol_gpu_{}_{}", ::getpid(), name);
+}
+
+TEST_CASE("Data image round trip") {
+    const auto text_file = temp_path("data.txt");
+    const auto image_file = temp_path("data.dimg");
+    {
+        auto file = std::ofstream{text_file};
+        file << "0: 5\n1: 6\n2: 0x10\n100: 7\n101: 8\n2147483647: 9\n";
+    }
+
+    const auto text_data = as::read_data(text_file);
+    REQUIRE(text_data.has_value());
+    REQUIRE(sim::write_data_image(image_file, *text_data).has_value());
+    REQUIRE(sim::DataImage::is_data_image(image_file));
+    CHECK_FALSE(sim::DataImage::is_data_image(text_file));
+
+    const auto image = sim::DataImage::load(image_file);
+    REQUIRE(image.has_value());
+    CHECK_EQ(image->size(), 6);
+    const auto segments = image->segments();
+    REQUIRE_EQ(segments.size(), 3);
+    CHECK_EQ(segments[0].base_address, 0);
+    CHECK_EQ(segments[0].words.size(), 3);
+    CHECK_EQ(segments[0].words[2], 16);
+    CHECK_EQ(segments[1].base_address, 100);
+    CHECK_EQ(segments[1].words.size(), 2);
+    CHECK_EQ(segments[2].base_address, 2147483647u);
+    CHECK_EQ(segments[2].words.size(), 1);
+
+    // read_data picks the format by itself
+    const auto image_data = as::read_data(image_file);
+    REQUIRE(image_data.has_value());
+    CHECK_EQ(*image_data, *text_data);
+
+    // Loading on top of existing contents overwrites only the addresses in the image
+    auto memory = sim::data_memory_container_t{{1, 0}, {50, 1}};
+    image->load_into(memory);
+    CHECK_EQ(memory.size(), 7);
+    CHECK_EQ(memory.at(1), 6);
+    CHECK_EQ(memory.at(50), 1);
+
+    fs::remove(text_file);
+    fs::remove(image_file);
+}
+
+TEST_CASE("Empty data image") {
+    const auto image_file = temp_path("empty.dimg");
+    REQUIRE(sim::write_data_image(image_file, {}).has_value());
+    const auto image = sim::DataImage::load(image_file);
+    REQUIRE(image.has_value());
+    CHECK(image->segments().empty());
+    fs::remove(image_file);
+}
+
+TEST_CASE("Malformed data images") {
+    const auto image_file = temp_path("malformed.dimg");
+    REQUIRE(sim::write_data_image(image_file, {{0, 1}, {1, 2}, {10, 3}}).has_value());
+    const auto size = fs::file_size(image_file);
+
+    SUBCASE("Truncated") {
+        fs::resize_file(image_file, size - 1);
+        CHECK_FALSE(sim::DataImage::load(image_file).has_value());
+        fs::resize_file(image_file, size - sizeof(IData));
+        CHECK_FALSE(sim::DataImage::load(image_file).has_value());
+    }
+
+    SUBCASE("Trailing bytes") {
+        fs::resize_file(image_file, size + sizeof(IData));
+        CHECK_FALSE(sim::DataImage::load(image_file).has_value());
+    }
+
+    SUBCASE("Wrapping segment") {
+        auto file = std::fstream{image_file, std::ios::binary | std::ios::in | std::ios::out};
+        const auto base_address = IData{0xFFFFFFFF};
+        file.seekp(sizeof(sim::DataImageHeader) + offsetof(sim::DataImageSegment, base_address));
+        file.write(reinterpret_cast<const char*>(&base_address), sizeof(base_address));
+        file.close();
+        const auto image = sim::DataImage::load(image_file);
+        REQUIRE_FALSE(image.has_value());
+        CHECK(image.error().contains("wraps around"));
+    }
+
+    SUBCASE("Wrong version") {
+        auto file = std::fstream{image_file, std::ios::binary | std::ios::in | std::ios::out};
+        const auto version = sim::DATA_IMAGE_VERSION + 1;
+        file.seekp(offsetof(sim::DataImageHeader, version));
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.close();
+        CHECK_FALSE(sim::DataImage::load(image_file).has_value());
+        CHECK_FALSE(as::read_data(image_file).has_value());
+    }
+    fs::remove(image_file);
+}
@@ -0,0 +1,94 @@
+#include "data_reader.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+namespace fs = std::filesystem;
+
+auto temp_path(std::string_view name) -> fs::path {
+    return fs::temp_directory_path() / std::format("smol_gpu_{}_{}", ::getpid(), name);
+}
+
+auto read_text(std::string_view contents) -> std::expected<sim::data_memory_container_t, std::string> {
+    const auto path = temp_path("data.txt");
+    {
+        auto file = std::ofstream{path};
+        file << contents;
+    }
+    auto data = as::read_data(path);
+    fs::remove(path);
+    return data;
+}
+
+TEST_CASE("Text data format") {
+    SUBCASE("Single words") {
+        const auto data = read_text("0: 5\n1 : -1\n2:0x10\n\n# Comment\n3: 7 # Trailing comment");
+        REQUIRE(data.has_value());
+        CHECK_EQ(*data, sim::data_memory_container_t{{0, 5}, {1, 0xFFFFFFFF}, {2, 16}, {3, 7}});
+    }
+
+    SUBCASE("Arrays") {
+        const auto data = read_text("10: 1 2 3\n20: 4, 5, 6\n");
+        REQUIRE(data.has_value());
+        CHECK_EQ(*data, sim::data_memory_container_t{{10, 1}, {11, 2}, {12, 3}, {20, 4}, {21, 5}, {22, 6}});
+    }
+
+    SUBCASE("Fill") {
+        const auto data = read_text(".fill 100 1000 7\n");
+        REQUIRE(data.has_value());
+        REQUIRE_EQ(data->size(), 1000);
+        CHECK_EQ(data->begin()->first, 100);
+        CHECK_EQ(data->rbegin()->first, 1099);
+        for (const auto& [address, value] : *data) {
+            CHECK_EQ(value, 7);
+        }
+    }
+
+    SUBCASE("Sequence") {
+        const auto data = read_text(".seq 0 256 0 1\n.seq 256 256 0 3\n");
+        REQUIRE(data.has_value());
+        REQUIRE_EQ(data->size(), 512);
+        for (auto address = 0u; address < 256; address++) {
+            CHECK_EQ(data->at(address), address);
+            CHECK_EQ(data->at(256 + address), address * 3);
+        }
+    }
+
+    SUBCASE("Later lines overwrite earlier ones") {
+        const auto data = read_text(".fill 0 8 1\n2: 9 9\n.seq 6 4 100 -10\n");
+        REQUIRE(data.has_value());
+        CHECK_EQ(*data, sim::data_memory_container_t{{0, 1}, {1, 1}, {2, 9}, {3, 9}, {4, 1}, {5, 1},
+                                                     {6, 100}, {7, 90}, {8, 80}, {9, 70}});
+    }
+
+    SUBCASE("Include") {
+        const auto blob = temp_path("blob.bin");
+        const auto words = std::array<IData, 3>{1, 0xDEADBEEF, 3};
+        {
+            auto file = std::ofstream{blob, std::ios::binary};
+            file.write(reinterpret_cast<const char*>(words.data()), sizeof(words));
+        }
+        const auto data = read_text(std::format("0: 5\n.include 64 {}\n", blob.filename().string()));
+        fs::remove(blob);
+        REQUIRE(data.has_value());
+        CHECK_EQ(*data, sim::data_memory_container_t{{0, 5}, {64, 1}, {65, 0xDEADBEEF}, {66, 3}});
+    }
+}
+
+TEST_CASE("Text data format errors") {
+    const auto check_error = [](std::string_view contents, std::string_view expected) {
+        const auto data = read_text(contents);
+        REQUIRE_FALSE(data.has_value());
+        CHECK_MESSAGE(data.error().contains(expected), data.error());
+    };
+
+    check_error("0: 1\n5\n", ":2: Expected '<address>: <value>...'");
+    check_error("0:\n", ":1: Expected at least one value");
+    check_error("0: 12z\n", ":1: Unexpected characters");
+    check_error("0: 12abc\n", ":1: Failed to parse number");
+    check_error(".fill 0 4\n", ":1: Expected '.fill");
+    check_error(".seq 0 4 1\n", ":1: Expected '.seq");
+    check_error("0: 1\n.fill -1 2 0\n", ":2: 2 words at address 4294967295");
+    check_error(".include 0 does_not_exist.bin\n", ":1: Failed to open file");
+}
@@ -0,0 +1,153 @@
+#include "disassembler.hpp"
+#include "emitter.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+
+auto assemble(std::string_view source) -> sim::KernelObjectContents {
+    const auto program = as::parse_program(source);
+    REQUIRE(program.has_value());
+    return as::make_kernel_object(*program, as::translate_to_binary(*program), false);
+}
+
+auto word(std::string_view line) -> IData {
+    const auto contents = assemble(line);
+    REQUIRE_EQ(contents.instructions.size(), 1);
+    return contents.instructions.front();
+}
+
+TEST_CASE("Every instruction disassembles back into its source") {
+    // Immediates are written as their encoding
+    constexpr auto source = std::string_view{
+        ".blocks 1\n"
+        ".warps 1\n"
+        "start:\n"
+        "    lui x5, 74565\n"
+        "    s.auipc s6, 1\n"
+        "    addi x5, x1, 4095\n"
+        "    s.slti s2, s3, 12\n"
+        "    xori x6, x7, 255\n"
+        "    ori x8, x9, 1\n"
+        "    s.andi s10, s11, 2047\n"
+        "    slli x12, x13, 31\n"
+        "    s.srli s14, s15, 3\n"
+        "    srai x16, x17, 5\n"
+        "loop:\n"
+        "    add x16, x17, x18\n"
+        "    sub x19, x20, x21\n"
+        "    s.sll s22, s23, s24\n"
+        "    slt x25, x26, x27\n"
+        "    xor x28, x29, x30\n"
+        "    srl x31, x4, x5\n"
+        "    s.sra s5, s6, s7\n"
+        "    or x1, x2, x3\n"
+        "    and x4, x5, x6\n"
+        "    lb x7, 0(x8)\n"
+        "    lh x9, 2(x10)\n"
+        "    s.lw s11, 4095(s12)\n"
+        "    sb x13, 0(x14)\n"
+        "    sh x15, 32(x16)\n"
+        "    sw x17, 5(x18)\n"
+        "    beq s1, s0, start\n"
+        "    bne s2, s3, end\n"
+        "    blt s4, s5, loop\n"
+        "    bge s6, s7, 2\n"
+        "    jal s0, loop\n"
+        "    jalr s1, end\n"
+        "    jalr s0, 3(s4)\n"
+        "    sx.slt s1, x5, x6\n"
+        "    sx.slti s1, x5, 16\n"
+        "end:\n"
+        "    halt\n"};
+
+    const auto contents = assemble(source);
+    const auto symbols = sim::SymbolTable{contents.symbols};
+    auto listing = std::string{".blocks 1\n.warps 1\n"};
+    auto disassembler = sim::Disassembler{symbols};
+    disassembler.feed(contents.instructions, listing);
+    CHECK_EQ(disassembler.address(), contents.instructions.size());
+    CHECK_EQ(listing, source);
+
+    // And assembles back into the same machine code
+    CHECK_EQ(assemble(listing).instructions, contents.instructions);
+}
+
+TEST_CASE("Encodings are disassembled the way the decoder reads them") {
+    // The scalar store opcode is the one of the branches
+    CHECK_EQ(sim::disassemble(word("sb x5, 0(x6)") | (IData)1 << 6u), "beq s6, s5, 0");
+    // funct7 has to be exactly 0100000 for sub
+    CHECK_EQ(sim::disassemble(word("sub x5, x6, x7")), "sub x5, x6, x7");
+    CHECK_EQ(sim::disassemble(word("sub x5, x6, x7") | (IData)1 << 31u), "add x5, x6, x7");
+    // The shift amount of srai sits below funct7
+    CHECK_EQ(sim::disassemble(word("srli x5, x6, 3") | (IData)0b0100000 << 25u), "srai x5, x6, 3");
+    CHECK_EQ(word("srai x5, x6, 3"), word("srli x5, x6, 3") | (IData)0b0100000 << 25u);
+    // Nothing decodes funct3 011 of the ALU, loads or stores, nor the unused opcodes
+    CHECK_EQ(sim::disassemble(word("addi x5, x6, 1") | (IData)0b011 << 12u), ".word 0x00133293");
+    CHECK_EQ(sim::disassemble(0x0000007bu), ".word 0x0000007b");
+
+    // Offsets without a symbol at the target
+    CHECK_EQ(sim::disassemble(word("bne s1, s0, -2")), "bne s1, s0, -2");
+    CHECK_EQ(sim::disassemble(word("jal s0, -100000")), "jal s0, -100000");
+}
+
+TEST_CASE("Symbols") {
+    const auto symbols_list = std::vector<std::pair<std::string, IData>>{{"b", 2}, {"a", 2}, {"c", 7}};
+    const auto symbols = sim::SymbolTable{symbols_list, 0x100};
+    CHECK_EQ(symbols.find(0x102), "b");
+    CHECK_EQ(symbols.find(0x107), "c");
+    CHECK(symbols.find(0x103).empty());
+    CHECK(symbols.find(0).empty());
+    CHECK(symbols.find(0x108).empty());
+
+    // Branch targets are relative to the branch
+    CHECK_EQ(sim::disassemble(word("beq s1, s0, 5"), 0x102, symbols), "beq s1, s0, c");
+    CHECK_EQ(sim::disassemble(word("beq s1, s0, 5"), 0x103, symbols), "beq s1, s0, 5");
+
+    // Every label at an address gets a line, in the order of the table
+    auto listing = std::string{};
+    auto disassembler = sim::Disassembler{symbols, 0x101, true};
+    const auto halt = word("halt");
+    disassembler.feed(std::vector<IData>{halt}, listing);
+    disassembler.feed(std::vector<IData>{halt}, listing);
+    CHECK_EQ(listing, "    halt                            # 257: 0000007f\n"
+                      "b:\n"
+                      "a:\n"
+                      "    halt                            # 258: 0000007f\n");
+}
+
+TEST_CASE("Throughput") {
+    const auto contents = assemble("loop: addi x5, x5, 87\n"
+                                   "s.lw s1, 32(s2)\n"
+                                   "sx.slti s1, x5, 16\n"
+                                   "sw x7, 64(x5)\n"
+                                   "blt s1, s2, loop\n"
+                                   "add x7, x6, x5\n"
+                                   "jal s0, loop\n"
+                                   "halt\n");
+    const auto symbols = sim::SymbolTable{contents.symbols};
+
+    // A trace is a stream of addresses and instructions, annotated one instruction at a time into a reused buffer
+    constexpr auto NUM_INSTRUCTIONS = 2'000'000u;
+    auto line = std::string{};
+    line.reserve(128);
+    const auto capacity = line.capacity();
+    auto characters = std::size_t{0};
+    const auto start = std::chrono::steady_clock::now();
+    for (auto i = 0u; i < NUM_INSTRUCTIONS; i++) {
+        const auto address = i % (IData)contents.instructions.size();
+        line.clear();
+        sim::append_disassembly(line, contents.instructions[address], address, symbols);
+        characters += line.size();
+    }
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    MESSAGE(std::format("{:.1f} M instructions/s, {:.1f} MB/s of text", NUM_INSTRUCTIONS / seconds / 1e6,
+                        (double)characters / seconds / 1e6));
+
+    // The buffer never had to grow
+    CHECK_EQ(line.capacity(), capacity);
+    CHECK_GT(characters, NUM_INSTRUCTIONS * 8u);
+}
@@ -1,9 +1,11 @@
 #include "instructions.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "emitter.hpp"
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "assembler_helper.hpp"
 #include "doctest.h"
+#include <algorithm>
 #include <array>
 
 TEST_CASE("Single character tokens") {
@@ -119,6 +121,27 @@ TEST_CASE("Multiple tokens: Valid use cases") {
     }
 }
 
+TEST_CASE("Numbers out of range") {
+    for (const auto input : {"addi x1, x2, 2147483648"sv, "addi x1, x2, -2147483649"sv, "addi x1, x2, 99999999999999999999"sv}) {
+        SUBCASE(input.data()) {
+            const auto [tokens, errors] = as::collect_tokens(input);
+
+            REQUIRE_EQ(errors.size(), 1);
+            CHECK_EQ(errors[0].column, 14);
+            CHECK_EQ(tokens.size(), 5);
+        }
+    }
+
+    SUBCASE("The rest of the line is still lexed") {
+        const auto [tokens, errors] = as::collect_tokens("lw x1, 4294967296(x2)");
+
+        REQUIRE_EQ(errors.size(), 1);
+        REQUIRE_EQ(tokens.size(), 6);
+        CHECK(tokens[4].is_of_type<as::token::Register>());
+        CHECK(tokens[5].is_of_type<as::token::Rparen>());
+    }
+}
+
 TEST_CASE("Labels") {
     SUBCASE("No instruction line label") {
         const std::vector<std::string> input = {
@@ -130,7 +153,7 @@ TEST_CASE("Labels") {
         auto program_or_err = as::parse_program(input);
         REQUIRE(program_or_err.has_value());
 
-        const auto& [blocks, warps, instructions, label_mappings] = program_or_err.value();
+        const auto& [blocks, warps, instructions, label_mappings, globals] = program_or_err.value();
         REQUIRE(label_mappings.size() == 1);
         REQUIRE(label_mappings.contains("label1"));
         REQUIRE_EQ(label_mappings.at("label1"sv), 0);
@@ -146,7 +169,7 @@ TEST_CASE("Labels") {
         auto program_or_err = as::parse_program(input);
         REQUIRE(program_or_err.has_value());
 
-        const auto& [blocks, warps, instructions, label_mappings] = program_or_err.value();
+        const auto& [blocks, warps, instructions, label_mappings, globals] = program_or_err.value();
         REQUIRE(label_mappings.size() == 1);
         REQUIRE(label_mappings.contains("label2"));
         REQUIRE_EQ(label_mappings.at("label2"sv), 1);
@@ -162,7 +185,7 @@ TEST_CASE("Labels") {
         auto program_or_err = as::parse_program(input);
         REQUIRE(program_or_err.has_value());
 
-        const auto& [blocks, warps, instructions, label_mappings] = program_or_err.value();
+        const auto& [blocks, warps, instructions, label_mappings, globals] = program_or_err.value();
         REQUIRE(label_mappings.size() == 0);
     }
     SUBCASE("Multiple labels") {
@@ -176,7 +199,7 @@ TEST_CASE("Labels") {
         auto program_or_err = as::parse_program(input);
         REQUIRE(program_or_err.has_value());
 
-        const auto& [blocks, warps, instructions, label_mappings] = program_or_err.value();
+        const auto& [blocks, warps, instructions, label_mappings, globals] = program_or_err.value();
         REQUIRE(label_mappings.size() == 3);
         REQUIRE(label_mappings.contains("label1"));
         REQUIRE(label_mappings.contains("label2"));
@@ -198,3 +221,116 @@ TEST_CASE("Labels") {
         REQUIRE_FALSE(program_or_err.has_value());
     }
 }
+
+TEST_CASE("Whole file parsing") {
+    SUBCASE("Same program as parsing line by line") {
+        const std::vector<std::string> lines = {
+            ".blocks 4",
+            ".warps 2",
+            "",
+            "# A comment",
+            "start: addi x5, x5, 87 # A trailing comment",
+            "\tlw x6, 32(x5)\r",
+            "loop:",
+            "jalr x0, loop",
+            "halt",
+        };
+        auto source = std::string{};
+        for (const auto& line : lines) {
+            source += line + "\n";
+        }
+
+        const auto expected = as::parse_program(lines);
+        const auto program = as::parse_program(std::string_view{source});
+        REQUIRE(expected.has_value());
+        REQUIRE(program.has_value());
+
+        REQUIRE_EQ(program->blocks, expected->blocks);
+        REQUIRE_EQ(program->warps, expected->warps);
+        REQUIRE_EQ(program->label_mappings, expected->label_mappings);
+        REQUIRE_EQ(program->instructions.size(), expected->instructions.size());
+        for (auto i = 0u; i < program->instructions.size(); i++) {
+            REQUIRE_EQ(program->instructions[i].to_str(), expected->instructions[i].to_str());
+        }
+    }
+
+    SUBCASE("No newline at the end") {
+        const auto program = as::parse_program("addi x5, x5, 87\nhalt"sv);
+        REQUIRE(program.has_value());
+        REQUIRE_EQ(program->instructions.size(), 2);
+    }
+
+    SUBCASE("Errors carry line numbers") {
+        const auto program = as::parse_program("addi x5, x5, 87\n\nhalt\naddi x5, x5, $\nhalt x5\n"sv);
+        REQUIRE_FALSE(program.has_value());
+        REQUIRE_FALSE(program.error().empty());
+        for (const auto& error : program.error()) {
+            CHECK((error.line == 4 || error.line == 5));
+        }
+        CHECK(program.error().front().line == 4);
+        CHECK(program.error().back().line == 5);
+    }
+
+    SUBCASE("Reusing the token buffer") {
+        auto lexer = as::Lexer{"addi x5, x5, 87\nlabel:\n# Comment\n"sv};
+        auto tokens = std::pmr::vector<as::Token>{};
+        auto errors = std::vector<sim::Error>{};
+
+        REQUIRE(lexer.next_line(tokens, errors));
+        REQUIRE_EQ(tokens.size(), 6);
+        REQUIRE(lexer.next_line(tokens, errors));
+        REQUIRE_EQ(tokens.size(), 1);
+        check_label(tokens[0], "label");
+        REQUIRE(lexer.next_line(tokens, errors));
+        REQUIRE(tokens.empty());
+        REQUIRE_EQ(lexer.get_line_number(), 3);
+        REQUIRE_FALSE(lexer.next_line(tokens, errors));
+        REQUIRE(errors.empty());
+    }
+}
+
+TEST_CASE("Parallel parsing") {
+    // Large enough to be split into several pieces
+    auto generate_source = [](bool with_errors) {
+        auto source = std::string{};
+        for (auto i = 0u; i < 40000; i++) {
+            source += std::format("label_{}: addi x5, x5, {}\n", i, i % 2048);
+            source += "    s.lw s1, 32(s2) # Comment\n";
+            source += std::format("    jalr x0, label_{}\n", i % 600); // Within the 12 bit immediate
+            if (with_errors && i % 9000 == 0) {
+                // Duplicates of labels defined far earlier, an error and a directive in every piece
+                source += std::format("label_{}: halt\n", i / 7);
+                source += "addi x5, x5, $\n";
+                source += ".warps 2\n";
+            }
+        }
+        return source;
+    };
+
+    for (const auto with_errors : {false, true}) {
+        const auto source = generate_source(with_errors);
+        const auto expected = as::parse_program(std::string_view{source});
+
+        for (const auto num_threads : {0u, 1u, 2u, 3u, 8u}) { // 0 runs on one thread
+            SUBCASE(std::format("Threads: {}, with errors: {}", num_threads, with_errors).data()) {
+                const auto program = as::parse_program_parallel(source, num_threads);
+                REQUIRE_EQ(program.has_value(), expected.has_value());
+
+                if (!expected.has_value()) {
+                    REQUIRE_EQ(program.error(), expected.error());
+                    continue;
+                }
+
+                REQUIRE_EQ(program->blocks, expected->blocks);
+                REQUIRE_EQ(program->warps, expected->warps);
+                REQUIRE_EQ(program->label_mappings, expected->label_mappings);
+                REQUIRE_EQ(program->instructions.size(), expected->instructions.size());
+
+                const auto expected_bits = as::translate_to_binary(*expected);
+                const auto bits = as::translate_to_binary(*program, num_threads);
+                REQUIRE(std::ranges::equal(bits, expected_bits, {}, &sim::InstructionBits::bits,
+                                           &sim::InstructionBits::bits));
+            }
+        }
+    }
+}
@@ -1,8 +1,14 @@
+#include "decoder.hpp"
+#include "emitter.hpp"
 #include "instructions.hpp"
 #include "lexer.hpp"
+#include "parser.hpp"
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 #include <array>
+#include <format>
+#include <string>
+#include <vector>
 
 TEST_CASE("Lexing instructions") {
     std::string_view input;
@@ -102,3 +108,190 @@ TEST_CASE("Lexing labels") {
 
 
 }
+
+TEST_CASE("Mnemonic lookup") {
+    for (auto i = 0u; i < sim::NUM_MNEMONIC_NAMES; i++) {
+        const auto name = static_cast<sim::MnemonicName>(i);
+        const auto spelling = std::string{sim::to_string(name)};
+
+        SUBCASE(std::format("Mnemonic: {}", spelling).data()) {
+            REQUIRE_EQ(sim::str_to_mnemonic_name(spelling), name);
+            REQUIRE_FALSE(sim::str_to_mnemonic_name("s." + spelling).has_value());
+
+            const auto vector = sim::str_to_mnemonic(spelling);
+            REQUIRE(vector.has_value());
+            REQUIRE_EQ(vector->get_name(), name);
+            REQUIRE_EQ(vector->to_str(), spelling);
+
+            const auto scalar = sim::str_to_mnemonic("s." + spelling);
+            REQUIRE(scalar.has_value());
+            REQUIRE_EQ(scalar->get_name(), name);
+            REQUIRE(scalar->is_scalar());
+            REQUIRE_EQ(scalar->to_str(), "s." + spelling);
+
+            REQUIRE_EQ(sim::str_to_opcode(spelling), (IData)sim::name_to_determinant(name).opcode);
+            REQUIRE_EQ(sim::str_to_opcode("s." + spelling), sim::to_scalar((IData)sim::name_to_determinant(name).opcode));
+        }
+    }
+
+    for (const auto &word : {"", "s.", "sx.", "s.s.addi", "S.addi", "ADDI", "addi.", "ad", "addix", "sx.add", "x.slt"}) {
+        SUBCASE(std::format("Not a mnemonic: '{}'", word).data()) {
+            REQUIRE_FALSE(sim::str_to_mnemonic(word).has_value());
+            REQUIRE_FALSE(sim::str_to_opcode(word).has_value());
+        }
+    }
+}
+
+TEST_CASE("Branch and jump targets") {
+    SUBCASE("Labels resolve to instruction offsets") {
+        const auto program = as::parse_program(R"(
+            s.addi s6, s0, 10
+            loop:
+            s.addi s5, s5, 1
+            blt s5, s6, loop
+            beq s5, s6, done
+            jal s3, loop
+            done:
+            bne s5, s0, -4
+            jal s3, 3
+            halt
+        )"sv);
+        REQUIRE(program.has_value());
+
+        const auto machine_code = as::translate_to_binary(*program);
+        REQUIRE_EQ(machine_code.size(), 8);
+        const auto expected_offsets = std::array<std::pair<std::size_t, IData>, 5>{{
+            {2, (IData)-1}, {3, 2}, {4, (IData)-3}, {5, (IData)-4}, {6, 3},
+        }};
+        for (const auto &[index, offset] : expected_offsets) {
+            CHECK_EQ(sim::decode(machine_code[index].bits).immediate, offset);
+        }
+    }
+
+    SUBCASE("Encoding round trips through the decoder") {
+        for (const auto offset : {0, 1, -1, 2, 17, -1000, 2047, -2048}) {
+            CHECK_EQ(sim::decode(sim::instructions::beq(1_s, 2_s, (IData)offset)).immediate, (IData)offset);
+        }
+        for (const auto offset : {0, 1, -1, 3, 2048, -70000, (1 << 19) - 1, -(1 << 19)}) {
+            CHECK_EQ(sim::decode(sim::instructions::jal(1_s, (IData)offset)).immediate, (IData)offset);
+        }
+    }
+
+    SUBCASE("Undefined labels") {
+        for (const auto source : {"beq s1, s2, nowhere\nhalt\n"sv, "jal s1, nowhere\nhalt\n"sv, "jalr x0, nowhere\nhalt\n"sv}) {
+            const auto program = as::parse_program(source);
+            REQUIRE_FALSE(program.has_value());
+            REQUIRE_EQ(program.error().size(), 1);
+            CHECK(program.error().front().message.contains("Undefined label 'nowhere'"));
+            CHECK_EQ(program.error().front().line, 1);
+        }
+    }
+
+    SUBCASE("Targets out of range") {
+        auto source = std::string{"start:\n"};
+        for (auto i = 0u; i < 3000; i++) {
+            source += "addi x5, x5, 1\n";
+        }
+        source += "bge s1, s2, start\njal s1, start\nhalt\n";
+
+        const auto program = as::parse_program(std::string_view{source});
+        REQUIRE_FALSE(program.has_value());
+        REQUIRE_EQ(program.error().size(), 1);
+        CHECK(program.error().front().message.contains("Branch target is -3000 instructions away"));
+        CHECK_EQ(program.error().front().line, 3002);
+    }
+
+    SUBCASE("Branches compare scalar registers") {
+        CHECK_FALSE(as::parse_program("beq x1, x2, 0\n"sv).has_value());
+        CHECK(as::parse_program("beq s1, s2, 0\n"sv).has_value());
+    }
+}
+
+TEST_CASE("Immediate ranges") {
+    // Sign extended or the raw bits of the field
+    for (const auto source : {"addi x5, x0, -2048\n"sv, "xori x5, x5, 4095\n"sv, "lw x5, -1(x1)\n"sv,
+                              "sw x5, 2047(x1)\n"sv, "jalr s0, -2048(s1)\n"sv, "lui x5, 0xFFFFF\n"sv,
+                              "lui x5, -524288\n"sv}) {
+        CAPTURE(source);
+        CHECK(as::parse_program(source).has_value());
+    }
+    for (const auto source : {"addi x5, x0, 5000\n"sv, "addi x5, x0, -2049\n"sv, "lw x5, 4096(x1)\n"sv,
+                              "sw x5, -3000(x1)\n"sv, "jalr s0, 4096(s1)\n"sv, "lui x5, 0x100000\n"sv}) {
+        CAPTURE(source);
+        const auto program = as::parse_program(source);
+        REQUIRE_FALSE(program.has_value());
+        REQUIRE_EQ(program.error().size(), 1);
+        CHECK(program.error().front().message.contains("doesn't fit"));
+    }
+    // funct7 sits above the shift amount
+    CHECK(as::parse_program("srai x5, x5, 31\n"sv).has_value());
+    for (const auto source : {"slli x5, x5, 32\n"sv, "srai x5, x5, -1\n"sv, "s.srli s5, s5, 4095\n"sv}) {
+        CAPTURE(source);
+        const auto program = as::parse_program(source);
+        REQUIRE_FALSE(program.has_value());
+        CHECK(program.error().front().message.contains("Shift amount"));
+    }
+}
+
+TEST_CASE("Pseudo-instructions") {
+    auto expand = [](std::string_view source) {
+        const auto program = as::parse_program(source);
+        REQUIRE(program.has_value());
+        auto strings = std::vector<std::string>{};
+        for (const auto &instruction : program->instructions) {
+            strings.push_back(instruction.to_str());
+        }
+        return strings;
+    };
+
+    SUBCASE("Expansions") {
+        CHECK_EQ(expand("mv x5, x6\n"sv), std::vector<std::string>{"addi x5, x6, 0"});
+        CHECK_EQ(expand("end: halt\n"sv), std::vector<std::string>{"end: halt"});
+        CHECK_EQ(expand("s.mv s5, s6\n"sv), std::vector<std::string>{"s.addi s5, s6, 0"});
+        CHECK_EQ(expand("not x5, x6\n"sv), std::vector<std::string>{"xori x5, x6, 4095"});
+        CHECK_EQ(expand("s.neg s5, s6\n"sv), std::vector<std::string>{"s.sub s5, s0, s6"});
+        CHECK_EQ(expand("nop\n"sv), std::vector<std::string>{"addi x0, x0, 0"});
+        CHECK_EQ(expand("j 2\n"sv), std::vector<std::string>{"jal s0, 2"});
+        CHECK_EQ(expand("li x5, 100\n"sv), std::vector<std::string>{"addi x5, x0, 100"});
+        CHECK_EQ(expand("s.li s5, -1\n"sv), std::vector<std::string>{"s.addi s5, s0, 4095"});
+        CHECK_EQ(expand("li x5, 0x12345000\n"sv), std::vector<std::string>{"lui x5, 74565"});
+        // Bit 11 is set, the addi subtracts, so the upper part is one more
+        CHECK_EQ(expand("li x5, 0x12345800\n"sv), std::vector<std::string>{"lui x5, 74566", "addi x5, x5, 2048"});
+    }
+
+    SUBCASE("Labels, constants and jumps") {
+        const auto program = as::parse_program(".equ BIG, 0x7FFFFFFF\nstart: li x5, BIG\nj start\n"sv);
+        REQUIRE(program.has_value());
+        REQUIRE_EQ(program->instructions.size(), 3);
+        CHECK_EQ(program->label_mappings.at("start"), 0);
+        CHECK_EQ(sim::decode(as::translate_to_binary(*program)[2].bits).immediate, (IData)-2);
+    }
+
+    SUBCASE("li loads the value") {
+        for (const auto value : {0, 1, -1, 2047, -2048, 2048, -2049, 4095, 4096, 0x800, (std::int32_t)0xFFFFF800,
+                                 0x7FFFFFFF, (std::int32_t)0x80000000, 0x12345678, (std::int32_t)0xDEADBEEF, -4096}) {
+            const auto source = std::format("li x5, {}\n", value);
+            const auto program = as::parse_program(std::string_view{source});
+            REQUIRE(program.has_value());
+            const auto fits = value >= -2048 && value < 2048;
+            CHECK_EQ(program->instructions.size(), fits || (value & 0xFFF) == 0 ? 1 : 2);
+
+            auto reg = IData{0};
+            for (const auto &bits : as::translate_to_binary(*program)) {
+                const auto decoded = sim::decode(bits.bits);
+                reg = decoded.reg_input_mux == sim::RegInputMux::IMMEDIATE
+                          ? decoded.immediate
+                          : sim::alu(decoded.alu_instruction, 0, decoded.rs1 == 0 ? 0 : reg, 0, decoded.immediate);
+            }
+            CHECK_MESSAGE(reg == (IData)value, source);
+        }
+    }
+
+    SUBCASE("Errors") {
+        for (const auto source : {"li x5\n"sv, "mv x5, 3\n"sv, "nop x5\n"sv, "li x5, 3, 4\n"sv, "li s5, 3\n"sv,
+                                  "li x5, 2147483648\n"sv}) {
+            const auto program = as::parse_program(source);
+            CHECK_FALSE_MESSAGE(program.has_value(), source);
+        }
+    }
+}
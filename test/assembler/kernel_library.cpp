@@ -0,0 +1,85 @@
+// Runs the kernel library (kernels/, see aslib/kernel_library.hpp) on the executor, the RTL runs are in
+// test/gpu/kernel_library_test.cpp
+
+#include "kernel_library.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <algorithm>
+#include <array>
+#include <string>
+#include <tuple>
+
+namespace {
+
+auto link(std::string_view routine) -> sim::KernelObjectContents {
+    const auto image = as::link_kernel_routine(KERNELS_DIR, routine);
+    if (!image.has_value()) {
+        for (const auto &error : image.error()) {
+            MESSAGE(error);
+        }
+    }
+    REQUIRE(image.has_value());
+    return *image;
+}
+
+} // namespace
+
+TEST_CASE("Every routine matches the reference") {
+    // Sizes below, at and above a warp, the grid and several strides of it, with blocks that aren't a power of two
+    constexpr auto CONFIGS = std::array{
+        std::tuple{16u, 1u, 1u}, std::tuple{48u, 1u, 2u},   std::tuple{512u, 2u, 1u},
+        std::tuple{1008u, 3u, 2u}, std::tuple{4096u, 8u, 2u}, std::tuple{80u, 5u, 1u},
+    };
+    for (const auto routine : as::KERNEL_ROUTINES) {
+        const auto image = link(routine);
+        for (const auto [num_elements, num_blocks, num_warps] : CONFIGS) {
+            CAPTURE(routine);
+            CAPTURE(num_elements);
+            CAPTURE(num_blocks);
+            CAPTURE(num_warps);
+            const auto job = as::make_kernel_job(routine, num_elements, num_blocks, num_warps, num_elements);
+            REQUIRE(job.has_value());
+            const auto memory = as::execute_kernel_job(*job, image.instructions);
+            for (const auto &error : as::check_kernel_job(*job, memory)) {
+                FAIL_CHECK(error);
+            }
+        }
+    }
+}
+
+TEST_CASE("Routines only link grid.as") {
+    for (const auto routine : as::KERNEL_ROUTINES) {
+        const auto image = link(routine);
+        CHECK_FALSE(image.relocatable);
+        CHECK(std::ranges::any_of(image.symbols, [](const auto &symbol) { return symbol.first == "grid_setup"; }));
+    }
+}
+
+TEST_CASE("Jobs the routines can't run are rejected") {
+    CHECK_FALSE(as::make_kernel_job("sort", 64, 1, 1).has_value());
+    CHECK_FALSE(as::make_kernel_job("memcpy", 0, 1, 1).has_value());
+    CHECK_FALSE(as::make_kernel_job("memcpy", 64, 0, 1).has_value());
+    // scan adds up the warps of the grid with a single one
+    CHECK(as::make_kernel_job("scan", 64, 16, 2).has_value());
+    CHECK_FALSE(as::make_kernel_job("scan", 64, 17, 2).has_value());
+    // Whole rows of C
+    CHECK_FALSE(as::make_kernel_job("matmul", 40, 1, 1).has_value());
+}
+
+TEST_CASE("Multi-pass routines launch the grid, then a single warp") {
+    const auto reduce = as::make_kernel_job("reduce", 1000, 4, 2);
+    REQUIRE(reduce.has_value());
+    REQUIRE_EQ(reduce->launches.size(), 2);
+    CHECK_EQ(reduce->launches[0].num_blocks, 4);
+    CHECK_EQ(reduce->launches[1].num_blocks, 1);
+    CHECK_EQ(reduce->launches[1].num_warps_per_block, 1);
+
+    const auto scan = as::make_kernel_job("scan", 1000, 4, 2);
+    REQUIRE(scan.has_value());
+    CHECK_EQ(scan->launches.size(), 3);
+
+    // The first launch counts, the others merge down to one histogram
+    const auto histogram = as::make_kernel_job("histogram", 1000, 4, 2);
+    REQUIRE(histogram.has_value());
+    CHECK_GT(histogram->launches.size(), 1);
+}
@@ -0,0 +1,98 @@
+#include "emitter.hpp"
+#include "executor.hpp"
+#include "kernel_literal.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <span>
+#include <vector>
+
+using namespace as::literals;
+using namespace sim::instructions;
+
+// Assembled by the compiler, nothing is left to do at run time
+constexpr auto SCALAR_LOOP = as::kernel<".blocks 2\n"
+                                        ".warps 2\n"
+                                        "s.addi s6, s0, 16       # Number of iterations\n"
+                                        "loop:\n"
+                                        "s.addi s5, s5, 1\n"
+                                        "addi x5, x5, 3\n"
+                                        "blt s5, s6, loop        # Loop while s5 < s6\n"
+                                        "slli x6, x2, 6\n"
+                                        "add x6, x6, x1\n"
+                                        "sw x5, 0(x6)\n"
+                                        "halt\n">();
+static_assert(SCALAR_LOOP.size() == 8);
+static_assert(SCALAR_LOOP[7] == 0b1111111);
+
+auto assemble(std::string_view source) -> std::vector<IData> {
+    const auto program = as::parse_program(source);
+    REQUIRE(program.has_value());
+    auto words = std::vector<IData>{};
+    for (const auto &instruction : as::translate_to_binary(*program)) {
+        words.push_back(instruction.bits);
+    }
+    return words;
+}
+
+template <std::size_t N>
+auto to_vector(const std::array<IData, N> &kernel) -> std::vector<IData> {
+    return {kernel.begin(), kernel.end()};
+}
+
+TEST_CASE("Kernel literals match the assembler") {
+    CHECK_EQ(to_vector(SCALAR_LOOP), assemble(".blocks 2\n"
+                                              ".warps 2\n"
+                                              "s.addi s6, s0, 16\n"
+                                              "loop:\n"
+                                              "s.addi s5, s5, 1\n"
+                                              "addi x5, x5, 3\n"
+                                              "blt s5, s6, loop\n"
+                                              "slli x6, x2, 6\n"
+                                              "add x6, x6, x1\n"
+                                              "sw x5, 0(x6)\n"
+                                              "halt\n"));
+
+    static constexpr char every_format[] = "start: lui x5, 0x12345\n"
+                                           "s.auipc s5, 1\n"
+                                           "xori x6, x5, -1\n"
+                                           "sx.slti s1, x6, 0b101\n"
+                                           "sx.slt s2, x5, x6\n"
+                                           "s.sub s7, s5, s2\n"
+                                           "lw x7, -32(x5)\n"
+                                           "s.lh s8, 010(s7)\n"
+                                           "sb x7, 65(x5)\n"
+                                           "srai x8, x7, 31\n"
+                                           "s.slli s9, s8, 2\n"
+                                           "beq s5, s0, end\n"
+                                           "jal s3, start\n"
+                                           "jalr s4, 2(s3)\n"
+                                           "jalr s0, start\n"
+                                           "end: halt\n";
+    CHECK_EQ(to_vector(as::kernel<every_format>()), assemble(every_format));
+    CHECK_EQ(to_vector("addi x5, x1, 1 # comment\n\nbne s5, s6, -1\n"_kernel),
+             assemble("addi x5, x1, 1 # comment\n\nbne s5, s6, -1\n"));
+}
+
+TEST_CASE("Kernel literals match the instruction constructors") {
+    constexpr auto kernel = "addi x5, x1, 7\nsrai x6, x5, 2\nadd x7, x5, x6\ns.lw s5, 4(s0)\nsw x7, 5(x1)\nhalt"_kernel;
+    CHECK_EQ(kernel[0], (IData)addi(5_x, 1_x, 7));
+    CHECK_EQ(kernel[1], (IData)srai(6_x, 5_x, 2));
+    CHECK_EQ(kernel[2], (IData)add(7_x, 5_x, 6_x));
+    CHECK_EQ(kernel[3], (IData)lw(5_s, 0_s, 4).make_scalar());
+    CHECK_EQ(kernel[4], (IData)sw(1_x, 7_x, 5));
+    CHECK_EQ(kernel[5], (IData)halt());
+}
+
+TEST_CASE("Store offsets are encoded where the decoder reads them") {
+    constexpr auto kernel = "addi x5, x1, 40\nsw x5, 5(x1)\nhalt\n"_kernel;
+    CHECK_EQ(sim::decode(kernel[1]).immediate, 5);
+
+    auto executor = sim::Executor{sim::ExecutorConfig{.threads_per_warp = 4, .num_blocks = 1, .num_warps_per_block = 1},
+                                  std::span<const IData>{kernel}};
+    executor.run();
+    REQUIRE(executor.done());
+    for (auto thread = IData{0}; thread < 4; thread++) {
+        CHECK_EQ(executor.get_memory().at(thread + 5), thread + 40);
+    }
+}
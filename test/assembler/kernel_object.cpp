@@ -0,0 +1,116 @@
+#include "emitter.hpp"
+#include "kernel_object.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+namespace fs = std::filesystem;
+
+auto temp_path(std::string_view name) -> fs::path {
+    return fs::temp_directory_path() / std::format("smol_gpu_{}_{}", ::getpid(), name);
+}
+
+TEST_CASE("Kernel object round trip") {
+    constexpr auto source = std::string_view{
+        ".blocks 3\n"
+        ".warps 2\n"
+        "start: addi x5, x5, 87\n"
+        "\n"
+        "# Comment\n"
+        "s.lw s1, 32(s2)\n"
+        "loop:\n"
+        "jalr x0, loop\n"
+        "end: halt\n"};
+
+    const auto program = as::parse_program(source);
+    REQUIRE(program.has_value());
+    const auto machine_code = as::translate_to_binary(*program);
+    const auto path = temp_path("round_trip.kobj");
+
+    for (const auto with_source_lines : {true, false}) {
+        SUBCASE(std::format("With source lines: {}", with_source_lines).data()) {
+            const auto contents = as::make_kernel_object(*program, machine_code, with_source_lines);
+            REQUIRE(sim::write_kernel_object(path, contents).has_value());
+            REQUIRE(sim::KernelObject::is_kernel_object(path));
+
+            const auto object = sim::KernelObject::load(path);
+            REQUIRE(object.has_value());
+            CHECK_EQ(object->header().num_blocks, 3);
+            CHECK_EQ(object->header().num_warps_per_block, 2);
+            CHECK_EQ(object->header().base_instructions_address, 0);
+
+            const auto instructions = object->instructions();
+            REQUIRE_EQ(instructions.size(), machine_code.size());
+            for (auto i = 0u; i < instructions.size(); i++) {
+                CHECK_EQ(instructions[i], machine_code[i].bits);
+            }
+
+            auto symbols = std::unordered_map<std::string_view, IData>{};
+            for (const auto& symbol : object->symbols()) {
+                symbols[object->symbol_name(symbol)] = symbol.instruction;
+            }
+            CHECK_EQ(symbols.size(), 3);
+            CHECK_EQ(symbols.at("start"), 0);
+            CHECK_EQ(symbols.at("loop"), 2);
+            CHECK_EQ(symbols.at("end"), 3);
+
+            if (with_source_lines) {
+                const auto lines = object->source_lines();
+                REQUIRE_EQ(lines.size(), 4);
+                CHECK_EQ(lines[0], 3);
+                CHECK_EQ(lines[1], 6);
+                CHECK_EQ(lines[2], 8);
+                CHECK_EQ(lines[3], 9);
+            } else {
+                CHECK(object->source_lines().empty());
+            }
+
+            auto memory = std::unordered_map<IData, IData>{};
+            object->load_instructions(memory);
+            CHECK_EQ(memory.size(), machine_code.size());
+            CHECK_EQ(memory.at(3), machine_code[3].bits);
+        }
+    }
+    fs::remove(path);
+}
+
+TEST_CASE("Malformed kernel objects") {
+    const auto path = temp_path("malformed.kobj");
+    auto contents = sim::KernelObjectContents{.num_blocks = 1, .num_warps_per_block = 1};
+    contents.instructions = {1, 2, 3};
+    contents.symbols = {{"label", 1}};
+    REQUIRE(sim::write_kernel_object(path, contents).has_value());
+    const auto size = fs::file_size(path);
+
+    SUBCASE("Truncated") {
+        fs::resize_file(path, size - 1);
+        CHECK_FALSE(sim::KernelObject::load(path).has_value());
+    }
+
+    SUBCASE("Wrong version") {
+        auto file = std::fstream{path, std::ios::binary | std::ios::in | std::ios::out};
+        const auto version = sim::KERNEL_OBJECT_VERSION + 1;
+        file.seekp(offsetof(sim::KernelObjectHeader, version));
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.close();
+        const auto object = sim::KernelObject::load(path);
+        REQUIRE_FALSE(object.has_value());
+        CHECK(object.error().contains("version"));
+    }
+
+    SUBCASE("Assembly source") {
+        auto file = std::ofstream{path, std::ios::trunc};
+        file << "addi x5, x5, 87\nhalt\n";
+        file.close();
+        CHECK_FALSE(sim::KernelObject::is_kernel_object(path));
+        CHECK_FALSE(sim::KernelObject::load(path).has_value());
+    }
+
+    SUBCASE("Mismatched source lines") {
+        contents.source_lines = {1};
+        CHECK_FALSE(sim::write_kernel_object(path, contents).has_value());
+    }
+    fs::remove(path);
+}
@@ -0,0 +1,140 @@
+// Lexing and assembly throughput and heap allocation counts on a large generated kernel,
+// run the test with -s to see the numbers
+
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "emitter.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+
+// Counts every heap allocation in this binary
+namespace {
+std::atomic<std::size_t> heap_allocations{0};
+}
+
+auto operator new(std::size_t size) -> void * {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+// std::pmr::new_delete_resource goes through the aligned versions
+auto operator new(std::size_t size, std::align_val_t alignment) -> void * {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    const auto align = static_cast<std::size_t>(alignment);
+    if (auto *ptr = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+constexpr auto NUM_LINES = 200000u; // Multiple of the 8 line block below
+
+auto generate_source() -> std::string {
+    constexpr auto body = std::array<std::string_view, 6>{
+        "    lw x6, 0x20(x5)  # Load the next element\n",
+        "    s.addi s1, s2, 0b101\n",
+        "    add x7, x6, x5\n",
+        "\n",
+        "    sw x7, 64(x5)\n",
+        "# Just a comment\n",
+    };
+
+    auto source = std::string{".blocks 4\n.warps 2\n"};
+    for (auto i = 0u; i < NUM_LINES; i += body.size() + 2) {
+        source += std::format("label_{}: addi x5, x5, 87\n", i);
+        for (const auto line : body) {
+            source += line;
+        }
+        source += std::format("    jalr x0, label_{}\n", i % 2048); // Within the 12 bit immediate
+    }
+    return source;
+}
+
+TEST_CASE("Lexer throughput") {
+    const auto source = generate_source();
+
+    auto lexer = as::Lexer{source};
+    auto tokens = std::pmr::vector<as::Token>{};
+    auto errors = std::vector<sim::Error>{};
+    auto num_tokens = std::size_t{0};
+
+    const auto start = std::chrono::steady_clock::now();
+    while (lexer.next_line(tokens, errors)) {
+        num_tokens += tokens.size();
+    }
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    REQUIRE(errors.empty());
+    REQUIRE_EQ(lexer.get_line_number(), NUM_LINES + 2);
+    MESSAGE(std::format("Lexed {} lines ({} tokens, {:.1f} MB) in {:.3f} s: {:.1f} MB/s, {:.1f} Mtokens/s", NUM_LINES,
+                        num_tokens, source.size() / 1e6, seconds, source.size() / 1e6 / seconds,
+                        num_tokens / 1e6 / seconds));
+}
+
+TEST_CASE("Assembler throughput") {
+    const auto source = generate_source();
+
+    auto arena = as::Arena{};
+    const auto start = std::chrono::steady_clock::now();
+    const auto program = as::parse_program(std::string_view{source}, &arena);
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    REQUIRE(program.has_value());
+    MESSAGE(std::format("Parsed {} instructions in {:.3f} s: {:.1f} MB/s", program->instructions.size(), seconds,
+                        source.size() / 1e6 / seconds));
+}
+
+TEST_CASE("Parallel assembler throughput") {
+    const auto source = generate_source();
+
+    for (const auto num_threads : {1u, std::max(2u, std::thread::hardware_concurrency())}) {
+        auto arena = as::Arena{};
+        const auto start = std::chrono::steady_clock::now();
+        const auto program = as::parse_program_parallel(source, num_threads, &arena);
+        REQUIRE(program.has_value());
+        const auto machine_code = as::translate_to_binary(*program, num_threads);
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        REQUIRE_EQ(machine_code.size(), program->instructions.size());
+        MESSAGE(std::format("Assembled {} instructions on {} thread(s) in {:.3f} s: {:.1f} MB/s", machine_code.size(),
+                            num_threads, seconds, source.size() / 1e6 / seconds));
+    }
+}
+
+TEST_CASE("Assembler allocations") {
+    const auto source = generate_source();
+
+    auto before = heap_allocations.load();
+    {
+        const auto program = as::parse_program(std::string_view{source});
+        REQUIRE(program.has_value());
+    }
+    const auto without_arena = heap_allocations.load() - before;
+
+    before = heap_allocations.load();
+    {
+        auto arena = as::Arena{};
+        const auto program = as::parse_program(std::string_view{source}, &arena);
+        REQUIRE(program.has_value());
+    }
+    const auto with_arena = heap_allocations.load() - before;
+
+    MESSAGE(std::format("Heap allocations for {} lines: {} without an arena, {} with one", NUM_LINES, without_arena,
+                        with_arena));
+    // Only the arena's own chunks, which grow geometrically
+    CHECK(with_arena < 64);
+    CHECK(with_arena < without_arena);
+}
@@ -0,0 +1,179 @@
+#include "emitter.hpp"
+#include "executor.hpp"
+#include "kernel_object.hpp"
+#include "linker.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+namespace fs = std::filesystem;
+
+auto module(std::string name, std::string_view source, std::optional<IData> address = std::nullopt) -> as::LinkInput {
+    const auto program = as::parse_module(source);
+    if (!program.has_value()) {
+        for (const auto &error : program.error()) {
+            MESSAGE(error.line, ": ", error.message);
+        }
+    }
+    REQUIRE(program.has_value());
+    return as::LinkInput{.name = std::move(name),
+                         .object = as::make_relocatable_object(*program, as::translate_to_binary(*program)),
+                         .address = address};
+}
+
+auto link(std::vector<as::LinkInput> objects, std::vector<as::LinkInput> library = {},
+          const as::LinkOptions &options = {}) -> sim::KernelObjectContents {
+    const auto image = as::link(objects, library, options);
+    if (!image.has_value()) {
+        for (const auto &error : image.error()) {
+            MESSAGE(error);
+        }
+    }
+    REQUIRE(image.has_value());
+    return *image;
+}
+
+auto link_error(std::vector<as::LinkInput> objects, std::vector<as::LinkInput> library = {}) -> std::string {
+    const auto image = as::link(objects, library);
+    REQUIRE_FALSE(image.has_value());
+    REQUIRE_EQ(image.error().size(), 1);
+    return image.error().front();
+}
+
+auto symbol(const sim::KernelObjectContents &contents, std::string_view name) -> std::optional<IData> {
+    const auto it = std::ranges::find(contents.symbols, name, [](const auto &symbol) { return symbol.first; });
+    return it != contents.symbols.end() ? std::optional{it->second} : std::nullopt;
+}
+
+auto run(const sim::KernelObjectContents &image) -> sim::data_memory_container_t {
+    auto executor = sim::Executor{sim::ExecutorConfig{.warps_per_core = 1,
+                                                      .threads_per_warp = 4,
+                                                      .base_instructions_address = image.base_instructions_address,
+                                                      .num_blocks = image.num_blocks,
+                                                      .num_warps_per_block = image.num_warps_per_block},
+                                  std::span<const IData>{image.instructions}, {}};
+    executor.run();
+    REQUIRE(executor.done());
+    return executor.get_memory();
+}
+
+// Stores 7 + 10 + 100 through a call into the library and a tail call back, the return address is in s5
+constexpr auto MAIN = std::string_view{".blocks 1\n"
+                                       ".warps 1\n"
+                                       "    addi x5, x0, 7\n"
+                                       "    jal s5, add_ten\n"
+                                       "    beq s0, s0, finish\n"};
+constexpr auto ADD_TEN = std::string_view{".global add_ten\n"
+                                          "add_ten:\n"
+                                          "    addi x5, x5, 10\n"
+                                          "    jalr s0, 0(s5)\n"};
+constexpr auto FINISH = std::string_view{".global finish\n"
+                                         "finish:\n"
+                                         "    jalr s0, add_hundred\n"
+                                         "store:\n"
+                                         "    sw x5, 0(x1)\n"
+                                         "    halt\n"
+                                         "add_hundred:\n"
+                                         "    addi x5, x5, 100\n"
+                                         "    jalr s0, store\n"};
+
+TEST_CASE("Relocatable objects") {
+    const auto main = module("main", MAIN);
+    CHECK(main.object.relocatable);
+    // Labels of other modules are undefined symbols with a relocation at every use
+    REQUIRE_EQ(main.object.symbols.size(), 2);
+    CHECK_EQ(main.object.symbols[0].first, "add_ten");
+    CHECK_EQ(main.object.bindings[0], sim::SymbolBinding::UNDEFINED);
+    REQUIRE_EQ(main.object.relocations.size(), 2);
+    CHECK_EQ(main.object.relocations[0].instruction, 1);
+    CHECK_EQ(main.object.relocations[0].type, sim::RelocationType::JUMP);
+    CHECK_EQ(main.object.relocations[1].type, sim::RelocationType::BRANCH);
+
+    // Only jalr needs relocating within a module, the rest is relative
+    const auto finish = module("finish", FINISH);
+    REQUIRE_EQ(finish.object.symbols.size(), 3);
+    CHECK_EQ(finish.object.bindings[0], sim::SymbolBinding::GLOBAL);
+    CHECK_EQ(finish.object.bindings[1], sim::SymbolBinding::LOCAL);
+    REQUIRE_EQ(finish.object.relocations.size(), 2);
+    CHECK_EQ(finish.object.relocations[0].type, sim::RelocationType::ABSOLUTE);
+    CHECK_EQ(finish.object.relocations[1].type, sim::RelocationType::ABSOLUTE);
+
+    // Relocations and bindings survive the object file
+    const auto path = fs::temp_directory_path() / std::format("smol_gpu_{}_module.kobj", ::getpid());
+    REQUIRE(sim::write_kernel_object(path, finish.object).has_value());
+    const auto object = sim::KernelObject::load(path);
+    REQUIRE(object.has_value());
+    CHECK(object->is_relocatable());
+    const auto contents = object->contents();
+    CHECK_EQ(contents.bindings, finish.object.bindings);
+    REQUIRE_EQ(contents.relocations.size(), 2);
+    CHECK_EQ(contents.relocations[1].instruction, finish.object.relocations[1].instruction);
+    CHECK_EQ(contents.relocations[1].symbol, finish.object.relocations[1].symbol);
+    fs::remove(path);
+
+    // parse_module still checks everything else
+    CHECK_FALSE(as::parse_module(".global nowhere\nhalt\n").has_value());
+    CHECK(as::parse_module(".global start\n.global start\nstart: halt\n").has_value());
+    CHECK_FALSE(as::parse_program("jal s0, elsewhere\n").has_value());
+}
+
+TEST_CASE("Calls across modules") {
+    for (const auto base : {IData{0}, IData{100}}) {
+        const auto image = link({module("main", MAIN), module("add_ten", ADD_TEN), module("finish", FINISH)}, {},
+                                {.base_instructions_address = base});
+        CHECK_EQ(image.base_instructions_address, base);
+        CHECK_EQ(image.instructions.size(), 3 + 2 + 5);
+        CHECK_EQ(symbol(image, "add_ten"), 3);
+        CHECK_EQ(symbol(image, "finish"), 5);
+        CHECK_EQ(symbol(image, "add_hundred"), 8);
+
+        const auto memory = run(image);
+        for (auto thread = IData{0}; thread < 4; thread++) {
+            CHECK_EQ(memory.at(thread), 117);
+        }
+    }
+}
+
+TEST_CASE("Library members are only linked when needed") {
+    const auto unused = module("unused", ".global unused\nunused: halt\n");
+    // finish is in the library and pulls in add_ten, which main doesn't reference itself
+    const auto calls = module("calls", ".global finish\nfinish:\n    jal s5, add_ten\n    sw x5, 0(x1)\n    halt\n");
+    const auto image = link({module("main", "addi x5, x0, 7\nbeq s0, s0, finish\n")},
+                            {unused, module("add_ten", ADD_TEN), calls});
+    CHECK_FALSE(symbol(image, "unused").has_value());
+    // In the order they were pulled in
+    CHECK_EQ(symbol(image, "finish"), 2);
+    CHECK_EQ(symbol(image, "add_ten"), 5);
+    CHECK_EQ(run(image).at(2), 17);
+}
+
+TEST_CASE("Placement") {
+    const auto image = link({module("main", MAIN, 4), module("add_ten", ADD_TEN, 20), module("finish", FINISH)});
+    CHECK_EQ(image.base_instructions_address, 4);
+    CHECK_EQ(symbol(image, "add_ten"), 16);
+    CHECK_EQ(symbol(image, "finish"), 18);
+    // The gap is filled with halt
+    CHECK_EQ(image.instructions[3], sim::instructions::halt().bits);
+    CHECK_EQ(image.instructions[15], sim::instructions::halt().bits);
+    CHECK_EQ(run(image).at(0), 117);
+}
+
+TEST_CASE("Errors") {
+    CHECK_EQ(link_error({module("main", MAIN), module("add_ten", ADD_TEN)}),
+             "Undefined symbol 'finish' referenced by main");
+    CHECK_EQ(link_error({module("a", ADD_TEN), module("b", ADD_TEN)}),
+             "Symbol 'add_ten' is defined by both a and b");
+    CHECK_EQ(link_error({module("main", "halt\n", 10), module("b", ADD_TEN, 5)}),
+             "b is placed at 5, which overlaps the code before it up to 11");
+    CHECK_EQ(link_error({module("main", "beq s0, s0, far\n"), module("far", ".global far\nfar: halt\n", 3000)}),
+             "main:1: Branch target 'far' is 3000 instructions away, a 13-bit immediate reaches -2048 to 2047");
+    CHECK_EQ(link_error({module("main", MAIN), module("add_ten", ADD_TEN), module("finish", FINISH, 2045)}),
+             "finish:3: jalr target 'add_hundred' is at 2048, a 12-bit immediate reaches up to 2047");
+
+    auto executable = module("main", MAIN);
+    executable.object.relocatable = false;
+    CHECK_EQ(link_error({executable}), "main is not a relocatable object");
+}
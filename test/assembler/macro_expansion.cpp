@@ -0,0 +1,145 @@
+#include "lexer.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "assembler_helper.hpp"
+#include "doctest.h"
+#include <format>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+auto error_lines(std::string_view source) -> std::vector<std::uint32_t> {
+    const auto program = as::parse_program(source);
+    REQUIRE_FALSE(program.has_value());
+    auto lines = std::vector<std::uint32_t>{};
+    for (const auto &error : program.error()) {
+        lines.push_back(error.line);
+    }
+    return lines;
+}
+
+TEST_CASE("Lexing expander directives") {
+    const auto [tokens, errors] = as::collect_tokens(".equ .macro .endm .rept .endr");
+    REQUIRE(errors.empty());
+    REQUIRE_EQ(tokens.size(), 5);
+    CHECK(tokens[0].is_of_type<as::token::EquDirective>());
+    CHECK(tokens[1].is_of_type<as::token::MacroDirective>());
+    CHECK(tokens[2].is_of_type<as::token::EndmDirective>());
+    CHECK(tokens[3].is_of_type<as::token::ReptDirective>());
+    CHECK(tokens[4].is_of_type<as::token::EndrDirective>());
+}
+
+TEST_CASE("Constants") {
+    const auto program = as::parse_program(".equ STRIDE, 32\n"
+                                           ".equ OFFSET, STRIDE\n"
+                                           "addi x5, x1, STRIDE\n"
+                                           "lw x6, OFFSET(x1)\n"
+                                           ".equ STRIDE, -4\n"
+                                           "s.addi s5, s5, STRIDE\n"
+                                           "halt\n"sv);
+    REQUIRE(program.has_value());
+    CHECK_EQ(instruction_strings(*program),
+             std::vector<std::string>{"addi x5, x1, 32", "lw x6, 32(x1)", "s.addi s5, s5, -4", "halt"});
+    CHECK_EQ(program->instructions[1].line, 4);
+
+    SUBCASE("Errors") {
+        CHECK_EQ(error_lines(".equ x5, 3\nhalt\n"), std::vector<std::uint32_t>{1});
+        CHECK_EQ(error_lines(".equ N\nhalt\n"), std::vector<std::uint32_t>{1});
+        CHECK_EQ(error_lines(".equ N, M\nhalt\n"), std::vector<std::uint32_t>{1});
+        // A label with the name of a constant could never be referenced
+        CHECK_EQ(error_lines(".equ N, 1\nN: halt\n"), std::vector<std::uint32_t>{2});
+    }
+}
+
+TEST_CASE("Macros") {
+    const auto program = as::parse_program(".equ BASE, 64\n"
+                                           ".macro load_add dst, offset, addend\n"
+                                           "    lw dst, offset(x1)\n"
+                                           "    add dst, dst, addend\n"
+                                           ".endm\n"
+                                           ".macro twice, dst\n"
+                                           "    load_add dst, BASE, dst\n"
+                                           "    load_add dst, 0, dst\n"
+                                           ".endm\n"
+                                           "start: load_add x5, 8, x6\n"
+                                           "twice x7\n"
+                                           "halt\n"sv);
+    REQUIRE(program.has_value());
+    CHECK_EQ(instruction_strings(*program),
+             std::vector<std::string>{"lw x5, 8(x1)", "add x5, x5, x6", "lw x7, 64(x1)", "add x7, x7, x7",
+                                      "lw x7, 0(x1)", "add x7, x7, x7", "halt"});
+    CHECK_EQ(program->label_mappings.at("start"), 0);
+    // The expanded lines are reported on the line of the call
+    CHECK_EQ(program->instructions[0].line, 10);
+    CHECK_EQ(program->instructions[5].line, 11);
+
+    SUBCASE("Errors") {
+        constexpr auto definition = ".macro inc reg\naddi reg, reg, 1\n.endm\n"sv;
+        CHECK_EQ(error_lines(std::string{definition} + "inc x5, x6\nhalt\n"), std::vector<std::uint32_t>{4});
+        CHECK_EQ(error_lines(std::string{definition} + "inc\nhalt\n"), std::vector<std::uint32_t>{4});
+        CHECK_EQ(error_lines(std::string{definition} + ".macro inc reg\n.endm\nhalt\n"), std::vector<std::uint32_t>{4});
+        CHECK_EQ(error_lines(".macro inc reg, reg\n.endm\nhalt\n"), std::vector<std::uint32_t>{1});
+        CHECK_EQ(error_lines(".macro addi\n.endm\nhalt\n"), std::vector<std::uint32_t>{1});
+        CHECK_EQ(error_lines(".macro loop\nloop\n.endm\nloop\nhalt\n"), std::vector<std::uint32_t>{4});
+        CHECK_EQ(error_lines(".macro inc reg\naddi reg, reg, 1\nhalt\n"), std::vector<std::uint32_t>{1});
+        CHECK_EQ(error_lines("addi x5, x5, 1\n.endm\nhalt\n"), std::vector<std::uint32_t>{2});
+        // Errors in the body show up on every call
+        CHECK_EQ(error_lines(".macro bad\naddi x5, x5\n.endm\nbad\nbad\nhalt\n"), std::vector<std::uint32_t>{4, 5});
+    }
+}
+
+TEST_CASE("Repeats") {
+    const auto program = as::parse_program(".equ UNROLL, 3\n"
+                                           "loop:\n"
+                                           ".rept UNROLL, i\n"
+                                           "    lw x5, i(x1)\n"
+                                           "    .rept 2\n"
+                                           "        addi x5, x5, i\n"
+                                           "    .endr\n"
+                                           "    sw x5, i(x1)\n"
+                                           ".endr\n"
+                                           ".rept 0\n"
+                                           "    sub x5, x5, x5\n"
+                                           ".endr\n"
+                                           "blt s5, s6, loop\n"
+                                           "halt\n"sv);
+    REQUIRE(program.has_value());
+    auto expected = std::vector<std::string>{};
+    for (auto i = 0; i < 3; i++) {
+        expected.push_back(std::format("lw x5, {}(x1)", i));
+        expected.push_back(std::format("addi x5, x5, {}", i));
+        expected.push_back(std::format("addi x5, x5, {}", i));
+        expected.push_back(std::format("sw x5, {}(x1)", i));
+    }
+    expected.insert(expected.end(), {"blt s5, s6, loop", "halt"});
+    CHECK_EQ(instruction_strings(*program), expected);
+    CHECK_EQ(program->label_mappings.at("loop"), 0);
+    // Repeated lines keep their own line numbers
+    CHECK_EQ(program->instructions[5].line, 6);
+
+    SUBCASE("Errors") {
+        CHECK_EQ(error_lines(".rept -1\n.endr\nhalt\n"), std::vector<std::uint32_t>{1});
+        CHECK_EQ(error_lines(".rept 2, x5\n.endr\nhalt\n"), std::vector<std::uint32_t>{1});
+        CHECK_EQ(error_lines(".rept 2\nhalt\n"), std::vector<std::uint32_t>{1});
+        CHECK_EQ(error_lines(".endr\nhalt\n"), std::vector<std::uint32_t>{1});
+        // The label is defined once per repetition
+        CHECK_EQ(error_lines(".rept 2\nlabel: addi x5, x5, 1\n.endr\nhalt\n"), std::vector<std::uint32_t>{2});
+    }
+}
+
+TEST_CASE("Macros and repeats parse the same in parallel") {
+    auto source = std::string{".macro body reg, n\naddi reg, reg, n\n.endm\n.rept 4, n\nbody x5, n\n.endr\n"};
+    // Large enough to be split without the expander
+    while (source.size() < (std::size_t{1} << 18)) {
+        source += "addi x6, x6, 1\n";
+    }
+    source += "halt\n";
+
+    const auto sequential = as::parse_program(source);
+    const auto parallel = as::parse_program_parallel(source, 4);
+    REQUIRE(sequential.has_value());
+    REQUIRE(parallel.has_value());
+    CHECK_EQ(instruction_strings(*parallel), instruction_strings(*sequential));
+    CHECK_EQ(instruction_strings(*parallel)[3], "addi x5, x5, 3");
+}
@@ -136,19 +136,30 @@ TEST_CASE("parse_num - Edge Cases") {
     SUBCASE("Minimum 32-bit Integer") {
         input = "-2147483648";
         auto result = as::parse_num(input);
-        REQUIRE_FALSE(result.has_value());
+        REQUIRE(result.has_value());
+        CHECK(*result == -2147483648);
+        CHECK(input.empty());
     }
 
     SUBCASE("Out of Range (Positive)") {
         input = "2147483648"; // Greater than INT32_MAX
         auto result = as::parse_num(input);
         REQUIRE_FALSE(result.has_value());
+        CHECK(input.empty());
     }
 
     SUBCASE("Out of Range (Negative)") {
         input = "-2147483649"; // Less than INT32_MIN
         auto result = as::parse_num(input);
         REQUIRE_FALSE(result.has_value());
+        CHECK(input.empty());
+    }
+
+    SUBCASE("Out of Range (64-bit)") {
+        input = "0x123456789ABCDEF01, x1";
+        auto result = as::parse_num(input);
+        REQUIRE_FALSE(result.has_value());
+        CHECK(input == ", x1");
     }
 }
 
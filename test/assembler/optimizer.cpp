@@ -0,0 +1,158 @@
+#include "decoder.hpp"
+#include "emitter.hpp"
+#include "executor.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "assembler_helper.hpp"
+#include "doctest.h"
+#include <array>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+auto machine_code_of(const as::parser::Program &program) -> std::vector<IData> {
+    auto words = std::vector<IData>{};
+    for (const auto &instruction : as::translate_to_binary(program)) {
+        words.push_back(instruction.bits);
+    }
+    return words;
+}
+
+TEST_CASE("Writes to read-only registers") {
+    auto program = as::parse_program("addi x0, x5, 1\naddi x2, x2, 1\ns.addi s0, s5, 3\nlw x1, 0(x5)\n"
+                                     "sx.slti s0, x5, 3\naddi x5, x5, 1\ns.addi s1, s0, 1\nhalt\n"sv);
+    REQUIRE(program.has_value());
+
+    const auto report = as::optimize(*program);
+    CHECK_EQ(report.size(), 5);
+    CHECK_EQ(report.front().line, 1);
+    CHECK(report.front().description.contains("x0 is read-only"));
+    CHECK_EQ(instruction_strings(*program), std::vector<std::string>{"addi x5, x5, 1", "s.addi s1, s0, 1", "halt"});
+}
+
+TEST_CASE("Folding immediate arithmetic") {
+    SUBCASE("Same kind on the same register") {
+        auto program = as::parse_program("addi x5, x6, 1\naddi x5, x5, 2\naddi x5, x5, 4095\n"
+                                         "slli x6, x6, 2\nslli x6, x6, 3\n"
+                                         "s.xori s5, s5, 12\ns.xori s5, s5, 10\n"
+                                         "andi x7, x8, 4095\nandi x7, x7, 12\nhalt\n"sv);
+        REQUIRE(program.has_value());
+
+        const auto report = as::optimize(*program);
+        CHECK_EQ(report.size(), 5);
+        CHECK_EQ(instruction_strings(*program),
+                 std::vector<std::string>{"addi x5, x6, 2", "slli x6, x6, 5", "s.xori s5, s5, 6", "andi x7, x8, 12", "halt"});
+    }
+
+    SUBCASE("Constants") {
+        auto program = as::parse_program("addi x7, x0, 3\nslli x7, x7, 4\nori x7, x7, 1\nslti x7, x7, 50\n"
+                                         "s.addi s5, s0, 4095\ns.srli s5, s5, 24\nhalt\n"sv);
+        REQUIRE(program.has_value());
+
+        const auto report = as::optimize(*program);
+        CHECK_EQ(report.size(), 4);
+        CHECK_EQ(instruction_strings(*program), std::vector<std::string>{"addi x7, x0, 1", "s.addi s5, s0, 255", "halt"});
+    }
+
+    SUBCASE("Left alone") {
+        const auto sources = std::array{
+            "addi x5, x5, 1\nlabel: addi x5, x5, 2\nhalt\n"sv,   // Reachable from elsewhere
+            "addi x5, x5, 1\naddi x6, x5, 2\nhalt\n"sv,          // Different destination
+            "addi x5, x5, 2047\naddi x5, x5, 1\nhalt\n"sv,       // 2048 doesn't fit
+            "slli x5, x5, 20\nslli x5, x5, 12\nhalt\n"sv,        // Shifts everything out
+            "s.addi s5, s5, 1\naddi x5, x5, 2\nhalt\n"sv,
+            "addi x5, x5, 1\nsrli x5, x5, 2\nhalt\n"sv,          // Not a constant
+            "addi x5, x0, 2047\naddi x5, x5, 2047\nhalt\n"sv,
+        };
+        for (const auto source : sources) {
+            auto program = as::parse_program(source);
+            REQUIRE(program.has_value());
+            const auto before = instruction_strings(*program);
+            const auto report = as::optimize(*program);
+            CHECK_MESSAGE(report.empty(), source);
+            CHECK_EQ(instruction_strings(*program), before);
+        }
+    }
+}
+
+TEST_CASE("Repeated mask writes") {
+    auto program = as::parse_program("sx.slti s1, x5, 5\naddi x6, x6, 1\nsx.slti s1, x5, 5\nsw x6, 0(x1)\n"
+                                     "addi x5, x5, 1\nsx.slti s1, x5, 5\nsx.slti s1, x5, 6\nsx.slti s1, x5, 6\n"
+                                     "s.add s1, s1, s5\ns.add s1, s1, s5\nloop: sx.slti s1, x5, 6\nhalt\n"sv);
+    REQUIRE(program.has_value());
+
+    const auto report = as::optimize(*program);
+    REQUIRE_EQ(report.size(), 2);
+    CHECK_EQ(report[0].line, 3);
+    CHECK_EQ(report[1].line, 8);
+    CHECK(report[0].description.contains("the mask already holds its result"));
+    CHECK_EQ(program->instructions.size(), 10);
+}
+
+TEST_CASE("Labels and offsets follow the instructions") {
+    auto program = as::parse_program(".blocks 2\n"
+                                     ".warps 1\n"
+                                     "s.addi s6, s0, 5\n"
+                                     "loop:\n"
+                                     "addi x0, x0, 1\n"
+                                     "addi x5, x5, 2\n"
+                                     "addi x5, x5, 1\n"
+                                     "sx.slti s1, x1, 20\n"
+                                     "sx.slti s1, x1, 20\n"
+                                     "s.addi s5, s5, 1\n"
+                                     "blt s5, s6, loop\n"
+                                     "beq s0, s0, 3\n"
+                                     "addi x0, x0, 1\n"
+                                     "addi x5, x5, 100\n"
+                                     "skip:\n"
+                                     "addi x7, x0, 3\n"
+                                     "slli x7, x7, 4\n"
+                                     "add x5, x5, x7\n"
+                                     "slli x6, x2, 5\n"
+                                     "add x6, x6, x1\n"
+                                     "jal s3, store\n"
+                                     "addi x5, x5, 1000\n"
+                                     "store:\n"
+                                     "sw x5, 0(x6)\n"
+                                     "halt\n"sv);
+    REQUIRE(program.has_value());
+    const auto original = machine_code_of(*program);
+
+    const auto report = as::optimize(*program);
+    CHECK_EQ(report.size(), 5);
+    CHECK_EQ(program->label_mappings.at("loop"), 1);
+    CHECK_EQ(program->label_mappings.at("skip"), 7);
+    CHECK_EQ(program->label_mappings.at("store"), 13);
+    const auto optimized = machine_code_of(*program);
+    REQUIRE_EQ(optimized.size(), original.size() - 5);
+    CHECK_EQ(sim::decode(optimized[4]).immediate, (IData)-3); // blt s5, s6, loop
+    CHECK_EQ(sim::decode(optimized[5]).immediate, 2);         // beq s0, s0, 3 jumped over an instruction that is gone
+
+    // Both run to the same memory, the optimized one with fewer instructions
+    const auto config = sim::ExecutorConfig{.num_blocks = 2, .num_warps_per_block = 1};
+    auto before = sim::Executor{config, original};
+    auto after = sim::Executor{config, optimized};
+    const auto executed_before = before.run();
+    const auto executed_after = after.run();
+    REQUIRE(before.done());
+    REQUIRE(after.done());
+    CHECK_EQ(before.get_memory(), after.get_memory());
+    // Threads 20 and up are masked out, the others add 3 five times and 48
+    CHECK_EQ(after.get_memory().size(), 2 * 20);
+    CHECK_EQ(after.get_memory().at(32 + 3), 63);
+    CHECK_LT(executed_after, executed_before);
+}
+
+TEST_CASE("Address dependent programs are left alone") {
+    for (const auto source : {"addi x0, x0, 1\njalr s0, 0(s9)\nhalt\n"sv, "addi x0, x0, 1\nauipc x5, 1\nhalt\n"sv}) {
+        auto program = as::parse_program(source);
+        REQUIRE(program.has_value());
+        const auto report = as::optimize(*program);
+        REQUIRE_EQ(report.size(), 1);
+        CHECK_EQ(report.front().line, 2);
+        CHECK(report.front().description.contains("Left the program unchanged"));
+        CHECK_EQ(program->instructions.size(), 3);
+    }
+}
@@ -0,0 +1,126 @@
+#include "emitter.hpp"
+#include "executor.hpp"
+#include "parser.hpp"
+#include "scheduler.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "assembler_helper.hpp"
+#include "doctest.h"
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+auto run(const as::parser::Program &program, const sim::data_memory_container_t &memory) -> sim::data_memory_container_t {
+    auto words = std::vector<IData>{};
+    for (const auto &instruction : as::translate_to_binary(program)) {
+        words.push_back(instruction.bits);
+    }
+    auto executor = sim::Executor{sim::ExecutorConfig{.num_blocks = 1, .num_warps_per_block = 1}, words, memory};
+    executor.run();
+    REQUIRE(executor.done());
+    return executor.get_memory();
+}
+
+TEST_CASE("Independent work moves between a load and its use") {
+    constexpr auto source = "lw x5, 0(x1)\n"
+                            "addi x6, x5, 1\n"
+                            "addi x7, x7, 1\n"
+                            "addi x8, x7, 2\n"
+                            "addi x9, x9, 3\n"
+                            "sw x6, 0(x1)\n"
+                            "sw x8, 32(x1)\n"
+                            "halt\n"sv;
+    auto program = as::parse_program(source);
+    REQUIRE(program.has_value());
+    const auto original = *as::parse_program(source);
+
+    const auto regions = as::schedule(*program);
+    REQUIRE(regions.has_value());
+    REQUIRE_EQ(regions->size(), 1);
+    CHECK_EQ(regions->front().begin, 0);
+    CHECK_EQ(regions->front().order, std::vector<std::uint32_t>{0, 2, 3, 4, 1, 5, 6});
+    CHECK_EQ(regions->front().stalls_before, 3);
+    CHECK_EQ(regions->front().stalls_after, 0);
+    CHECK_EQ(instruction_strings(*program),
+             std::vector<std::string>{"lw x5, 0(x1)", "addi x7, x7, 1", "addi x8, x7, 2", "addi x9, x9, 3",
+                                      "addi x6, x5, 1", "sw x6, 0(x1)", "sw x8, 32(x1)", "halt"});
+
+    auto memory = sim::data_memory_container_t{};
+    for (auto address = IData{0}; address < 32; address++) {
+        memory[address] = address * 10;
+    }
+    CHECK_EQ(run(*program, memory), run(original, memory));
+
+    const auto dump = as::dump_schedule(*program, *regions);
+    CHECK(dump.contains("Instructions 0-6, estimated stalls 3 -> 0"));
+    CHECK(dump.contains("addi x6, x5, 1"));
+    CHECK(dump.contains("# line 2, was 1"));
+}
+
+TEST_CASE("Instructions that stay in order") {
+    const auto sources = std::array{
+        // A mask write in between
+        "lw x5, 0(x1)\naddi x6, x5, 1\nsx.slti s1, x1, 8\naddi x7, x7, 1\naddi x8, x8, 1\nhalt\n"sv,
+        // A label in between
+        "lw x5, 0(x1)\naddi x6, x5, 1\nlabel: addi x7, x7, 1\naddi x8, x8, 1\nhalt\n"sv,
+        // A branch in between
+        "lw x5, 0(x1)\naddi x6, x5, 1\nbeq s0, s0, 1\naddi x7, x7, 1\nhalt\n"sv,
+        // Every instruction depends on the one before it
+        "lw x5, 0(x1)\naddi x5, x5, 1\nslli x5, x5, 2\nsw x5, 0(x1)\nhalt\n"sv,
+    };
+    for (const auto source : sources) {
+        auto program = as::parse_program(source);
+        REQUIRE(program.has_value());
+        const auto before = instruction_strings(*program);
+
+        const auto regions = as::schedule(*program);
+        REQUIRE(regions.has_value());
+        CHECK_MESSAGE(instruction_strings(*program) == before, source);
+        for (const auto &region : *regions) {
+            CHECK_EQ(region.stalls_before, region.stalls_after);
+        }
+    }
+}
+
+TEST_CASE("Loads don't pass stores") {
+    auto program = as::parse_program("addi x6, x6, 1\nsw x4, 0(x1)\nlw x5, 4(x1)\naddi x7, x5, 1\nhalt\n"sv);
+    REQUIRE(program.has_value());
+
+    REQUIRE(as::schedule(*program).has_value());
+    const auto strings = instruction_strings(*program);
+    const auto store = std::ranges::find(strings, "sw x4, 0(x1)");
+    const auto load = std::ranges::find(strings, "lw x5, 4(x1)");
+    REQUIRE(store != strings.end());
+    CHECK_LT(store, load);
+}
+
+TEST_CASE("Loads pass loads, labels stay") {
+    auto program = as::parse_program("start: lw x5, 0(x1)\n"
+                                     "addi x6, x5, 1\n"
+                                     "lw x7, 32(x1)\n"
+                                     "add x8, x6, x7\n"
+                                     "sw x8, 0(x1)\n"
+                                     "halt\n"sv);
+    REQUIRE(program.has_value());
+
+    const auto regions = as::schedule(*program);
+    REQUIRE(regions.has_value());
+    CHECK_EQ(instruction_strings(*program)[1], "lw x7, 32(x1)");
+    CHECK_EQ(program->label_mappings.at("start"), 0);
+    REQUIRE(program->instructions[0].label.has_value());
+    CHECK_EQ(program->instructions[0].label->name, "start");
+    CHECK_FALSE(program->instructions[1].label.has_value());
+    CHECK_LT(regions->front().stalls_after, regions->front().stalls_before);
+}
+
+TEST_CASE("Address dependent programs are not scheduled") {
+    auto program = as::parse_program("lw x5, 0(x1)\naddi x6, x5, 1\naddi x7, x7, 1\njalr s0, 0(s9)\nhalt\n"sv);
+    REQUIRE(program.has_value());
+
+    const auto regions = as::schedule(*program);
+    REQUIRE_FALSE(regions.has_value());
+    CHECK_EQ(regions.error().line, 4);
+    CHECK_EQ(instruction_strings(*program)[1], "addi x6, x5, 1");
+}
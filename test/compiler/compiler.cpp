@@ -0,0 +1,214 @@
+#include "compiler.hpp"
+#include "emitter.hpp"
+#include "executor.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include <string>
+#include <vector>
+
+constexpr auto THREADS_PER_WARP = 4u;
+constexpr auto WARPS_PER_CORE = 2u;
+constexpr auto THREADS_PER_BLOCK = THREADS_PER_WARP * WARPS_PER_CORE;
+
+auto compile(std::string_view source) -> std::string {
+    const auto assembly = cc::compile(source);
+    if (!assembly.has_value()) {
+        for (const auto &error : assembly.error()) {
+            MESSAGE(error.line, ":", error.column, ": ", error.message);
+        }
+    }
+    REQUIRE(assembly.has_value());
+    return *assembly;
+}
+
+auto compile_error(std::string_view source) -> sim::Error {
+    const auto assembly = cc::compile(source);
+    REQUIRE_FALSE(assembly.has_value());
+    REQUIRE_EQ(assembly.error().size(), 1);
+    return assembly.error().front();
+}
+
+// Assembles the compiled kernel and runs it with 4 threads per warp
+auto run(const std::string &assembly, sim::data_memory_container_t memory = {}) -> sim::data_memory_container_t {
+    const auto program = as::parse_program(assembly);
+    REQUIRE(program.has_value());
+    auto words = std::vector<IData>{};
+    for (const auto &instruction : as::translate_to_binary(*program)) {
+        words.push_back(instruction.bits);
+    }
+    auto executor = sim::Executor{sim::ExecutorConfig{.warps_per_core = WARPS_PER_CORE,
+                                                      .threads_per_warp = THREADS_PER_WARP,
+                                                      .num_blocks = program->blocks,
+                                                      .num_warps_per_block = program->warps},
+                                  std::span<const IData>{words}, std::move(memory)};
+    executor.run();
+    REQUIRE(executor.done());
+    return executor.get_memory();
+}
+
+auto read(const sim::data_memory_container_t &memory, IData address) -> IData {
+    const auto it = memory.find(address);
+    return it != memory.end() ? it->second : 0u;
+}
+
+TEST_CASE("Divergent if/else is if-converted") {
+    const auto assembly = compile("int a[] @ 0;\n"
+                                  "int b[] @ 64;\n"
+                                  "int out[] @ 128;\n"
+                                  "kernel(blocks = 2) {\n"
+                                  "    int i = block_id * 8 + thread_id;\n"
+                                  "    if (a[i] < b[i]) {\n"
+                                  "        out[i] = b[i] - a[i];\n"
+                                  "    } else {\n"
+                                  "        out[i] = a[i] - b[i];\n"
+                                  "    }\n"
+                                  "}\n");
+    // Masks instead of branches
+    CHECK_NE(assembly.find("sx.slt s1,"), std::string::npos);
+    CHECK_EQ(assembly.find("blt"), std::string::npos);
+
+    auto memory = sim::data_memory_container_t{};
+    for (auto i = IData{0}; i < 2 * THREADS_PER_BLOCK; i++) {
+        memory[i] = (i * 7) % 11;
+        memory[64 + i] = (i * 5) % 13;
+    }
+    const auto result = run(assembly, memory);
+    for (auto i = IData{0}; i < 2 * THREADS_PER_BLOCK; i++) {
+        const auto a = memory[i];
+        const auto b = memory[64 + i];
+        CHECK_EQ(read(result, 128 + i), a < b ? b - a : a - b);
+    }
+}
+
+TEST_CASE("Uniform values are scalarized") {
+    const auto assembly = compile("const int N = 16;\n"
+                                  "int data[] @ 0;\n"
+                                  "int out[] @ 32;\n"
+                                  "kernel {\n"
+                                  "    int sum = 0;\n"
+                                  "    for (int k = 0; k < N; k++) {\n"
+                                  "        sum += data[k];\n"
+                                  "    }\n"
+                                  "    out[0] = sum;\n"
+                                  "    int t = thread_id;\n"
+                                  "    out[t + 1] = sum + t;\n"
+                                  "}\n");
+    // The loop runs on scalar registers
+    CHECK_NE(assembly.find("s.lw"), std::string::npos);
+    CHECK_NE(assembly.find("blt s"), std::string::npos);
+    CHECK_EQ(assembly.find("sx."), std::string::npos);
+
+    auto memory = sim::data_memory_container_t{};
+    auto sum = IData{0};
+    for (auto i = IData{0}; i < 16; i++) {
+        memory[i] = i * i + 1;
+        sum += i * i + 1;
+    }
+    const auto result = run(assembly, memory);
+    CHECK_EQ(read(result, 32), sum);
+    for (auto t = IData{0}; t < THREADS_PER_BLOCK; t++) {
+        CHECK_EQ(read(result, 33 + t), sum + t);
+    }
+}
+
+TEST_CASE("Divergent loops run until every thread is done") {
+    const auto assembly = compile("int out[] @ 0;\n"
+                                  "kernel {\n"
+                                  "    int count = 0;\n"
+                                  "    int value = 1;\n"
+                                  "    while (count < thread_id) {\n"
+                                  "        value = value << 1 | 1;\n"
+                                  "        count++;\n"
+                                  "    }\n"
+                                  "    out[thread_id] = value;\n"
+                                  "}\n");
+    const auto result = run(assembly);
+    for (auto t = IData{0}; t < THREADS_PER_BLOCK; t++) {
+        CHECK_EQ(read(result, t), (IData{2} << t) - 1);
+    }
+}
+
+TEST_CASE("Nested conditions inside a uniform loop") {
+    const auto assembly = compile("int out[] @ 0;\n"
+                                  "kernel {\n"
+                                  "    for (int k = 0; k < 3; k++) {\n"
+                                  "        if (thread_id > k && thread_id != 6) {\n"
+                                  "            out[thread_id] += 1;\n"
+                                  "        } else if (!(thread_id < 2)) {\n"
+                                  "            out[thread_id] += 10;\n"
+                                  "        }\n"
+                                  "    }\n"
+                                  "}\n");
+    const auto result = run(assembly);
+    for (auto t = IData{0}; t < THREADS_PER_BLOCK; t++) {
+        auto expected = IData{0};
+        for (auto k = IData{0}; k < 3; k++) {
+            if (t > k && t != 6) {
+                expected += 1;
+            } else if (t >= 2) {
+                expected += 10;
+            }
+        }
+        CHECK_EQ(read(result, t), expected);
+    }
+}
+
+TEST_CASE("Constant offsets fold into loads and stores") {
+    const auto assembly = compile("int a[] @ 0;\n"
+                                  "int out[] @ 37;\n"
+                                  "kernel(blocks = 2) {\n"
+                                  "    int i = block_id * 8 + thread_id;\n"
+                                  "    out[i + 3] = a[i + 1];\n"
+                                  "}\n");
+    // Neither offset is a multiple of 32, both go straight into the instruction
+    CHECK_NE(assembly.find(", 1(x"), std::string::npos);
+    CHECK_NE(assembly.find(", 40(x"), std::string::npos);
+    CHECK_EQ(assembly.find("addi"), std::string::npos);
+
+    auto memory = sim::data_memory_container_t{};
+    for (auto i = IData{0}; i <= 2 * THREADS_PER_BLOCK; i++) {
+        memory[i] = i * 3 + 1;
+    }
+    const auto result = run(assembly, memory);
+    for (auto i = IData{0}; i < 2 * THREADS_PER_BLOCK; i++) {
+        CHECK_EQ(read(result, 40 + i), (i + 1) * 3 + 1);
+    }
+}
+
+TEST_CASE("Arithmetic") {
+    const auto assembly = compile("int out[] @ 0;\n"
+                                  "kernel {\n"
+                                  "    int t = thread_id;\n"
+                                  "    out[t] = t * 10;\n"
+                                  "    out[t + 32] = t * -3;\n"
+                                  "    out[t + 64] = (t >= 3) + (t == 2) * 2 + (t != 5) * 4;\n"
+                                  "    out[t + 96] = 0x12345678 ^ t;\n"
+                                  "    out[t + 128] = ~t & 0xF0 | t >> 1;\n"
+                                  "}\n");
+    // No multiplier, so multiplications are shifts and adds
+    CHECK_NE(assembly.find("slli"), std::string::npos);
+
+    const auto result = run(assembly);
+    for (auto t = IData{0}; t < THREADS_PER_BLOCK; t++) {
+        CHECK_EQ(read(result, t), t * 10);
+        CHECK_EQ(read(result, t + 32), IData{0} - 3 * t);
+        CHECK_EQ(read(result, t + 64), IData{t >= 3} + IData{t == 2} * 2 + IData{t != 5} * 4);
+        CHECK_EQ(read(result, t + 96), 0x12345678u ^ t);
+        CHECK_EQ(read(result, t + 128), ((~t & 0xF0u) | (t >> 1)));
+    }
+}
+
+TEST_CASE("Errors") {
+    const auto product = compile_error("kernel {\n    int x = thread_id * thread_id;\n}\n");
+    CHECK_EQ(product.line, 2);
+    CHECK_NE(product.message.find("multiplier"), std::string::npos);
+
+    const auto undeclared = compile_error("kernel {\n    y = 1;\n}\n");
+    CHECK_EQ(undeclared.message, "Undeclared name 'y'");
+    CHECK_EQ(undeclared.line, 2);
+
+    CHECK_EQ(compile_error("kernel { thread_id = 1; }").message, "Cannot assign to 'thread_id'");
+    CHECK_EQ(compile_error("const int N = 4; kernel { int x = N; int x = 2; }").message, "'x' is already declared");
+    CHECK_EQ(compile_error("int a[] @ 0;").message, "Expected a kernel");
+}
@@ -8,11 +8,13 @@
 #include "common.hpp"
 #include "data_reader.hpp"
 #include "emitter.hpp"
+#include "kernel_object.hpp"
 #include "parser.hpp"
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest.h>
 #include "sim.hpp"
 #include <filesystem>
+#include <unistd.h>
 namespace fs = std::filesystem;
 
 constexpr auto INST_NUM_CHANNELS = Vgpu_gpu::INSTRUCTION_MEM_NUM_CHANNELS;
@@ -65,14 +67,19 @@ TEST_CASE("Full system test") {
             auto program_or_err = as::parse_program(lines);
             REQUIRE(program_or_err.has_value());
 
-            const auto& [blocks, warps, instructions, label_mappings] = program_or_err.value();
+            // Goes through a kernel object, the same way the simulator loads the output of smol-as
             const auto machine_code = as::translate_to_binary(*program_or_err);
-
-            for (auto i = 0u; i < machine_code.size(); i++) {
-                instruction_mem.memory[i] = machine_code[i].bits;
-            }
-
-            sim::set_kernel_config(gpu, 0, 0, blocks, warps);
+            // Named after the process, so concurrent runs of the suite don't overwrite each other's objects
+            const auto object_file = fs::temp_directory_path() / std::format("smol_gpu_{}_{}.kobj", ::getpid(), test_name);
+            REQUIRE(sim::write_kernel_object(object_file, as::make_kernel_object(*program_or_err, machine_code)).has_value());
+            const auto object = sim::KernelObject::load(object_file);
+            fs::remove(object_file);
+            REQUIRE(object.has_value());
+            object->load_instructions(instruction_mem.memory);
+
+            const auto& header = object->header();
+            sim::set_kernel_config(gpu, header.base_instructions_address, header.base_data_address, header.num_blocks,
+                                   header.num_warps_per_block);
 
             auto done = sim::simulate(gpu, instruction_mem, data_mem, MAX_CYCLES);
 
@@ -0,0 +1,27 @@
+# This test checks whether the branches and jal reach their labels
+# The loop runs 10 times and every other path skips code that must not run
+# The output should be:
+# memory[0] = 30
+# memory[1] = 31
+# memory[2] = 32
+# memory[3] = 33
+
+.blocks 1
+.warps 1
+
+s.addi s6, s0, 10       # Number of iterations
+loop:
+s.addi s5, s5, 1
+addi x5, x5, 3          # x5 := x5 + 3 on every iteration
+blt s5, s6, loop        # Backwards, taken while s5 < 10
+bne s5, s6, wrong       # Not taken, s5 == s6 after the loop
+beq s5, s6, skip        # Forwards, taken
+wrong:
+addi x5, x5, 100
+skip:
+jal s3, store           # s3 := return address
+addi x5, x5, 1000       # Jumped over
+store:
+add x5, x5, x1          # x5 := 30 + thread_id
+sw x5, 0(x1)            # mem[thread_id] := x5
+halt
@@ -0,0 +1,14 @@
+# This test checks that store offsets which aren't multiples of 32 reach the address the decoder computes
+# The output should be:
+# memory[5] = 1
+# memory[6] = 2
+# memory[7] = 3
+# memory[8] = 4
+
+.blocks 1
+.warps 1
+
+addi x5, x1, 1      # x5 := thread_id + 1
+sx.slti s1, x5, 5   # s1[thread_id] := x5 < 5
+sw x5, 5(x1)        # mem[thread_id + 5] := x5
+halt                # Stop the execution
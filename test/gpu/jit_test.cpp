@@ -0,0 +1,226 @@
+// Checks that kernels compiled by the JIT behave exactly like the functional executor
+
+#include "common.hpp"
+#include "data_reader.hpp"
+#include "emitter.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+#include "executor.hpp"
+#include "jit.hpp"
+#include <filesystem>
+#include <random>
+namespace fs = std::filesystem;
+
+using namespace sim::instructions;
+
+constexpr auto MEMORY_SIZE = 256u;
+
+auto make_config(IData num_blocks, IData num_warps) -> sim::ExecutorConfig {
+    return sim::ExecutorConfig{
+        .warps_per_core = 2,
+        .threads_per_warp = 32,
+        .base_instructions_address = 0,
+        .base_data_address = 0,
+        .num_blocks = num_blocks,
+        .num_warps_per_block = num_warps,
+    };
+}
+
+auto to_flat(const sim::data_memory_container_t& memory) -> std::vector<IData> {
+    auto flat = std::vector<IData>(MEMORY_SIZE, 0u);
+    for (const auto& [address, value] : memory) {
+        if (address < MEMORY_SIZE) {
+            flat[address] = value;
+        }
+    }
+    return flat;
+}
+
+// Runs the program through both the executor and the JIT and compares every warp and the memory
+void check_against_executor(const sim::ExecutorConfig& config, const std::vector<IData>& program,
+                            const sim::data_memory_container_t& data) {
+    auto executor = sim::Executor{config, program, data};
+    executor.run();
+    REQUIRE(executor.done());
+
+    const auto kernel = sim::jit_compile(config, program);
+    REQUIRE(kernel.has_value());
+
+    auto memory = to_flat(data);
+    for (const auto& block : executor.get_blocks()) {
+        for (auto warp_id = 0u; warp_id < block.warps.size(); warp_id++) {
+            const auto& expected = block.warps[warp_id];
+            auto warp = kernel->initial_warp_state(block.block_id, warp_id);
+            REQUIRE(kernel->run_warp(warp, memory) == sim::JitStatus::HALTED);
+
+            CHECK(warp.done == 1u);
+            CHECK(warp.pc == expected.pc);
+            CHECK(warp.instructions_executed == expected.instructions_executed);
+            for (auto reg = 0u; reg < sim::WarpState::NUM_REGISTERS; reg++) {
+                CHECK(warp.scalar_registers[reg] == expected.scalar_registers[reg]);
+                for (auto thread = 0u; thread < config.threads_per_warp; thread++) {
+                    CHECK(warp.vector_registers[reg][thread] == expected.vector_registers[thread][reg]);
+                }
+            }
+        }
+    }
+
+    CHECK(memory == to_flat(executor.get_memory()));
+}
+
+TEST_CASE("JIT runs the full system tests") {
+    for (const auto& entry : fs::directory_iterator(TESTS_DIR)) {
+        if (entry.path().extension() != ".as") {
+            continue;
+        }
+        const auto test_name = entry.path().stem().string();
+
+        SUBCASE(std::format("Test: {}", test_name).c_str()) {
+            auto input_file = as::open_file(entry.path());
+            REQUIRE(input_file.has_value());
+            const auto lines = as::get_lines(*input_file);
+            input_file->close();
+
+            const auto program_or_err = as::parse_program(lines);
+            REQUIRE(program_or_err.has_value());
+            const auto& [blocks, warps, instructions, label_mappings, globals] = program_or_err.value();
+
+            auto program = std::vector<IData>{};
+            for (const auto& instruction : as::translate_to_binary(*program_or_err)) {
+                program.push_back(instruction.bits);
+            }
+
+            auto data = sim::data_memory_container_t{};
+            const auto data_file = entry.path().parent_path() / (test_name + ".data");
+            if (fs::exists(data_file)) {
+                data = *as::read_data(data_file);
+            }
+
+            check_against_executor(make_config(blocks, warps), program, data);
+
+            const auto kernel = sim::jit_compile(make_config(blocks, warps), program);
+            REQUIRE(kernel.has_value());
+            auto memory = to_flat(data);
+            REQUIRE(kernel->run(memory).has_value());
+
+            const auto expected = as::read_data(entry.path().parent_path() / (test_name + ".expected"));
+            REQUIRE(expected.has_value());
+            for (const auto& [address, value] : *expected) {
+                CHECK(memory[address] == value);
+            }
+        }
+    }
+}
+
+TEST_CASE("JIT loops and masks") {
+    SUBCASE("scalar loop") {
+        // s5 counts to 10, every iteration adds the thread id to x5, the branch goes back two instructions to the add
+        const auto program = std::vector<IData>{
+            (IData)addi(6_s, 0_s, 10).make_scalar(),
+            (IData)add(5_x, 5_x, 1_x),
+            (IData)addi(5_s, 5_s, 1).make_scalar(),
+            (IData)blt(5_s, 6_s, (IData)-2),
+            (IData)sw(1_x, 5_x, 0),
+            (IData)lw(7_s, 0_s, 3).make_scalar(),
+            (IData)halt(),
+        };
+        check_against_executor(make_config(2, 2), program, {});
+    }
+
+    SUBCASE("masked execution") {
+        // Threads with an id < 20 take one path, the others the second one
+        const auto program = std::vector<IData>{
+            (IData)sx_slti(1_s, 1_x, 20),
+            (IData)addi(5_x, 1_x, 100),
+            (IData)xori(1_s, 1_s, 0xFFF).make_scalar(),
+            (IData)slli(5_x, 1_x, 3),
+            (IData)addi(1_s, 0_s, 0xFFF).make_scalar(),
+            (IData)sw(1_x, 5_x, 0),
+            (IData)halt(),
+        };
+        check_against_executor(make_config(1, 2), program, {});
+    }
+
+    SUBCASE("indirect jumps") {
+        const auto program = std::vector<IData>{
+            (IData)addi(7_s, 0_s, 4).make_scalar(),
+            (IData)jalr(8_s, 7_s, 0).make_scalar(),
+            (IData)addi(5_x, 5_x, 1),
+            (IData)halt(),
+            (IData)addi(5_x, 5_x, 2),
+            (IData)jalr(0_s, 8_s, 0).make_scalar(),
+        };
+        check_against_executor(make_config(1, 1), program, {});
+    }
+
+    SUBCASE("jumping outside of the program") {
+        const auto program = std::vector<IData>{
+            (IData)addi(7_s, 0_s, 100).make_scalar(),
+            (IData)jalr(0_s, 7_s, 0).make_scalar(),
+        };
+        const auto kernel = sim::jit_compile(make_config(1, 1), program);
+        REQUIRE(kernel.has_value());
+        auto memory = std::vector<IData>(MEMORY_SIZE);
+        auto warp = kernel->initial_warp_state(0, 0);
+        CHECK(kernel->run_warp(warp, memory) == sim::JitStatus::INVALID_PC);
+        CHECK(warp.pc == 100);
+        CHECK_FALSE(kernel->run(memory).has_value());
+    }
+}
+
+TEST_CASE("JIT matches the executor on random programs") {
+    auto rng = std::mt19937{42};
+    auto random = [&](IData max) { return std::uniform_int_distribution<IData>{0, max}(rng); };
+    auto vector_rd = [&] { return sim::Register{.register_number = 4 + random(27), .type = sim::RegisterType::VECTOR}; };
+    auto vector_rs = [&] { return sim::Register{.register_number = random(31), .type = sim::RegisterType::VECTOR}; };
+    auto scalar = [&] { return sim::Register{.register_number = random(31), .type = sim::RegisterType::SCALAR}; };
+
+    for (auto iteration = 0; iteration < 50; iteration++) {
+        auto program = std::vector<IData>{};
+        for (auto i = 0; i < 64; i++) {
+            const auto is_scalar = random(3) == 0;
+            const auto rd = is_scalar ? scalar() : vector_rd();
+            const auto rs1 = is_scalar ? scalar() : vector_rs();
+            const auto rs2 = is_scalar ? scalar() : vector_rs();
+            const auto imm = random(0xFFF);
+            auto instruction = sim::InstructionBits{};
+            switch (random(20)) {
+            case 0: instruction = addi(rd, rs1, imm); break;
+            case 1: instruction = slti(rd, rs1, imm); break;
+            case 2: instruction = xori(rd, rs1, imm); break;
+            case 3: instruction = ori(rd, rs1, imm); break;
+            case 4: instruction = andi(rd, rs1, imm); break;
+            case 5: instruction = slli(rd, rs1, imm % 32); break;
+            case 6: instruction = srli(rd, rs1, imm % 32); break;
+            case 7: instruction = add(rd, rs1, rs2); break;
+            case 8: instruction = sub(rd, rs1, rs2); break;
+            case 9: instruction = sll(rd, rs1, rs2); break;
+            case 10: instruction = slt(rd, rs1, rs2); break;
+            case 11: instruction = xor_(rd, rs1, rs2); break;
+            case 12: instruction = srl(rd, rs1, rs2); break;
+            case 13: instruction = or_(rd, rs1, rs2); break;
+            case 14: instruction = and_(rd, rs1, rs2); break;
+            case 15: instruction = lui(rd, random(0xFFFFF)); break;
+            // Memory accesses relative to the thread id so that they stay inside of the flat memory
+            case 16: instruction = lw(rd, is_scalar ? 0_s : 1_x, imm % 128); break;
+            case 17: instruction = sw(is_scalar ? 0_s : 1_x, rs2, (imm % 4) << 5u); break;
+            case 18: instruction = sx_slt(scalar(), vector_rs(), vector_rs()); break;
+            case 19: instruction = sx_slti(scalar(), vector_rs(), imm); break;
+            default: instruction = sra(rd, rs1, rs2); break;
+            }
+            if (is_scalar) {
+                instruction.make_scalar();
+            }
+            program.push_back(instruction.bits);
+        }
+        program.push_back((IData)halt());
+
+        auto data = sim::data_memory_container_t{};
+        for (auto address = 0u; address < MEMORY_SIZE; address++) {
+            data[address] = (IData)rng();
+        }
+
+        check_against_executor(make_config(2, 2), program, data);
+    }
+}
@@ -0,0 +1,58 @@
+// Runs the kernel library (kernels/, see aslib/kernel_library.hpp) on the RTL, over several grid shapes
+
+#include "Vgpu_gpu.h"
+#include "kernel_library.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+#include "sim.hpp"
+#include <memory>
+#include <optional>
+
+constexpr auto INST_NUM_CHANNELS = Vgpu_gpu::INSTRUCTION_MEM_NUM_CHANNELS;
+constexpr auto DATA_NUM_CHANNELS = Vgpu_gpu::DATA_MEM_NUM_CHANNELS;
+constexpr auto MAX_CYCLES = 1'000'000u;
+constexpr auto NUM_ELEMENTS = 256u;
+
+// Runs every launch of the job, returns the data memory after the last one or nothing if one didn't finish
+auto run_rtl(const as::KernelJob& job, const sim::KernelObjectContents& image)
+    -> std::optional<sim::data_memory_container_t> {
+    auto memory = job.memory;
+    for (const auto& launch : job.launches) {
+        auto top = std::make_unique<Vgpu>();
+        auto data_mem = sim::make_data_memory<DATA_NUM_CHANNELS>(top.get());
+        auto instruction_mem = sim::make_instruction_memory<INST_NUM_CHANNELS>(top.get());
+        for (auto i = 0u; i < image.instructions.size(); i++) {
+            instruction_mem.memory[image.base_instructions_address + i] = image.instructions[i];
+        }
+        as::write_arguments(launch, memory);
+        data_mem.memory = std::move(memory);
+        sim::set_kernel_config(*top, image.base_instructions_address, 0, launch.num_blocks, launch.num_warps_per_block);
+        if (!sim::simulate_cycles(*top, instruction_mem, data_mem, MAX_CYCLES).has_value()) {
+            return std::nullopt;
+        }
+        memory = std::move(data_mem.memory);
+    }
+    return memory;
+}
+
+TEST_CASE("The kernel library runs on the RTL") {
+    REQUIRE_EQ(Vgpu_gpu::THREADS_PER_WARP, as::KERNEL_THREADS_PER_WARP);
+    for (const auto routine : as::KERNEL_ROUTINES) {
+        const auto image = as::link_kernel_routine(KERNELS_DIR, routine);
+        REQUIRE(image.has_value());
+        for (const auto num_blocks : {1u, 2u, 4u}) {
+            for (const auto num_warps : {1u, 2u}) {
+                CAPTURE(routine);
+                CAPTURE(num_blocks);
+                CAPTURE(num_warps);
+                const auto job = as::make_kernel_job(routine, NUM_ELEMENTS, num_blocks, num_warps);
+                REQUIRE(job.has_value());
+                const auto memory = run_rtl(*job, *image);
+                REQUIRE(memory.has_value());
+                for (const auto& error : as::check_kernel_job(*job, *memory)) {
+                    FAIL_CHECK(error);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,171 @@
+// Runs the full system tests (see full_system_test.cpp) through the functional executor alone
+// and through the sampled simulation, which switches from the executor to the RTL part way through the kernel.
+
+#include "Vgpu_gpu.h"
+#include "common.hpp"
+#include "data_reader.hpp"
+#include "emitter.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+#include "executor.hpp"
+#include "sampling.hpp"
+#include "sim.hpp"
+#include <filesystem>
+namespace fs = std::filesystem;
+
+using namespace sim::instructions;
+
+constexpr auto INST_NUM_CHANNELS = Vgpu_gpu::INSTRUCTION_MEM_NUM_CHANNELS;
+constexpr auto DATA_NUM_CHANNELS = Vgpu_gpu::DATA_MEM_NUM_CHANNELS;
+constexpr auto MAX_CYCLES = 10000u;
+
+struct Kernel {
+    sim::ExecutorConfig config;
+    std::vector<IData> program;
+    sim::data_memory_container_t data;
+    sim::data_memory_container_t expected;
+};
+
+auto load_kernel(const fs::path& test_dir, const std::string& test_name) -> Kernel {
+    const auto as_file = test_dir / (test_name + ".as");
+    const auto expected_file = test_dir / (test_name + ".expected");
+    const auto data_file = test_dir / (test_name + ".data");
+
+    auto kernel = Kernel{};
+
+    const auto expected = as::read_data(expected_file);
+    REQUIRE(expected.has_value());
+    kernel.expected = *expected;
+
+    if (fs::exists(data_file)) {
+        const auto data = as::read_data(data_file);
+        REQUIRE(data.has_value());
+        kernel.data = *data;
+    }
+
+    auto input_file = as::open_file(as_file);
+    REQUIRE(input_file.has_value());
+    const auto lines = as::get_lines(*input_file);
+    input_file->close();
+
+    const auto program_or_err = as::parse_program(lines);
+    REQUIRE(program_or_err.has_value());
+
+    const auto& [blocks, warps, instructions, label_mappings, globals] = program_or_err.value();
+    for (const auto& instruction : as::translate_to_binary(*program_or_err)) {
+        kernel.program.push_back(instruction.bits);
+    }
+
+    kernel.config = sim::ExecutorConfig{
+        .warps_per_core = Vgpu_gpu::WARPS_PER_CORE,
+        .threads_per_warp = Vgpu_gpu::THREADS_PER_WARP,
+        .base_instructions_address = 0,
+        .base_data_address = 0,
+        .num_blocks = blocks,
+        .num_warps_per_block = warps,
+    };
+    return kernel;
+}
+
+auto get_test_names() -> std::set<std::string> {
+    auto test_names = std::set<std::string>{};
+    for (const auto& entry : fs::directory_iterator(TESTS_DIR)) {
+        const auto file_name = entry.path().filename().string();
+        test_names.insert(file_name.substr(0, file_name.find('.')));
+    }
+    return test_names;
+}
+
+TEST_CASE("Executor runs the full system tests") {
+    for (const auto& test_name : get_test_names()) {
+        SUBCASE(std::format("Test: {}", test_name).c_str()) {
+            const auto kernel = load_kernel(TESTS_DIR, test_name);
+
+            auto executor = sim::Executor{kernel.config, kernel.program, kernel.data};
+            executor.run();
+
+            REQUIRE(executor.done());
+            auto& memory = executor.get_memory();
+            for (const auto& [address, value] : kernel.expected) {
+                CHECK(memory[address] == value);
+            }
+        }
+    }
+}
+
+TEST_CASE("Sampled simulation matches the expected memory") {
+    for (const auto& test_name : get_test_names()) {
+        for (const auto fast_forward : {0u, 1u, 2u, 3u}) {
+            SUBCASE(std::format("Test: {}, fast-forward: {}", test_name, fast_forward).c_str()) {
+                const auto kernel = load_kernel(TESTS_DIR, test_name);
+
+                auto executor = sim::Executor{kernel.config, kernel.program, kernel.data};
+                executor.run(sim::StopCondition{.max_instructions_per_warp = fast_forward, .marker_pc = {}});
+
+                auto gpu = Vgpu{};
+                auto data_mem = sim::make_data_memory<DATA_NUM_CHANNELS>(&gpu);
+                auto instruction_mem = sim::make_instruction_memory<INST_NUM_CHANNELS>(&gpu);
+                for (auto i = 0u; i < kernel.program.size(); i++) {
+                    instruction_mem.memory[i] = kernel.program[i];
+                }
+                sim::set_kernel_config(gpu, 0, 0, kernel.config.num_blocks, kernel.config.num_warps_per_block);
+
+                const auto result = sim::simulate_sampled(gpu, instruction_mem, data_mem, executor, MAX_CYCLES);
+
+                REQUIRE(result.done);
+                for (const auto& [address, value] : kernel.expected) {
+                    CHECK(data_mem[address] == value);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Sampled simulation injects registers") {
+    // Every thread accumulates into x5 and s5, the RTL only runs the last iteration
+    // A scalar store encodes to the branch opcode, so s5 is checked by using it as the execution mask
+    const auto program = std::vector<IData>{
+        (IData)addi(5_x, 5_x, 1),
+        (IData)addi(5_s, 5_s, 2).make_scalar(),
+        (IData)addi(5_x, 5_x, 1),
+        (IData)addi(5_s, 5_s, 2).make_scalar(),
+        (IData)add(6_x, 5_x, 1_x),
+        (IData)sw(1_x, 6_x, 0),
+        (IData)addi(1_s, 5_s, 0).make_scalar(),
+        (IData)sw(1_x, 1_x, 100),
+        (IData)halt(),
+    };
+    const auto config = sim::ExecutorConfig{
+        .warps_per_core = Vgpu_gpu::WARPS_PER_CORE,
+        .threads_per_warp = Vgpu_gpu::THREADS_PER_WARP,
+        .base_instructions_address = 0,
+        .base_data_address = 0,
+        .num_blocks = 1,
+        .num_warps_per_block = 1,
+    };
+
+    auto executor = sim::Executor{config, program};
+    executor.run(sim::StopCondition{.max_instructions_per_warp = {}, .marker_pc = 4u});
+
+    auto gpu = Vgpu{};
+    auto data_mem = sim::make_data_memory<DATA_NUM_CHANNELS>(&gpu);
+    auto instruction_mem = sim::make_instruction_memory<INST_NUM_CHANNELS>(&gpu);
+    for (auto i = 0u; i < program.size(); i++) {
+        instruction_mem.memory[i] = program[i];
+    }
+    sim::set_kernel_config(gpu, 0, 0, 1, 1);
+
+    const auto result = sim::simulate_sampled(gpu, instruction_mem, data_mem, executor, MAX_CYCLES);
+
+    REQUIRE(result.done);
+    CHECK(result.injection_cycles > 0);
+    const auto num_threads = Vgpu_gpu::WARPS_PER_CORE * Vgpu_gpu::THREADS_PER_WARP;
+    for (auto thread = 0u; thread < (IData)num_threads; thread++) {
+        CHECK(data_mem[thread] == thread + 2);
+    }
+    // s5 == 4 only leaves thread 2 of every warp active
+    CHECK(data_mem[100 + 2] == 2);
+    CHECK(data_mem[100 + 32 + 2] == 34);
+    CHECK(data_mem[100 + 1] == 0);
+}
@@ -0,0 +1,177 @@
+// Checks the approximate timing model (timing_model.hpp) against itself and against the RTL
+
+#include "Vgpu_gpu.h"
+#include "common.hpp"
+#include "emitter.hpp"
+#include "parser.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+#include "sim.hpp"
+#include "timing_model.hpp"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <unistd.h>
+namespace fs = std::filesystem;
+
+using namespace sim::instructions;
+
+constexpr auto NUM_CHANNELS = Vgpu_gpu::DATA_MEM_NUM_CHANNELS;
+constexpr auto MAX_CYCLES = 10000u;
+constexpr auto SHAPE = sim::GpuShape{.num_cores = Vgpu_gpu::NUM_CORES, .data_mem_channels = NUM_CHANNELS};
+
+auto make_config(IData num_blocks, IData num_warps) -> sim::ExecutorConfig {
+    return sim::ExecutorConfig{
+        .warps_per_core = Vgpu_gpu::WARPS_PER_CORE,
+        .threads_per_warp = Vgpu_gpu::THREADS_PER_WARP,
+        .base_instructions_address = 0,
+        .base_data_address = 0,
+        .num_blocks = num_blocks,
+        .num_warps_per_block = num_warps,
+    };
+}
+
+auto run_rtl(const sim::ExecutorConfig& config, const std::vector<IData>& program) -> std::optional<uint32_t> {
+    auto top = std::make_unique<Vgpu>();
+    auto data_mem = sim::make_data_memory<NUM_CHANNELS>(top.get());
+    auto instruction_mem = sim::make_instruction_memory<NUM_CHANNELS>(top.get());
+    for (auto i = 0u; i < program.size(); i++) {
+        instruction_mem.memory[i] = program[i];
+    }
+    sim::set_kernel_config(*top, 0, 0, config.num_blocks, config.num_warps_per_block);
+    return sim::simulate_cycles(*top, instruction_mem, data_mem, MAX_CYCLES);
+}
+
+auto alu_program(std::size_t length) -> std::vector<IData> {
+    auto program = std::vector<IData>(length, (IData)addi(5_x, 5_x, 1));
+    program.push_back((IData)halt());
+    return program;
+}
+
+auto memory_program(std::size_t stores) -> std::vector<IData> {
+    auto program = std::vector<IData>{};
+    for (auto i = 0u; i < stores; i++) {
+        program.push_back((IData)sw(1_x, 1_x, i << 5u));
+    }
+    program.push_back((IData)halt());
+    return program;
+}
+
+TEST_CASE("Traces follow the executed instructions") {
+    const auto program = std::vector<IData>{
+        (IData)sx_slti(1_s, 1_x, 5),
+        (IData)sw(1_x, 1_x, 0),
+        (IData)lw(5_s, 0_s, 32).make_scalar(),
+        (IData)halt(),
+    };
+    const auto trace = sim::trace_kernel(make_config(3, 1), program);
+
+    REQUIRE(trace.blocks.size() == 3);
+    for (const auto& block : trace.blocks) {
+        REQUIRE(block.size() == Vgpu_gpu::WARPS_PER_CORE);
+        for (auto warp_id = 0u; warp_id < block.size(); warp_id++) {
+            const auto& warp = block[warp_id];
+            REQUIRE(warp.size() == 4);
+            CHECK(warp[0].memory_requests == 0);
+            // Only the first warp has threads with an id below 5
+            CHECK(warp[1].memory_requests == (warp_id == 0 ? 5 : 0));
+            CHECK(warp[2].memory_requests == 1);
+            CHECK(warp[3].halt);
+        }
+    }
+}
+
+TEST_CASE("Timing model scales with the work") {
+    const auto short_alu = sim::model_cycles(sim::trace_kernel(make_config(1, 1), alu_program(10)), SHAPE);
+    const auto long_alu = sim::model_cycles(sim::trace_kernel(make_config(1, 1), alu_program(20)), SHAPE);
+    CHECK(long_alu > short_alu);
+
+    // Blocks beyond the number of cores run one after another
+    const auto parallel = sim::model_cycles(sim::trace_kernel(make_config(SHAPE.num_cores, 1), alu_program(10)), SHAPE);
+    const auto serial = sim::model_cycles(sim::trace_kernel(make_config(SHAPE.num_cores * 2, 1), alu_program(10)), SHAPE);
+    CHECK(parallel == short_alu);
+    CHECK(serial > parallel);
+
+    // A vector store is limited by the number of channels
+    const auto stores = sim::model_cycles(sim::trace_kernel(make_config(1, 1), memory_program(10)), SHAPE);
+    CHECK(stores > short_alu);
+
+    auto slow_memory = sim::TimingParameters{};
+    slow_memory.channel_occupancy *= 2;
+    CHECK(sim::model_cycles(sim::trace_kernel(make_config(1, 1), memory_program(10)), SHAPE, slow_memory) > stores);
+}
+
+TEST_CASE("Timing parameter files") {
+    const auto path = fs::temp_directory_path() / std::format("smol_gpu_{}_timing_parameters.txt", ::getpid());
+    auto write_file = [&](std::string_view contents) { std::ofstream{path} << contents; };
+
+    SUBCASE("Round trip") {
+        auto parameters = sim::TimingParameters{};
+        auto value = 11u;
+        for (const auto& [name, field] : sim::TIMING_PARAMETERS) {
+            parameters.*field = value++;
+        }
+        REQUIRE(sim::write_timing_parameters(path, parameters).has_value());
+        const auto read = sim::read_timing_parameters(path);
+        REQUIRE(read.has_value());
+        for (const auto& [name, field] : sim::TIMING_PARAMETERS) {
+            CHECK_MESSAGE((*read).*field == parameters.*field, name);
+        }
+    }
+
+    SUBCASE("Missing parameters keep their defaults") {
+        write_file("memory_latency 9\n\n");
+        const auto read = sim::read_timing_parameters(path);
+        REQUIRE(read.has_value());
+        CHECK_EQ(read->memory_latency, 9);
+        CHECK_EQ(read->fetch_cycles, sim::TimingParameters{}.fetch_cycles);
+    }
+
+    SUBCASE("Errors") {
+        for (const auto contents : {"fetch 3\n", "fetch_cycles\n", "fetch_cycles -1\n", "fetch_cycles 3 4\n"}) {
+            write_file(contents);
+            CHECK_FALSE_MESSAGE(sim::read_timing_parameters(path).has_value(), contents);
+        }
+        CHECK_FALSE(sim::read_timing_parameters(path.string() + ".missing").has_value());
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("Timing model is in the ballpark of the RTL") {
+    auto kernels = std::vector<std::pair<sim::ExecutorConfig, std::vector<IData>>>{
+        {make_config(1, 1), alu_program(20)},
+        {make_config(4, 2), alu_program(20)},
+        {make_config(1, 1), memory_program(4)},
+        {make_config(4, 2), memory_program(4)},
+    };
+
+    for (const auto& entry : fs::directory_iterator(TESTS_DIR)) {
+        if (entry.path().extension() != ".as") {
+            continue;
+        }
+        auto input_file = as::open_file(entry.path());
+        REQUIRE(input_file.has_value());
+        const auto lines = as::get_lines(*input_file);
+        input_file->close();
+        const auto program_or_err = as::parse_program(lines);
+        REQUIRE(program_or_err.has_value());
+
+        const auto& [blocks, warps, instructions, label_mappings, globals] = program_or_err.value();
+        auto program = std::vector<IData>{};
+        for (const auto& instruction : as::translate_to_binary(*program_or_err)) {
+            program.push_back(instruction.bits);
+        }
+        kernels.emplace_back(make_config(blocks, warps), program);
+    }
+
+    for (const auto& [config, program] : kernels) {
+        const auto rtl_cycles = run_rtl(config, program);
+        REQUIRE(rtl_cycles.has_value());
+
+        // The default parameters aren't fitted, they only need to get the order of magnitude right
+        const auto modeled = sim::model_cycles(sim::trace_kernel(config, program), SHAPE);
+        CHECK(modeled * 2 >= *rtl_cycles);
+        CHECK(modeled <= *rtl_cycles * 2);
+    }
+}